@@ -1,2 +1,280 @@
-//== Placeholder: No public interface ==--
+//======================================================================================================
+// Copyright 2015, NaturalPoint Inc.
+//======================================================================================================
+#pragma once
 
+// System includes
+#include <vector>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Core
+{
+    /// <summary>
+    /// Maximum clique search over a bitset adjacency matrix (branch and bound after Tomita).
+    ///
+    /// Candidate sets are bitsets, intersected with a vertex's adjacency row one word at a time.
+    /// Every node first prunes on the popcount of its candidates, then greedily colors them:
+    /// vertices of one color are pairwise unconnected, so a clique takes at most one of each and
+    /// the color count is a tighter bound. Candidates are expanded from the highest color down and
+    /// a branch ends as soon as its color bound no longer beats the best clique.
+    ///
+    /// A clique known in advance (e.g. last frame's answer) seeds the best, and a limit (the largest
+    /// clique possible, e.g. a rigid body's marker count) ends the search the moment it is reached,
+    /// so confirming a known answer costs a handful of bound checks.
+    /// </summary>
+    class cCliqueSearch
+    {
+    public:
+        cCliqueSearch() : mVertices( 0 ), mWords( 0 ), mLimit( 0 ), mNodes( 0 ) { }
+
+        /// <summary>Start a graph of the given number of vertices and no edges.</summary>
+        void            Reset( int vertices )
+        {
+            mVertices = std::max( vertices, 0 );
+            mWords = ( mVertices + 63 ) / 64;
+
+            mAdjacency.assign( mVertices * mWords, 0 );
+        }
+
+        void            Connect( int a, int b )
+        {
+            if( a == b )
+            {
+                return;
+            }
+
+            mAdjacency[a * mWords + ( b >> 6 )] |= 1ull << ( b & 63 );
+            mAdjacency[b * mWords + ( a >> 6 )] |= 1ull << ( a & 63 );
+        }
+
+        bool            Connected( int a, int b ) const { return ( ( mAdjacency[a * mWords + ( b >> 6 )] >> ( b & 63 ) ) & 1 ) != 0; }
+        int             VertexCount() const { return mVertices; }
+
+        /// <summary>
+        /// Largest clique of at least minimum vertices; the search ends once one of limit vertices is
+        /// found. Seed, if given, must be a clique. Returns the clique's size, 0 (and an empty clique)
+        /// if none reaches minimum.
+        /// </summary>
+        int             Search( std::vector<int>& clique, int minimum, int limit, const std::vector<int>* seed = 0 )
+        {
+            mLimit = std::min( std::max( limit, minimum ), mVertices );
+            mNodes = 0;
+
+            mCurrent.clear();
+            mBest.clear();
+
+            if( seed )
+            {
+                mBest = *seed;
+            }
+
+            // A clique can not be deeper than the limit, so neither can the search.
+            if( (int) mBest.size() < mLimit && mVertices > 0 )
+            {
+                mCandidates.assign( ( mLimit + 1 ) * mWords, 0 );
+                mScratch.resize( 2 * mWords );
+                mOrder.resize( ( mLimit + 1 ) * mVertices );
+                mBound.resize( ( mLimit + 1 ) * mVertices );
+
+                uint64* all = Candidates( 0 );
+
+                for( int v = 0; v < mVertices; ++v )
+                {
+                    all[v >> 6] |= 1ull << ( v & 63 );
+                }
+
+                Expand( 0 );
+            }
+
+            if( (int) mBest.size() < minimum )
+            {
+                mBest.clear();
+            }
+
+            clique = mBest;
+
+            return (int) clique.size();
+        }
+
+        /// <summary>Search tree nodes visited by the last Search().</summary>
+        long            NodeCount() const { return mNodes; }
+
+    private:
+        typedef unsigned long long uint64;
+
+        static int      CountBits( uint64 value )
+        {
+#if defined(_MSC_VER) && defined(_M_X64)
+            return (int) __popcnt64( value );
+#elif defined(_MSC_VER)
+            return (int) ( __popcnt( (unsigned int) value ) + __popcnt( (unsigned int) ( value >> 32 ) ) );
+#else
+            return __builtin_popcountll( value );
+#endif
+        }
+
+        static int      CountTrailingZeros( uint64 value )
+        {
+#if defined(_MSC_VER) && defined(_M_X64)
+            unsigned long index;
+            _BitScanForward64( &index, value );
+            return (int) index;
+#elif defined(_MSC_VER)
+            unsigned long index;
+
+            if( _BitScanForward( &index, (unsigned long) value ) )
+            {
+                return (int) index;
+            }
+
+            _BitScanForward( &index, (unsigned long) ( value >> 32 ) );
+            return (int) index + 32;
+#else
+            return __builtin_ctzll( value );
+#endif
+        }
+
+        const uint64*   Row( int vertex ) const { return &mAdjacency[vertex * mWords]; }
+        uint64*         Candidates( int depth ) { return &mCandidates[depth * mWords]; }
+
+        // Greedy sequential coloring: each color class takes every remaining candidate not adjacent
+        // to one already in it. The output is ordered by ascending color.
+        int             Color( int depth )
+        {
+            uint64* remaining = &mScratch[0];
+            uint64* available = &mScratch[mWords];
+            int* order = &mOrder[depth * mVertices];
+            int* bound = &mBound[depth * mVertices];
+            int count = 0;
+            int color = 0;
+            int left = 0;
+
+            const uint64* candidates = Candidates( depth );
+
+            for( int w = 0; w < mWords; ++w )
+            {
+                remaining[w] = candidates[w];
+                left += CountBits( candidates[w] );
+            }
+
+            while( left > 0 )
+            {
+                color++;
+
+                for( int w = 0; w < mWords; ++w )
+                {
+                    available[w] = remaining[w];
+                }
+
+                for( int w = 0; w < mWords; ++w )
+                {
+                    while( available[w] )
+                    {
+                        int v = w * 64 + CountTrailingZeros( available[w] );
+                        const uint64* row = Row( v );
+
+                        available[w] &= available[w] - 1;
+                        remaining[w] &= ~( 1ull << ( v & 63 ) );
+
+                        // Earlier words are already exhausted.
+                        for( int x = w; x < mWords; ++x )
+                        {
+                            available[x] &= ~row[x];
+                        }
+
+                        order[count] = v;
+                        bound[count] = color;
+                        count++;
+                        left--;
+                    }
+                }
+            }
+
+            return count;
+        }
+
+        void            Expand( int depth )
+        {
+            mNodes++;
+
+            uint64* candidates = Candidates( depth );
+            int current = (int) mCurrent.size();
+            int size = 0;
+
+            for( int w = 0; w < mWords; ++w )
+            {
+                size += CountBits( candidates[w] );
+            }
+
+            if( current + size <= (int) mBest.size() )
+            {
+                return;
+            }
+
+            int count = Color( depth );
+
+            const int* order = &mOrder[depth * mVertices];
+            const int* bound = &mBound[depth * mVertices];
+
+            for( int i = count - 1; i >= 0; --i )
+            {
+                if( current + bound[i] <= (int) mBest.size() )
+                {
+                    return;
+                }
+
+                int v = order[i];
+                const uint64* row = Row( v );
+                uint64* next = Candidates( depth + 1 );
+                bool any = false;
+
+                mCurrent.push_back( v );
+
+                if( depth + 1 < mLimit )
+                {
+                    for( int w = 0; w < mWords; ++w )
+                    {
+                        next[w] = candidates[w] & row[w];
+                        any |= next[w] != 0;
+                    }
+                }
+
+                if( any )
+                {
+                    Expand( depth + 1 );
+                }
+                else if( current + 1 > (int) mBest.size() )
+                {
+                    mBest = mCurrent;
+                }
+
+                mCurrent.pop_back();
+
+                if( (int) mBest.size() >= mLimit )
+                {
+                    return;
+                }
+
+                candidates[v >> 6] &= ~( 1ull << ( v & 63 ) );
+            }
+        }
+
+        int             mVertices;
+        int             mWords;                 // Per bitset.
+        std::vector<uint64> mAdjacency;         // [vertex * mWords + word]
+
+        // Search state.
+        std::vector<uint64> mCandidates;        // One bitset per depth.
+        std::vector<uint64> mScratch;           // Two bitsets for coloring.
+        std::vector<int> mOrder;                // Colored candidates, per depth.
+        std::vector<int> mBound;                // Their colors.
+        std::vector<int> mCurrent;
+        std::vector<int> mBest;
+        int             mLimit;
+        long            mNodes;
+    };
+}
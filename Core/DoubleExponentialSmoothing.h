@@ -1,2 +1,389 @@
-//== Placeholder: No public interface ==--
+//======================================================================================================
+// Copyright 2015, NaturalPoint Inc.
+//======================================================================================================
+#pragma once
 
+// System includes
+#include <math.h>
+#include <string.h>
+
+// The orientation update needs square roots, which compilers only vectorize when they may ignore
+// errno, so it has an explicit SSE2 path (x86/x64) next to the scalar one.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define DOUBLEEXPONENTIALSMOOTHING_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Core
+{
+    /// <summary>
+    /// A bank of Holt double-exponential smoothing filters for up to MaxEntities poses (position and
+    /// orientation). Each filter tracks a level and a trend:
+    ///
+    ///   level = alpha * input + (1 - alpha) * (level + trend)
+    ///   trend = beta * (level - previous level) + (1 - beta) * trend
+    ///
+    /// Orientation is filtered on the quaternion manifold: the trend is a per-frame rotation,
+    /// "level + trend" is that rotation applied to the level, and the blends are normalized
+    /// quaternion interpolations (always along the shorter arc), which match slerp to first order
+    /// for the small per-frame changes smoothing deals with.
+    ///
+    /// State is kept in fixed-size structure-of-arrays storage, so the bank never allocates and
+    /// Update() runs branch-free loops over all entities, four at a time with SSE2. Storage is padded
+    /// to whole blocks of four and lanes past Count() are masked, so every entity, even that of a
+    /// bank of one, goes through the vector loop. Fill the inputs with SetInput() and call Update()
+    /// once per frame.
+    /// </summary>
+    template <int MaxEntities>
+    class cDoubleExponentialSmoothing
+    {
+    public:
+        cDoubleExponentialSmoothing() : mCount( 0 )
+        {
+            SetPositionSmoothing( 0.5f, 0.5f );
+            SetRotationSmoothing( 0.5f, 0.5f );
+            Reset();
+        }
+
+        /// <summary>Alpha (level) and beta (trend) for all position axes, 1 passes the input through.</summary>
+        void            SetPositionSmoothing( float alpha, float beta )
+        {
+            for( int axis = 0; axis < 3; ++axis )
+            {
+                SetPositionSmoothing( axis, alpha, beta );
+            }
+        }
+
+        /// <summary>Alpha (level) and beta (trend) for one position axis (0-2 for x, y, z).</summary>
+        void            SetPositionSmoothing( int axis, float alpha, float beta )
+        {
+            mPositionAlpha[axis] = Clamp( alpha );
+            mPositionBeta[axis] = Clamp( beta );
+        }
+
+        /// <summary>Alpha (level) and beta (trend) for orientation.</summary>
+        void            SetRotationSmoothing( float alpha, float beta )
+        {
+            mRotationAlpha = Clamp( alpha );
+            mRotationBeta = Clamp( beta );
+        }
+
+        /// <summary>Number of entities Update() processes, at most MaxEntities.</summary>
+        void            SetCount( int count ) { mCount = ( count < 0 ) ? 0 : ( count > MaxEntities ) ? MaxEntities : count; }
+        int             Count() const { return mCount; }
+        static int      Capacity() { return MaxEntities; }
+
+        /// <summary>Forget all filter state, the next input of every entity is passed through.</summary>
+        void            Reset()
+        {
+            for( int i = 0; i < kLanes; ++i )
+            {
+                Reset( i );
+            }
+        }
+
+        /// <summary>Forget the state of one entity, e.g. when it is lost and found again.</summary>
+        void            Reset( int index )
+        {
+            mStarted[index] = 0;
+
+            for( int c = 0; c < 3; ++c )
+            {
+                mInputPosition[c][index] = 0;
+                mLevelPosition[c][index] = 0;
+                mTrendPosition[c][index] = 0;
+            }
+
+            for( int c = 0; c < 4; ++c )
+            {
+                mInputRotation[c][index] = ( c == 3 ) ? 1.0f : 0.0f;
+                mLevelRotation[c][index] = ( c == 3 ) ? 1.0f : 0.0f;
+                mTrendRotation[c][index] = ( c == 3 ) ? 1.0f : 0.0f;
+            }
+        }
+
+        /// <summary>Set the measurement of one entity for the next Update(). Rotation is x, y, z, w.</summary>
+        void            SetInput( int index, const float position[3], const float rotation[4] )
+        {
+            for( int c = 0; c < 3; ++c )
+            {
+                mInputPosition[c][index] = position[c];
+            }
+
+            for( int c = 0; c < 4; ++c )
+            {
+                mInputRotation[c][index] = rotation[c];
+            }
+        }
+
+        /// <summary>Advance every filter by one frame.</summary>
+        void            Update()
+        {
+            UpdatePosition();
+
+#ifdef DOUBLEEXPONENTIALSMOOTHING_SSE2
+            UpdateRotationSSE2();
+#else
+            UpdateRotation();
+#endif
+        }
+
+        /// <summary>Update() through the scalar loops alone, the reference the SSE2 path is checked against.</summary>
+        void            UpdateScalar()
+        {
+            UpdatePosition();
+            UpdateRotation();
+        }
+
+        /// <summary>Filtered position of one entity.</summary>
+        void            Position( int index, float position[3] ) const
+        {
+            for( int c = 0; c < 3; ++c )
+            {
+                position[c] = mLevelPosition[c][index];
+            }
+        }
+
+        /// <summary>Filtered orientation of one entity, x, y, z, w.</summary>
+        void            Rotation( int index, float rotation[4] ) const
+        {
+            for( int c = 0; c < 4; ++c )
+            {
+                rotation[c] = mLevelRotation[c][index];
+            }
+        }
+
+        /// <summary>Per-frame position change (trend) of one entity.</summary>
+        void            PositionTrend( int index, float trend[3] ) const
+        {
+            for( int c = 0; c < 3; ++c )
+            {
+                trend[c] = mTrendPosition[c][index];
+            }
+        }
+
+        /// <summary>Per-frame rotation (trend) of one entity, x, y, z, w.</summary>
+        void            RotationTrend( int index, float trend[4] ) const
+        {
+            for( int c = 0; c < 4; ++c )
+            {
+                trend[c] = mTrendRotation[c][index];
+            }
+        }
+
+    private:
+        // Whole blocks of four, so the vector loop never reads past the storage.
+        static const int kLanes = ( MaxEntities + 3 ) & ~3;
+
+        void            UpdatePosition()
+        {
+            const int count = mCount;
+
+            for( int c = 0; c < 3; ++c )
+            {
+                const float alpha = mPositionAlpha[c];
+                const float beta = mPositionBeta[c];
+
+                float* input = mInputPosition[c];
+                float* level = mLevelPosition[c];
+                float* trend = mTrendPosition[c];
+
+                for( int i = 0; i < count; ++i )
+                {
+                    // Entities that just started take the input as level and no trend.
+                    float started = mStarted[i];
+
+                    float predicted = level[i] + trend[i];
+                    float newLevel = alpha * input[i] + ( 1.0f - alpha ) * predicted;
+                    float newTrend = beta * ( newLevel - level[i] ) + ( 1.0f - beta ) * trend[i];
+
+                    level[i] = started * newLevel + ( 1.0f - started ) * input[i];
+                    trend[i] = started * newTrend;
+                }
+            }
+        }
+
+        // Orientation, one entity at a time.
+        void            UpdateRotation()
+        {
+            const int count = mCount;
+
+            const float alpha = mRotationAlpha;
+            const float beta = mRotationBeta;
+
+            float* ix = mInputRotation[0]; float* iy = mInputRotation[1]; float* iz = mInputRotation[2]; float* iw = mInputRotation[3];
+            float* lx = mLevelRotation[0]; float* ly = mLevelRotation[1]; float* lz = mLevelRotation[2]; float* lw = mLevelRotation[3];
+            float* tx = mTrendRotation[0]; float* ty = mTrendRotation[1]; float* tz = mTrendRotation[2]; float* tw = mTrendRotation[3];
+
+            for( int i = 0; i < count; ++i )
+            {
+                float started = mStarted[i];
+
+                // Predicted orientation: trend rotation applied to the level.
+                float px = tw[i] * lx[i] + tx[i] * lw[i] + ty[i] * lz[i] - tz[i] * ly[i];
+                float py = tw[i] * ly[i] - tx[i] * lz[i] + ty[i] * lw[i] + tz[i] * lx[i];
+                float pz = tw[i] * lz[i] + tx[i] * ly[i] - ty[i] * lx[i] + tz[i] * lw[i];
+                float pw = tw[i] * lw[i] - tx[i] * lx[i] - ty[i] * ly[i] - tz[i] * lz[i];
+
+                // Blend towards the input along the shorter arc.
+                float dot = px * ix[i] + py * iy[i] + pz * iz[i] + pw * iw[i];
+                float sign = ( dot < 0.0f ) ? -alpha : alpha;
+                float keep = 1.0f - alpha;
+
+                float nx = keep * px + sign * ix[i];
+                float ny = keep * py + sign * iy[i];
+                float nz = keep * pz + sign * iz[i];
+                float nw = keep * pw + sign * iw[i];
+
+                float scale = 1.0f / sqrtf( nx * nx + ny * ny + nz * nz + nw * nw + 1e-30f );
+
+                nx *= scale; ny *= scale; nz *= scale; nw *= scale;
+
+                // Rotation from the previous level to the new one: new * conjugate(old).
+                float dx = -nw * lx[i] + nx * lw[i] - ny * lz[i] + nz * ly[i];
+                float dy = -nw * ly[i] + nx * lz[i] + ny * lw[i] - nz * lx[i];
+                float dz = -nw * lz[i] - nx * ly[i] + ny * lx[i] + nz * lw[i];
+                float dw =  nw * lw[i] + nx * lx[i] + ny * ly[i] + nz * lz[i];
+
+                // Blend the trend towards it, both kept in the w >= 0 hemisphere.
+                float dSign = ( dw < 0.0f ) ? -beta : beta;
+                float tSign = ( tw[i] < 0.0f ) ? -( 1.0f - beta ) : ( 1.0f - beta );
+
+                float mx = tSign * tx[i] + dSign * dx;
+                float my = tSign * ty[i] + dSign * dy;
+                float mz = tSign * tz[i] + dSign * dz;
+                float mw = tSign * tw[i] + dSign * dw;
+
+                float trendScale = started / sqrtf( mx * mx + my * my + mz * mz + mw * mw + 1e-30f );
+
+                // Entities that just started take the input as level and the identity as trend.
+                float inputScale = ( 1.0f - started ) / sqrtf( ix[i] * ix[i] + iy[i] * iy[i] + iz[i] * iz[i] + iw[i] * iw[i] + 1e-30f );
+
+                lx[i] = started * nx + inputScale * ix[i];
+                ly[i] = started * ny + inputScale * iy[i];
+                lz[i] = started * nz + inputScale * iz[i];
+                lw[i] = started * nw + inputScale * iw[i];
+
+                tx[i] = trendScale * mx;
+                ty[i] = trendScale * my;
+                tz[i] = trendScale * mz;
+                tw[i] = trendScale * mw + ( 1.0f - started );
+
+                mStarted[i] = 1.0f;
+            }
+        }
+
+#ifdef DOUBLEEXPONENTIALSMOOTHING_SSE2
+        // Orientation, four entities at a time over the padded storage.
+        void            UpdateRotationSSE2()
+        {
+            const int count = mCount;
+
+            const float alpha = mRotationAlpha;
+            const float beta = mRotationBeta;
+
+            float* ix = mInputRotation[0]; float* iy = mInputRotation[1]; float* iz = mInputRotation[2]; float* iw = mInputRotation[3];
+            float* lx = mLevelRotation[0]; float* ly = mLevelRotation[1]; float* lz = mLevelRotation[2]; float* lw = mLevelRotation[3];
+            float* tx = mTrendRotation[0]; float* ty = mTrendRotation[1]; float* tz = mTrendRotation[2]; float* tw = mTrendRotation[3];
+
+            const __m128 one = _mm_set1_ps( 1.0f );
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 tiny = _mm_set1_ps( 1e-30f );
+            const __m128 signBit = _mm_set1_ps( -0.0f );
+            const __m128 alpha4 = _mm_set1_ps( alpha );
+            const __m128 keep4 = _mm_set1_ps( 1.0f - alpha );
+            const __m128 beta4 = _mm_set1_ps( beta );
+            const __m128 keepBeta4 = _mm_set1_ps( 1.0f - beta );
+
+            const __m128 lane = _mm_set_ps( 3.0f, 2.0f, 1.0f, 0.0f );
+            const __m128 count4 = _mm_set1_ps( (float) count );
+
+            for( int i = 0; i < count; i += 4 )
+            {
+                // Lanes past the count keep their state.
+                __m128 active = _mm_cmplt_ps( _mm_add_ps( _mm_set1_ps( (float) i ), lane ), count4 );
+                __m128 started = _mm_loadu_ps( mStarted + i );
+
+                __m128 inX = _mm_loadu_ps( ix + i ), inY = _mm_loadu_ps( iy + i ), inZ = _mm_loadu_ps( iz + i ), inW = _mm_loadu_ps( iw + i );
+                __m128 lvX = _mm_loadu_ps( lx + i ), lvY = _mm_loadu_ps( ly + i ), lvZ = _mm_loadu_ps( lz + i ), lvW = _mm_loadu_ps( lw + i );
+                __m128 trX = _mm_loadu_ps( tx + i ), trY = _mm_loadu_ps( ty + i ), trZ = _mm_loadu_ps( tz + i ), trW = _mm_loadu_ps( tw + i );
+
+                __m128 px = _mm_sub_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( trW, lvX ), _mm_mul_ps( trX, lvW ) ), _mm_mul_ps( trY, lvZ ) ), _mm_mul_ps( trZ, lvY ) );
+                __m128 py = _mm_add_ps( _mm_add_ps( _mm_sub_ps( _mm_mul_ps( trW, lvY ), _mm_mul_ps( trX, lvZ ) ), _mm_mul_ps( trY, lvW ) ), _mm_mul_ps( trZ, lvX ) );
+                __m128 pz = _mm_add_ps( _mm_sub_ps( _mm_add_ps( _mm_mul_ps( trW, lvZ ), _mm_mul_ps( trX, lvY ) ), _mm_mul_ps( trY, lvX ) ), _mm_mul_ps( trZ, lvW ) );
+                __m128 pw = _mm_sub_ps( _mm_sub_ps( _mm_sub_ps( _mm_mul_ps( trW, lvW ), _mm_mul_ps( trX, lvX ) ), _mm_mul_ps( trY, lvY ) ), _mm_mul_ps( trZ, lvZ ) );
+
+                __m128 dot = Dot( px, py, pz, pw, inX, inY, inZ, inW );
+                __m128 sign = _mm_xor_ps( alpha4, _mm_and_ps( _mm_cmplt_ps( dot, zero ), signBit ) );
+
+                __m128 nx = _mm_add_ps( _mm_mul_ps( keep4, px ), _mm_mul_ps( sign, inX ) );
+                __m128 ny = _mm_add_ps( _mm_mul_ps( keep4, py ), _mm_mul_ps( sign, inY ) );
+                __m128 nz = _mm_add_ps( _mm_mul_ps( keep4, pz ), _mm_mul_ps( sign, inZ ) );
+                __m128 nw = _mm_add_ps( _mm_mul_ps( keep4, pw ), _mm_mul_ps( sign, inW ) );
+
+                __m128 scale = _mm_div_ps( one, _mm_sqrt_ps( _mm_add_ps( Dot( nx, ny, nz, nw, nx, ny, nz, nw ), tiny ) ) );
+
+                nx = _mm_mul_ps( nx, scale ); ny = _mm_mul_ps( ny, scale ); nz = _mm_mul_ps( nz, scale ); nw = _mm_mul_ps( nw, scale );
+
+                __m128 dx = _mm_add_ps( _mm_sub_ps( _mm_sub_ps( _mm_mul_ps( nx, lvW ), _mm_mul_ps( nw, lvX ) ), _mm_mul_ps( ny, lvZ ) ), _mm_mul_ps( nz, lvY ) );
+                __m128 dy = _mm_sub_ps( _mm_add_ps( _mm_sub_ps( _mm_mul_ps( nx, lvZ ), _mm_mul_ps( nw, lvY ) ), _mm_mul_ps( ny, lvW ) ), _mm_mul_ps( nz, lvX ) );
+                __m128 dz = _mm_add_ps( _mm_add_ps( _mm_sub_ps( _mm_xor_ps( _mm_mul_ps( nw, lvZ ), signBit ), _mm_mul_ps( nx, lvY ) ), _mm_mul_ps( ny, lvX ) ), _mm_mul_ps( nz, lvW ) );
+                __m128 dw = Dot( nw, nx, ny, nz, lvW, lvX, lvY, lvZ );
+
+                __m128 dSign = _mm_xor_ps( beta4, _mm_and_ps( _mm_cmplt_ps( dw, zero ), signBit ) );
+                __m128 tSign = _mm_xor_ps( keepBeta4, _mm_and_ps( _mm_cmplt_ps( trW, zero ), signBit ) );
+
+                __m128 mx = _mm_add_ps( _mm_mul_ps( tSign, trX ), _mm_mul_ps( dSign, dx ) );
+                __m128 my = _mm_add_ps( _mm_mul_ps( tSign, trY ), _mm_mul_ps( dSign, dy ) );
+                __m128 mz = _mm_add_ps( _mm_mul_ps( tSign, trZ ), _mm_mul_ps( dSign, dz ) );
+                __m128 mw = _mm_add_ps( _mm_mul_ps( tSign, trW ), _mm_mul_ps( dSign, dw ) );
+
+                __m128 fresh = _mm_sub_ps( one, started );
+                __m128 trendScale = _mm_div_ps( started, _mm_sqrt_ps( _mm_add_ps( Dot( mx, my, mz, mw, mx, my, mz, mw ), tiny ) ) );
+                __m128 inputScale = _mm_div_ps( fresh, _mm_sqrt_ps( _mm_add_ps( Dot( inX, inY, inZ, inW, inX, inY, inZ, inW ), tiny ) ) );
+
+                _mm_storeu_ps( lx + i, Select( active, _mm_add_ps( _mm_mul_ps( started, nx ), _mm_mul_ps( inputScale, inX ) ), lvX ) );
+                _mm_storeu_ps( ly + i, Select( active, _mm_add_ps( _mm_mul_ps( started, ny ), _mm_mul_ps( inputScale, inY ) ), lvY ) );
+                _mm_storeu_ps( lz + i, Select( active, _mm_add_ps( _mm_mul_ps( started, nz ), _mm_mul_ps( inputScale, inZ ) ), lvZ ) );
+                _mm_storeu_ps( lw + i, Select( active, _mm_add_ps( _mm_mul_ps( started, nw ), _mm_mul_ps( inputScale, inW ) ), lvW ) );
+
+                _mm_storeu_ps( tx + i, Select( active, _mm_mul_ps( trendScale, mx ), trX ) );
+                _mm_storeu_ps( ty + i, Select( active, _mm_mul_ps( trendScale, my ), trY ) );
+                _mm_storeu_ps( tz + i, Select( active, _mm_mul_ps( trendScale, mz ), trZ ) );
+                _mm_storeu_ps( tw + i, Select( active, _mm_add_ps( _mm_mul_ps( trendScale, mw ), fresh ), trW ) );
+
+                _mm_storeu_ps( mStarted + i, Select( active, one, started ) );
+            }
+        }
+
+        static __m128   Select( __m128 mask, __m128 a, __m128 b ) { return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) ); }
+
+        static __m128   Dot( __m128 ax, __m128 ay, __m128 az, __m128 aw, __m128 bx, __m128 by, __m128 bz, __m128 bw )
+        {
+            // Summed left to right as the scalar loop does, so both paths round alike.
+            return _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( ax, bx ), _mm_mul_ps( ay, by ) ), _mm_mul_ps( az, bz ) ), _mm_mul_ps( aw, bw ) );
+        }
+#endif
+
+        static float    Clamp( float value ) { return ( value < 0.0f ) ? 0.0f : ( value > 1.0f ) ? 1.0f : value; }
+
+        int             mCount;
+
+        float           mPositionAlpha[3];
+        float           mPositionBeta[3];
+        float           mRotationAlpha;
+        float           mRotationBeta;
+
+        // 1 once an entity has been through Update(), as a float so the filter loops stay branch-free.
+        float           mStarted[kLanes];
+
+        // Structure of arrays, [component][entity].
+        float           mInputPosition[3][kLanes];
+        float           mLevelPosition[3][kLanes];
+        float           mTrendPosition[3][kLanes];
+
+        float           mInputRotation[4][kLanes];
+        float           mLevelRotation[4][kLanes];
+        float           mTrendRotation[4][kLanes];
+    };
+}
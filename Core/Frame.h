@@ -61,7 +61,9 @@ namespace Core
             Packet,
             ObjectOnly,
             Original,
-            TinyObjectOnly
+            TinyObjectOnly,
+            DeltaObjectOnly,
+            LosslessGrayscale
         };
 
         virtual eCompressedFrameTypes CompressionType() const = 0;
@@ -0,0 +1,549 @@
+//======================================================================================================
+// Copyright 2015, NaturalPoint Inc.
+//======================================================================================================
+#pragma once
+
+// System includes
+#include <math.h>
+
+// Local includes
+#include "Core/RotationVector.h"
+
+namespace Core
+{
+    /// <summary>
+    /// Fixed-size matrix for Kalman filtering. Dimensions are template parameters, so filters built
+    /// from it live entirely in their owner's storage and never touch the heap.
+    /// </summary>
+    template <int Rows, int Cols>
+    class cKalmanMatrix
+    {
+    public:
+        double          m[Rows][Cols];
+
+        double&         operator()( int row, int col ) { return m[row][col]; }
+        double          operator()( int row, int col ) const { return m[row][col]; }
+
+        void            SetZero()
+        {
+            for( int r = 0; r < Rows; ++r )
+                for( int c = 0; c < Cols; ++c )
+                    m[r][c] = 0;
+        }
+
+        void            SetIdentity( double diagonal = 1.0 )
+        {
+            SetZero();
+
+            for( int i = 0; i < Rows && i < Cols; ++i )
+            {
+                m[i][i] = diagonal;
+            }
+        }
+    };
+
+    /// <summary>result = a * b</summary>
+    template <int N, int K, int M>
+    inline void KalmanMultiply( const cKalmanMatrix<N, K>& a, const cKalmanMatrix<K, M>& b, cKalmanMatrix<N, M>& result )
+    {
+        for( int r = 0; r < N; ++r )
+        {
+            for( int c = 0; c < M; ++c )
+            {
+                double sum = 0;
+
+                for( int k = 0; k < K; ++k )
+                {
+                    sum += a.m[r][k] * b.m[k][c];
+                }
+
+                result.m[r][c] = sum;
+            }
+        }
+    }
+
+    /// <summary>result = a * transpose(b)</summary>
+    template <int N, int K, int M>
+    inline void KalmanMultiplyTransposed( const cKalmanMatrix<N, K>& a, const cKalmanMatrix<M, K>& b, cKalmanMatrix<N, M>& result )
+    {
+        for( int r = 0; r < N; ++r )
+        {
+            for( int c = 0; c < M; ++c )
+            {
+                double sum = 0;
+
+                for( int k = 0; k < K; ++k )
+                {
+                    sum += a.m[r][k] * b.m[c][k];
+                }
+
+                result.m[r][c] = sum;
+            }
+        }
+    }
+
+    /// <summary>
+    /// Inverse of a symmetric positive definite matrix by Cholesky decomposition. Returns false
+    /// (leaving the result undefined) if the matrix is not positive definite.
+    /// </summary>
+    template <int N>
+    inline bool KalmanInverseSPD( const cKalmanMatrix<N, N>& a, cKalmanMatrix<N, N>& result )
+    {
+        // a = L * transpose(L)
+        double l[N][N];
+
+        for( int r = 0; r < N; ++r )
+        {
+            for( int c = 0; c <= r; ++c )
+            {
+                double sum = a.m[r][c];
+
+                for( int k = 0; k < c; ++k )
+                {
+                    sum -= l[r][k] * l[c][k];
+                }
+
+                if( r == c )
+                {
+                    if( sum <= 0 )
+                    {
+                        return false;
+                    }
+
+                    l[r][r] = sqrt( sum );
+                }
+                else
+                {
+                    l[r][c] = sum / l[c][c];
+                }
+            }
+        }
+
+        // inverse(L), lower triangular
+        double li[N][N];
+
+        for( int c = 0; c < N; ++c )
+        {
+            for( int r = 0; r < N; ++r )
+            {
+                if( r < c )
+                {
+                    li[r][c] = 0;
+                    continue;
+                }
+
+                double sum = ( r == c ) ? 1.0 : 0.0;
+
+                for( int k = c; k < r; ++k )
+                {
+                    sum -= l[r][k] * li[k][c];
+                }
+
+                li[r][c] = sum / l[r][r];
+            }
+        }
+
+        // inverse(a) = transpose(inverse(L)) * inverse(L)
+        for( int r = 0; r < N; ++r )
+        {
+            for( int c = r; c < N; ++c )
+            {
+                double sum = 0;
+
+                for( int k = c; k < N; ++k )
+                {
+                    sum += li[k][r] * li[k][c];
+                }
+
+                result.m[r][c] = sum;
+                result.m[c][r] = sum;
+            }
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Linear Kalman filter with StateSize states and MeasurementSize measurements, the model
+    /// matrices are passed to each Predict() / Update() call.
+    /// </summary>
+    template <int StateSize, int MeasurementSize>
+    class cKalmanFilter
+    {
+    public:
+        typedef cKalmanMatrix<StateSize, 1>                 State;
+        typedef cKalmanMatrix<StateSize, StateSize>         Covariance;
+        typedef cKalmanMatrix<MeasurementSize, 1>           Measurement;
+        typedef cKalmanMatrix<MeasurementSize, StateSize>   MeasurementModel;
+        typedef cKalmanMatrix<MeasurementSize, MeasurementSize> MeasurementCovariance;
+
+        cKalmanFilter() : mNormalizedInnovation( 0 )
+        {
+            X.SetZero();
+            P.SetIdentity();
+        }
+
+        /// <summary>State estimate.</summary>
+        State           X;
+
+        /// <summary>State covariance.</summary>
+        Covariance      P;
+
+        /// <summary>x = F x, P = F P transpose(F) + Q</summary>
+        void            Predict( const Covariance& F, const Covariance& Q )
+        {
+            State x;
+            KalmanMultiply( F, X, x );
+            X = x;
+
+            Covariance fp;
+            KalmanMultiply( F, P, fp );
+            KalmanMultiplyTransposed( fp, F, P );
+
+            for( int r = 0; r < StateSize; ++r )
+                for( int c = 0; c < StateSize; ++c )
+                    P.m[r][c] += Q.m[r][c];
+        }
+
+        /// <summary>
+        /// Correct the estimate with measurement z = H x + noise of covariance R. Returns false and
+        /// leaves the state alone if the innovation covariance is degenerate.
+        /// </summary>
+        bool            Update( const Measurement& z, const MeasurementModel& H, const MeasurementCovariance& R )
+        {
+            // Innovation y = z - H x, S = H P transpose(H) + R
+            Measurement hx;
+            KalmanMultiply( H, X, hx );
+
+            Measurement y;
+
+            for( int i = 0; i < MeasurementSize; ++i )
+            {
+                y.m[i][0] = z.m[i][0] - hx.m[i][0];
+            }
+
+            cKalmanMatrix<MeasurementSize, StateSize> hp;
+            KalmanMultiply( H, P, hp );
+
+            MeasurementCovariance s;
+            KalmanMultiplyTransposed( hp, H, s );
+
+            for( int r = 0; r < MeasurementSize; ++r )
+                for( int c = 0; c < MeasurementSize; ++c )
+                    s.m[r][c] += R.m[r][c];
+
+            MeasurementCovariance sInverse;
+
+            if( !KalmanInverseSPD( s, sInverse ) )
+            {
+                return false;
+            }
+
+            // Gain K = P transpose(H) inverse(S) = transpose(H P) inverse(S), P being symmetric.
+            cKalmanMatrix<StateSize, MeasurementSize> k;
+
+            for( int r = 0; r < StateSize; ++r )
+            {
+                for( int c = 0; c < MeasurementSize; ++c )
+                {
+                    double sum = 0;
+
+                    for( int i = 0; i < MeasurementSize; ++i )
+                    {
+                        sum += hp.m[i][r] * sInverse.m[i][c];
+                    }
+
+                    k.m[r][c] = sum;
+                }
+            }
+
+            // x += K y, P -= K H P
+            for( int r = 0; r < StateSize; ++r )
+            {
+                double sum = 0;
+
+                for( int i = 0; i < MeasurementSize; ++i )
+                {
+                    sum += k.m[r][i] * y.m[i][0];
+                }
+
+                X.m[r][0] += sum;
+            }
+
+            Covariance khp;
+            KalmanMultiply( k, hp, khp );
+
+            for( int r = 0; r < StateSize; ++r )
+            {
+                for( int c = r; c < StateSize; ++c )
+                {
+                    // Keep P symmetric against round-off.
+                    double value = 0.5 * ( ( P.m[r][c] - khp.m[r][c] ) + ( P.m[c][r] - khp.m[c][r] ) );
+
+                    P.m[r][c] = value;
+                    P.m[c][r] = value;
+                }
+            }
+
+            // Squared Mahalanobis distance of the innovation, for gating and noise adaptation.
+            double nis = 0;
+
+            for( int r = 0; r < MeasurementSize; ++r )
+                for( int c = 0; c < MeasurementSize; ++c )
+                    nis += y.m[r][0] * sInverse.m[r][c] * y.m[c][0];
+
+            mNormalizedInnovation = nis;
+
+            return true;
+        }
+
+        /// <summary>Squared normalized innovation of the last successful Update().</summary>
+        double          NormalizedInnovation() const { return mNormalizedInnovation; }
+
+    private:
+        double          mNormalizedInnovation;
+    };
+
+    /// <summary>
+    /// Constant velocity model in Dimensions axes: state is position then velocity, the measurement
+    /// is the position. Process noise is white acceleration with the given spectral density
+    /// (units^2/s^3), measurement noise is an isotropic variance per update.
+    /// </summary>
+    template <int Dimensions>
+    class cConstantVelocityKalman
+    {
+    public:
+        enum
+        {
+            StateSize = 2 * Dimensions
+        };
+
+        cConstantVelocityKalman() : mProcessNoise( 1.0 ), mInitialVelocityVariance( 1.0 ), mStarted( false )
+        {
+        }
+
+        /// <summary>White acceleration spectral density, larger follows manoeuvres more closely.</summary>
+        void            SetProcessNoise( double density ) { mProcessNoise = density; }
+
+        /// <summary>Velocity uncertainty of a freshly started track.</summary>
+        void            SetInitialVelocityVariance( double variance ) { mInitialVelocityVariance = variance; }
+
+        /// <summary>True once the track was started by its first measurement.</summary>
+        bool            Started() const { return mStarted; }
+
+        /// <summary>Forget the track, the next measurement starts it again.</summary>
+        void            Reset() { mStarted = false; }
+
+        /// <summary>Start at the given position with no velocity.</summary>
+        void            Start( const double position[Dimensions], double variance )
+        {
+            mFilter.X.SetZero();
+            mFilter.P.SetZero();
+
+            for( int i = 0; i < Dimensions; ++i )
+            {
+                mFilter.X.m[i][0] = position[i];
+                mFilter.P.m[i][i] = variance;
+                mFilter.P.m[Dimensions + i][Dimensions + i] = mInitialVelocityVariance;
+            }
+
+            mStarted = true;
+        }
+
+        /// <summary>Advance the model by dt seconds.</summary>
+        void            Predict( double dt )
+        {
+            if( !mStarted || dt <= 0 )
+            {
+                return;
+            }
+
+            typename cKalmanFilter<StateSize, Dimensions>::Covariance f;
+            typename cKalmanFilter<StateSize, Dimensions>::Covariance q;
+
+            f.SetIdentity();
+            q.SetZero();
+
+            const double q11 = mProcessNoise * dt * dt * dt / 3.0;
+            const double q12 = mProcessNoise * dt * dt / 2.0;
+            const double q22 = mProcessNoise * dt;
+
+            for( int i = 0; i < Dimensions; ++i )
+            {
+                const int v = Dimensions + i;
+
+                f.m[i][v] = dt;
+
+                q.m[i][i] = q11;
+                q.m[i][v] = q12;
+                q.m[v][i] = q12;
+                q.m[v][v] = q22;
+            }
+
+            mFilter.Predict( f, q );
+        }
+
+        /// <summary>Correct with a position measurement of the given variance, starting the track if needed.</summary>
+        bool            Update( const double position[Dimensions], double variance )
+        {
+            if( !mStarted )
+            {
+                Start( position, variance );
+                return true;
+            }
+
+            typename cKalmanFilter<StateSize, Dimensions>::Measurement z;
+            typename cKalmanFilter<StateSize, Dimensions>::MeasurementModel h;
+            typename cKalmanFilter<StateSize, Dimensions>::MeasurementCovariance r;
+
+            h.SetZero();
+            r.SetIdentity( variance );
+
+            for( int i = 0; i < Dimensions; ++i )
+            {
+                z.m[i][0] = position[i];
+                h.m[i][i] = 1.0;
+            }
+
+            return mFilter.Update( z, h, r );
+        }
+
+        void            Position( double position[Dimensions] ) const
+        {
+            for( int i = 0; i < Dimensions; ++i )
+            {
+                position[i] = mFilter.X.m[i][0];
+            }
+        }
+
+        void            Velocity( double velocity[Dimensions] ) const
+        {
+            for( int i = 0; i < Dimensions; ++i )
+            {
+                velocity[i] = mFilter.X.m[Dimensions + i][0];
+            }
+        }
+
+        /// <summary>Shift the position estimate, used by filters that re-anchor their coordinates.</summary>
+        void            OffsetPosition( const double offset[Dimensions] )
+        {
+            for( int i = 0; i < Dimensions; ++i )
+            {
+                mFilter.X.m[i][0] += offset[i];
+            }
+        }
+
+        double          NormalizedInnovation() const { return mFilter.NormalizedInnovation(); }
+
+        const cKalmanFilter<StateSize, Dimensions>& Filter() const { return mFilter; }
+
+    private:
+        cKalmanFilter<StateSize, Dimensions> mFilter;
+        double          mProcessNoise;
+        double          mInitialVelocityVariance;
+        bool            mStarted;
+    };
+
+    /// <summary>
+    /// Constant angular velocity orientation filter. The state is a rotation vector relative to a
+    /// reference orientation plus the angular velocity (world frame, radians per second); after
+    /// every update the estimated rotation is folded into the reference, so the linear filter only
+    /// ever sees small angles. Quaternions are x, y, z, w.
+    /// </summary>
+    class cOrientationKalman
+    {
+    public:
+        cOrientationKalman()
+        {
+            mReference[0] = mReference[1] = mReference[2] = 0;
+            mReference[3] = 1;
+        }
+
+        void            SetProcessNoise( double density ) { mFilter.SetProcessNoise( density ); }
+        void            SetInitialVelocityVariance( double variance ) { mFilter.SetInitialVelocityVariance( variance ); }
+
+        bool            Started() const { return mFilter.Started(); }
+        void            Reset() { mFilter.Reset(); }
+
+        void            Predict( double dt ) { mFilter.Predict( dt ); }
+
+        /// <summary>Correct with a measured orientation of the given variance (radians^2).</summary>
+        bool            Update( const double quaternion[4], double variance )
+        {
+            if( !mFilter.Started() )
+            {
+                double length = sqrt( quaternion[0] * quaternion[0] + quaternion[1] * quaternion[1] +
+                    quaternion[2] * quaternion[2] + quaternion[3] * quaternion[3] );
+
+                for( int i = 0; i < 4; ++i )
+                {
+                    mReference[i] = ( length > 0 ) ? quaternion[i] / length : ( i == 3 ? 1.0 : 0.0 );
+                }
+
+                const double zero[3] = { 0, 0, 0 };
+                mFilter.Start( zero, variance );
+                return true;
+            }
+
+            // Measurement as a rotation vector relative to the reference.
+            double inverse[4] = { -mReference[0], -mReference[1], -mReference[2], mReference[3] };
+            double relative[4];
+            double measured[3];
+
+            MultiplyQuaternions( quaternion, inverse, relative );
+            QuaternionToRotationVector( relative, measured );
+
+            if( !mFilter.Update( measured, variance ) )
+            {
+                return false;
+            }
+
+            Rebase();
+            return true;
+        }
+
+        /// <summary>Current orientation estimate.</summary>
+        void            Rotation( double quaternion[4] ) const
+        {
+            double offset[3];
+            mFilter.Position( offset );
+
+            double delta[4];
+            RotationVectorToQuaternion( offset, delta );
+            MultiplyQuaternions( delta, mReference, quaternion );
+        }
+
+        /// <summary>Angular velocity, world frame, radians per second.</summary>
+        void            AngularVelocity( double velocity[3] ) const { mFilter.Velocity( velocity ); }
+
+        double          NormalizedInnovation() const { return mFilter.NormalizedInnovation(); }
+
+    private:
+        // Fold the estimated rotation vector into the reference and zero it.
+        void            Rebase()
+        {
+            double offset[3];
+            mFilter.Position( offset );
+
+            double delta[4];
+            double reference[4];
+
+            RotationVectorToQuaternion( offset, delta );
+            MultiplyQuaternions( delta, mReference, reference );
+
+            double length = sqrt( reference[0] * reference[0] + reference[1] * reference[1] +
+                reference[2] * reference[2] + reference[3] * reference[3] );
+
+            for( int i = 0; i < 4; ++i )
+            {
+                mReference[i] = reference[i] / length;
+            }
+
+            double negate[3] = { -offset[0], -offset[1], -offset[2] };
+            mFilter.OffsetPosition( negate );
+        }
+
+        cConstantVelocityKalman<3> mFilter;
+        double          mReference[4];
+    };
+}
@@ -0,0 +1,82 @@
+//======================================================================================================
+// Copyright 2015, NaturalPoint Inc.
+//======================================================================================================
+#pragma once
+
+// System includes
+#include <math.h>
+
+namespace Core
+{
+    /// <summary>
+    /// Quaternion helpers on plain double[4] arrays (x, y, z, w) for the filters and predictors that
+    /// work in rotation vectors: a rotation vector is the rotation axis scaled by its angle in
+    /// radians, which turns small orientation changes into something a linear model can handle.
+    /// </summary>
+
+    /// <summary>Hamilton product a * b (b applied first).</summary>
+    inline void     MultiplyQuaternions( const double a[4], const double b[4], double result[4] )
+    {
+        double x = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+        double y = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+        double z = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+        double w = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+
+        result[0] = x;
+        result[1] = y;
+        result[2] = z;
+        result[3] = w;
+    }
+
+    /// <summary>Rotation vector of a unit quaternion, taking the short way round.</summary>
+    inline void     QuaternionToRotationVector( const double q[4], double vector[3] )
+    {
+        double sign = ( q[3] < 0 ) ? -1.0 : 1.0;
+        double s = sqrt( q[0] * q[0] + q[1] * q[1] + q[2] * q[2] );
+        double scale = ( s < 1e-12 ) ? 2.0 : 2.0 * atan2( s, sign * q[3] ) / s;
+
+        for( int i = 0; i < 3; ++i )
+        {
+            vector[i] = sign * scale * q[i];
+        }
+    }
+
+    inline void     RotationVectorToQuaternion( const double vector[3], double q[4] )
+    {
+        double angle = sqrt( vector[0] * vector[0] + vector[1] * vector[1] + vector[2] * vector[2] );
+        double scale = ( angle < 1e-12 ) ? 0.5 : sin( 0.5 * angle ) / angle;
+
+        for( int i = 0; i < 3; ++i )
+        {
+            q[i] = scale * vector[i];
+        }
+
+        q[3] = cos( 0.5 * angle );
+    }
+
+    /// <summary>Scale to unit length, the identity if there is no length to scale.</summary>
+    inline void     NormalizeQuaternion( double q[4] )
+    {
+        double length = sqrt( q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3] );
+
+        if( length < 1e-12 )
+        {
+            q[0] = q[1] = q[2] = 0;
+            q[3] = 1;
+            return;
+        }
+
+        for( int i = 0; i < 4; ++i )
+        {
+            q[i] /= length;
+        }
+    }
+
+    /// <summary>Angle in radians between two unit quaternions, 0 to pi.</summary>
+    inline double   QuaternionAngle( const double a[4], const double b[4] )
+    {
+        double dot = fabs( a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3] );
+
+        return 2.0 * acos( ( dot > 1.0 ) ? 1.0 : dot );
+    }
+}
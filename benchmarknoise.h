@@ -0,0 +1,50 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Repeatable noise for the Benchmark() statics: a xorshift32 generator, seeded per benchmark
+//== so each one replays the same scene from run to run and machine to machine.  Uniform values
+//== take the top 24 bits, Normal() is the sum of four uniforms scaled to unit variance, close
+//== enough to Gaussian for measurement noise and far cheaper.
+//==
+
+#ifndef __CAMERALIBRARY__BENCHMARKNOISE_H__
+#define __CAMERALIBRARY__BENCHMARKNOISE_H__
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cBenchmarkNoise
+    {
+    public:
+        cBenchmarkNoise(unsigned int Seed) : mState(Seed ? Seed : 2463534242u) { }
+
+        unsigned int Next()
+        {
+            mState ^= mState<<13;
+            mState ^= mState>>17;
+            mState ^= mState<<5;
+            return mState;
+        }
+
+        float Uniform()   { return (Next()>>8)*(1.0f/16777216.0f); }       //== [0,1) =========----
+        float Signed()    { return 2.0f*Uniform() - 1.0f; }                //== [-1,1) ========----
+
+        float Normal()                                                      //== Roughly, unit variance
+        {
+            float sum = 0;
+
+            for(int i=0; i<4; i++)
+                sum += Uniform();
+
+            return (sum - 2.0f)*1.7320508f;
+        }
+
+    private:
+        unsigned int mState;
+    };
+}
+
+#endif
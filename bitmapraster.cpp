@@ -0,0 +1,616 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define BITMAPRASTER_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "bitmapraster.h"
+#include "Core/Timer.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    const int kPatternSize = 48;                //== Multiple of every pixel size and of 16 ====----
+
+    struct sSpan
+    {
+        unsigned char * Data;                   //== First pixel ==============================----
+        int             Pixels;
+    };
+
+    //== Clipped span of row Y from X to X2 (inclusive), false if nothing is visible ==--
+
+    bool ClipSpan(Bitmap &Target, int X, int Y, int X2, sSpan &Span)
+    {
+        if(X>X2)
+        {
+            int swap = X;
+            X  = X2;
+            X2 = swap;
+        }
+
+        if(Y<0 || Y>=Target.PixelHeight() || X2<0 || X>=Target.PixelWidth())
+            return false;
+
+        int first = (X<0) ? 0 : X;
+        int last  = (X2>=Target.PixelWidth()) ? Target.PixelWidth()-1 : X2;
+
+        Span.Data   = Target.GetBits() + Y*Target.ByteSpan() + first*Target.GetBytesPerPixel();
+        Span.Pixels = last-first+1;
+
+        return true;
+    }
+
+    //== Pixel encoding ==--
+
+    inline unsigned short Encode565(int R, int G, int B)
+    {
+        return (unsigned short) (((R>>3)<<11) | ((G>>2)<<5) | (B>>3));
+    }
+
+    int EncodePixel(PIXEL Color, int BytesPerPixel, unsigned char *Output)
+    {
+        int r = GetRedCol(Color);
+        int g = GetGreenCol(Color);
+        int b = GetBlueCol(Color);
+
+        switch(BytesPerPixel)
+        {
+        case 1:
+            Output[0] = (unsigned char) ((77*r + 150*g + 29*b) >> 8);
+            break;
+        case 2:
+            {
+                unsigned short value = Encode565(r, g, b);
+                memcpy(Output, &value, 2);
+            }
+            break;
+        case 3:
+            Output[0] = (unsigned char) r;
+            Output[1] = (unsigned char) g;
+            Output[2] = (unsigned char) b;
+            break;
+        default:
+            memcpy(Output, &Color, 4);
+            break;
+        }
+
+        return BytesPerPixel;
+    }
+
+    void BuildPattern(PIXEL Color, int BytesPerPixel, unsigned char *Pattern)
+    {
+        for(int i=0; i<kPatternSize; i+=BytesPerPixel)
+            EncodePixel(Color, BytesPerPixel, Pattern+i);
+    }
+
+    //== Fills ==--
+
+    void FillBytes(unsigned char *Data, int Size, const unsigned char *Pattern)
+    {
+        int i = 0;
+
+#ifdef BITMAPRASTER_SSE2
+        __m128i p0 = _mm_loadu_si128((const __m128i*) (Pattern));
+        __m128i p1 = _mm_loadu_si128((const __m128i*) (Pattern+16));
+        __m128i p2 = _mm_loadu_si128((const __m128i*) (Pattern+32));
+
+        for(; i+kPatternSize<=Size; i+=kPatternSize)
+        {
+            _mm_storeu_si128((__m128i*) (Data+i),    p0);
+            _mm_storeu_si128((__m128i*) (Data+i+16), p1);
+            _mm_storeu_si128((__m128i*) (Data+i+32), p2);
+        }
+#else
+        for(; i+kPatternSize<=Size; i+=kPatternSize)
+            memcpy(Data+i, Pattern, kPatternSize);
+#endif
+
+        memcpy(Data+i, Pattern, Size-i);
+    }
+
+    void FillSpan(const sSpan &Span, int BytesPerPixel, const unsigned char *Pattern)
+    {
+        if(BytesPerPixel==1)
+            memset(Span.Data, Pattern[0], Span.Pixels);
+        else
+            FillBytes(Span.Data, Span.Pixels*BytesPerPixel, Pattern);
+    }
+
+    //== Alpha blending, (c a + d (255-a)) / 255 ==--
+
+    inline unsigned char BlendByte(int Source, int Dest, int Alpha)
+    {
+        int t = Source*Alpha + Dest*(255-Alpha) + 128;
+
+        return (unsigned char) ((t + (t>>8)) >> 8);
+    }
+
+    //== 8, 24 and 32-bit pixels blend per byte ==--
+
+    void BlendBytes(unsigned char *Data, int Size, const unsigned char *Pattern, int Alpha)
+    {
+        int i = 0;
+
+#ifdef BITMAPRASTER_SSE2
+        __m128i zero    = _mm_setzero_si128();
+        __m128i inverse = _mm_set1_epi16((short) (255-Alpha));
+        __m128i source[6];
+
+        //== c a + 128 per byte of the pattern, 8 lanes per register ==--
+
+        for(int j=0; j<3; j++)
+        {
+            __m128i pattern = _mm_loadu_si128((const __m128i*) (Pattern + j*16));
+            __m128i alpha   = _mm_set1_epi16((short) Alpha);
+            __m128i round   = _mm_set1_epi16(128);
+
+            source[j*2]   = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pattern, zero), alpha), round);
+            source[j*2+1] = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pattern, zero), alpha), round);
+        }
+
+        for(; i+kPatternSize<=Size; i+=kPatternSize)
+        {
+            for(int j=0; j<3; j++)
+            {
+                __m128i dest = _mm_loadu_si128((const __m128i*) (Data + i + j*16));
+
+                __m128i lo = _mm_add_epi16(source[j*2],   _mm_mullo_epi16(_mm_unpacklo_epi8(dest, zero), inverse));
+                __m128i hi = _mm_add_epi16(source[j*2+1], _mm_mullo_epi16(_mm_unpackhi_epi8(dest, zero), inverse));
+
+                lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+                hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+                _mm_storeu_si128((__m128i*) (Data + i + j*16), _mm_packus_epi16(lo, hi));
+            }
+        }
+#endif
+
+        for(; i<Size; i++)
+            Data[i] = BlendByte(Pattern[i % kPatternSize], Data[i], Alpha);
+    }
+
+    //== 16-bit pixels blend per 565 field ==--
+
+    void Blend565(unsigned short *Data, int Pixels, PIXEL Color, int Alpha)
+    {
+        int r = GetRedCol(Color)   >> 3;
+        int g = GetGreenCol(Color) >> 2;
+        int b = GetBlueCol(Color)  >> 3;
+
+        int i = 0;
+
+#ifdef BITMAPRASTER_SSE2
+        __m128i inverse = _mm_set1_epi16((short) (255-Alpha));
+        __m128i sourceR = _mm_set1_epi16((short) (r*Alpha + 128));
+        __m128i sourceG = _mm_set1_epi16((short) (g*Alpha + 128));
+        __m128i sourceB = _mm_set1_epi16((short) (b*Alpha + 128));
+        __m128i mask5   = _mm_set1_epi16(0x1F);
+        __m128i mask6   = _mm_set1_epi16(0x3F);
+
+        for(; i+8<=Pixels; i+=8)
+        {
+            __m128i dest = _mm_loadu_si128((const __m128i*) (Data+i));
+
+            __m128i dr = _mm_srli_epi16(dest, 11);
+            __m128i dg = _mm_and_si128(_mm_srli_epi16(dest, 5), mask6);
+            __m128i db = _mm_and_si128(dest, mask5);
+
+            dr = _mm_add_epi16(sourceR, _mm_mullo_epi16(dr, inverse));
+            dg = _mm_add_epi16(sourceG, _mm_mullo_epi16(dg, inverse));
+            db = _mm_add_epi16(sourceB, _mm_mullo_epi16(db, inverse));
+
+            dr = _mm_srli_epi16(_mm_add_epi16(dr, _mm_srli_epi16(dr, 8)), 8);
+            dg = _mm_srli_epi16(_mm_add_epi16(dg, _mm_srli_epi16(dg, 8)), 8);
+            db = _mm_srli_epi16(_mm_add_epi16(db, _mm_srli_epi16(db, 8)), 8);
+
+            __m128i result = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(dr, 11), _mm_slli_epi16(dg, 5)), db);
+
+            _mm_storeu_si128((__m128i*) (Data+i), result);
+        }
+#endif
+
+        for(; i<Pixels; i++)
+        {
+            int dest = Data[i];
+
+            Data[i] = (unsigned short) ((BlendByte(r, dest>>11, Alpha) << 11)
+                                      | (BlendByte(g, (dest>>5) & 0x3F, Alpha) << 5)
+                                      |  BlendByte(b, dest & 0x1F, Alpha));
+        }
+    }
+
+    void BlendSpan(const sSpan &Span, int BytesPerPixel, PIXEL Color)
+    {
+        int alpha = GetAlphaCol(Color);
+
+        if(alpha==0)
+            return;
+
+        unsigned char pattern[kPatternSize];
+
+        if(BytesPerPixel==2)
+        {
+            Blend565((unsigned short*) Span.Data, Span.Pixels, Color, alpha);
+            return;
+        }
+
+        //== blending an opaque source, destination alpha ends up opaque too ==--
+
+        BuildPattern(Color | (255<<24), BytesPerPixel, pattern);
+
+        if(alpha==255)
+            FillBytes(Span.Data, Span.Pixels*BytesPerPixel, pattern);
+        else
+            BlendBytes(Span.Data, Span.Pixels*BytesPerPixel, pattern, alpha);
+    }
+
+    //== Grayscale expansion ==--
+
+    void Expand8To16(const unsigned char *Source, unsigned short *Dest, int Pixels)
+    {
+        int i = 0;
+
+#ifdef BITMAPRASTER_SSE2
+        __m128i zero = _mm_setzero_si128();
+
+        for(; i+16<=Pixels; i+=16)
+        {
+            __m128i gray = _mm_loadu_si128((const __m128i*) (Source+i));
+
+            for(int half=0; half<2; half++)
+            {
+                __m128i g  = half ? _mm_unpackhi_epi8(gray, zero) : _mm_unpacklo_epi8(gray, zero);
+                __m128i g5 = _mm_srli_epi16(g, 3);
+                __m128i g6 = _mm_srli_epi16(g, 2);
+
+                __m128i value = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(g5, 11), _mm_slli_epi16(g6, 5)), g5);
+
+                _mm_storeu_si128((__m128i*) (Dest + i + half*8), value);
+            }
+        }
+#endif
+
+        for(; i<Pixels; i++)
+            Dest[i] = Encode565(Source[i], Source[i], Source[i]);
+    }
+
+    void Expand8To24(const unsigned char *Source, unsigned char *Dest, int Pixels)
+    {
+        for(int i=0; i<Pixels; i++)
+        {
+            Dest[i*3]   = Source[i];
+            Dest[i*3+1] = Source[i];
+            Dest[i*3+2] = Source[i];
+        }
+    }
+
+    void Expand8To32(const unsigned char *Source, unsigned char *Dest, int Pixels)
+    {
+        int i = 0;
+
+#ifdef BITMAPRASTER_SSE2
+        __m128i opaque = _mm_set1_epi8((char) 0xFF);
+
+        for(; i+16<=Pixels; i+=16)
+        {
+            __m128i gray = _mm_loadu_si128((const __m128i*) (Source+i));
+
+            __m128i gg = _mm_unpacklo_epi8(gray, gray);         //== g g pairs, low 8 ==--
+            __m128i ga = _mm_unpacklo_epi8(gray, opaque);       //== g 255 pairs ========--
+
+            _mm_storeu_si128((__m128i*) (Dest + i*4),      _mm_unpacklo_epi16(gg, ga));
+            _mm_storeu_si128((__m128i*) (Dest + i*4 + 16), _mm_unpackhi_epi16(gg, ga));
+
+            gg = _mm_unpackhi_epi8(gray, gray);
+            ga = _mm_unpackhi_epi8(gray, opaque);
+
+            _mm_storeu_si128((__m128i*) (Dest + i*4 + 32), _mm_unpacklo_epi16(gg, ga));
+            _mm_storeu_si128((__m128i*) (Dest + i*4 + 48), _mm_unpackhi_epi16(gg, ga));
+        }
+#endif
+
+        for(; i<Pixels; i++)
+        {
+            Dest[i*4]   = Source[i];
+            Dest[i*4+1] = Source[i];
+            Dest[i*4+2] = Source[i];
+            Dest[i*4+3] = 0xFF;
+        }
+    }
+
+    void ExpandSpan(const sSpan &Span, int BytesPerPixel, const unsigned char *Source)
+    {
+        switch(BytesPerPixel)
+        {
+        case 1:
+            memcpy(Span.Data, Source, Span.Pixels);
+            break;
+        case 2:
+            Expand8To16(Source, (unsigned short*) Span.Data, Span.Pixels);
+            break;
+        case 3:
+            Expand8To24(Source, Span.Data, Span.Pixels);
+            break;
+        default:
+            Expand8To32(Source, Span.Data, Span.Pixels);
+            break;
+        }
+    }
+}
+
+//== Clear & single pixels ==============================================================================----
+
+void cBitmapRaster::Clear(Bitmap &Target, unsigned char Intensity)
+{
+    int rowBytes = Target.PixelWidth()*Target.GetBytesPerPixel();
+
+    if(rowBytes==Target.ByteSpan())
+    {
+        memset(Target.GetBits(), Intensity, rowBytes*Target.PixelHeight());
+        return;
+    }
+
+    for(int y=0; y<Target.PixelHeight(); y++)
+        memset(Target.GetBits() + y*Target.ByteSpan(), Intensity, rowBytes);
+}
+
+void cBitmapRaster::PutPixel(Bitmap &Target, int X, int Y, PIXEL Color)
+{
+    if(X<0 || Y<0 || X>=Target.PixelWidth() || Y>=Target.PixelHeight())
+        return;
+
+    int bytesPerPixel = Target.GetBytesPerPixel();
+
+    EncodePixel(Color, bytesPerPixel, Target.GetBits() + Y*Target.ByteSpan() + X*bytesPerPixel);
+}
+
+void cBitmapRaster::PutPixelAlpha(Bitmap &Target, int X, int Y, PIXEL Color)
+{
+    HorizontalLineAlpha(Target, X, Y, X, Color);
+}
+
+//== Spans & rectangles =================================================================================----
+
+void cBitmapRaster::HorizontalLine(Bitmap &Target, int X, int Y, int X2, PIXEL Color)
+{
+    sSpan span;
+
+    if(!ClipSpan(Target, X, Y, X2, span))
+        return;
+
+    unsigned char pattern[kPatternSize];
+
+    BuildPattern(Color, Target.GetBytesPerPixel(), pattern);
+    FillSpan(span, Target.GetBytesPerPixel(), pattern);
+}
+
+void cBitmapRaster::HorizontalLineAlpha(Bitmap &Target, int X, int Y, int X2, PIXEL Color)
+{
+    sSpan span;
+
+    if(ClipSpan(Target, X, Y, X2, span))
+        BlendSpan(span, Target.GetBytesPerPixel(), Color);
+}
+
+void cBitmapRaster::SolidRectangle(Bitmap &Target, int X1, int Y1, int X2, int Y2, PIXEL Color)
+{
+    if(Y1>Y2)
+    {
+        int swap = Y1;
+        Y1 = Y2;
+        Y2 = swap;
+    }
+
+    if(Y1<0)
+        Y1 = 0;
+
+    if(Y2>=Target.PixelHeight())
+        Y2 = Target.PixelHeight()-1;
+
+    int bytesPerPixel = Target.GetBytesPerPixel();
+
+    unsigned char pattern[kPatternSize];
+
+    BuildPattern(Color, bytesPerPixel, pattern);
+
+    for(int y=Y1; y<=Y2; y++)
+    {
+        sSpan span;
+
+        if(ClipSpan(Target, X1, y, X2, span))
+            FillSpan(span, bytesPerPixel, pattern);
+    }
+}
+
+void cBitmapRaster::SolidRectangleAlpha(Bitmap &Target, int X1, int Y1, int X2, int Y2, PIXEL Color)
+{
+    if(Y1>Y2)
+    {
+        int swap = Y1;
+        Y1 = Y2;
+        Y2 = swap;
+    }
+
+    if(Y1<0)
+        Y1 = 0;
+
+    if(Y2>=Target.PixelHeight())
+        Y2 = Target.PixelHeight()-1;
+
+    for(int y=Y1; y<=Y2; y++)
+        HorizontalLineAlpha(Target, X1, y, X2, Color);
+}
+
+//== Grayscale ==========================================================================================----
+
+void cBitmapRaster::HorizontalLineFrom8BitSource(Bitmap &Target, int X, int Y, int X2, const unsigned char *Buffer)
+{
+    if(X>X2)
+        return;
+
+    sSpan span;
+
+    if(!ClipSpan(Target, X, Y, X2, span))
+        return;
+
+    //== skip source pixels clipped off the left edge ==--
+
+    if(X<0)
+        Buffer -= X;
+
+    ExpandSpan(span, Target.GetBytesPerPixel(), Buffer);
+}
+
+void cBitmapRaster::ExpandGrayscale(const unsigned char *Source, unsigned char *Dest, int Pixels, int BytesPerPixel)
+{
+    sSpan span;
+
+    span.Data   = Dest;
+    span.Pixels = Pixels;
+
+    ExpandSpan(span, BytesPerPixel, Source);
+}
+
+void cBitmapRaster::GrayscaleImage(Bitmap &Target, const unsigned char *Image, int Width, int Height, int Span)
+{
+    if(Image==0)
+        return;
+
+    int rows = (Height<Target.PixelHeight()) ? Height : Target.PixelHeight();
+
+    for(int y=0; y<rows; y++)
+        HorizontalLineFrom8BitSource(Target, 0, y, Width-1, Image + y*Span);
+}
+
+//== Benchmark ==========================================================================================----
+
+namespace
+{
+    enum eBenchmarkOperation
+    {
+        BenchmarkClear,
+        BenchmarkFill,
+        BenchmarkBlend,
+        BenchmarkGrayscale,
+        BenchmarkOperationCount
+    };
+
+    const char * kBenchmarkNames[BenchmarkOperationCount] =
+    {
+        "Clear", "SolidRectangle", "SolidRectangleAlpha", "HorizontalLineFrom8BitSource"
+    };
+
+    const double kBenchmarkSeconds = 0.1;       //== Per routine & depth ======================----
+
+    void RunOperation(Bitmap &Target, int Operation, bool Raster, const unsigned char *Gray)
+    {
+        int width  = Target.PixelWidth();
+        int height = Target.PixelHeight();
+
+        PIXEL opaque      = PIXELCOLOR(40, 160, 220);
+        PIXEL translucent = PIXELCOLORA(40, 160, 220, 96);
+
+        switch(Operation)
+        {
+        case BenchmarkClear:
+            if(Raster)
+                cBitmapRaster::Clear(Target, 16);
+            else
+                Target.Clear(16);
+            break;
+        case BenchmarkFill:
+            if(Raster)
+                cBitmapRaster::SolidRectangle(Target, 0, 0, width-1, height-1, opaque);
+            else
+                Target.SolidRectangle(0, 0, width-1, height-1, opaque);
+            break;
+        case BenchmarkBlend:
+            if(Raster)
+            {
+                cBitmapRaster::SolidRectangleAlpha(Target, 0, 0, width-1, height-1, translucent);
+            }
+            else
+            {
+                for(int y=0; y<height; y++)
+                    for(int x=0; x<width; x++)
+                        Target.PutPixelAlpha(x, y, translucent);
+            }
+            break;
+        default:
+            for(int y=0; y<height; y++)
+            {
+                if(Raster)
+                    cBitmapRaster::HorizontalLineFrom8BitSource(Target, 0, y, width-1, Gray + y*width);
+                else
+                    Target.HorizontalLineFrom8BitSource(0, y, width-1, (unsigned char*) Gray + y*width);
+            }
+            break;
+        }
+    }
+
+    double MeasureOperation(Bitmap &Target, int Operation, bool Raster, const unsigned char *Gray)
+    {
+        Core::cTimer timer;
+
+        int    iterations = 0;
+        double elapsed    = 0;
+
+        timer.CatchUp();
+
+        while(elapsed<kBenchmarkSeconds || iterations<3)
+        {
+            RunOperation(Target, Operation, Raster, Gray);
+
+            iterations++;
+            elapsed = timer.Elapsed();
+        }
+
+        return (elapsed>0) ? iterations * (double) Target.PixelWidth() * Target.PixelHeight() / elapsed / 1000000.0 : 0;
+    }
+}
+
+void cBitmapRaster::Benchmark(int Width, int Height, std::vector<sBenchmark> &Results)
+{
+    static const Bitmap::ColorDepth depths[] =
+    {
+        Bitmap::EightBit, Bitmap::SixteenBit, Bitmap::TwentyFourBit, Bitmap::ThirtyTwoBit
+    };
+
+    Results.clear();
+
+    if(Width<=0 || Height<=0)
+        return;
+
+    std::vector<unsigned char> gray(Width*Height);
+
+    for(int i=0; i<(int) gray.size(); i++)
+        gray[i] = (unsigned char) (i*7 + i/Width);
+
+    for(int d=0; d<4; d++)
+    {
+        int span = ((Width*depths[d]/8) + 3) & ~3;
+
+        std::vector<unsigned char> bits(span*Height);
+
+        Bitmap target(Width, Height, span, depths[d], &bits[0]);
+
+        for(int op=0; op<BenchmarkOperationCount; op++)
+        {
+            sBenchmark result;
+
+            result.Depth                  = depths[d];
+            result.Operation              = kBenchmarkNames[op];
+            result.BitmapMPixelsPerSecond = MeasureOperation(target, op, false, &gray[0]);
+            result.RasterMPixelsPerSecond = MeasureOperation(target, op, true,  &gray[0]);
+
+            Results.push_back(result);
+        }
+    }
+}
@@ -0,0 +1,74 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Vectorized drawing into a Bitmap.  Same operations as the Bitmap members of the same names for
+//== all four ColorDepths, but spans are filled, blended and expanded 16 bytes at a time with SSE2
+//== (scalar on other platforms) instead of one pixel per call.  Pixel encoding:
+//==
+//==     8-bit    luminance, (77 r + 150 g + 29 b) / 256
+//==     16-bit   RGB 565, red in the high bits
+//==     24-bit   r, g, b byte order
+//==     32-bit   PIXEL value as is, r in the low byte
+//==
+//== Coordinates are inclusive and clipped to the bitmap.  Alpha variants blend with the alpha of
+//== the PIXEL (GetAlphaCol), leaving 32-bit destinations opaque where alpha is 255.
+//==
+//== GrayscaleImage() expands an 8-bit camera image into any depth and is meant to replace per
+//== pixel HorizontalLineFrom8BitSource() loops when showing grayscale/MJPEG video.
+//==
+
+#ifndef __CAMERALIBRARY__BITMAPRASTER_H__
+#define __CAMERALIBRARY__BITMAPRASTER_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <vector>
+#include "bitmap.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cBitmapRaster
+    {
+    public:
+        static void Clear(Bitmap &Target, unsigned char Intensity = 0);
+
+        static void PutPixel     (Bitmap &Target, int X, int Y, PIXEL Color);
+        static void PutPixelAlpha(Bitmap &Target, int X, int Y, PIXEL Color);
+
+        static void HorizontalLine     (Bitmap &Target, int X, int Y, int X2, PIXEL Color);
+        static void HorizontalLineAlpha(Bitmap &Target, int X, int Y, int X2, PIXEL Color);
+
+        static void SolidRectangle     (Bitmap &Target, int X1, int Y1, int X2, int Y2, PIXEL Color);
+        static void SolidRectangleAlpha(Bitmap &Target, int X1, int Y1, int X2, int Y2, PIXEL Color);
+
+        //== Buffer holds the pixels for X..X2 ==--
+
+        static void HorizontalLineFrom8BitSource(Bitmap &Target, int X, int Y, int X2, const unsigned char *Buffer);
+
+        //== Raw 8-bit to BytesPerPixel (1-4) row conversion, for rasterizing into plain buffers ==--
+
+        static void ExpandGrayscale(const unsigned char *Source, unsigned char *Dest, int Pixels, int BytesPerPixel);
+
+        //== Whole 8-bit image at the top left corner, clipped to the bitmap ==--
+
+        static void GrayscaleImage(Bitmap &Target, const unsigned char *Image, int Width, int Height, int Span);
+
+        //== Throughput of these routines vs. the Bitmap members, every ColorDepth ==--
+
+        struct sBenchmark
+        {
+            Bitmap::ColorDepth Depth;
+            const char *       Operation;
+            double             BitmapMPixelsPerSecond;
+            double             RasterMPixelsPerSecond;
+        };
+
+        static void Benchmark(int Width, int Height, std::vector<sBenchmark> &Results);
+    };
+}
+
+#endif
@@ -0,0 +1,309 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <algorithm>
+
+#include "clusterassignment.h"
+
+using namespace Core;
+
+namespace
+{
+    const double kMissCost   = 1.0;
+    const double kNoPairCost = 1e6;
+
+    struct sRootOrder
+    {
+        const std::vector<int> *Roots;
+
+        bool operator()(int A, int B) const { return (*Roots)[A]<(*Roots)[B]; }
+    };
+}
+
+cClusterAssignment::cClusterAssignment()
+    : mMaxClusterSize(64)
+{
+    mStatistics.DirectMatches  = 0;
+    mStatistics.Clusters       = 0;
+    mStatistics.GreedyClusters = 0;
+    mStatistics.LargestCluster = 0;
+    mStatistics.ClusterColumns = 0;
+}
+
+int cClusterAssignment::Root(int Node)
+{
+    while(mParent[Node]!=Node)
+    {
+        mParent[Node] = mParent[mParent[Node]];
+        Node = mParent[Node];
+    }
+
+    return Node;
+}
+
+void cClusterAssignment::Solve(int Rows, int Columns, const std::vector<sCandidate> &Candidates,
+                               std::vector<int> &RowMatch, std::vector<int> &ColumnMatch)
+{
+    int candidates = (int) Candidates.size();
+
+    mStatistics.DirectMatches  = 0;
+    mStatistics.Clusters       = 0;
+    mStatistics.GreedyClusters = 0;
+    mStatistics.LargestCluster = 0;
+    mStatistics.ClusterColumns = 0;
+
+    RowMatch.assign(Rows, -1);
+    ColumnMatch.assign(Columns, -1);
+
+    mRowDegree.assign(Rows, 0);
+    mColumnDegree.assign(Columns, 0);
+
+    for(int c=0; c<candidates; c++)
+    {
+        mRowDegree[Candidates[c].Row]++;
+        mColumnDegree[Candidates[c].Column]++;
+    }
+
+    //== uncontested pairs are matched directly, everything else is clustered ==--
+
+    mParent.resize(Rows + Columns);
+
+    for(int n=0; n<Rows + Columns; n++)
+        mParent[n] = n;
+
+    mConflicts.clear();
+
+    for(int c=0; c<candidates; c++)
+    {
+        const sCandidate &candidate = Candidates[c];
+
+        if(mRowDegree[candidate.Row]==1 && mColumnDegree[candidate.Column]==1)
+        {
+            RowMatch[candidate.Row]       = candidate.Column;
+            ColumnMatch[candidate.Column] = candidate.Row;
+            mStatistics.DirectMatches++;
+            continue;
+        }
+
+        int a = Root(candidate.Row);
+        int b = Root(Rows + candidate.Column);
+
+        if(a!=b)
+            mParent[a] = b;
+
+        mConflicts.push_back(c);
+    }
+
+    if(mConflicts.empty())
+        return;
+
+    //== group conflicting candidates by cluster, then solve cluster by cluster ==--
+
+    mRoots.resize(candidates);
+
+    for(int i=0; i<(int) mConflicts.size(); i++)
+        mRoots[mConflicts[i]] = Root(Candidates[mConflicts[i]].Row);
+
+    sRootOrder order;
+    order.Roots = &mRoots;
+
+    std::sort(mConflicts.begin(), mConflicts.end(), order);
+
+    mGrouped.resize(mConflicts.size());
+    mBounds.clear();
+
+    for(int i=0; i<(int) mConflicts.size(); i++)
+    {
+        if(i==0 || mRoots[mConflicts[i]]!=mRoots[mConflicts[i - 1]])
+            mBounds.push_back(i);
+
+        mGrouped[i] = Candidates[mConflicts[i]];
+    }
+
+    mBounds.push_back((int) mConflicts.size());
+
+    mLocal.assign(Rows + Columns, -1);
+
+    for(int i=0; i + 1<(int) mBounds.size(); i++)
+        SolveCluster(mBounds[i], mBounds[i + 1], Rows, RowMatch, ColumnMatch);
+}
+
+void cClusterAssignment::SolveCluster(int First, int Last, int Rows, std::vector<int> &RowMatch, std::vector<int> &ColumnMatch)
+{
+    mClusterRows.clear();
+    mClusterColumns.clear();
+
+    for(int c=First; c<Last; c++)
+    {
+        int row    = mGrouped[c].Row;
+        int column = Rows + mGrouped[c].Column;
+
+        if(mLocal[row]<0)
+        {
+            mLocal[row] = (int) mClusterRows.size();
+            mClusterRows.push_back(row);
+        }
+
+        if(mLocal[column]<0)
+        {
+            mLocal[column] = (int) mClusterColumns.size();
+            mClusterColumns.push_back(mGrouped[c].Column);
+        }
+    }
+
+    int rows    = (int) mClusterRows.size();
+    int columns = (int) mClusterColumns.size();
+    int size    = rows + columns;
+
+    mStatistics.LargestCluster  = std::max(mStatistics.LargestCluster, size);
+    mStatistics.ClusterColumns += columns;
+
+    if(size>mMaxClusterSize)
+    {
+        SolveGreedy(First, Last, RowMatch, ColumnMatch);
+        mStatistics.GreedyClusters++;
+    }
+    else
+    {
+        //== square problem: rows and one "unmatched" row per column against columns and one
+        //== "unmatched" column per row.  Dummy to dummy is free, so any subset may stay unmatched.
+
+        mCost.assign(size*size, kNoPairCost);
+
+        for(int r=0; r<size; r++)
+        {
+            for(int c=0; c<size; c++)
+            {
+                bool dummyRow    = (r>=rows);
+                bool dummyColumn = (c>=columns);
+
+                if(dummyRow && dummyColumn)
+                    mCost[r*size + c] = 0;
+                else if(dummyRow || dummyColumn)
+                    mCost[r*size + c] = kMissCost;
+            }
+        }
+
+        for(int c=First; c<Last; c++)
+        {
+            int r   = mLocal[mGrouped[c].Row];
+            int col = mLocal[Rows + mGrouped[c].Column];
+
+            mCost[r*size + col] = mGrouped[c].Cost;
+        }
+
+        Hungarian(size);
+
+        for(int j=1; j<=columns; j++)
+        {
+            int r = mColumnRow[j] - 1;
+
+            if(r<rows && mCost[r*size + (j - 1)]<kNoPairCost)
+            {
+                RowMatch[mClusterRows[r]]           = mClusterColumns[j - 1];
+                ColumnMatch[mClusterColumns[j - 1]] = mClusterRows[r];
+            }
+        }
+
+        mStatistics.Clusters++;
+    }
+
+    for(int r=0; r<rows; r++)
+        mLocal[mClusterRows[r]] = -1;
+
+    for(int c=0; c<columns; c++)
+        mLocal[Rows + mClusterColumns[c]] = -1;
+}
+
+void cClusterAssignment::Hungarian(int Size)
+{
+    //== shortest augmenting paths with potentials, O(Size^3); mColumnRow is 1-based ==--
+
+    mRowPotential.assign(Size + 1, 0);
+    mColumnPotential.assign(Size + 1, 0);
+    mColumnRow.assign(Size + 1, 0);
+    mWay.assign(Size + 1, 0);
+
+    for(int i=1; i<=Size; i++)
+    {
+        mColumnRow[0] = i;
+
+        int column = 0;
+
+        mMinimum.assign(Size + 1, 1e300);
+        mUsed.assign(Size + 1, 0);
+
+        do
+        {
+            mUsed[column] = 1;
+
+            int    row   = mColumnRow[column];
+            double delta = 1e300;
+            int    next  = 0;
+
+            for(int j=1; j<=Size; j++)
+            {
+                if(mUsed[j])
+                    continue;
+
+                double reduced = mCost[(row - 1)*Size + (j - 1)] - mRowPotential[row] - mColumnPotential[j];
+
+                if(reduced<mMinimum[j])
+                {
+                    mMinimum[j] = reduced;
+                    mWay[j]     = column;
+                }
+
+                if(mMinimum[j]<delta)
+                {
+                    delta = mMinimum[j];
+                    next  = j;
+                }
+            }
+
+            for(int j=0; j<=Size; j++)
+            {
+                if(mUsed[j])
+                {
+                    mRowPotential[mColumnRow[j]] += delta;
+                    mColumnPotential[j]          -= delta;
+                }
+                else
+                    mMinimum[j] -= delta;
+            }
+
+            column = next;
+        }
+        while(mColumnRow[column]!=0);
+
+        do
+        {
+            int previous = mWay[column];
+            mColumnRow[column] = mColumnRow[previous];
+            column = previous;
+        }
+        while(column!=0);
+    }
+}
+
+void cClusterAssignment::SolveGreedy(int First, int Last, std::vector<int> &RowMatch, std::vector<int> &ColumnMatch)
+{
+    mOrder.clear();
+
+    for(int c=First; c<Last; c++)
+        mOrder.push_back(std::make_pair(mGrouped[c].Cost, c));
+
+    std::sort(mOrder.begin(), mOrder.end());
+
+    for(int i=0; i<(int) mOrder.size(); i++)
+    {
+        const sCandidate &candidate = mGrouped[mOrder[i].second];
+
+        if(RowMatch[candidate.Row]<0 && ColumnMatch[candidate.Column]<0)
+        {
+            RowMatch[candidate.Row]       = candidate.Column;
+            ColumnMatch[candidate.Column] = candidate.Row;
+        }
+    }
+}
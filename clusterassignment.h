@@ -0,0 +1,95 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Sparse one to one assignment between rows (tracks) and columns (detections), given only the
+//== gated candidate pairs.  A pair that neither side shares with anyone else is matched outright.
+//== The rest are split into connected clusters with union find and every cluster is solved
+//== optimally by the Hungarian method, padded so any row or column may also stay unmatched.
+//== Clusters bigger than MaxClusterSize rows + columns are matched cheapest pair first instead,
+//== which bounds the worst case at O(n log n) per frame.
+//==
+//== Candidate costs are expected in [0,1], 1 being the edge of the gate.  Leaving a row or a
+//== column unmatched costs 1 each, so the solve never drops a gated pair just to save cost; it
+//== only decides who gets whom.
+//==
+
+#ifndef __CAMERALIBRARY__CLUSTERASSIGNMENT_H__
+#define __CAMERALIBRARY__CLUSTERASSIGNMENT_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <vector>
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace Core
+{
+    class cClusterAssignment
+    {
+    public:
+        struct sCandidate
+        {
+            int     Row;
+            int     Column;
+            float   Cost;
+        };
+
+        struct sStatistics
+        {
+            int     DirectMatches;              //== Matched without an assignment solve =======----
+            int     Clusters;                   //== Conflicts solved optimally ================----
+            int     GreedyClusters;             //== Conflicts above MaxClusterSize ============----
+            int     LargestCluster;             //== Rows + columns ============================----
+            int     ClusterColumns;             //== Columns decided inside clusters ===========----
+        };
+
+        cClusterAssignment();
+
+        void    SetMaxClusterSize(int Size)         { mMaxClusterSize = Size; }
+        int     MaxClusterSize() const              { return mMaxClusterSize; }
+
+        //== RowMatch/ColumnMatch receive the partner index or -1. ==--
+
+        void    Solve(int Rows, int Columns, const std::vector<sCandidate> &Candidates,
+                      std::vector<int> &RowMatch, std::vector<int> &ColumnMatch);
+
+        const sStatistics & Statistics() const      { return mStatistics; }
+
+    private:
+        void    SolveCluster(int First, int Last, int Rows, std::vector<int> &RowMatch, std::vector<int> &ColumnMatch);
+        void    SolveGreedy (int First, int Last, std::vector<int> &RowMatch, std::vector<int> &ColumnMatch);
+        void    Hungarian(int Size);
+
+        int     Root(int Node);
+
+        int                         mMaxClusterSize;
+        sStatistics                 mStatistics;
+
+        //== Scratch, kept to avoid reallocating every frame ==--
+
+        std::vector<int>            mRowDegree;
+        std::vector<int>            mColumnDegree;
+        std::vector<int>            mParent;            //== Union find, rows then columns ==----
+        std::vector<int>            mConflicts;         //== Candidates inside clusters =====----
+        std::vector<int>            mRoots;
+        std::vector<int>            mBounds;            //== Cluster ranges in mGrouped =====----
+        std::vector<sCandidate>     mGrouped;
+
+        std::vector<int>            mLocal;             //== Node -> cluster row/column =====----
+        std::vector<int>            mClusterRows;
+        std::vector<int>            mClusterColumns;
+        std::vector<std::pair<float, int> > mOrder;
+
+        std::vector<double>         mCost;
+        std::vector<double>         mRowPotential;
+        std::vector<double>         mColumnPotential;
+        std::vector<double>         mMinimum;
+        std::vector<int>            mColumnRow;
+        std::vector<int>            mWay;
+        std::vector<char>           mUsed;
+    };
+}
+
+#endif
@@ -0,0 +1,1259 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Console entry point, built as VectorTrackingConsole.  Nothing here needs a window, OpenGL or a
+//== display, so it runs on a headless server.
+//==
+//==   -headless [frames] [interval]     the default: track the first camera for that many frames,
+//==                                     rendering the sample's view into memory every interval
+//==                                     frames, then report visualization vs. tracking cost
+//==   -publish name                     share every tracked pose with other processes
+//==   -stream address [port]            send every tracked pose over UDP, repeatable
+//==   -take filename [speed]            track the take's first camera instead, played back at
+//==                                     speed times its recorded rate, or as fast as the pipeline
+//==                                     takes it when 0 or left out, then report the speedup
+//==   -benchmark                        run every component benchmark on synthetic data and
+//==                                     print the results, no camera needed
+//==   -selftest                         check the smoothing filters' step response and that their
+//==                                     SSE2 and scalar paths agree, nonzero exit on failure
+//==
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "cameralibrary.h"
+#include "modulevector.h"
+#include "modulevectorprocessing.h"
+#include "coremath.h"
+#include "headlessview.h"
+#include "posepublisher.h"
+#include "posestreamer.h"
+#include "vectorresults.h"
+#include "inputmanagerfile/inputmanagerfile.h"
+#include "streamwriter.h"
+#include "takedeltaframe.h"
+#include "grayscalecodec.h"
+#include "jpegdecoder.h"
+#include "jpegencoder.h"
+#include "mjpegdecoderpool.h"
+#include "bitmapraster.h"
+#include "framerasterizer.h"
+#include "posepredictor.h"
+#include "kalmanfilterstage.h"
+#include "markerlinker2d.h"
+#include "markerlinker3d.h"
+#include "triangulator.h"
+#include "rigidbodysolver.h"
+#include "rigidbodyidentifier.h"
+#include "vectorposesolver.h"
+#include "multivectortracker.h"
+#include "benchmarknoise.h"
+
+#include "Core/Timer.h"
+#include "Core/DoubleExponentialSmoothing.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    void SleepMilliseconds(int Milliseconds)
+    {
+#ifdef WIN32
+        Sleep(Milliseconds);
+#else
+        usleep(Milliseconds*1000);
+#endif
+    }
+
+    //== Same setup as the windowed sample ==--
+
+    void ConfigureVector(Camera *Camera, const Core::DistortionModel &Distortion,
+                         cModuleVector *Vector, cModuleVectorProcessing *Processor)
+    {
+        cVectorSettings vectorSettings;
+        vectorSettings = *Vector->Settings();
+
+        vectorSettings.Arrangement = cVectorSettings::VectorClip;
+        vectorSettings.Enabled     = true;
+
+        cVectorProcessingSettings processorSettings;
+        processorSettings = *Processor->Settings();
+
+        processorSettings.Arrangement    = cVectorSettings::VectorClip;
+        processorSettings.ShowPivotPoint = false;
+        processorSettings.ShowProcessed  = false;
+
+        Processor->SetSettings(processorSettings);
+
+        vectorSettings.ImagerFocalLength = (Distortion.HorizontalFocalLength/((float) Camera->PhysicalPixelWidth()))*Camera->ImagerWidth();
+
+        vectorSettings.ImagerHeight = Camera->ImagerHeight();
+        vectorSettings.ImagerWidth  = Camera->ImagerWidth();
+
+        vectorSettings.PrincipalX   = Camera->PhysicalPixelWidth()/2;
+        vectorSettings.PrincipalY   = Camera->PhysicalPixelHeight()/2;
+
+        vectorSettings.PixelWidth   = Camera->PhysicalPixelWidth();
+        vectorSettings.PixelHeight  = Camera->PhysicalPixelHeight();
+
+        Vector->SetSettings(vectorSettings);
+    }
+
+    int RunHeadless(int Frames, int RenderInterval, const char *PublishName, cPoseStreamer &Streamer)
+    {
+        CameraManager::X();
+
+        //== No dialog to wait on, block until the attached cameras are up ==--
+
+        CameraManager::X().WaitForInitialization();
+
+        Camera *camera = CameraManager::X().GetCamera();
+
+        if(camera==0)
+        {
+            printf("No camera connected\n");
+            CameraManager::X().Shutdown();
+            return 1;
+        }
+
+        cHeadlessView view(800, 450);
+        view.SetRenderInterval(RenderInterval);
+
+        cPosePublisher publisher;
+
+        if(PublishName && !publisher.Open(PublishName))
+            printf("Unable to publish poses as '%s', another publisher may own it\n", PublishName);
+
+        camera->SetVideoType(Core::SegmentMode);
+        camera->Start();
+        camera->SetTextOverlay(false);
+
+        cModuleVector *vec = cModuleVector::Create();
+        cModuleVectorProcessing *vecprocessor = new cModuleVectorProcessing();
+
+        Core::DistortionModel lensDistortion;
+
+        camera->GetDistortionModel(lensDistortion);
+
+        ConfigureVector(camera, lensDistortion, vec, vecprocessor);
+
+        Core::cTimer trackingTimer;
+        double       trackingSeconds = 0;
+        int          trackedFrames   = 0;
+
+        sVectorResults results;
+
+        while(trackedFrames<Frames)
+        {
+            Frame *frame = camera->GetFrame();
+
+            if(frame==0)
+            {
+                SleepMilliseconds(2);
+                continue;
+            }
+
+            trackingTimer.CatchUp();
+
+            vec->BeginFrame();
+
+            for(int i=0; i<frame->ObjectCount(); i++)
+            {
+                cObject *obj = frame->Object(i);
+
+                float x = obj->X();
+                float y = obj->Y();
+
+                Core::Undistort2DPoint(lensDistortion,x,y);
+
+                vec->PushMarkerData(x, y, obj->Area(), obj->Width(), obj->Height());
+            }
+
+            vec->Calculate();
+            vecprocessor->PushData(vec);
+
+            trackingSeconds += trackingTimer.Elapsed();
+            trackedFrames++;
+
+            if(publisher.IsOpen())
+                publisher.Publish(vecprocessor, frame->FrameID(), frame->TimeStamp());
+
+            if(Streamer.IsOpen())
+                Streamer.Submit(vecprocessor, frame->FrameID(), frame->TimeStamp());
+
+            //== The window's view: camera image, axes and a line between every marker pair,
+            //== positions scaled for display as the sample does.  Markers are exported once
+            //== per rendered frame rather than fetched again for every pair ==--
+
+            if(view.BeginFrame())
+            {
+                view.DrawCameraFrame(frame);
+                view.DrawAxes();
+
+                ExportResults(vecprocessor, &results, frame->FrameID(), frame->TimeStamp());
+
+                for(int i=0; i<results.MarkerCount; i++)
+                {
+                    const float *a = results.Markers[i];
+
+                    for(int j=i+1; j<results.MarkerCount; j++)
+                    {
+                        const float *b = results.Markers[j];
+
+                        view.DrawLine3D(a[0]/200, a[1]/200, a[2]/200, b[0]/200, b[1]/200, b[2]/200,
+                                        PIXELCOLORA(0,255,255,255));
+                    }
+                }
+
+                view.EndFrame();
+            }
+
+            frame->Release();
+        }
+
+        //== Report visualization cost next to tracking cost ==--
+
+        cHeadlessView::sStatistics stats;
+        view.Statistics(stats);
+
+        printf("Tracking: %d frames, %.3f ms per frame\n", trackedFrames,
+               trackedFrames ? 1000.0*trackingSeconds/trackedFrames : 0.0);
+        printf("Visualization: %d of %d frames rendered, %.3f ms per render\n",
+               stats.FramesRendered, stats.FramesSubmitted, stats.MillisecondsPerRender);
+
+        if(view.SavePPM("headless.ppm"))
+            printf("Last image saved to headless.ppm\n");
+
+        camera->Release();
+
+        CameraManager::X().Shutdown();
+
+        return 0;
+    }
+
+    //== Take playback: the playback thread hands over each take frame, the first camera's go
+    //== through the same pipeline as a live camera's ==--
+
+    class cTakeTracker : public cTakeFrameListener
+    {
+    public:
+        cTakeTracker(Camera *Camera, cPosePublisher &Publisher, cPoseStreamer &Streamer)
+            : mCamera(Camera), mPublisher(Publisher), mStreamer(Streamer), mSeconds(0), mFrames(0)
+        {
+            mVector    = cModuleVector::Create();
+            mProcessor = new cModuleVectorProcessing();
+
+            mCamera->GetDistortionModel(mDistortion);
+
+            ConfigureVector(mCamera, mDistortion, mVector, mProcessor);
+        }
+
+        virtual void IncomingTakeFrame(Camera *Camera, const cTakeFrame &Frame)
+        {
+            if(Camera!=mCamera)
+                return;
+
+            mTimer.CatchUp();
+
+            mVector->BeginFrame();
+
+            const std::vector<cTinyObject> &objects = Frame.Objects();
+
+            for(int i=0; i<(int) objects.size(); i++)
+            {
+                const cTinyObject &obj = objects[i];
+
+                //== 8 bits of sub-pixel position.  A tiny object keeps its area but not its
+                //== extents, those of a round marker of that area are passed on ==--
+
+                float x = obj.X + obj.XMantissa/256.0f;
+                float y = obj.Y + obj.YMantissa/256.0f;
+
+                int diameter = (int) (2*sqrtf(obj.Area/3.14159265f) + 0.5f);
+
+                Core::Undistort2DPoint(mDistortion,x,y);
+
+                mVector->PushMarkerData(x, y, obj.Area, diameter, diameter);
+            }
+
+            mVector->Calculate();
+            mProcessor->PushData(mVector);
+
+            mSeconds += mTimer.Elapsed();
+            mFrames++;
+
+            if(mPublisher.IsOpen())
+                mPublisher.Publish(mProcessor, Frame.FrameID(), Frame.TimeStamp());
+
+            if(mStreamer.IsOpen())
+                mStreamer.Submit(mProcessor, Frame.FrameID(), Frame.TimeStamp());
+        }
+
+        int     Frames() const                  { return mFrames; }
+        double  MillisecondsPerFrame() const    { return mFrames ? 1000.0*mSeconds/mFrames : 0.0; }
+
+    private:
+        Camera                  *mCamera;
+        cPosePublisher          &mPublisher;
+        cPoseStreamer           &mStreamer;
+        cModuleVector           *mVector;
+        cModuleVectorProcessing *mProcessor;
+        Core::DistortionModel    mDistortion;
+        Core::cTimer             mTimer;
+        double                   mSeconds;
+        int                      mFrames;
+    };
+
+    int RunTake(const char *Filename, double Speed, const char *PublishName, cPoseStreamer &Streamer)
+    {
+        CameraManager::X();
+
+        cInputManagerFile take;
+
+        if(!take.Open(Filename))
+        {
+            printf("Unable to open take %s\n", Filename);
+            CameraManager::X().Shutdown();
+            return 1;
+        }
+
+        cPosePublisher publisher;
+
+        if(PublishName && !publisher.Open(PublishName))
+            printf("Unable to publish poses as '%s', another publisher may own it\n", PublishName);
+
+        cTakeTracker tracker(take.GetCamera(0), publisher, Streamer);
+
+        if(Speed>0)
+            take.SetPlaybackMode(cInputManagerFile::PlaybackFixedMultiplier, Speed);
+        else
+            take.SetPlaybackMode(cInputManagerFile::PlaybackAsFastAsPossible);
+
+        take.SetListener(&tracker);
+        take.Start();
+
+        while(take.IsPlaying())
+            SleepMilliseconds(10);
+
+        take.Stop();
+
+        printf("Take: %d frames of %d cameras over %.2f s, %d delivered at %.1f frames/s, %.2fx speedup\n",
+               take.FrameCount(), take.CameraCount(), take.Duration(), take.FramesDelivered(),
+               take.DeliveredFrameRate(), take.Speedup());
+        printf("Tracking: %d frames, %.3f ms per frame\n", tracker.Frames(), tracker.MillisecondsPerFrame());
+
+        take.Close();
+
+        CameraManager::X().Shutdown();
+
+        return 0;
+    }
+
+    //== Component benchmarks, each on its synthetic scene.  Accuracy figures are repeatable,
+    //== timings are this machine's ==--
+
+    void BenchmarkStreamWriter()
+    {
+        printf("Stream writer, 256 MB of take records\n");
+
+        for(int direct=0; direct<2; direct++)
+        {
+            cStreamWriter::sBenchmark result;
+
+            if(!cStreamWriter::Benchmark("streamwriter.benchmark", 256, direct!=0, result))
+            {
+                printf("  Unable to write streamwriter.benchmark\n");
+                return;
+            }
+
+            printf("  %-8s %.0f MB/s appended, %.0f MB/s to disk, %d of %d buffers in flight, %d stalls\n",
+                   result.DirectIO ? "direct" : "buffered", result.AppendMBps, result.ThroughputMBps,
+                   result.PeakQueueDepth, result.BufferCount, result.CaptureStalls);
+        }
+    }
+
+    void BenchmarkTakeDeltaCodec()
+    {
+        printf("Delta object frames, take round trip\n");
+
+        for(int entropy=0; entropy<2; entropy++)
+        {
+            cTakeDeltaCodec::sBenchmark result;
+            cTakeDeltaCodec::Benchmark(8, 40, 3600, entropy!=0, result);
+
+            printf("  %d cameras x %d markers, %-10s %.2fx smaller, encode %.0f MB/s, decode %.0f MB/s, %d of %d frames mismatched\n",
+                   result.Cameras, result.Markers, entropy ? "entropy" : "varint", result.CompressionRatio,
+                   result.EncodeMBps, result.DecodeMBps, result.Mismatches, result.Cameras*result.Frames);
+        }
+    }
+
+    void BenchmarkGrayscaleCodec()
+    {
+        printf("Grayscale codec, round trip\n");
+
+        cGrayscaleCodec::sBenchmark result;
+        cGrayscaleCodec::Benchmark(1280, 1024, 50, 200, result);
+
+        printf("  %dx%d, %d markers: %.1fx smaller, encode %.0f MB/s, decode %.0f MB/s, %d frames mismatched\n",
+               result.Width, result.Height, result.Blobs, result.CompressionRatio,
+               result.EncodeMBps, result.DecodeMBps, result.Mismatches);
+    }
+
+    void BenchmarkMJPEGDecoderPool()
+    {
+        printf("MJPEG decoder pool, 1280x1024\n");
+
+        const int threads[] = { 1, 2, 4, 8 };
+
+        double single = 0;
+
+        for(int i=0; i<4; i++)
+        {
+            cMJPEGDecoderPool::sBenchmark result;
+            cMJPEGDecoderPool::Benchmark(threads[i], 1280, 1024, 200, result);
+
+            if(i==0)
+                single = result.FramesPerSecond;
+
+            printf("  %d threads: %6.1f frames/s, %6.1f MPixels/s, %.2fx, %d errors, %d mismatched\n",
+                   result.ThreadCount, result.FramesPerSecond, result.MegapixelsPerSecond,
+                   single>0 ? result.FramesPerSecond/single : 0, result.DecodeErrors, result.Mismatches);
+        }
+    }
+
+    void BenchmarkBitmapRaster()
+    {
+        printf("Bitmap raster, 800x450\n");
+
+        std::vector<cBitmapRaster::sBenchmark> results;
+        cBitmapRaster::Benchmark(800, 450, results);
+
+        for(size_t i=0; i<results.size(); i++)
+            printf("  %2d bit %-28s Bitmap %8.1f  raster %8.1f MPixels/s\n", (int) results[i].Depth,
+                   results[i].Operation, results[i].BitmapMPixelsPerSecond, results[i].RasterMPixelsPerSecond);
+    }
+
+    void BenchmarkFrameRasterizer()
+    {
+        printf("Frame rasterizer, 2048x2048 into 32-bit\n");
+
+        const int threads[]    = { 1, 2, 4, 4 };
+        const int decimation[] = { 1, 1, 1, 2 };
+
+        for(int i=0; i<4; i++)
+        {
+            cFrameRasterizer::sBenchmark result;
+            cFrameRasterizer::Benchmark(2048, 2048, threads[i], decimation[i], 30, result);
+
+            printf("  %d threads, decimation %d: Bitmap %7.1f  banded %7.1f MPixels/s (%.2fx), %d rows mismatched\n",
+                   result.ThreadCount, result.Decimation, result.BitmapMPixelsPerSecond, result.BandedMPixelsPerSecond,
+                   result.BitmapMPixelsPerSecond>0 ? result.BandedMPixelsPerSecond/result.BitmapMPixelsPerSecond : 0,
+                   result.Mismatches);
+        }
+    }
+
+    void BenchmarkPoseStreamer()
+    {
+        printf("Pose streamer, loopback at 360 Hz\n");
+
+        const int poses[] = { 1, 10, 50 };
+
+        for(int i=0; i<3; i++)
+        {
+            cPoseStreamer::sBenchmark result;
+
+            if(!cPoseStreamer::Benchmark(kPoseStreamDefaultPort + 1, 1000, poses[i], 1.0/360, result))
+            {
+                printf("  Unable to open a loopback socket\n");
+                return;
+            }
+
+            printf("  %2d poses: %d of %d frames received, %.1f frames per datagram, latency %.0f us mean %.0f us max\n",
+                   result.PosesPerFrame, result.FramesReceived, result.FramesSent, result.FramesPerDatagram,
+                   result.MeanLatencyMicroseconds, result.MaxLatencyMicroseconds);
+        }
+    }
+
+    void BenchmarkPosePublisher()
+    {
+        printf("Pose publisher, shared memory to a polling reader\n");
+
+        const double rates[] = { 360, 1000 };
+
+        for(int i=0; i<2; i++)
+        {
+            cPosePublisher::sBenchmark result;
+
+            if(!cPosePublisher::Benchmark("posepublisher.benchmark", 2000, 1.0/rates[i], result))
+            {
+                printf("  Unable to create the shared memory\n");
+                return;
+            }
+
+            printf("  %4.0f Hz: %d of %d samples seen, latency %.1f us mean %.1f us max, publish %.0f ns, latest %.0f ns\n",
+                   rates[i], result.SamplesSeen, result.SamplesPublished, result.MeanLatencyMicroseconds,
+                   result.MaxLatencyMicroseconds, result.PublishNanoseconds, result.LatestNanoseconds);
+        }
+    }
+
+    void BenchmarkPosePredictor()
+    {
+        printf("Pose predictor, 10 ms ahead\n");
+
+        cPosePredictor::sBenchmark result;
+        cPosePredictor::Benchmark(200000, 0.01, result);
+
+        printf("  %.0f ns per sample, %.0f ns per query, error %g position %g degrees\n",
+               result.NanosecondsPerSample, result.NanosecondsPerQuery, result.PositionError, result.RotationErrorDegrees);
+    }
+
+    //== Update() over a full bank, one input nudged per frame so nothing settles ==--
+
+    void BenchmarkSmoothing()
+    {
+        printf("Double exponential smoothing\n");
+
+        typedef Core::cDoubleExponentialSmoothing<256> cBank;
+
+        const int entities = cBank::Capacity();
+        const int frames   = 20000;
+
+        cBank *bank = new cBank();
+
+        bank->SetCount(entities);
+
+        for(int i=0; i<entities; i++)
+        {
+            float position[3] = { 0.01f*i, 1.0f, -0.02f*i };
+            float rotation[4] = { 0.0f, sinf(0.001f*i), 0.0f, cosf(0.001f*i) };
+
+            bank->SetInput(i, position, rotation);
+        }
+
+        bank->Update();
+
+        Core::cTimer timer;
+
+        for(int f=0; f<frames; f++)
+        {
+            int   i           = f % entities;
+            float position[3] = { 0.01f*i + 0.001f*(f/entities + 1), 1.0f, -0.02f*i };
+            float rotation[4] = { 0.0f, sinf(0.001f*i), 0.0f, cosf(0.001f*i) };
+
+            bank->SetInput(i, position, rotation);
+            bank->Update();
+        }
+
+        double seconds = timer.Elapsed();
+
+        delete bank;
+
+        printf("  %d entities: %.0f ns per frame, %.1f filters per us\n", entities, 1e9*seconds/frames,
+               (seconds>0) ? (double) frames*entities/(1e6*seconds) : 0.0);
+    }
+
+    void BenchmarkKalman()
+    {
+        printf("Kalman filter stage, 360 Hz\n");
+
+        cKalmanFilterStage::sBenchmark result;
+        cKalmanFilterStage::Benchmark(1000, 720, 360, result);
+
+        printf("  %d tracks: %.0f ns per marker, %.0f ns per rigid body, error %.3f mm raw %.3f mm filtered, "
+               "%.3f deg raw %.3f deg filtered\n",
+               result.Tracks, result.NanosecondsPerMarker, result.NanosecondsPerRigidBody,
+               1000*result.PositionErrorRaw, 1000*result.PositionErrorFiltered,
+               result.RotationErrorRaw, result.RotationErrorFiltered);
+    }
+
+    void BenchmarkMarkerLinker2D()
+    {
+        printf("Marker linker 2D\n");
+
+        const float speeds[] = { 2, 6 };
+
+        for(int i=0; i<2; i++)
+        {
+            cMarkerLinker2D::sBenchmark result;
+            cMarkerLinker2D::Benchmark(2000, 300, speeds[i], result);
+
+            printf("  %d objects at %.0f px: %.1f us per frame, label errors %.5f, conflicts %.3f\n",
+                   result.Objects, speeds[i], result.MicrosecondsPerFrame, result.LabelErrorRate, result.ConflictFraction);
+        }
+    }
+
+    void BenchmarkMarkerLinker3D()
+    {
+        printf("Marker linker 3D, 240 Hz\n");
+
+        const float speeds[] = { 1, 3 };
+
+        for(int i=0; i<2; i++)
+        {
+            cMarkerLinker3D::sBenchmark result;
+            cMarkerLinker3D::Benchmark(5000, 600, speeds[i], 240, result);
+
+            printf("  %d markers at %.0f m/s: %.1f us per frame, label errors %.5f, recovery %.3f, conflicts %.3f\n",
+                   result.Markers, speeds[i], result.MicrosecondsPerFrame, result.LabelErrorRate,
+                   result.OcclusionRecovery, result.ConflictFraction);
+        }
+    }
+
+    void BenchmarkTriangulator()
+    {
+        printf("Triangulator\n");
+
+        cTriangulator::sBenchmark result;
+        cTriangulator::Benchmark(32, 1000, 60, result);
+
+        printf("  %d cameras %d markers: %.2f ms cold, %.3f ms warm, recall %.4f, %.2f ghosts, error %.2f mm\n",
+               result.Cameras, result.Markers, result.ColdMilliseconds, result.WarmMilliseconds,
+               result.Recall, result.Ghosts, 1000*result.MeanError);
+    }
+
+    void BenchmarkRigidBodySolver()
+    {
+        printf("Rigid body solver, 360 Hz\n");
+
+        cRigidBodySolver::sBenchmark result;
+        cRigidBodySolver::Benchmark(100, 2000, 360, result);
+
+        printf("  %d bodies: %.1f us per frame, %.0f bodies at rate, error %.4f degrees %.6f m\n",
+               result.Bodies, result.MicrosecondsPerFrame, result.BodiesAtRate, result.RotationError, result.PositionError);
+    }
+
+    void BenchmarkRigidBodyIdentifier()
+    {
+        printf("Rigid body identifier\n");
+
+        cRigidBodyIdentifier::sBenchmark result;
+        cRigidBodyIdentifier::Benchmark(50, 200, 300, result);
+
+        printf("  %d bodies %d clutter: %.2f ms cold, %.1f us per frame, recall %.5f, mislabeled %.5f\n",
+               result.Bodies, result.Clutter, result.ColdMilliseconds, result.MicrosecondsPerFrame,
+               result.Recall, result.Mislabeled);
+    }
+
+    void BenchmarkVectorPoseSolver()
+    {
+        printf("Vector pose solver\n");
+
+        const int         arrangements[] = { cVectorSettings::VectorClip, cVectorSettings::TrackClipPro };
+        const char *const names[]        = { "VectorClip",               "TrackClipPro" };
+
+        cVectorPoseSolver::sBenchmark result;
+
+        for(int i=0; i<2; i++)
+        {
+            cVectorPoseSolver::Benchmark(arrangements[i], 20000, result);
+
+            printf("  %-12s %d markers: %.0f ns tracking, %.0f ns acquiring, error %.4f, failures %.4f\n",
+                   names[i], result.Markers, result.NanosecondsPerSolve, result.NanosecondsPerAcquire,
+                   result.PositionError, result.Failures);
+        }
+
+        for(int markers=5; markers<=8; markers++)
+        {
+            cVectorPoseSolver::BenchmarkCustom(markers, 20000, result);
+
+            printf("  %-12s %d markers: %.0f ns tracking, %.0f ns acquiring, error %.4f, failures %.4f\n",
+                   "custom", result.Markers, result.NanosecondsPerSolve, result.NanosecondsPerAcquire,
+                   result.PositionError, result.Failures);
+        }
+    }
+
+    void BenchmarkMultiVectorTracker()
+    {
+        printf("Multi vector tracker\n");
+
+        const int markers[] = { 3, 4 };
+
+        for(int i=0; i<2; i++)
+        {
+            cMultiVectorTracker::sBenchmark result;
+            cMultiVectorTracker::Benchmark(16, markers[i], 3000, result);
+
+            printf("  %d x %d: %.1f us per frame vs %.1f us separate, tracked %.4f, mislabeled %.4f, error %.3f mm\n",
+                   result.Targets, result.Markers, result.MicrosecondsPerFrame, result.SeparateMicroseconds,
+                   result.TrackedFraction, result.MislabeledFraction, result.PositionError);
+        }
+    }
+
+    int RunBenchmarks()
+    {
+        BenchmarkStreamWriter();
+        BenchmarkTakeDeltaCodec();
+        BenchmarkGrayscaleCodec();
+        BenchmarkMJPEGDecoderPool();
+        BenchmarkBitmapRaster();
+        BenchmarkFrameRasterizer();
+        BenchmarkPoseStreamer();
+        BenchmarkPosePublisher();
+        BenchmarkPosePredictor();
+        BenchmarkSmoothing();
+        BenchmarkKalman();
+        BenchmarkMarkerLinker2D();
+        BenchmarkMarkerLinker3D();
+        BenchmarkTriangulator();
+        BenchmarkRigidBodySolver();
+        BenchmarkRigidBodyIdentifier();
+        BenchmarkVectorPoseSolver();
+        BenchmarkMultiVectorTracker();
+
+        return 0;
+    }
+
+    //== Step response of a smoothing filter, in frames after the step ==--
+
+    struct sStepResponse
+    {
+        int     PositionRise;                   //== First frame at 90% of the step ============----
+        int     PositionSettle;                 //== Stays within 2% after, -1 never ===========----
+        float   PositionOvershoot;              //== Peak beyond the step, fraction of it ======----
+        int     RotationRise;
+        int     RotationSettle;
+        float   RotationOvershoot;
+    };
+
+    void TrackStep(float Done, int Frame, int &Rise, int &Settle, float &Overshoot)
+    {
+        if(Rise<0 && Done>=0.9f)
+            Rise = Frame;
+
+        if(Done - 1.0f>Overshoot)
+            Overshoot = Done - 1.0f;
+
+        if(fabsf(Done - 1.0f)>0.02f)
+            Settle = -1;
+        else if(Settle<0)
+            Settle = Frame;
+    }
+
+    //== One filter's response to a unit position step and a 90 degree turn about Y, applied
+    //== once it has settled, watched for Frames frames ==--
+
+    void StepResponse(float Alpha, float Beta, int Frames, sStepResponse &Result)
+    {
+        Core::cDoubleExponentialSmoothing<1> filter;
+
+        filter.SetCount(1);
+        filter.SetPositionSmoothing(Alpha, Beta);
+        filter.SetRotationSmoothing(Alpha, Beta);
+
+        const float zero[3]     = { 0, 0, 0 };
+        const float step[3]     = { 1, 1, 1 };
+        const float identity[4] = { 0, 0, 0, 1 };
+        const float turned[4]   = { 0, 0.70710678f, 0, 0.70710678f };
+
+        filter.SetInput(0, zero, identity);
+        filter.Update();
+
+        Result.PositionRise      = Result.PositionSettle = -1;
+        Result.RotationRise      = Result.RotationSettle = -1;
+        Result.PositionOvershoot = Result.RotationOvershoot = 0;
+
+        filter.SetInput(0, step, turned);
+
+        for(int f=1; f<=Frames; f++)
+        {
+            filter.Update();
+
+            float position[3];
+            float rotation[4];
+
+            filter.Position(0, position);
+            filter.Rotation(0, rotation);
+
+            //== fraction of the step covered: along x, and as the angle about Y ==--
+
+            float positionDone = position[0];
+            float rotationDone = 2.0f*atan2f(rotation[1], rotation[3])/1.57079633f;
+
+            TrackStep(positionDone, f, Result.PositionRise, Result.PositionSettle, Result.PositionOvershoot);
+            TrackStep(rotationDone, f, Result.RotationRise, Result.RotationSettle, Result.RotationOvershoot);
+        }
+    }
+
+    //== Largest difference over Frames frames of random poses between a bank of five run by
+    //== Update() and the same bank run by UpdateScalar(), 0 where there is no SSE2 path ==--
+
+    float LaneDeviation(float Alpha, float Beta, int Frames)
+    {
+        typedef Core::cDoubleExponentialSmoothing<5> cBank;
+
+        cBank vector, scalar;
+
+        vector.SetCount(5);
+        vector.SetPositionSmoothing(Alpha, Beta);
+        vector.SetRotationSmoothing(Alpha, Beta);
+
+        scalar.SetCount(5);
+        scalar.SetPositionSmoothing(Alpha, Beta);
+        scalar.SetRotationSmoothing(Alpha, Beta);
+
+        cBenchmarkNoise noise(2463534242u);
+
+        float worst = 0;
+
+        for(int f=0; f<Frames; f++)
+        {
+            for(int i=0; i<5; i++)
+            {
+                float position[3];
+                float rotation[4];
+                float length = 0;
+
+                for(int c=0; c<3; c++)
+                    position[c] = noise.Signed();
+
+                for(int c=0; c<4; c++)
+                {
+                    rotation[c] = noise.Signed();
+                    length     += rotation[c]*rotation[c];
+                }
+
+                for(int c=0; c<4; c++)
+                    rotation[c] /= sqrtf(length + 1e-30f);
+
+                vector.SetInput(i, position, rotation);
+                scalar.SetInput(i, position, rotation);
+            }
+
+            vector.Update();
+            scalar.UpdateScalar();
+
+            for(int i=0; i<5; i++)
+            {
+                float a[4], b[4];
+
+                vector.Position(i, a);
+                scalar.Position(i, b);
+
+                for(int c=0; c<3; c++)
+                    worst = std::max(worst, fabsf(a[c] - b[c]));
+
+                vector.Rotation(i, a);
+                scalar.Rotation(i, b);
+
+                for(int c=0; c<4; c++)
+                    worst = std::max(worst, fabsf(a[c] - b[c]));
+            }
+        }
+
+        return worst;
+    }
+
+    //== Holt's recurrence in double for a unit step after a settled start, scored the way
+    //== StepResponse() scores it: rise at 90%, settled once it stays within 2% ==--
+
+    void ReferenceStep(double Alpha, double Beta, int Frames, int &Rise, int &Settle, double &Overshoot)
+    {
+        double level = 0;
+        double trend = 0;
+
+        Rise      = -1;
+        Settle    = -1;
+        Overshoot = 0;
+
+        for(int f=1; f<=Frames; f++)
+        {
+            double previous = level;
+
+            level = Alpha + (1 - Alpha)*(level + trend);
+            trend = Beta*(level - previous) + (1 - Beta)*trend;
+
+            if(Rise<0 && level>=0.9)
+                Rise = f;
+
+            if(level - 1>Overshoot)
+                Overshoot = level - 1;
+
+            if(fabs(level - 1)>0.02)
+                Settle = -1;
+            else if(Settle<0)
+                Settle = f;
+        }
+    }
+
+    //== The smoothing filters against the reference, rotation against position, and the SSE2
+    //== lanes against the scalar loop ==--
+
+    int SelfTestSmoothing()
+    {
+        const float parameters[][2] = { { 1.0f, 1.0f }, { 0.8f, 0.3f }, { 0.5f, 0.5f }, { 0.5f, 0.1f },
+                                        { 0.3f, 0.1f }, { 0.2f, 0.05f }, { 0.1f, 0.1f } };
+        const int   count           = sizeof(parameters)/sizeof(parameters[0]);
+        const int   frames          = 200;
+
+        int failures = 0;
+
+        for(int i=0; i<count; i++)
+        {
+            float alpha = parameters[i][0];
+            float beta  = parameters[i][1];
+
+            sStepResponse response;
+            StepResponse(alpha, beta, frames, response);
+
+            int    rise, settle;
+            double overshoot;
+
+            ReferenceStep(alpha, beta, frames, rise, settle, overshoot);
+
+            float lanes = LaneDeviation(alpha, beta, 2000);
+
+            //== a frame of slack where float and double land either side of a threshold ==--
+
+            bool ok = response.PositionRise>0 && response.PositionSettle>0
+                   && abs(response.PositionRise - rise)<=1
+                   && abs(response.PositionSettle - settle)<=1
+                   && fabs(response.PositionOvershoot - overshoot)<=1e-3
+                   && response.RotationRise>0 && response.RotationSettle>0
+                   && abs(response.RotationRise - response.PositionRise)<=1
+                   && abs(response.RotationSettle - response.PositionSettle)<=1
+                   && fabs(response.RotationOvershoot - response.PositionOvershoot)<=5e-3
+                   && lanes<=1e-6f;
+
+            printf("%s alpha %.2f beta %.2f: rise %d/%d (%d), settle %d/%d (%d), overshoot %.4f/%.4f (%.4f), lanes %g\n",
+                   ok ? "ok  " : "FAIL", alpha, beta,
+                   response.PositionRise, response.RotationRise, rise,
+                   response.PositionSettle, response.RotationSettle, settle,
+                   response.PositionOvershoot, response.RotationOvershoot, overshoot, lanes);
+
+            if(!ok)
+                failures++;
+        }
+
+        printf("%d of %d smoothing cases failed\n", failures, count);
+
+        return failures;
+    }
+
+    //== Known images through cJPEGEncoder and back: a flat field has to come back exactly, the
+    //== test card within the quality's error, and with restart markers every interval has to
+    //== decode on its own (last to first) to the same image as the whole scan ==--
+
+    void TestCard(int Width, int Height, std::vector<unsigned char> &Image)
+    {
+        Image.resize(Width*Height);
+
+        for(int y=0; y<Height; y++)
+        {
+            for(int x=0; x<Width; x++)
+            {
+                int   value = (x*255)/(Width-1);                        //== horizontal ramp ==--
+                float dx    = x - 0.7f*Width;
+                float dy    = y - 0.4f*Height;
+
+                if(y>=Height/2)
+                    value = (((x/6) + (y/6)) & 1) ? 200 : 30;           //== checkerboard ==--
+
+                if(dx*dx + dy*dy<64)
+                    value = 250;                                        //== marker ==--
+
+                Image[y*Width + x] = (unsigned char) value;
+            }
+        }
+    }
+
+    int SelfTestJPEGDecoder()
+    {
+        const int kWidth  = 100;                //== Partial blocks on both edges ============----
+        const int kHeight = 75;
+
+        std::vector<unsigned char> flat(kWidth*kHeight, 77);
+        std::vector<unsigned char> card;
+
+        TestCard(kWidth, kHeight, card);
+
+        struct sCase
+        {
+            const char *          Name;
+            const unsigned char * Image;
+            int                   Quality;
+            int                   MaxError;
+            double                MinPSNR;
+        };
+
+        const sCase cases[] =
+        {
+            { "flat",      &flat[0], 90,  0,  0.0 },
+            { "test card", &card[0], 90, 40, 34.0 },
+            { "test card", &card[0], 50, 80, 26.0 },
+        };
+
+        const int restarts[] = { 0, 1, 5, (kWidth+7)/8 };     //== Blocks, the last one a row ==----
+
+        int failures = 0;
+        int count    = 0;
+
+        for(int c=0; c<3; c++)
+        {
+            for(int r=0; r<4; r++)
+            {
+                const sCase &test = cases[c];
+
+                std::vector<unsigned char> jpeg;
+                cJPEGEncoder::Encode(test.Image, kWidth, kHeight, kWidth, test.Quality, restarts[r], jpeg);
+
+                std::vector<unsigned char> whole(kWidth*kHeight, 0);
+                std::vector<unsigned char> pieces(kWidth*kHeight, 0);
+
+                cJPEGDecoder decoder;
+
+                bool ok = decoder.Decode(&jpeg[0], (int) jpeg.size(), &whole[0], kWidth)
+                       && decoder.Width()==kWidth && decoder.Height()==kHeight
+                       && decoder.RestartInterval()==restarts[r];
+
+                int blocks   = ((kWidth+7)/8)*((kHeight+7)/8);
+                int segments = restarts[r] ? (blocks + restarts[r] - 1)/restarts[r] : 1;
+
+                ok = ok && decoder.SegmentCount()==segments;
+
+                for(int i=decoder.SegmentCount()-1; ok && i>=0; i--)
+                    ok = decoder.DecodeSegments(i, 1, &pieces[0], kWidth);
+
+                ok = ok && memcmp(&whole[0], &pieces[0], whole.size())==0;
+
+                int    maxError = 0;
+                double squared  = 0;
+
+                for(size_t p=0; p<whole.size(); p++)
+                {
+                    int error = abs((int) whole[p] - (int) test.Image[p]);
+
+                    maxError  = std::max(maxError, error);
+                    squared  += error*error;
+                }
+
+                double psnr = squared>0 ? 10*log10(255.0*255.0*whole.size()/squared) : 99.0;
+
+                ok = ok && maxError<=test.MaxError && psnr>=test.MinPSNR;
+
+                printf("%s JPEG %-9s quality %d, restart %2d: %d bytes, %d segments, max error %d, PSNR %.1f dB\n",
+                       ok ? "ok  " : "FAIL", test.Name, test.Quality, restarts[r], (int) jpeg.size(),
+                       decoder.SegmentCount(), maxError, psnr);
+
+                if(!ok)
+                    failures++;
+
+                count++;
+            }
+        }
+
+        printf("%d of %d JPEG cases failed\n", failures, count);
+
+        return failures;
+    }
+
+    //== DecodeRegions() against DecodeSegments(): inside the blocks a rectangle touches the pixels
+    //== match the whole image, everything else keeps its fill.  Also once per restart interval,
+    //== last to first, through the segment range overload ==--
+
+    int SelfTestJPEGRegions()
+    {
+        const int           kWidth  = 203;
+        const int           kHeight = 157;
+        const unsigned char kFill   = 0xA5;
+
+        std::vector<unsigned char> card;
+
+        TestCard(kWidth, kHeight, card);
+
+        const cJPEGDecoder::sRect rects[] =
+        {
+            {  10,  12,  30,  25 },             //== interior, block aligned neither way ==--
+            {  -6, 140,   4, 170 },             //== past the left and bottom edges ==--
+            { 190,  -3, 260,   9 },             //== past the right and top edges ==--
+            {  24,  20,  60,  64 },             //== overlaps the first ==--
+            { 120,  70, 120,  70 },             //== a single pixel ==--
+            { 300, 300, 320, 320 },             //== outside the image ==--
+        };
+        const int rectCount = sizeof(rects)/sizeof(rects[0]);
+
+        const int restarts[] = { 0, 3, (kWidth+7)/8 };
+
+        int blocksPerRow = (kWidth +7)/8;
+        int blockRows    = (kHeight+7)/8;
+
+        std::vector<unsigned char> mask(blocksPerRow*blockRows, 0);
+
+        for(int i=0; i<rectCount; i++)
+        {
+            int left   = std::max(rects[i].Left, 0);
+            int top    = std::max(rects[i].Top, 0);
+            int right  = std::min(rects[i].Right, kWidth-1);
+            int bottom = std::min(rects[i].Bottom, kHeight-1);
+
+            for(int y=top/8; y<=bottom/8 && left<=right; y++)
+            {
+                for(int x=left/8; x<=right/8; x++)
+                    mask[y*blocksPerRow + x] = 1;
+            }
+        }
+
+        int failures = 0;
+        int count    = 0;
+
+        for(int r=0; r<3; r++)
+        {
+            std::vector<unsigned char> jpeg;
+            cJPEGEncoder::Encode(&card[0], kWidth, kHeight, kWidth, 90, restarts[r], jpeg);
+
+            cJPEGDecoder decoder;
+
+            std::vector<unsigned char> whole(kWidth*kHeight, 0);
+
+            bool parsed = decoder.Decode(&jpeg[0], (int) jpeg.size(), &whole[0], kWidth);
+
+            for(int split=0; split<2; split++)
+            {
+                std::vector<unsigned char> regions(kWidth*kHeight, kFill);
+
+                bool ok = parsed;
+
+                if(split==0)
+                {
+                    ok = ok && decoder.DecodeRegions(rects, rectCount, &regions[0], kWidth);
+                }
+                else
+                {
+                    for(int i=decoder.SegmentCount()-1; ok && i>=0; i--)
+                        ok = decoder.DecodeRegions(rects, rectCount, i, 1, &regions[0], kWidth);
+                }
+
+                int inside      = 0;
+                int wrong       = 0;
+                int overwritten = 0;
+
+                for(int y=0; y<kHeight; y++)
+                {
+                    for(int x=0; x<kWidth; x++)
+                    {
+                        int p = y*kWidth + x;
+
+                        if(mask[(y/8)*blocksPerRow + x/8])
+                        {
+                            inside++;
+                            wrong += (regions[p]!=whole[p]);
+                        }
+                        else
+                        {
+                            overwritten += (regions[p]!=kFill);
+                        }
+                    }
+                }
+
+                ok = ok && inside>0 && wrong==0 && overwritten==0;
+
+                printf("%s JPEG regions restart %2d, %-9s: %d segments, %d pixels in blocks, %d differ, %d outside written\n",
+                       ok ? "ok  " : "FAIL", restarts[r], split ? "intervals" : "whole",
+                       decoder.SegmentCount(), inside, wrong, overwritten);
+
+                if(!ok)
+                    failures++;
+
+                count++;
+            }
+        }
+
+        printf("%d of %d JPEG region cases failed\n", failures, count);
+
+        return failures;
+    }
+
+    int RunSelfTest()
+    {
+        int failures = SelfTestSmoothing();
+
+        failures += SelfTestJPEGDecoder();
+        failures += SelfTestJPEGRegions();
+
+        return failures ? 1 : 0;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    CameraLibrary_EnableDevelopment();
+
+    int         headlessFrames = 1000;
+    int         renderInterval = 1;
+    const char *publishName    = 0;
+    const char *takeName       = 0;
+    double      takeSpeed      = 0;
+    bool        benchmark      = false;
+    bool        selfTest       = false;
+
+    cPoseStreamer streamer;
+
+    for(int arg=1; arg<argc; arg++)
+    {
+        if(strcmp(argv[arg], "-headless")==0)
+        {
+            if(arg+1<argc && argv[arg+1][0]!='-')
+                headlessFrames = atoi(argv[++arg]);
+
+            if(arg+1<argc && argv[arg+1][0]!='-')
+                renderInterval = atoi(argv[++arg]);
+        }
+        else if(strcmp(argv[arg], "-benchmark")==0)
+        {
+            benchmark = true;
+        }
+        else if(strcmp(argv[arg], "-selftest")==0)
+        {
+            selfTest = true;
+        }
+        else if(strcmp(argv[arg], "-take")==0 && arg+1<argc)
+        {
+            takeName = argv[++arg];
+
+            if(arg+1<argc && argv[arg+1][0]!='-')
+                takeSpeed = atof(argv[++arg]);
+        }
+        else if(strcmp(argv[arg], "-publish")==0 && arg+1<argc)
+        {
+            publishName = argv[++arg];
+        }
+        else if(strcmp(argv[arg], "-stream")==0 && arg+1<argc)
+        {
+            const char *address = argv[++arg];
+            int         port    = kPoseStreamDefaultPort;
+
+            if(arg+1<argc && argv[arg+1][0]!='-')
+                port = atoi(argv[++arg]);
+
+            if((streamer.IsOpen() || streamer.Open()) && streamer.AddDestination(address, port))
+                continue;
+
+            printf("Unable to stream poses to %s:%d\n", address, port);
+        }
+        else
+        {
+            printf("Unknown option %s\n", argv[arg]);
+            return 1;
+        }
+    }
+
+    if(selfTest)
+        return RunSelfTest();
+
+    if(benchmark)
+        return RunBenchmarks();
+
+    if(takeName)
+        return RunTake(takeName, takeSpeed, publishName, streamer);
+
+    return RunHeadless(headlessFrames, renderInterval, publishName, streamer);
+}
@@ -0,0 +1,227 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <math.h>
+#include <algorithm>
+
+#include "epipolarindex.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    const float kFullCircle = 4.0f;         //== Pseudo angle period ==========================----
+}
+
+cEpipolarIndex::cEpipolarIndex()
+    : mCameraCount(0)
+    , mBins(16)
+{
+}
+
+void cEpipolarIndex::SetCameras(const std::vector<sCamera> &Cameras)
+{
+    mCameraCount = (int) Cameras.size();
+
+    mBaselines.assign(mCameraCount*mCameraCount, sBaseline());
+
+    for(int a=0; a<mCameraCount; a++)
+    {
+        for(int b=a + 1; b<mCameraCount; b++)
+        {
+            sBaseline &baseline = mBaselines[a*mCameraCount + b];
+
+            double axis[3];
+            double length = 0;
+
+            for(int k=0; k<3; k++)
+            {
+                axis[k] = Cameras[b].Position[k] - Cameras[a].Position[k];
+                length += axis[k]*axis[k];
+            }
+
+            length = sqrt(length);
+
+            if(length<1e-9)
+                length = 1;
+
+            for(int k=0; k<3; k++)
+                axis[k] /= length;
+
+            //== U: the world axis least aligned with the baseline, made perpendicular ==--
+
+            int least = 0;
+
+            for(int k=1; k<3; k++)
+                if(fabs(axis[k])<fabs(axis[least]))
+                    least = k;
+
+            double u[3] = { -axis[least]*axis[0], -axis[least]*axis[1], -axis[least]*axis[2] };
+
+            u[least] += 1;
+
+            double norm = sqrt(u[0]*u[0] + u[1]*u[1] + u[2]*u[2]);
+
+            for(int k=0; k<3; k++)
+                baseline.U[k] = (float) (u[k]/norm);
+
+            baseline.V[0] = (float) ((axis[1]*u[2] - axis[2]*u[1])/norm);
+            baseline.V[1] = (float) ((axis[2]*u[0] - axis[0]*u[2])/norm);
+            baseline.V[2] = (float) ((axis[0]*u[1] - axis[1]*u[0])/norm);
+        }
+    }
+
+    mBinStart.assign(mCameraCount*mCameraCount*mBins + 1, 0);
+
+    Clear();
+}
+
+float cEpipolarIndex::Angle(float X, float Y)
+{
+    //== "diamond" angle: same order as atan2(Y, X) over [0,4), slope between 1/2 and 1 ==--
+
+    float sum = fabsf(X) + fabsf(Y);
+
+    if(sum<=0)
+        return 0;
+
+    if(Y>=0)
+        return (X>=0) ? Y/sum : 1 - X/sum;
+
+    return (X<0) ? 2 - Y/sum : 3 + X/sum;
+}
+
+void cEpipolarIndex::Clear()
+{
+    mStaged.clear();
+    mStagedList.clear();
+}
+
+void cEpipolarIndex::Add(int Camera, int Ray, const float Direction[3])
+{
+    //== one entry per other camera, keyed by the angle in that pair's frame ==--
+
+    for(int o=0; o<mCameraCount; o++)
+    {
+        if(o==Camera)
+            continue;
+
+        const sBaseline &baseline = Baseline(Camera, o);
+
+        sEntry entry;
+
+        entry.Angle = Angle(Direction[0]*baseline.U[0] + Direction[1]*baseline.U[1] + Direction[2]*baseline.U[2],
+                            Direction[0]*baseline.V[0] + Direction[1]*baseline.V[1] + Direction[2]*baseline.V[2]);
+        entry.Ray   = Ray;
+
+        mStaged.push_back(entry);
+        mStagedList.push_back(Camera*mCameraCount + o);
+    }
+}
+
+void cEpipolarIndex::Build()
+{
+    //== every list is cut into mBins equal angle bins, about one entry per bin, and all entries
+    //== are counting sorted by (list, bin) in one pass
+
+    int lists   = mCameraCount*mCameraCount;
+    int entries = (int) mStaged.size();
+    int longest = 0;
+
+    mListCount.assign(lists, 0);
+
+    for(int e=0; e<entries; e++)
+        mListCount[mStagedList[e]]++;
+
+    for(int l=0; l<lists; l++)
+        longest = std::max(longest, mListCount[l]);
+
+    mBins = 16;
+
+    while(mBins<longest)
+        mBins <<= 1;
+
+    mBinStart.assign(lists*mBins + 1, 0);
+    mEntries.resize(entries);
+
+    float scale = mBins/kFullCircle;
+
+    for(int e=0; e<entries; e++)
+    {
+        int bin = mStagedList[e]*mBins + std::min((int) (mStaged[e].Angle*scale), mBins - 1);
+
+        mStagedList[e] = bin;
+        mBinStart[bin + 1]++;
+    }
+
+    for(int b=0; b<lists*mBins; b++)
+        mBinStart[b + 1] += mBinStart[b];
+
+    //== fill advances every bin's start to its end, shift back afterwards ==--
+
+    for(int e=0; e<entries; e++)
+        mEntries[mBinStart[mStagedList[e]]++] = mStaged[e];
+
+    for(int b=lists*mBins; b>0; b--)
+        mBinStart[b] = mBinStart[b - 1];
+
+    mBinStart[0] = 0;
+}
+
+void cEpipolarIndex::Range(int List, float Low, float High, std::vector<int> &Rays) const
+{
+    float scale = mBins/kFullCircle;
+
+    int first = List*mBins + std::min((int) (Low*scale), mBins - 1);
+    int last  = List*mBins + std::min((int) (High*scale), mBins - 1);
+
+    for(int e=mBinStart[first]; e<mBinStart[last + 1]; e++)
+        if(mEntries[e].Angle>=Low && mEntries[e].Angle<=High)
+            Rays.push_back(mEntries[e].Ray);
+}
+
+void cEpipolarIndex::Query(int Camera, int Other, const float Direction[3], float Radius, float Depth,
+                           std::vector<int> &Rays) const
+{
+    int list = Other*mCameraCount + Camera;
+
+    if(mBinStart[list*mBins]==mBinStart[(list + 1)*mBins])
+        return;
+
+    const sBaseline &baseline = Baseline(Camera, Other);
+
+    float x = Direction[0]*baseline.U[0] + Direction[1]*baseline.U[1] + Direction[2]*baseline.U[2];
+    float y = Direction[0]*baseline.V[0] + Direction[1]*baseline.V[1] + Direction[2]*baseline.V[2];
+
+    //== beyond Depth the ray is at least Depth * |perpendicular part| from the baseline, a miss
+    //== by Radius turns the plane by at most asin(Radius / that); the pseudo angle moves less
+
+    float distance = Depth*sqrtf(x*x + y*y) - Radius;
+
+    if(distance<=0 || Radius>=0.5f*distance)
+    {
+        Range(list, 0, kFullCircle, Rays);
+        return;
+    }
+
+    float angle     = Angle(x, y);
+    float tolerance = Radius/distance;
+
+    float low  = angle - tolerance;
+    float high = angle + tolerance;
+
+    if(low<0)
+    {
+        Range(list, low + kFullCircle, kFullCircle, Rays);
+        low = 0;
+    }
+
+    if(high>=kFullCircle)
+    {
+        Range(list, 0, high - kFullCircle, Rays);
+        high = kFullCircle;
+    }
+
+    Range(list, low, high, Rays);
+}
@@ -0,0 +1,98 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Cross camera candidate lookup.  Every epipolar plane of a camera pair contains the baseline
+//== between the two camera centers, so a plane is identified by its angle around the baseline.
+//== Two rays that meet in a point lie in the same plane and therefore have the same angle, and
+//== rays that nearly meet have nearly the same angle.
+//==
+//== The baseline frames are precomputed from the camera poses when the cameras are set.  Every
+//== frame, each observation's world direction (undistorted with the camera's DistortionModel and
+//== rotated by its orientation) is binned once per camera pair by its epipolar angle; the
+//== candidates for a ray in another camera are then a range of bins.
+//==
+//== Angles are pseudo angles in [0,4) (monotonic in the true angle, no trigonometry) and the
+//== tolerance is widened accordingly, so the ranges are a superset; callers verify candidates.
+//==
+
+#ifndef __CAMERALIBRARY__EPIPOLARINDEX_H__
+#define __CAMERALIBRARY__EPIPOLARINDEX_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <vector>
+#include "coremath.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cEpipolarIndex
+    {
+    public:
+        struct sCamera
+        {
+            int                   Serial;           //== Matched against Camera::Serial() ======----
+            double                Position[3];      //== World, meters =========================----
+            double                Orientation[9];   //== Camera to world, row major ============----
+            Core::DistortionModel Model;
+        };
+
+        cEpipolarIndex();
+
+        void    SetCameras(const std::vector<sCamera> &Cameras);
+        int     CameraCount() const                 { return mCameraCount; }
+
+        //== Per frame: Clear(), Add() every observation, Build(), then Query() ==--
+
+        void    Clear();
+        void    Add(int Camera, int Ray, const float Direction[3]);     //== Unit, world ======----
+        void    Build();
+
+        //== Appends the rays of Other that may pass within Radius of the ray leaving Camera along
+        //== Direction, anywhere beyond Depth (meters from the camera) along it.
+
+        void    Query(int Camera, int Other, const float Direction[3], float Radius, float Depth,
+                      std::vector<int> &Rays) const;
+
+        int     EntryCount() const                  { return (int) mEntries.size(); }
+
+    private:
+        struct sBaseline
+        {
+            float   U[3];                       //== Orthonormal, perpendicular to the baseline ----
+            float   V[3];
+        };
+
+        struct sEntry
+        {
+            float   Angle;
+            int     Ray;
+        };
+
+        static float Angle(float X, float Y);
+
+        const sBaseline & Baseline(int A, int B) const
+        {
+            return (A<B) ? mBaselines[A*mCameraCount + B] : mBaselines[B*mCameraCount + A];
+        }
+
+        void    Range(int List, float Low, float High, std::vector<int> &Rays) const;
+
+        int                         mCameraCount;
+        std::vector<sBaseline>      mBaselines;         //== [A*count + B], A < B ===========----
+
+        //== List [C*count + O] holds camera C's rays binned by their angle in the (C, O) frame ==--
+
+        int                         mBins;              //== Per list, power of two =========----
+        std::vector<int>            mListCount;
+        std::vector<int>            mBinStart;          //== [list*mBins + bin] -> first entry --
+        std::vector<sEntry>         mEntries;
+        std::vector<int>            mStagedList;        //== List, then bin of every entry ==----
+        std::vector<sEntry>         mStaged;
+    };
+}
+
+#endif
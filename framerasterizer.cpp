@@ -0,0 +1,485 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include <string.h>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define FRAMERASTERIZER_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "framerasterizer.h"
+#include "bitmapraster.h"
+#include "bitmap.h"
+#include "camera.h"
+#include "frame.h"
+
+#include "Core/Timer.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    const int kMaxDecimation  = 16;             //== 16*16*255 still fits the 16-bit sums ======----
+    const int kMinBandRows    = 16;
+    const int kBandsPerThread = 4;              //== Smaller bands even out uneven threads ====----
+
+#ifdef WIN32
+    unsigned long __stdcall RasterizerThreadProc(void *Param)
+    {
+        cFrameRasterizer::sWorker *worker = (cFrameRasterizer::sWorker*) Param;
+        worker->Rasterizer->WorkerThread(worker);
+        return 0;
+    }
+#else
+    void RasterizerThreadProc(void *Param)
+    {
+        cFrameRasterizer::sWorker *worker = (cFrameRasterizer::sWorker*) Param;
+        worker->Rasterizer->WorkerThread(worker);
+    }
+#endif
+
+    int ProcessorCount()
+    {
+#ifdef WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return (int) info.dwNumberOfProcessors;
+#else
+        return (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    }
+
+    //== Box filter ==--
+
+    void AccumulateRow(const unsigned char *Row, unsigned short *Sums, int Count, bool First)
+    {
+        int i = 0;
+
+#ifdef FRAMERASTERIZER_SSE2
+        __m128i zero = _mm_setzero_si128();
+
+        for(; i+16<=Count; i+=16)
+        {
+            __m128i row = _mm_loadu_si128((const __m128i*) (Row+i));
+            __m128i lo  = _mm_unpacklo_epi8(row, zero);
+            __m128i hi  = _mm_unpackhi_epi8(row, zero);
+
+            if(!First)
+            {
+                lo = _mm_add_epi16(lo, _mm_loadu_si128((const __m128i*) (Sums+i)));
+                hi = _mm_add_epi16(hi, _mm_loadu_si128((const __m128i*) (Sums+i+8)));
+            }
+
+            _mm_storeu_si128((__m128i*) (Sums+i),   lo);
+            _mm_storeu_si128((__m128i*) (Sums+i+8), hi);
+        }
+#endif
+
+        for(; i<Count; i++)
+            Sums[i] = (unsigned short) ((First ? 0 : Sums[i]) + Row[i]);
+    }
+
+    void ReduceSums(const unsigned short *Sums, unsigned char *Line, int Width, int Factor)
+    {
+        int          area  = Factor*Factor;
+        unsigned int half  = area/2;
+        int          shift = -1;
+
+        for(int s=0; s<=8; s++)
+        {
+            if((1<<s)==area)
+                shift = s;
+        }
+
+        //== exact (v + area/2) / area for v < 2^16 and area < 256 with a 2^24 reciprocal ==--
+
+        unsigned long long reciprocal = ((1ULL<<24) / area) + 1;
+
+        int x = 0;
+
+#ifdef FRAMERASTERIZER_SSE2
+        if(Factor==2 || Factor==4)
+        {
+            //== pairwise horizontal sums with madd, twice for 4, 8 outputs per iteration ==--
+
+            __m128i ones    = _mm_set1_epi16(1);
+            __m128i rounder = _mm_set1_epi16((short) half);
+
+            for(; x+8<=Width; x+=8)
+            {
+                const unsigned short *sums = Sums + x*Factor;
+
+                __m128i a = _mm_madd_epi16(_mm_loadu_si128((const __m128i*) (sums)),   ones);
+                __m128i b = _mm_madd_epi16(_mm_loadu_si128((const __m128i*) (sums+8)), ones);
+
+                __m128i total = _mm_packs_epi32(a, b);
+
+                if(Factor==4)
+                {
+                    __m128i c = _mm_madd_epi16(_mm_loadu_si128((const __m128i*) (sums+16)), ones);
+                    __m128i d = _mm_madd_epi16(_mm_loadu_si128((const __m128i*) (sums+24)), ones);
+
+                    total = _mm_packs_epi32(_mm_madd_epi16(total, ones),
+                                            _mm_madd_epi16(_mm_packs_epi32(c, d), ones));
+                }
+
+                total = _mm_srl_epi16(_mm_add_epi16(total, rounder), _mm_cvtsi32_si128(shift));
+
+                _mm_storel_epi64((__m128i*) (Line+x), _mm_packus_epi16(total, total));
+            }
+        }
+#endif
+
+        for(; x<Width; x++)
+        {
+            unsigned int sum = half;
+
+            for(int k=0; k<Factor; k++)
+                sum += Sums[x*Factor + k];
+
+            if(shift>=0)
+                Line[x] = (unsigned char) (sum >> shift);
+            else
+                Line[x] = (unsigned char) ((sum * reciprocal) >> 24);
+        }
+    }
+}
+
+cFrameRasterizer::cFrameRasterizer(int ThreadCount)
+    : mDecimation(1)
+    , mLastSeconds(0)
+    , mRunning(true)
+{
+    memset(&mJob, 0, sizeof(mJob));
+
+    if(ThreadCount<=0)
+        ThreadCount = ProcessorCount();
+
+    //== the calling thread works too ==--
+
+    for(int i=1; i<ThreadCount; i++)
+    {
+        sWorker *worker = new sWorker();
+        worker->Rasterizer = this;
+
+        mWorkers.push_back(worker);
+
+#ifdef WIN32
+        worker->Thread.StartThread((void*) RasterizerThreadProc, worker);
+#else
+        worker->Thread.StartThread(RasterizerThreadProc, worker);
+#endif
+    }
+}
+
+cFrameRasterizer::~cFrameRasterizer()
+{
+    mRunning = false;
+
+    for(int i=0; i<(int) mWorkers.size(); i++)
+    {
+        mWorkAvailable.Trigger();
+        mWorkers[i]->Thread.StopThread();
+        delete mWorkers[i];
+    }
+}
+
+void cFrameRasterizer::SetDecimation(int Factor)
+{
+    if(Factor<1)
+        Factor = 1;
+
+    if(Factor>kMaxDecimation)
+        Factor = kMaxDecimation;
+
+    mDecimation = Factor;
+}
+
+void cFrameRasterizer::Rasterize(Frame *Frame, Bitmap *Target)
+{
+    Rasterize(Frame, Target->PixelWidth(), Target->PixelHeight(), Target->ByteSpan(),
+              Target->GetBitsPerPixel(), Target->GetBits());
+}
+
+void cFrameRasterizer::Rasterize(Frame *Frame, unsigned int Width, unsigned int Height, unsigned int Span,
+                                 unsigned int BitsPerPixel, void *Buffer)
+{
+    unsigned char *image = Frame->IsGrayscale() ? Frame->GetGrayscaleData() : 0;
+    int            size  = Frame->GetGrayscaleDataSize();
+    int            imageWidth  = Frame->Width();
+    int            imageHeight = Frame->Height();
+
+    //== camera side grayscale decimation shrinks the image but not the frame size ==--
+
+    if(image && imageWidth*imageHeight!=size && Frame->GetCamera())
+    {
+        int decimation = Frame->GetCamera()->GrayscaleDecimation();
+
+        if(decimation>1)
+        {
+            imageWidth  /= decimation;
+            imageHeight /= decimation;
+        }
+    }
+
+    if(image==0 || imageWidth<=0 || imageWidth*imageHeight!=size
+       || !Rasterize(image, imageWidth, imageHeight, imageWidth, Width, Height, Span, BitsPerPixel, Buffer))
+    {
+        Frame->Rasterize(Width, Height, Span, BitsPerPixel, Buffer);
+    }
+}
+
+bool cFrameRasterizer::Rasterize(const unsigned char *Image, int ImageWidth, int ImageHeight, int ImageSpan,
+                                 unsigned int Width, unsigned int Height, unsigned int Span,
+                                 unsigned int BitsPerPixel, void *Buffer)
+{
+    if(Image==0 || Buffer==0 || ImageWidth<=0 || ImageHeight<=0
+       || (BitsPerPixel!=8 && BitsPerPixel!=16 && BitsPerPixel!=24 && BitsPerPixel!=32))
+        return false;
+
+    Core::cTimer timer;
+
+    sJob job;
+
+    job.Image         = Image;
+    job.ImageSpan     = ImageSpan;
+    job.Buffer        = (unsigned char*) Buffer;
+    job.Span          = (int) Span;
+    job.BytesPerPixel = (int) BitsPerPixel/8;
+    job.Factor        = mDecimation;
+    job.Width         = ImageWidth/job.Factor;
+    job.Height        = ImageHeight/job.Factor;
+
+    if(job.Width>(int) Width)
+        job.Width = (int) Width;
+
+    if(job.Height>(int) Height)
+        job.Height = (int) Height;
+
+    if(job.Width<=0 || job.Height<=0)
+        return true;
+
+    int bands = ThreadCount()*kBandsPerThread;
+
+    if(bands*kMinBandRows>job.Height)
+        bands = (job.Height + kMinBandRows-1)/kMinBandRows;
+
+    job.BandRows  = (job.Height + bands-1)/bands;
+    job.BandCount = (job.Height + job.BandRows-1)/job.BandRows;
+    job.NextBand  = 0;
+    job.BandsDone = 0;
+
+    timer.CatchUp();
+
+    mLock.Lock();
+    mJob = job;
+    mLock.UnLock();
+
+    for(int i=0; i<(int) mWorkers.size() && i<job.BandCount-1; i++)
+        mWorkAvailable.Trigger();
+
+    while(RunBand(mScratch))
+        ;
+
+    //== wait for bands still running on the workers ==--
+
+    for(;;)
+    {
+        mLock.Lock();
+        bool done = (mJob.BandsDone==mJob.BandCount);
+        mLock.UnLock();
+
+        if(done)
+            break;
+
+        mBandDone.Wait(10);
+    }
+
+    mLock.Lock();
+    mJob.Image = 0;
+    mLock.UnLock();
+
+    mLastSeconds = timer.Elapsed();
+
+    return true;
+}
+
+bool cFrameRasterizer::RunBand(sScratch &Scratch)
+{
+    mLock.Lock();
+
+    if(mJob.Image==0 || mJob.NextBand>=mJob.BandCount)
+    {
+        mLock.UnLock();
+        return false;
+    }
+
+    int  band = mJob.NextBand++;
+    sJob job  = mJob;
+
+    mLock.UnLock();
+
+    int first = band*job.BandRows;
+    int last  = first + job.BandRows;
+
+    if(last>job.Height)
+        last = job.Height;
+
+    RasterizeRows(job, first, last, Scratch);
+
+    mLock.Lock();
+    bool done = (++mJob.BandsDone==mJob.BandCount);
+    mLock.UnLock();
+
+    if(done)
+        mBandDone.Trigger();
+
+    return true;
+}
+
+void cFrameRasterizer::RasterizeRows(const sJob &Job, int First, int Last, sScratch &Scratch) const
+{
+    int sourceWidth = Job.Width*Job.Factor;
+
+    if(Job.Factor>1)
+    {
+        Scratch.Sums.resize(sourceWidth);
+        Scratch.Line.resize(Job.Width);
+    }
+
+    for(int y=First; y<Last; y++)
+    {
+        const unsigned char *line = Job.Image + y*Job.Factor*Job.ImageSpan;
+
+        if(Job.Factor>1)
+        {
+            for(int k=0; k<Job.Factor; k++)
+                AccumulateRow(line + k*Job.ImageSpan, &Scratch.Sums[0], sourceWidth, k==0);
+
+            ReduceSums(&Scratch.Sums[0], &Scratch.Line[0], Job.Width, Job.Factor);
+
+            line = &Scratch.Line[0];
+        }
+
+        cBitmapRaster::ExpandGrayscale(line, Job.Buffer + y*Job.Span, Job.Width, Job.BytesPerPixel);
+    }
+}
+
+void cFrameRasterizer::WorkerThread(sWorker *Worker)
+{
+    while(mRunning && Worker->Thread.IsSteadyState())
+    {
+        if(!RunBand(Worker->Scratch))
+            mWorkAvailable.Wait(100);
+    }
+
+    Worker->Thread.mThreadRunning = false;
+}
+
+//== Benchmark =========================================================================================----
+
+void cFrameRasterizer::Benchmark(int Width, int Height, int ThreadCount, int Decimation, int Frames,
+                                 sBenchmark &Result)
+{
+    Width      = std::max(Width, 16);
+    Height     = std::max(Height, 16);
+    Frames     = std::max(Frames, 1);
+    Decimation = std::min(std::max(Decimation, 1), kMaxDecimation);
+
+    std::vector<unsigned char> image(Width*Height);
+
+    for(int i=0; i<(int) image.size(); i++)
+        image[i] = (unsigned char) (i*7 + i/Width);
+
+    //== Output at the decimated size, the reference box filtered one pixel at a time ==--
+
+    int width  = Width /Decimation;
+    int height = Height/Decimation;
+    int area   = Decimation*Decimation;
+    int span   = width*4;
+
+    std::vector<unsigned char> decimated(width*height);
+
+    for(int y=0; y<height; y++)
+    {
+        for(int x=0; x<width; x++)
+        {
+            int sum = area/2;
+
+            for(int v=0; v<Decimation; v++)
+                for(int u=0; u<Decimation; u++)
+                    sum += image[(y*Decimation + v)*Width + x*Decimation + u];
+
+            decimated[y*width + x] = (unsigned char) (sum/area);
+        }
+    }
+
+    std::vector<unsigned char> reference(span*height);
+    std::vector<unsigned char> bits(span*height);
+
+    Bitmap referenceBitmap(width, height, span, Bitmap::ThirtyTwoBit, &reference[0]);
+
+    cBitmapRaster::GrayscaleImage(referenceBitmap, &decimated[0], width, height, width);
+
+    //== Frame::Rasterize's share: every source row through the Bitmap, full size ==--
+
+    double bitmapSeconds;
+
+    {
+        std::vector<unsigned char> full(Width*4*Height);
+
+        Bitmap fullBitmap(Width, Height, Width*4, Bitmap::ThirtyTwoBit, &full[0]);
+
+        Core::cTimer timer;
+
+        timer.CatchUp();
+
+        for(int f=0; f<Frames; f++)
+        {
+            for(int y=0; y<Height; y++)
+                fullBitmap.HorizontalLineFrom8BitSource(0, y, Width-1, &image[y*Width]);
+        }
+
+        bitmapSeconds = timer.CatchUp();
+    }
+
+    double bandedSeconds;
+
+    {
+        cFrameRasterizer rasterizer(ThreadCount);
+
+        rasterizer.SetDecimation(Decimation);
+
+        ThreadCount = rasterizer.ThreadCount();
+
+        Core::cTimer timer;
+
+        timer.CatchUp();
+
+        for(int f=0; f<Frames; f++)
+            rasterizer.Rasterize(&image[0], Width, Height, Width, width, height, span, 32, &bits[0]);
+
+        bandedSeconds = timer.CatchUp();
+    }
+
+    int mismatches = 0;
+
+    for(int y=0; y<height; y++)
+        mismatches += (memcmp(&bits[y*span], &reference[y*span], span)!=0);
+
+    double megapixels = (double) Width*Height*Frames/1000000.0;
+
+    Result.ThreadCount            = ThreadCount;
+    Result.Decimation             = Decimation;
+    Result.BitmapMPixelsPerSecond = bitmapSeconds>0 ? megapixels/bitmapSeconds : 0;
+    Result.BandedMPixelsPerSecond = bandedSeconds>0 ? megapixels/bandedSeconds : 0;
+    Result.Mismatches             = mismatches;
+}
@@ -0,0 +1,122 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Multi-threaded grayscale frame rasterizer.  Frame::Rasterize converts the whole image on the
+//== calling thread, which a 4 MP camera at full rate is enough to saturate.  cFrameRasterizer
+//== splits the output into bands of rows that a pool of worker threads (and the caller) convert
+//== in parallel, optionally box-filter decimating by an integer factor in the same pass, so the
+//== host can display a smaller image without changing the camera's GrayscaleDecimation.
+//==
+//== Frames without grayscale image data (object modes) are passed on to Frame::Rasterize.
+//== Rasterize() is synchronous and must not be called from several threads at once.
+//==
+
+#ifndef __CAMERALIBRARY__FRAMERASTERIZER_H__
+#define __CAMERALIBRARY__FRAMERASTERIZER_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <vector>
+#include "threading.h"
+#include "lock.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class Frame;
+    class Bitmap;
+
+    class cFrameRasterizer
+    {
+    public:
+        cFrameRasterizer(int ThreadCount = 0);          //== 0: one thread per processor ======----
+        ~cFrameRasterizer();
+
+        void    SetDecimation(int Factor);              //== Box filter Factor x Factor (1-16) -
+        int     Decimation() const                  { return mDecimation; }
+
+        //== Same arguments as Frame::Rasterize, BitsPerPixel is 8, 16, 24 or 32 ==--
+
+        void    Rasterize(Frame *Frame, unsigned int Width, unsigned int Height, unsigned int Span,
+                          unsigned int BitsPerPixel, void *Buffer);
+        void    Rasterize(Frame *Frame, Bitmap *Target);
+
+        //== Rasterize an 8-bit image, false if arguments are invalid ==--
+
+        bool    Rasterize(const unsigned char *Image, int ImageWidth, int ImageHeight, int ImageSpan,
+                          unsigned int Width, unsigned int Height, unsigned int Span,
+                          unsigned int BitsPerPixel, void *Buffer);
+
+        int     ThreadCount() const                 { return (int) mWorkers.size() + 1; }
+        double  LastRasterizeSeconds() const        { return mLastSeconds; }
+
+        //== A Width x Height 8-bit image into a 32-bit buffer, Frames times, on ThreadCount threads
+        //== against the per row Bitmap conversion Frame::Rasterize does on the calling thread (a
+        //== Frame can't be handed a synthetic image, so the Bitmap loop stands in for it) ==--
+
+        struct sBenchmark
+        {
+            int     ThreadCount;
+            int     Decimation;
+            double  BitmapMPixelsPerSecond;     //== Source pixels, both ====================----
+            double  BandedMPixelsPerSecond;
+            int     Mismatches;                 //== Output rows unlike a scalar reference ==----
+        };
+
+        static void Benchmark(int Width, int Height, int ThreadCount, int Decimation, int Frames,
+                              sBenchmark &Result);
+
+        //== Internal use, thread entry point needs to be public ==--
+
+        struct sScratch
+        {
+            std::vector<unsigned short> Sums;           //== Vertical box sums ==============----
+            std::vector<unsigned char>  Line;           //== Decimated source row ===========----
+        };
+
+        struct sWorker
+        {
+            cFrameRasterizer * Rasterizer;
+            ThreadInfo         Thread;
+            sScratch           Scratch;
+        };
+
+        void    WorkerThread(sWorker *Worker);
+
+    private:
+        struct sJob
+        {
+            const unsigned char * Image;
+            int                   ImageSpan;
+            unsigned char *       Buffer;
+            int                   Span;
+            int                   BytesPerPixel;
+            int                   Width;                //== Output pixels ==================----
+            int                   Height;
+            int                   Factor;
+            int                   BandRows;
+            int                   BandCount;
+            int                   NextBand;
+            int                   BandsDone;
+        };
+
+        bool    RunBand(sScratch &Scratch);             //== False when no band is left ======----
+        void    RasterizeRows(const sJob &Job, int First, int Last, sScratch &Scratch) const;
+
+        std::vector<sWorker*> mWorkers;
+        sScratch              mScratch;                 //== Calling thread's ================----
+        sJob                  mJob;
+        int                   mDecimation;
+        double                mLastSeconds;
+
+        LockItem              mLock;
+        cEvent                mWorkAvailable;
+        cEvent                mBandDone;
+        volatile bool         mRunning;
+    };
+}
+
+#endif
@@ -0,0 +1,350 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define GRAYSCALECODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include <math.h>
+#include <algorithm>
+
+#include "grayscalecodec.h"
+#include "benchmarknoise.h"
+
+#include "Core/Timer.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    const int kLiteralBreak = 3;                //== Zeros that end a literal run =============----
+
+    inline int CountTrailingZeros(unsigned int Value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, Value);
+        return (int) index;
+#else
+        return __builtin_ctz(Value);
+#endif
+    }
+
+    //== Prediction ==--
+
+    void PredictRow(const unsigned char *Row, const unsigned char *Above, unsigned char *Residual, int Width)
+    {
+        if(Above==0)
+        {
+            memcpy(Residual, Row, Width);
+            return;
+        }
+
+        int x = 0;
+
+#ifdef GRAYSCALECODEC_SSE2
+        for(; x+16<=Width; x+=16)
+        {
+            __m128i current = _mm_loadu_si128((const __m128i*) (Row+x));
+            __m128i above   = _mm_loadu_si128((const __m128i*) (Above+x));
+
+            _mm_storeu_si128((__m128i*) (Residual+x), _mm_sub_epi8(current, above));
+        }
+#endif
+
+        for(; x<Width; x++)
+            Residual[x] = (unsigned char) (Row[x]-Above[x]);
+    }
+
+    void ReconstructRow(unsigned char *Row, const unsigned char *Above, int Width)
+    {
+        int x = 0;
+
+#ifdef GRAYSCALECODEC_SSE2
+        for(; x+16<=Width; x+=16)
+        {
+            __m128i residual = _mm_loadu_si128((const __m128i*) (Row+x));
+            __m128i above    = _mm_loadu_si128((const __m128i*) (Above+x));
+
+            _mm_storeu_si128((__m128i*) (Row+x), _mm_add_epi8(residual, above));
+        }
+#endif
+
+        for(; x<Width; x++)
+            Row[x] = (unsigned char) (Row[x]+Above[x]);
+    }
+
+    //== Run detection ==--
+
+    int ZeroRun(const unsigned char *Data, const unsigned char *End)
+    {
+        const unsigned char *start = Data;
+
+#ifdef GRAYSCALECODEC_SSE2
+        __m128i zero = _mm_setzero_si128();
+
+        while(End-Data>=16)
+        {
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) Data), zero));
+
+            if(mask!=0xFFFF)
+                return (int) (Data-start) + CountTrailingZeros(~mask & 0xFFFF);
+
+            Data += 16;
+        }
+#endif
+
+        while(Data<End && *Data==0)
+            Data++;
+
+        return (int) (Data-start);
+    }
+
+    int LiteralRun(const unsigned char *Data, const unsigned char *End)
+    {
+        int count = (int) (End-Data);
+        int zeros = 0;
+
+        for(int i=0; i<count; i++)
+        {
+            if(Data[i]!=0)
+            {
+                zeros = 0;
+            }
+            else if(++zeros==kLiteralBreak)
+            {
+                return i+1-kLiteralBreak;
+            }
+        }
+
+        return count;
+    }
+
+    //== Varints ==--
+
+    inline unsigned char * PutVarint(unsigned char *Output, unsigned int Value)
+    {
+        while(Value>=0x80)
+        {
+            *Output++ = (unsigned char) (Value | 0x80);
+            Value >>= 7;
+        }
+
+        *Output++ = (unsigned char) Value;
+
+        return Output;
+    }
+
+    inline bool GetVarint(const unsigned char *&Data, const unsigned char *End, unsigned int &Value)
+    {
+        Value = 0;
+
+        for(int shift=0; Data<End && shift<32; shift+=7)
+        {
+            unsigned char bits = *Data++;
+
+            Value |= (unsigned int) (bits & 0x7F) << shift;
+
+            if((bits & 0x80)==0)
+                return true;
+        }
+
+        return false;
+    }
+}
+
+int cGrayscaleCodec::MaxEncodedSize(int Width, int Height)
+{
+    //== worst case is one literal, kLiteralBreak zeros, one literal... ==--
+
+    return 2*Width*Height + 16;
+}
+
+int cGrayscaleCodec::Encode(const unsigned char *Image, int Width, int Height, int Span,
+                            std::vector<unsigned char> &Output, std::vector<unsigned char> &Scratch)
+{
+    int total = Width*Height;
+
+    if(total<=0)
+        return 0;
+
+    //== Residual plane, then room for the worst case encoding behind it.  Scratch only grows,
+    //== so after the first frame nothing is zero filled ==--
+
+    size_t needed = (size_t) total + MaxEncodedSize(Width, Height);
+
+    if(Scratch.size()<needed)
+        Scratch.resize(needed);
+
+    for(int y=0; y<Height; y++)
+        PredictRow(Image + y*Span, (y>0) ? Image + (y-1)*Span : 0, &Scratch[y*Width], Width);
+
+    //== Zero suppression ==--
+
+    unsigned char       *encoded = &Scratch[total];
+    unsigned char       *out     = encoded;
+    const unsigned char *current = &Scratch[0];
+    const unsigned char *end     = current + total;
+
+    while(current<end)
+    {
+        int zeros = ZeroRun(current, end);
+
+        out      = PutVarint(out, zeros);
+        current += zeros;
+
+        int literals = LiteralRun(current, end);
+
+        out = PutVarint(out, literals);
+        memcpy(out, current, literals);
+
+        out     += literals;
+        current += literals;
+    }
+
+    //== Only the bytes produced are copied to the output ==--
+
+    Output.insert(Output.end(), encoded, out);
+
+    return (int) (out - encoded);
+}
+
+bool cGrayscaleCodec::Decode(const unsigned char *Data, int Size, unsigned char *Image, int Width, int Height)
+{
+    int total = Width*Height;
+
+    if(total<=0)
+        return false;
+
+    const unsigned char *end = Data + Size;
+
+    unsigned char *out    = Image;
+    unsigned char *outEnd = Image + total;
+
+    while(out<outEnd)
+    {
+        unsigned int zeros, literals;
+
+        if(!GetVarint(Data, end, zeros) || zeros>(unsigned int) (outEnd-out))
+            return false;
+
+        memset(out, 0, zeros);
+        out += zeros;
+
+        if(!GetVarint(Data, end, literals) || literals>(unsigned int) (outEnd-out)
+           || literals>(unsigned int) (end-Data))
+            return false;
+
+        memcpy(out, Data, literals);
+        out  += literals;
+        Data += literals;
+    }
+
+    //== Undo prediction top down ==--
+
+    for(int y=1; y<Height; y++)
+        ReconstructRow(Image + y*Width, Image + (y-1)*Width, Width);
+
+    return true;
+}
+
+//== Benchmark =========================================================================================----
+
+void cGrayscaleCodec::Benchmark(int Width, int Height, int Blobs, int Frames, sBenchmark &Result)
+{
+    const int kImages = 8;                      //== Distinct frames, encoded in turn ==========----
+
+    Width  = std::max(Width, 16);
+    Height = std::max(Height, 16);
+    Frames = std::max(Frames, 1);
+    Blobs  = std::max(Blobs, 0);
+
+    int total = Width*Height;
+
+    cBenchmarkNoise noise(362436069u);
+
+    std::vector<unsigned char> images((size_t) total*kImages, 0);
+
+    for(int i=0; i<kImages; i++)
+    {
+        unsigned char *image = &images[(size_t) i*total];
+
+        for(int p=0; p<total; p++)
+        {
+            if(noise.Uniform()<0.005f)
+                image[p] = (unsigned char) (1 + (noise.Next() & 7));
+        }
+
+        for(int b=0; b<Blobs; b++)
+        {
+            float radius = 2 + 4*noise.Uniform();
+            float peak   = 180 + 75*noise.Uniform();
+            float cx     = radius + (Width  - 2*radius)*noise.Uniform();
+            float cy     = radius + (Height - 2*radius)*noise.Uniform();
+
+            int reach = (int) (radius + 2);
+
+            for(int y=std::max((int) cy-reach, 0); y<=std::min((int) cy+reach, Height-1); y++)
+            {
+                for(int x=std::max((int) cx-reach, 0); x<=std::min((int) cx+reach, Width-1); x++)
+                {
+                    float distance = sqrtf((x-cx)*(x-cx) + (y-cy)*(y-cy));
+                    float value    = peak*std::min(1.0f, std::max(0.0f, radius + 1 - distance));
+
+                    image[y*Width + x] = (unsigned char) std::max((float) image[y*Width + x], value);
+                }
+            }
+        }
+    }
+
+    //== Encode every frame, keeping the last encoding of each image to decode ==--
+
+    std::vector<unsigned char> scratch;
+    std::vector<unsigned char> encoded[kImages];
+
+    long long    encodedBytes = 0;
+    Core::cTimer timer;
+
+    for(int f=0; f<Frames; f++)
+    {
+        std::vector<unsigned char> &output = encoded[f%kImages];
+
+        output.clear();
+        encodedBytes += Encode(&images[(size_t) (f%kImages)*total], Width, Height, Width, output, scratch);
+    }
+
+    double encodeSeconds = timer.CatchUp();
+
+    std::vector<unsigned char> decoded(total);
+
+    int mismatches = 0;
+
+    for(int f=0; f<Frames; f++)
+    {
+        const std::vector<unsigned char> &input = encoded[f%kImages];
+
+        if(!Decode(&input[0], (int) input.size(), &decoded[0], Width, Height)
+           || memcmp(&decoded[0], &images[(size_t) (f%kImages)*total], total)!=0)
+            mismatches++;
+    }
+
+    double decodeSeconds = timer.CatchUp();
+
+    double megabytes = (double) total*Frames/(1024.0*1024.0);
+
+    Result.Width            = Width;
+    Result.Height           = Height;
+    Result.Blobs            = Blobs;
+    Result.CompressionRatio = encodedBytes>0    ? (double) total*Frames/encodedBytes : 0;
+    Result.EncodeMBps       = encodeSeconds>0   ? megabytes/encodeSeconds : 0;
+    Result.DecodeMBps       = decodeSeconds>0   ? megabytes/decodeSeconds : 0;
+    Result.Mismatches       = mismatches;
+}
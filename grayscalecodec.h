@@ -0,0 +1,66 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Lossless 8-bit grayscale image codec tuned for IR camera images, which are black apart from a
+//== handful of bright blobs.
+//==
+//==   1. Prediction: each pixel is predicted from the pixel above it (first row from zero) and
+//==      the residual is stored modulo 256.  Both directions are a single SIMD subtract/add per
+//==      16 pixels.
+//==   2. Zero suppression: the residual plane is stored as alternating varint zero-run lengths and
+//==      varint literal-run lengths followed by the literal bytes.  Zero runs are found 16 bytes
+//==      at a time.  Isolated zeros inside a blob stay in the literal run.
+//==
+//== SSE2 is used on x86/x64, other targets (ARM) use the scalar path.  Output is identical.
+//==
+
+#ifndef __CAMERALIBRARY__GRAYSCALECODEC_H__
+#define __CAMERALIBRARY__GRAYSCALECODEC_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <vector>
+#include "cameralibraryglobals.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cGrayscaleCodec
+    {
+    public:
+        //== Appends the compressed image to Output, returns the number of bytes appended.  Span is
+        //== the distance in bytes between rows of Image.  Scratch holds the residuals and the
+        //== worst case encoding; reused between calls it is allocated and cleared only once.
+
+        static int  Encode(const unsigned char *Image, int Width, int Height, int Span,
+                           std::vector<unsigned char> &Output, std::vector<unsigned char> &Scratch);
+
+        //== Decodes into Image (Width*Height bytes, tightly packed).  False on damaged data.
+
+        static bool Decode(const unsigned char *Data, int Size, unsigned char *Image, int Width, int Height);
+
+        static int  MaxEncodedSize(int Width, int Height);
+
+        //== Round trip of synthetic IR frames: black but for faint noise in one pixel of 200 and
+        //== Blobs markers 2 to 6 pixels in radius with soft edges, moving between frames.  Rates
+        //== are of raw image bytes.
+
+        struct sBenchmark
+        {
+            int     Width;
+            int     Height;
+            int     Blobs;
+            double  CompressionRatio;
+            double  EncodeMBps;
+            double  DecodeMBps;
+            int     Mismatches;                 //== Frames not decoded to their original =====----
+        };
+
+        static void Benchmark(int Width, int Height, int Blobs, int Frames, sBenchmark &Result);
+    };
+}
+
+#endif
@@ -0,0 +1,338 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "headlessview.h"
+#include "bitmapraster.h"
+#include "frame.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    const float kPi           = 3.14159265f;
+    const float kFieldOfView  = 45.0f;          //== Same view as StartScene() =================----
+    const float kNearPlane    = 0.1f;
+    const float kDistance     = 15.0f;
+    const float kTilt         = 20.0f;
+    const float kTurn         = 20.0f;
+    const int   kImageOffset  = 10;             //== Camera image corner, DrawGLScene() ========----
+
+    //== Cohen-Sutherland clip to [0, Width-1] x [0, Height-1] ==--
+
+    int OutCode(float X, float Y, float Right, float Bottom)
+    {
+        return (X<0 ? 1 : 0) | (X>Right ? 2 : 0) | (Y<0 ? 4 : 0) | (Y>Bottom ? 8 : 0);
+    }
+
+    bool ClipLine(float &X1, float &Y1, float &X2, float &Y2, int Width, int Height)
+    {
+        float right  = (float) (Width -1);
+        float bottom = (float) (Height-1);
+
+        int code1 = OutCode(X1, Y1, right, bottom);
+        int code2 = OutCode(X2, Y2, right, bottom);
+
+        while(code1 | code2)
+        {
+            if(code1 & code2)
+                return false;
+
+            int   code = code1 ? code1 : code2;
+            float x, y;
+
+            if(code & 8)
+            {
+                x = X1 + (X2-X1)*(bottom-Y1)/(Y2-Y1);
+                y = bottom;
+            }
+            else if(code & 4)
+            {
+                x = X1 + (X2-X1)*(0-Y1)/(Y2-Y1);
+                y = 0;
+            }
+            else if(code & 2)
+            {
+                y = Y1 + (Y2-Y1)*(right-X1)/(X2-X1);
+                x = right;
+            }
+            else
+            {
+                y = Y1 + (Y2-Y1)*(0-X1)/(X2-X1);
+                x = 0;
+            }
+
+            if(code==code1)
+            {
+                X1 = x;
+                Y1 = y;
+                code1 = OutCode(X1, Y1, right, bottom);
+            }
+            else
+            {
+                X2 = x;
+                Y2 = y;
+                code2 = OutCode(X2, Y2, right, bottom);
+            }
+        }
+
+        return true;
+    }
+}
+
+cHeadlessView::cHeadlessView(int Width, int Height, int RasterizerThreads)
+    : mWidth(Width>0 ? Width : 1)
+    , mHeight(Height>0 ? Height : 1)
+    , mRasterizer(RasterizerThreads)
+    , mRenderInterval(1)
+    , mFrameCounter(0)
+    , mRendering(false)
+{
+    mPixels.resize(mWidth*mHeight*4);
+    mTarget = new Bitmap(mWidth, mHeight, mWidth*4, Bitmap::ThirtyTwoBit, &mPixels[0]);
+
+    //== modelview = translate(0,0,-distance) * rotateX(tilt) * rotateY(turn) ==--
+
+    float cx = cosf(kTilt*kPi/180), sx = sinf(kTilt*kPi/180);
+    float cy = cosf(kTurn*kPi/180), sy = sinf(kTurn*kPi/180);
+
+    float rotation[3][3] =
+    {
+        {  cy,     0,    sy    },
+        {  sx*sy,  cx,  -sx*cy },
+        { -cx*sy,  sx,   cx*cy }
+    };
+
+    for(int r=0; r<3; r++)
+    {
+        for(int c=0; c<3; c++)
+            mModelView[r][c] = rotation[r][c];
+
+        mModelView[r][3] = 0;
+    }
+
+    mModelView[2][3] = -kDistance;
+
+    mFocal = 1.0f / tanf(kFieldOfView*0.5f*kPi/180);
+
+    ResetStatistics();
+}
+
+cHeadlessView::~cHeadlessView()
+{
+    delete mTarget;
+}
+
+void cHeadlessView::SetRenderInterval(int Frames)
+{
+    mRenderInterval = (Frames<1) ? 1 : Frames;
+}
+
+bool cHeadlessView::BeginFrame()
+{
+    mFramesSubmitted++;
+
+    if(mFrameCounter++ % mRenderInterval != 0)
+        return false;
+
+    mTimer.CatchUp();
+    mRendering = true;
+
+    cBitmapRaster::Clear(*mTarget, 0);
+
+    return true;
+}
+
+void cHeadlessView::EndFrame()
+{
+    if(!mRendering)
+        return;
+
+    mRenderSeconds += mTimer.Elapsed();
+    mFramesRendered++;
+    mRendering = false;
+}
+
+void cHeadlessView::DrawCameraFrame(Frame *Frame, int Scale)
+{
+    if(!mRendering || Frame==0)
+        return;
+
+    if(Scale<1)
+        Scale = 1;
+
+    int width  = Frame->Width();
+    int height = Frame->Height();
+
+    if(width<=0 || height<=0 || kImageOffset>=mWidth || kImageOffset>=mHeight)
+        return;
+
+    unsigned char *corner = &mPixels[(kImageOffset*mWidth + kImageOffset)*4];
+
+    unsigned int outWidth  = mWidth  - kImageOffset;
+    unsigned int outHeight = mHeight - kImageOffset;
+
+    mRasterizer.SetDecimation(Scale);
+
+    if(Frame->IsGrayscale())
+    {
+        mRasterizer.Rasterize(Frame, outWidth, outHeight, mWidth*4, 32, corner);
+    }
+    else
+    {
+        //== object frames are drawn by the library at full size, then decimated ==--
+
+        mFrameImage.assign(width*height, 0);
+
+        Frame->Rasterize(width, height, width, 8, &mFrameImage[0]);
+
+        mRasterizer.Rasterize(&mFrameImage[0], width, height, width, outWidth, outHeight, mWidth*4, 32, corner);
+    }
+
+    //== outline ==--
+
+    float left   = (float) kImageOffset;
+    float top    = (float) kImageOffset;
+    float right  = (float) (kImageOffset + width/Scale);
+    float bottom = (float) (kImageOffset + height/Scale);
+
+    PIXEL white = PIXELCOLORA(255, 255, 255, 255);
+
+    DrawLine(left,  top,    right, top,    white);
+    DrawLine(right, top,    right, bottom, white);
+    DrawLine(right, bottom, left,  bottom, white);
+    DrawLine(left,  bottom, left,  top,    white);
+}
+
+void cHeadlessView::DrawAxes(float Length)
+{
+    PIXEL color = PIXELCOLORA(255, 255, 255, 77);
+
+    DrawLine3D( Length, 0, 0, -Length,  0,  0, color);
+    DrawLine3D( 0, Length, 0,  0, -Length,  0, color);
+    DrawLine3D( 0, 0, Length,  0,  0, -Length, color);
+}
+
+void cHeadlessView::DrawLine3D(float X1, float Y1, float Z1, float X2, float Y2, float Z2, PIXEL Color)
+{
+    if(!mRendering)
+        return;
+
+    float sx1, sy1, sx2, sy2;
+
+    if(Project(X1, Y1, Z1, sx1, sy1) && Project(X2, Y2, Z2, sx2, sy2))
+        DrawLine(sx1, sy1, sx2, sy2, Color);
+}
+
+bool cHeadlessView::Project(float X, float Y, float Z, float &ScreenX, float &ScreenY) const
+{
+    float eyeX = mModelView[0][0]*X + mModelView[0][1]*Y + mModelView[0][2]*Z + mModelView[0][3];
+    float eyeY = mModelView[1][0]*X + mModelView[1][1]*Y + mModelView[1][2]*Z + mModelView[1][3];
+    float eyeZ = mModelView[2][0]*X + mModelView[2][1]*Y + mModelView[2][2]*Z + mModelView[2][3];
+
+    if(-eyeZ<kNearPlane)
+        return false;
+
+    float aspect = (float) mWidth / mHeight;
+
+    float ndcX = (mFocal/aspect) * eyeX / -eyeZ;
+    float ndcY =  mFocal         * eyeY / -eyeZ;
+
+    ScreenX = (ndcX + 1) * 0.5f * mWidth;
+    ScreenY = (1 - ndcY) * 0.5f * mHeight;
+
+    return true;
+}
+
+void cHeadlessView::DrawLine(float StartX, float StartY, float EndX, float EndY, PIXEL Color)
+{
+    if(!ClipLine(StartX, StartY, EndX, EndY, mWidth, mHeight))
+        return;
+
+    int X1 = (int) (StartX + 0.5f);
+    int Y1 = (int) (StartY + 0.5f);
+    int X2 = (int) (EndX   + 0.5f);
+    int Y2 = (int) (EndY   + 0.5f);
+
+    int dx =  (X2>X1) ? X2-X1 : X1-X2;
+    int dy = -((Y2>Y1) ? Y2-Y1 : Y1-Y2);
+    int sx =  (X1<X2) ? 1 : -1;
+    int sy =  (Y1<Y2) ? 1 : -1;
+    int error = dx + dy;
+
+    bool opaque = (GetAlphaCol(Color)==255);
+
+    for(;;)
+    {
+        if(opaque)
+            cBitmapRaster::PutPixel(*mTarget, X1, Y1, Color);
+        else
+            cBitmapRaster::PutPixelAlpha(*mTarget, X1, Y1, Color);
+
+        if(X1==X2 && Y1==Y2)
+            break;
+
+        int twice = 2*error;
+
+        if(twice>=dy)
+        {
+            error += dy;
+            X1    += sx;
+        }
+
+        if(twice<=dx)
+        {
+            error += dx;
+            Y1    += sy;
+        }
+    }
+}
+
+bool cHeadlessView::SavePPM(const char *Filename) const
+{
+    FILE *file = fopen(Filename, "wb");
+
+    if(file==0)
+        return false;
+
+    fprintf(file, "P6\n%d %d\n255\n", mWidth, mHeight);
+
+    std::vector<unsigned char> row(mWidth*3);
+
+    for(int y=0; y<mHeight; y++)
+    {
+        const unsigned char *source = &mPixels[y*mWidth*4];
+
+        for(int x=0; x<mWidth; x++)
+        {
+            row[x*3]   = source[x*4];
+            row[x*3+1] = source[x*4+1];
+            row[x*3+2] = source[x*4+2];
+        }
+
+        fwrite(&row[0], 1, row.size(), file);
+    }
+
+    fclose(file);
+
+    return true;
+}
+
+void cHeadlessView::Statistics(sStatistics &Stats) const
+{
+    Stats.FramesSubmitted       = mFramesSubmitted;
+    Stats.FramesRendered        = mFramesRendered;
+    Stats.RenderSeconds         = mRenderSeconds;
+    Stats.MillisecondsPerRender = (mFramesRendered>0) ? 1000.0*mRenderSeconds/mFramesRendered : 0;
+}
+
+void cHeadlessView::ResetStatistics()
+{
+    mFramesSubmitted = 0;
+    mFramesRendered  = 0;
+    mRenderSeconds   = 0;
+}
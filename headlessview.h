@@ -0,0 +1,96 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Window-less visualization.  Renders what the sample window shows (the camera image at a third
+//== of its size in the top left corner and the 3D overlay seen through the StartScene() camera)
+//== into a 32-bit RGBA buffer in memory with no dependency on Win32, OpenGL or a display, so the
+//== visualization path can run and be profiled on a headless server.
+//==
+//== SetRenderInterval(N) renders every Nth frame; BeginFrame() returns false for skipped frames.
+//== Time spent between BeginFrame() and EndFrame() is accumulated in Statistics() so it can be
+//== compared against the time spent tracking.
+//==
+
+#ifndef __CAMERALIBRARY__HEADLESSVIEW_H__
+#define __CAMERALIBRARY__HEADLESSVIEW_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <vector>
+#include "bitmap.h"
+#include "framerasterizer.h"
+
+#include "Core/Timer.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class Frame;
+
+    class cHeadlessView
+    {
+    public:
+        cHeadlessView(int Width, int Height, int RasterizerThreads = 0);
+        ~cHeadlessView();
+
+        void    SetRenderInterval(int Frames);          //== 1: every frame, 2: every other ===----
+        int     RenderInterval() const              { return mRenderInterval; }
+
+        //== Per frame, draw calls are only valid between a true BeginFrame() and EndFrame() ==--
+
+        bool    BeginFrame();                           //== Clears, false if frame is skipped -
+        void    EndFrame();
+
+        void    DrawCameraFrame(Frame *Frame, int Scale = 3);
+        void    DrawAxes(float Length = 10);
+        void    DrawLine3D(float X1, float Y1, float Z1, float X2, float Y2, float Z2, PIXEL Color);
+
+        //== Rendered image, RGBA ==--
+
+        int     Width() const                       { return mWidth;  }
+        int     Height() const                      { return mHeight; }
+        int     Span() const                        { return mWidth*4; }
+        const unsigned char * Pixels() const        { return &mPixels[0]; }
+
+        bool    SavePPM(const char *Filename) const;
+
+        struct sStatistics
+        {
+            int     FramesSubmitted;
+            int     FramesRendered;
+            double  RenderSeconds;
+            double  MillisecondsPerRender;
+        };
+
+        void    Statistics(sStatistics &Stats) const;
+        void    ResetStatistics();
+
+    private:
+        bool    Project(float X, float Y, float Z, float &ScreenX, float &ScreenY) const;
+        void    DrawLine(float X1, float Y1, float X2, float Y2, PIXEL Color);   //== Screen, clipped
+
+        int                        mWidth;
+        int                        mHeight;
+        std::vector<unsigned char> mPixels;
+        Bitmap *                   mTarget;
+        cFrameRasterizer           mRasterizer;
+        std::vector<unsigned char> mFrameImage;         //== Object mode frames, 8-bit ======----
+
+        float                      mModelView[3][4];    //== StartScene() camera =============----
+        float                      mFocal;
+
+        int                        mRenderInterval;
+        int                        mFrameCounter;
+        bool                       mRendering;
+
+        Core::cTimer               mTimer;
+        int                        mFramesSubmitted;
+        int                        mFramesRendered;
+        double                     mRenderSeconds;
+    };
+}
+
+#endif
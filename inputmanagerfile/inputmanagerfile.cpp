@@ -0,0 +1,488 @@
+//=============================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//=============================================================================================-----
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sched.h>
+#endif
+
+#include "inputmanagerfile.h"
+#include "camera.h"
+#include "cameramanager.h"
+#include "mappedreader.h"
+
+#include "Core/IReader.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    const double kSpinThreshold     = 0.002;     //== Sleep above this, yield below (seconds) ==--
+
+#ifdef WIN32
+    unsigned long __stdcall PlaybackThreadProc(void *Param)
+    {
+        ((cInputManagerFile*) Param)->PlaybackThread();
+        return 0;
+    }
+#else
+    void PlaybackThreadProc(void *Param)
+    {
+        ((cInputManagerFile*) Param)->PlaybackThread();
+    }
+#endif
+}
+
+cInputManagerFile::cInputManagerFile()
+    : mStream(0)
+    , mMapped(0)
+    , mOwnedReader(0)
+    , mFirstRecord(0)
+    , mListener(0)
+    , mFrameCount(0)
+    , mFirstTimeStamp(0)
+    , mLastTimeStamp(0)
+    , mDeltaFrame(&mDeltaCodec)
+    , mThreadStarted(false)
+    , mPlaying(false)
+    , mRebase(true)
+    , mLooping(false)
+    , mMode(PlaybackRealTime)
+    , mMultiplier(1.0)
+{
+    ResetStatistics();
+}
+
+cInputManagerFile::~cInputManagerFile()
+{
+    Close();
+}
+
+//== Take Management ===========================================================================----
+
+bool cInputManagerFile::Open(const char *Filename)
+{
+    Close();
+
+    //== Map the take rather than reading it in, frames are decoded straight out of the
+    //== page cache.
+
+    cMappedReader *reader = new cMappedReader();
+
+    if(!reader->Open(Filename) || !Open(reader))
+    {
+        delete reader;
+        return false;
+    }
+
+    mOwnedReader = reader;
+
+    return true;
+}
+
+bool cInputManagerFile::Open(Core::cIReader *Stream)
+{
+    return OpenStream(Stream, 0);
+}
+
+bool cInputManagerFile::Open(cMappedReader *Stream)
+{
+    return OpenStream(Stream, Stream);
+}
+
+bool cInputManagerFile::OpenStream(Core::cIReader *Stream, cMappedReader *Mapped)
+{
+    Close();
+
+    mStream = Stream;
+    mMapped = Mapped;
+
+    int version;
+
+    if(!cTakeFile::ReadHeader(mStream, version))
+    {
+        mStream = 0;
+        mMapped = 0;
+        return false;
+    }
+
+    mFirstRecord = mStream->Tell();
+
+    if(!ScanTake())
+    {
+        Close();
+        return false;
+    }
+
+    Rewind();
+
+    return true;
+}
+
+bool cInputManagerFile::ScanTake()
+{
+    //== Single forward pass: create a virtual camera for every camera record and gather
+    //== take extents.  Frame payloads are skipped, only their fixed header is read.
+
+    mFrameCount     = 0;
+    mFirstTimeStamp = 0;
+    mLastTimeStamp  = 0;
+
+    eTakeRecordTypes type;
+    int              payloadSize;
+
+    while(cTakeFile::ReadRecordHeader(mStream, type, payloadSize))
+    {
+        unsigned long long payloadStart = mStream->Tell();
+
+        if(type==TakeRecordCamera)
+        {
+            cTakeCameraInfo info;
+
+            if(!info.Load(mStream))
+                return false;
+
+            if(mCameraBySerial.find(info.Serial)==mCameraBySerial.end())
+            {
+                CameraLibrary::Camera *camera = CameraManager::CameraFactory(info.Revision, true, info.Serial);
+
+                if(camera)
+                {
+                    cVirtualConfigurationData config;
+                    info.WriteTo(&config);
+
+                    camera->SendVirtualConfigurationData(&config);
+                    CameraManager::X().AddCamera(camera);
+
+                    mCameras.push_back(camera);
+                    mCameraBySerial[info.Serial] = camera;
+                }
+            }
+        }
+        else if(type==TakeRecordFrame)
+        {
+            //== TinyObjectOnly: compression type, serial, camera id, revision, frame id,
+            //== video mode, then the timestamp.  DeltaObjectOnly: type, serial, timestamp.
+
+            int compression = mStream->ReadInt();
+
+            if(compression==Core::cICameraFrame::DeltaObjectOnly)
+                mStream->Seek(payloadStart + 2*sizeof(int));
+            else
+                mStream->Seek(payloadStart + 6*sizeof(int));
+
+            double timeStamp = mStream->ReadDouble();
+
+            if(mFrameCount==0)
+                mFirstTimeStamp = timeStamp;
+
+            mLastTimeStamp = timeStamp;
+            mFrameCount++;
+        }
+
+        mStream->Seek(payloadStart + payloadSize);
+    }
+
+    return !mCameras.empty();
+}
+
+void cInputManagerFile::Close()
+{
+    Stop();
+
+    for(int i=0; i<(int) mCameras.size(); i++)
+    {
+        CameraManager::X().RemoveCamera(mCameras[i]);
+        mCameras[i]->Release();
+    }
+
+    mCameras.clear();
+    mCameraBySerial.clear();
+
+    mStream = 0;
+    mMapped = 0;
+
+    if(mOwnedReader)
+    {
+        delete mOwnedReader;
+        mOwnedReader = 0;
+    }
+
+    mFrameCount = 0;
+}
+
+CameraLibrary::Camera * cInputManagerFile::GetCamera(int Index) const
+{
+    if(Index<0 || Index>=(int) mCameras.size())
+        return 0;
+
+    return mCameras[Index];
+}
+
+//== Playback Control ==========================================================================----
+
+void cInputManagerFile::Start()
+{
+    if(mStream==0 || mPlaying)
+        return;
+
+    //== Playback that ran off the end of the take still has to be joined ==--
+
+    Stop();
+
+    mPlaying       = true;
+    mThreadStarted = true;
+    mRebase        = true;
+
+    ResetStatistics();
+
+#ifdef WIN32
+    mThread.StartThread((void*) PlaybackThreadProc, this);
+#else
+    mThread.StartThread(PlaybackThreadProc, this);
+#endif
+}
+
+void cInputManagerFile::Stop()
+{
+    //== mPlaying drops as soon as the thread leaves on its own, only mThreadStarted says
+    //== whether there is a thread left to join ==--
+
+    if(!mThreadStarted)
+        return;
+
+    mPlaying = false;
+    mThread.StopThread();
+
+    mThreadStarted = false;
+}
+
+void cInputManagerFile::Rewind()
+{
+    if(mStream==0)
+        return;
+
+    mStreamLock.Lock();
+    mStream->Seek(mFirstRecord);
+    mDeltaCodec.Reset();
+    mRebase = true;
+    mStreamLock.UnLock();
+}
+
+void cInputManagerFile::SetPlaybackMode(ePlaybackModes Mode, double Multiplier)
+{
+    if(Multiplier<=0)
+        Multiplier = 1.0;
+
+    mMode       = Mode;
+    mMultiplier = (Mode==PlaybackRealTime) ? 1.0 : Multiplier;
+    mRebase     = true;
+}
+
+//== Playback Thread ===========================================================================----
+
+void cInputManagerFile::PlaybackThread()
+{
+    double takeBase = 0;
+    double wallBase = 0;
+    double takeLast = 0;
+
+    while(mPlaying && mThread.IsSteadyState())
+    {
+        const cTakeFrame *frame = NextFrame();
+
+        if(frame==0)
+        {
+            if(!mLooping)
+                break;
+
+            Rewind();
+            continue;
+        }
+
+        double now = CameraManager::X().TimeStamp();
+
+        bool rebased = mRebase;
+
+        if(rebased)
+        {
+            //== Establish a new time base on start, rewind, loop or rate change so that
+            //== pacing never tries to catch up on time that was not spent playing.
+
+            takeBase = frame->TimeStamp();
+            wallBase = now;
+            mRebase  = false;
+        }
+
+        if(mMode!=PlaybackAsFastAsPossible)
+            WaitUntil(wallBase + (frame->TimeStamp()-takeBase)/mMultiplier);
+
+        Deliver(*frame);
+
+        if(mFramesDelivered==0)
+            mStatsWallStart = now;
+
+        if(!rebased)
+            mStatsTakeSeconds += frame->TimeStamp() - takeLast;
+
+        takeLast = frame->TimeStamp();
+
+        mFramesDelivered++;
+        mStatsWallLast = CameraManager::X().TimeStamp();
+    }
+
+    mPlaying = false;
+    mThread.mThreadRunning = false;
+}
+
+const cTakeFrame * cInputManagerFile::NextFrame()
+{
+    const cTakeFrame *found = 0;
+
+    mStreamLock.Lock();
+
+    eTakeRecordTypes type;
+    int              payloadSize;
+
+    for(;;)
+    {
+        bool haveRecord = mMapped ? cTakeFile::ReadRecordHeader(*mMapped, type, payloadSize)
+                                  : cTakeFile::ReadRecordHeader(mStream, type, payloadSize);
+
+        if(!haveRecord)
+            break;
+
+        unsigned long long payloadStart = mStream->Tell();
+
+        if(type==TakeRecordFrame && payloadSize>=(int) sizeof(int))
+        {
+            //== peek the compression type to pick the decoder ==--
+
+            int compression = mStream->ReadInt();
+            mStream->Seek(payloadStart);
+
+            const cTakeFrame *frame = LoadFrame((Core::cICameraFrame::eCompressedFrameTypes) compression);
+
+            if(frame && mCameraBySerial.find(frame->Serial())!=mCameraBySerial.end())
+                found = frame;
+        }
+
+        //== Always resynchronize on the record boundary so unknown or damaged payloads
+        //== can never derail the stream.
+
+        mStream->Seek(payloadStart + payloadSize);
+
+        if(found)
+            break;
+    }
+
+    mStreamLock.UnLock();
+
+    return found;
+}
+
+const cTakeFrame * cInputManagerFile::LoadFrame(Core::cICameraFrame::eCompressedFrameTypes Type)
+{
+    //== Mapped takes decode without a virtual call per field ==--
+
+    switch(Type)
+    {
+    case Core::cICameraFrame::TinyObjectOnly:
+        if(mMapped ? mTinyFrame.Load(*mMapped) : mTinyFrame.Load(mStream))
+            return &mTinyFrame;
+        break;
+
+    case Core::cICameraFrame::DeltaObjectOnly:
+        //== Delta frames must be decoded in order even when their camera is unknown, later
+        //== frames reference them.
+
+        if(mMapped ? mDeltaFrame.Load(*mMapped) : mDeltaFrame.Load(mStream))
+            return &mDeltaFrame;
+        break;
+
+    case Core::cICameraFrame::LosslessGrayscale:
+        //== Only object data can be delivered through a Frame, the decoded image is kept on
+        //== the take frame.
+
+        if(mMapped ? mGrayscaleFrame.Load(*mMapped) : mGrayscaleFrame.Load(mStream))
+            return &mGrayscaleFrame;
+        break;
+
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+void cInputManagerFile::Deliver(const cTakeFrame &TakeFrame)
+{
+    if(mListener==0)
+        return;
+
+    std::map<int,CameraLibrary::Camera*>::const_iterator camera = mCameraBySerial.find(TakeFrame.Serial());
+
+    if(camera!=mCameraBySerial.end())
+        mListener->IncomingTakeFrame(camera->second, TakeFrame);
+}
+
+void cInputManagerFile::WaitUntil(double WallTime)
+{
+    for(;;)
+    {
+        double remaining = WallTime - CameraManager::X().TimeStamp();
+
+        if(remaining<=0 || !mPlaying || mRebase)
+            return;
+
+        if(remaining>kSpinThreshold)
+        {
+#ifdef WIN32
+            Sleep((DWORD) ((remaining-kSpinThreshold/2)*1000));
+#else
+            usleep((useconds_t) ((remaining-kSpinThreshold/2)*1000000));
+#endif
+        }
+        else
+        {
+#ifdef WIN32
+            Sleep(0);
+#else
+            sched_yield();
+#endif
+        }
+    }
+}
+
+//== Playback Statistics =======================================================================----
+
+void cInputManagerFile::ResetStatistics()
+{
+    mFramesDelivered  = 0;
+    mStatsWallStart   = 0;
+    mStatsWallLast    = 0;
+    mStatsTakeSeconds = 0;
+}
+
+double cInputManagerFile::DeliveredFrameRate() const
+{
+    double elapsed = mStatsWallLast - mStatsWallStart;
+
+    if(elapsed<=0)
+        return 0;
+
+    return (mFramesDelivered-1)/elapsed;
+}
+
+double cInputManagerFile::Speedup() const
+{
+    double elapsed = mStatsWallLast - mStatsWallStart;
+
+    if(elapsed<=0)
+        return 0;
+
+    return mStatsTakeSeconds/elapsed;
+}
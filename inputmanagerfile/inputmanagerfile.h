@@ -1,2 +1,155 @@
-//== Placeholder: No public interface ==--
+//=============================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//=============================================================================================-----
 
+//==
+//== File based input.  Replays a take file (see takefile.h) through virtual cameras so the full
+//== tracking pipeline can be exercised offline.  Frames are paced at the original rate, at a fixed
+//== multiple of the original rate, or as fast as the pipeline will accept them.
+//==
+//== Frames are handed to a cTakeFrameListener as the decoded take frame itself rather than as a
+//== CameraLibrary::Frame: library frames can only be populated by the library, and a virtual one
+//== would lose the frame id, timestamps and video mode that were recorded.  The take frame is
+//== only valid for the duration of the call, the listener copies what it keeps.
+//==
+
+#ifndef __INPUTMANAGERFILE_H__
+#define __INPUTMANAGERFILE_H__
+
+//== INCLUDES ==================================================================================----
+
+#include <map>
+#include <vector>
+
+#include "inputmanagerbase.h"
+#include "threading.h"
+#include "lock.h"
+#include "takefile.h"
+#include "takedeltaframe.h"
+#include "takegrayscaleframe.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ===========================================================----
+
+namespace Core
+{
+    class cIReader;
+}
+
+namespace CameraLibrary
+{
+    class Camera;
+    class cMappedReader;
+}
+
+//== CLASS DEFINITIONS =========================================================================----
+
+class cTakeFrameListener
+{
+public:
+    virtual ~cTakeFrameListener() {};
+
+    //== Called on the playback thread, Camera is the take's virtual camera for the frame ==--
+
+    virtual void IncomingTakeFrame(CameraLibrary::Camera *Camera, const CameraLibrary::cTakeFrame &Frame) = 0;
+};
+
+class cInputManagerFile : public InputManager
+{
+public:
+    cInputManagerFile();
+    ~cInputManagerFile();
+
+    enum ePlaybackModes
+    {
+        PlaybackRealTime = 0,           //== Deliver frames at their recorded rate ==========----
+        PlaybackAsFastAsPossible,       //== No pacing, deliver frames back-to-back =========----
+        PlaybackFixedMultiplier,        //== Recorded rate scaled by PlaybackMultiplier() ===----
+        PlaybackModeCount
+    };
+
+    //== Take Management ======================================================================----
+
+    bool    Open (const char *Filename);          //== Map take from disk & create cameras -----
+    bool    Open (Core::cIReader *Stream);        //== Use caller owned stream ==============----
+    bool    Open (CameraLibrary::cMappedReader *Stream);  //== Caller owned, zero-copy decode -
+    void    Close();                              //== Stop playback & remove virtual cameras -
+
+    bool    IsOpen() const { return mStream!=0; }
+
+    void    SetListener(cTakeFrameListener *Listener) { mListener = Listener; }  //== Set before Start()
+
+    int     CameraCount() const { return (int) mCameras.size(); }
+    CameraLibrary::Camera * GetCamera(int Index) const;
+
+    int     FrameCount() const  { return mFrameCount; }
+    double  Duration() const    { return mLastTimeStamp-mFirstTimeStamp; }
+
+    //== Playback Control =====================================================================----
+
+    void    Start();                              //== Begin/resume playback thread ==========----
+    void    Stop ();                              //== Stop & join playback thread ===========----
+    bool    IsPlaying() const   { return mPlaying; }
+    void    Rewind();                             //== Restart from first frame ==============----
+
+    void    SetPlaybackMode(ePlaybackModes Mode, double Multiplier = 1.0);
+    ePlaybackModes PlaybackMode() const     { return mMode; }
+    double  PlaybackMultiplier() const      { return mMultiplier; }
+
+    void    SetLooping(bool Enable)         { mLooping = Enable; }
+    bool    Looping() const                 { return mLooping; }
+
+    //== Playback Statistics ==================================================================----
+
+    int     FramesDelivered() const         { return mFramesDelivered; }
+    double  DeliveredFrameRate() const;           //== Frames/sec across all cameras ========----
+    double  Speedup() const;                      //== Take seconds played per wall second ==----
+
+    const CameraLibrary::cTakeDeltaCodec & DeltaCodec() const { return mDeltaCodec; }  //== Decode stats
+
+    //== Internal use, thread entry point needs to be public ==--
+
+    void    PlaybackThread();
+
+private:
+    bool    OpenStream(Core::cIReader *Stream, CameraLibrary::cMappedReader *Mapped);
+    bool    ScanTake();
+    const CameraLibrary::cTakeFrame * NextFrame();
+    const CameraLibrary::cTakeFrame * LoadFrame(Core::cICameraFrame::eCompressedFrameTypes Type);
+    void    Deliver  (const CameraLibrary::cTakeFrame &Frame);
+    void    WaitUntil(double WallTime);
+    void    ResetStatistics();
+
+    Core::cIReader *      mStream;
+    CameraLibrary::cMappedReader * mMapped;       //== Same as mStream when it is mapped ==----
+    CameraLibrary::cMappedReader * mOwnedReader;
+    unsigned long long    mFirstRecord;
+
+    std::vector<CameraLibrary::Camera*>   mCameras;
+    std::map<int,CameraLibrary::Camera*>  mCameraBySerial;
+    cTakeFrameListener *  mListener;
+
+    int                   mFrameCount;
+    double                mFirstTimeStamp;
+    double                mLastTimeStamp;
+
+    CameraLibrary::cTakeFrame      mTinyFrame;
+    CameraLibrary::cTakeDeltaCodec mDeltaCodec;
+    CameraLibrary::cTakeDeltaFrame mDeltaFrame;
+    CameraLibrary::cTakeGrayscaleFrame mGrayscaleFrame;
+
+    ThreadInfo            mThread;
+    bool                  mThreadStarted;         //== Cleared once Stop() joins it =====----
+    LockItem              mStreamLock;
+    volatile bool         mPlaying;
+    volatile bool         mRebase;
+    bool                  mLooping;
+    ePlaybackModes        mMode;
+    double                mMultiplier;
+
+    int                   mFramesDelivered;
+    double                mStatsWallStart;
+    double                mStatsWallLast;
+    double                mStatsTakeSeconds;
+};
+
+#endif
@@ -0,0 +1,852 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <string.h>
+#include <math.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define JPEGDECODER_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "jpegdecoder.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    //== Zigzag position -> natural (row major) position ==--
+
+    const unsigned char kZigZag[64+16] =
+    {
+         0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+        12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+
+        //== damaged run lengths land here instead of outside the block ==--
+
+        63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63
+    };
+
+    const int kMaxOverrunBytes = 16;                //== Zero bytes fed past a segment's end -
+
+    //== Entropy decoding ==--
+
+    struct sBitReader
+    {
+        sBitReader(const unsigned char *Data, int Size) : Current(Data), End(Data+Size), Buffer(0), Count(0), Overrun(0) {}
+
+        inline void Fill()
+        {
+            while(Count<=56)
+            {
+                unsigned int value = 0;
+
+                if(Current<End)
+                {
+                    value = *Current++;
+
+                    //== skip stuffed zero ==--
+
+                    if(value==0xFF && Current<End && *Current==0x00)
+                        Current++;
+                }
+                else
+                {
+                    Overrun++;
+                }
+
+                Buffer |= (unsigned long long) value << (56-Count);
+                Count  += 8;
+            }
+        }
+
+        inline unsigned int Peek(int Bits) const { return (unsigned int) (Buffer >> (64-Bits)); }
+        inline void         Skip(int Bits)       { Buffer <<= Bits; Count -= Bits; }
+
+        inline int Receive(int Bits)
+        {
+            if(Bits==0)
+                return 0;
+
+            int value = (int) Peek(Bits);
+            Skip(Bits);
+
+            //== sign extension, F.2.2.1 ==--
+
+            if(value<(1<<(Bits-1)))
+                value -= (1<<Bits)-1;
+
+            return value;
+        }
+
+        const unsigned char * Current;
+        const unsigned char * End;
+        unsigned long long    Buffer;
+        int                   Count;
+        int                   Overrun;
+    };
+
+    //== Inverse DCT (AAN, jidctflt) ==--
+
+    const float kIDCT1414 =  1.414213562f;
+    const float kIDCT1847 =  1.847759065f;
+    const float kIDCT1082 =  1.082392200f;
+    const float kIDCT2613 = -2.613125930f;
+
+#ifdef JPEGDECODER_SSE2
+
+    inline void IDCT1D(__m128 *V)
+    {
+        const __m128 c1414 = _mm_set1_ps(kIDCT1414);
+        const __m128 c1847 = _mm_set1_ps(kIDCT1847);
+        const __m128 c1082 = _mm_set1_ps(kIDCT1082);
+        const __m128 c2613 = _mm_set1_ps(kIDCT2613);
+
+        __m128 tmp10 = _mm_add_ps(V[0], V[4]);
+        __m128 tmp11 = _mm_sub_ps(V[0], V[4]);
+        __m128 tmp13 = _mm_add_ps(V[2], V[6]);
+        __m128 tmp12 = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(V[2], V[6]), c1414), tmp13);
+
+        __m128 tmp0  = _mm_add_ps(tmp10, tmp13);
+        __m128 tmp3  = _mm_sub_ps(tmp10, tmp13);
+        __m128 tmp1  = _mm_add_ps(tmp11, tmp12);
+        __m128 tmp2  = _mm_sub_ps(tmp11, tmp12);
+
+        __m128 z13   = _mm_add_ps(V[5], V[3]);
+        __m128 z10   = _mm_sub_ps(V[5], V[3]);
+        __m128 z11   = _mm_add_ps(V[1], V[7]);
+        __m128 z12   = _mm_sub_ps(V[1], V[7]);
+
+        __m128 tmp7  = _mm_add_ps(z11, z13);
+        __m128 z5    = _mm_mul_ps(_mm_add_ps(z10, z12), c1847);
+
+        tmp11        = _mm_mul_ps(_mm_sub_ps(z11, z13), c1414);
+        tmp10        = _mm_sub_ps(_mm_mul_ps(z12, c1082), z5);
+        tmp12        = _mm_add_ps(_mm_mul_ps(z10, c2613), z5);
+
+        __m128 tmp6  = _mm_sub_ps(tmp12, tmp7);
+        __m128 tmp5  = _mm_sub_ps(tmp11, tmp6);
+        __m128 tmp4  = _mm_add_ps(tmp10, tmp5);
+
+        V[0] = _mm_add_ps(tmp0, tmp7);
+        V[7] = _mm_sub_ps(tmp0, tmp7);
+        V[1] = _mm_add_ps(tmp1, tmp6);
+        V[6] = _mm_sub_ps(tmp1, tmp6);
+        V[2] = _mm_add_ps(tmp2, tmp5);
+        V[5] = _mm_sub_ps(tmp2, tmp5);
+        V[4] = _mm_add_ps(tmp3, tmp4);
+        V[3] = _mm_sub_ps(tmp3, tmp4);
+    }
+
+    inline void Transpose(__m128 *Left, __m128 *Right)
+    {
+        //== 8x8 held as Left[row] (columns 0-3) and Right[row] (columns 4-7) ==--
+
+        __m128 a0 = Left[0],  a1 = Left[1],  a2 = Left[2],  a3 = Left[3];
+        __m128 b0 = Left[4],  b1 = Left[5],  b2 = Left[6],  b3 = Left[7];
+        __m128 c0 = Right[0], c1 = Right[1], c2 = Right[2], c3 = Right[3];
+        __m128 d0 = Right[4], d1 = Right[5], d2 = Right[6], d3 = Right[7];
+
+        _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+        _MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        _MM_TRANSPOSE4_PS(d0, d1, d2, d3);
+
+        Left[0]  = a0; Left[1]  = a1; Left[2]  = a2; Left[3]  = a3;
+        Left[4]  = c0; Left[5]  = c1; Left[6]  = c2; Left[7]  = c3;
+        Right[0] = b0; Right[1] = b1; Right[2] = b2; Right[3] = b3;
+        Right[4] = d0; Right[5] = d1; Right[6] = d2; Right[7] = d3;
+    }
+
+    void InverseDCT(const short *Coefficients, const float *Quant, unsigned char *Output, int Span)
+    {
+        __m128 left[8], right[8];
+
+        for(int row=0; row<8; row++)
+        {
+            __m128i values = _mm_loadu_si128((const __m128i*) (Coefficients + row*8));
+            __m128i low    = _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16);
+            __m128i high   = _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16);
+
+            left [row] = _mm_mul_ps(_mm_cvtepi32_ps(low),  _mm_loadu_ps(Quant + row*8));
+            right[row] = _mm_mul_ps(_mm_cvtepi32_ps(high), _mm_loadu_ps(Quant + row*8 + 4));
+        }
+
+        IDCT1D(left);                               //== columns, four at a time ============----
+        IDCT1D(right);
+
+        Transpose(left, right);
+
+        IDCT1D(left);                               //== rows ===============================----
+        IDCT1D(right);
+
+        Transpose(left, right);
+
+        const __m128 bias = _mm_set1_ps(128.0f);
+
+        for(int row=0; row<8; row++)
+        {
+            __m128i low   = _mm_cvtps_epi32(_mm_add_ps(left [row], bias));
+            __m128i high  = _mm_cvtps_epi32(_mm_add_ps(right[row], bias));
+            __m128i words = _mm_packs_epi32(low, high);
+
+            _mm_storel_epi64((__m128i*) (Output + row*Span), _mm_packus_epi16(words, words));
+        }
+    }
+
+#else
+
+    inline void IDCT1D(float *V, int Stride)
+    {
+        float tmp10 = V[0*Stride] + V[4*Stride];
+        float tmp11 = V[0*Stride] - V[4*Stride];
+        float tmp13 = V[2*Stride] + V[6*Stride];
+        float tmp12 = (V[2*Stride] - V[6*Stride])*kIDCT1414 - tmp13;
+
+        float tmp0  = tmp10 + tmp13;
+        float tmp3  = tmp10 - tmp13;
+        float tmp1  = tmp11 + tmp12;
+        float tmp2  = tmp11 - tmp12;
+
+        float z13   = V[5*Stride] + V[3*Stride];
+        float z10   = V[5*Stride] - V[3*Stride];
+        float z11   = V[1*Stride] + V[7*Stride];
+        float z12   = V[1*Stride] - V[7*Stride];
+
+        float tmp7  = z11 + z13;
+        float z5    = (z10 + z12)*kIDCT1847;
+
+        tmp11       = (z11 - z13)*kIDCT1414;
+        tmp10       = z12*kIDCT1082 - z5;
+        tmp12       = z10*kIDCT2613 + z5;
+
+        float tmp6  = tmp12 - tmp7;
+        float tmp5  = tmp11 - tmp6;
+        float tmp4  = tmp10 + tmp5;
+
+        V[0*Stride] = tmp0 + tmp7;
+        V[7*Stride] = tmp0 - tmp7;
+        V[1*Stride] = tmp1 + tmp6;
+        V[6*Stride] = tmp1 - tmp6;
+        V[2*Stride] = tmp2 + tmp5;
+        V[5*Stride] = tmp2 - tmp5;
+        V[4*Stride] = tmp3 + tmp4;
+        V[3*Stride] = tmp3 - tmp4;
+    }
+
+    void InverseDCT(const short *Coefficients, const float *Quant, unsigned char *Output, int Span)
+    {
+        float workspace[64];
+
+        for(int i=0; i<64; i++)
+            workspace[i] = Coefficients[i]*Quant[i];
+
+        for(int column=0; column<8; column++)
+            IDCT1D(workspace + column, 8);
+
+        for(int row=0; row<8; row++)
+            IDCT1D(workspace + row*8, 1);
+
+        for(int row=0; row<8; row++)
+        {
+            for(int column=0; column<8; column++)
+            {
+                int value = (int) floorf(workspace[row*8+column] + 128.5f);
+
+                Output[row*Span+column] = (unsigned char) (value<0 ? 0 : (value>255 ? 255 : value));
+            }
+        }
+    }
+
+#endif
+
+    inline int DecodeSymbol(sBitReader &Bits, const unsigned char *FastLength, const unsigned char *FastSymbol,
+                            const int *MaxCode, const int *ValueOffset, const unsigned char *Values)
+    {
+        Bits.Fill();
+
+        unsigned int look   = Bits.Peek(9);
+        int          length = FastLength[look];
+
+        if(length)
+        {
+            Bits.Skip(length);
+            return FastSymbol[look];
+        }
+
+        unsigned int code = Bits.Peek(16);
+
+        for(length=10; length<=16; length++)
+        {
+            int candidate = (int) (code >> (16-length));
+
+            if(candidate<=MaxCode[length])
+            {
+                Bits.Skip(length);
+                return Values[ValueOffset[length] + candidate];
+            }
+        }
+
+        return -1;
+    }
+}
+
+cJPEGDecoder::cJPEGDecoder()
+    : mComponentCount(0)
+    , mScanComponentCount(0)
+    , mWidth(0)
+    , mHeight(0)
+    , mMCUWidth(8)
+    , mMCUHeight(8)
+    , mMCUsPerRow(0)
+    , mMCUCount(0)
+    , mRestartInterval(0)
+{
+    memset(mQuant, 0, sizeof(mQuant));
+    memset(mDC, 0, sizeof(mDC));
+    memset(mAC, 0, sizeof(mAC));
+}
+
+//== Parsing ===========================================================================================----
+
+bool cJPEGDecoder::Parse(const unsigned char *Data, int Size)
+{
+    mComponentCount     = 0;
+    mScanComponentCount = 0;
+    mWidth              = 0;
+    mHeight             = 0;
+    mRestartInterval    = 0;
+
+    mSegments.clear();
+
+    if(Size<4 || Data[0]!=0xFF || Data[1]!=0xD8)
+        return false;
+
+    const unsigned char *current = Data + 2;
+    const unsigned char *end     = Data + Size;
+
+    while(current+4<=end)
+    {
+        if(current[0]!=0xFF)
+        {
+            current++;
+            continue;
+        }
+
+        unsigned char marker = current[1];
+
+        if(marker==0xFF)
+        {
+            current++;                              //== fill byte ==--
+            continue;
+        }
+
+        current += 2;
+
+        if(marker==0x01 || (marker>=0xD0 && marker<=0xD8))
+            continue;                               //== markers without a length ==--
+
+        if(marker==0xD9)
+            return false;                           //== no scan ==--
+
+        int length = (current[0] << 8) | current[1];
+
+        if(length<2 || current+length>end)
+            return false;
+
+        const unsigned char *segment = current + 2;
+        int                  size    = length - 2;
+
+        switch(marker)
+        {
+        case 0xDB:
+            if(!ParseQuantization(segment, size))
+                return false;
+            break;
+
+        case 0xC4:
+            if(!ParseHuffman(segment, size))
+                return false;
+            break;
+
+        case 0xC0:
+        case 0xC1:
+            if(!ParseFrame(segment, size))
+                return false;
+            break;
+
+        case 0xC2: case 0xC3: case 0xC5: case 0xC6: case 0xC7:
+        case 0xC9: case 0xCA: case 0xCB: case 0xCD: case 0xCE: case 0xCF:
+            return false;                           //== progressive, lossless, arithmetic ==--
+
+        case 0xDD:
+            if(size<2)
+                return false;
+            mRestartInterval = (segment[0] << 8) | segment[1];
+            break;
+
+        case 0xDA:
+            if(!ParseScan(segment, size))
+                return false;
+
+            IndexSegments(current + length, end);
+
+            return !mSegments.empty();
+
+        default:
+            break;                                  //== APPn, COM ==--
+        }
+
+        current += length;
+    }
+
+    return false;
+}
+
+bool cJPEGDecoder::ParseQuantization(const unsigned char *Data, int Length)
+{
+    //== AAN scale factors, also folds in the final divide by 8 ==--
+
+    float scale[8];
+
+    scale[0] = 1.0f;
+
+    for(int k=1; k<8; k++)
+        scale[k] = (float) (cos(k*3.14159265358979323846/16.0)*1.41421356237309504880);
+
+    while(Length>0)
+    {
+        int precision = Data[0] >> 4;
+        int table     = Data[0] & 15;
+        int size      = 1 + 64*(precision ? 2 : 1);
+
+        if(table>3 || Length<size)
+            return false;
+
+        for(int i=0; i<64; i++)
+        {
+            int value   = precision ? ((Data[1+i*2] << 8) | Data[2+i*2]) : Data[1+i];
+            int natural = kZigZag[i];
+
+            mQuant[table][natural] = value*scale[natural>>3]*scale[natural&7]/8.0f;
+        }
+
+        Data   += size;
+        Length -= size;
+    }
+
+    return true;
+}
+
+bool cJPEGDecoder::ParseHuffman(const unsigned char *Data, int Length)
+{
+    while(Length>=17)
+    {
+        int tableClass = Data[0] >> 4;
+        int table      = Data[0] & 15;
+
+        if(tableClass>1 || table>3)
+            return false;
+
+        int count = 0;
+
+        for(int i=0; i<16; i++)
+            count += Data[1+i];
+
+        if(count>256 || Length<17+count)
+            return false;
+
+        BuildHuffman(tableClass ? mAC[table] : mDC[table], Data+1, Data+17);
+
+        Data   += 17+count;
+        Length -= 17+count;
+    }
+
+    return true;
+}
+
+void cJPEGDecoder::BuildHuffman(sHuffmanTable &Table, const unsigned char *Counts, const unsigned char *Values)
+{
+    memset(&Table, 0, sizeof(Table));
+
+    int code  = 0;
+    int index = 0;
+
+    for(int length=1; length<=16; length++)
+    {
+        int count = Counts[length-1];
+
+        Table.ValueOffset[length] = index - code;
+
+        for(int i=0; i<count; i++, code++, index++)
+        {
+            Table.Values[index] = Values[index];
+
+            if(length<=9)
+            {
+                int shift = 9-length;
+                int first = code << shift;
+
+                for(int j=0; j<(1<<shift) && first+j<512; j++)
+                {
+                    Table.FastLength[first+j] = (unsigned char) length;
+                    Table.FastSymbol[first+j] = Values[index];
+                }
+            }
+        }
+
+        Table.MaxCode[length] = count ? code-1 : -1;
+
+        code <<= 1;
+    }
+
+    Table.Valid = true;
+}
+
+bool cJPEGDecoder::ParseFrame(const unsigned char *Data, int Length)
+{
+    if(Length<6 || Data[0]!=8)
+        return false;                               //== 8-bit samples only ==--
+
+    mHeight         = (Data[1] << 8) | Data[2];
+    mWidth          = (Data[3] << 8) | Data[4];
+    mComponentCount = Data[5];
+
+    if(mWidth==0 || mHeight==0 || mComponentCount<1 || mComponentCount>4 || Length<6+3*mComponentCount)
+        return false;
+
+    int maxH = 1;
+    int maxV = 1;
+
+    for(int i=0; i<mComponentCount; i++)
+    {
+        sComponent &component = mComponents[i];
+
+        component.ID         = Data[6+i*3];
+        component.H          = Data[7+i*3] >> 4;
+        component.V          = Data[7+i*3] & 15;
+        component.QuantTable = Data[8+i*3];
+
+        if(component.H<1 || component.H>4 || component.V<1 || component.V>4 || component.QuantTable>3)
+            return false;
+
+        if(component.H>maxH) maxH = component.H;
+        if(component.V>maxV) maxV = component.V;
+    }
+
+    //== luminance must be full resolution ==--
+
+    if(mComponents[0].H!=maxH || mComponents[0].V!=maxV)
+        return false;
+
+    mMCUWidth  = 8*maxH;
+    mMCUHeight = 8*maxV;
+
+    return true;
+}
+
+bool cJPEGDecoder::ParseScan(const unsigned char *Data, int Length)
+{
+    if(mComponentCount==0 || Length<1)
+        return false;
+
+    mScanComponentCount = Data[0];
+
+    if(mScanComponentCount<1 || mScanComponentCount>mComponentCount || Length<1+2*mScanComponentCount+3)
+        return false;
+
+    bool hasLuminance = false;
+
+    for(int i=0; i<mScanComponentCount; i++)
+    {
+        int id    = Data[1+i*2];
+        int found = -1;
+
+        for(int j=0; j<mComponentCount; j++)
+        {
+            if(mComponents[j].ID==id)
+                found = j;
+        }
+
+        if(found<0)
+            return false;
+
+        mComponents[found].DCTable = Data[2+i*2] >> 4;
+        mComponents[found].ACTable = Data[2+i*2] & 15;
+
+        if(mComponents[found].DCTable>3 || mComponents[found].ACTable>3
+           || !mDC[mComponents[found].DCTable].Valid || !mAC[mComponents[found].ACTable].Valid)
+            return false;
+
+        mScanComponents[i] = found;
+        hasLuminance      |= (found==0);
+    }
+
+    if(!hasLuminance)
+        return false;
+
+    if(mScanComponentCount==1)
+    {
+        //== non-interleaved, one block per MCU ==--
+
+        mMCUWidth  = 8;
+        mMCUHeight = 8;
+    }
+
+    mMCUsPerRow = (mWidth  + mMCUWidth -1)/mMCUWidth;
+    mMCUCount   = mMCUsPerRow * ((mHeight + mMCUHeight-1)/mMCUHeight);
+
+    return true;
+}
+
+void cJPEGDecoder::IndexSegments(const unsigned char *Scan, const unsigned char *End)
+{
+    const unsigned char *start   = Scan;
+    const unsigned char *current = Scan;
+    int                  mcu     = 0;
+
+    while(mcu<mMCUCount)
+    {
+        const unsigned char *marker = (const unsigned char*) memchr(current, 0xFF, End-current);
+
+        if(marker && marker+1<End && (marker[1]==0x00 || marker[1]==0xFF))
+        {
+            current = marker+1;                     //== stuffing or fill, keep looking ==--
+            continue;
+        }
+
+        sSegment segment;
+
+        segment.Data     = start;
+        segment.Size     = (int) ((marker ? marker : End) - start);
+        segment.FirstMCU = mcu;
+
+        mSegments.push_back(segment);
+
+        if(marker==0 || marker+1>=End || marker[1]<0xD0 || marker[1]>0xD7 || mRestartInterval==0)
+            break;
+
+        mcu    += mRestartInterval;
+        start   = marker+2;
+        current = start;
+    }
+}
+
+//== Decoding ==========================================================================================----
+
+bool cJPEGDecoder::Decode(const unsigned char *Data, int Size, unsigned char *Image, int Span)
+{
+    if(!Parse(Data, Size))
+        return false;
+
+    return DecodeSegments(0, SegmentCount(), Image, Span);
+}
+
+bool cJPEGDecoder::DecodeSegments(int First, int Count, unsigned char *Image, int Span) const
+{
+    bool success = true;
+
+    for(int i=First; i<First+Count && i<(int) mSegments.size(); i++)
+        success &= DecodeSegment(mSegments[i], Image, Span, 0);
+
+    return success;
+}
+
+//== Region of interest decoding =======================================================================----
+
+bool cJPEGDecoder::DecodeRegions(const sRect *Rects, int RectCount, unsigned char *Image, int Span) const
+{
+    return DecodeRegions(Rects, RectCount, 0, SegmentCount(), Image, Span);
+}
+
+bool cJPEGDecoder::DecodeRegions(const sRect *Rects, int RectCount, int First, int Count,
+                                 unsigned char *Image, int Span) const
+{
+    std::vector<unsigned char> mask;
+
+    if(!BuildBlockMask(Rects, RectCount, mask))
+        return true;                                //== nothing inside the image ==--
+
+    bool success = true;
+
+    for(int i=First; i<First+Count && i<(int) mSegments.size(); i++)
+        success &= DecodeSegment(mSegments[i], Image, Span, &mask[0]);
+
+    return success;
+}
+
+bool cJPEGDecoder::BuildBlockMask(const sRect *Rects, int RectCount, std::vector<unsigned char> &Mask) const
+{
+    int blocksPerRow = (mWidth +7)/8;
+    int blockRows    = (mHeight+7)/8;
+    bool any         = false;
+
+    Mask.assign(blocksPerRow*blockRows, 0);
+
+    for(int i=0; i<RectCount; i++)
+    {
+        int left   = (Rects[i].Left  <0) ? 0 : Rects[i].Left;
+        int top    = (Rects[i].Top   <0) ? 0 : Rects[i].Top;
+        int right  = (Rects[i].Right >=mWidth ) ? mWidth -1 : Rects[i].Right;
+        int bottom = (Rects[i].Bottom>=mHeight) ? mHeight-1 : Rects[i].Bottom;
+
+        if(left>right || top>bottom)
+            continue;
+
+        for(int y=top/8; y<=bottom/8; y++)
+            memset(&Mask[y*blocksPerRow + left/8], 1, right/8 - left/8 + 1);
+
+        any = true;
+    }
+
+    return any;
+}
+
+bool cJPEGDecoder::MCUInMask(const unsigned char *Mask, int MCU) const
+{
+    int blocksPerRow = (mWidth +7)/8;
+    int blockRows    = (mHeight+7)/8;
+
+    int x = (MCU % mMCUsPerRow)*(mMCUWidth /8);
+    int y = (MCU / mMCUsPerRow)*(mMCUHeight/8);
+
+    for(int v=y; v<y+mMCUHeight/8 && v<blockRows; v++)
+    {
+        for(int h=x; h<x+mMCUWidth/8 && h<blocksPerRow; h++)
+        {
+            if(Mask[v*blocksPerRow + h])
+                return true;
+        }
+    }
+
+    return false;
+}
+
+bool cJPEGDecoder::DecodeSegment(const sSegment &Segment, unsigned char *Image, int Span, const unsigned char *Mask) const
+{
+    int lastMCU = mRestartInterval ? Segment.FirstMCU + mRestartInterval : mMCUCount;
+
+    if(lastMCU>mMCUCount)
+        lastMCU = mMCUCount;
+
+    int blocksPerRow = (mWidth+7)/8;
+
+    if(Mask)
+    {
+        //== entropy decoding is sequential within a segment, but can stop after the last
+        //== MCU that touches a region, and segments without any are never read at all.
+
+        while(lastMCU>Segment.FirstMCU && !MCUInMask(Mask, lastMCU-1))
+            lastMCU--;
+    }
+
+    sBitReader bits(Segment.Data, Segment.Size);
+
+    int   predictor[4] = { 0, 0, 0, 0 };
+    short coefficients[64];
+    unsigned char edge[64];
+
+    for(int mcu=Segment.FirstMCU; mcu<lastMCU; mcu++)
+    {
+        int mcuX = (mcu % mMCUsPerRow)*mMCUWidth;
+        int mcuY = (mcu / mMCUsPerRow)*mMCUHeight;
+
+        for(int s=0; s<mScanComponentCount; s++)
+        {
+            int               index     = mScanComponents[s];
+            const sComponent &component = mComponents[index];
+            bool              luminance = (index==0);
+
+            const sHuffmanTable &dc = mDC[component.DCTable];
+            const sHuffmanTable &ac = mAC[component.ACTable];
+
+            int blocksH = (mScanComponentCount==1) ? 1 : component.H;
+            int blocksV = (mScanComponentCount==1) ? 1 : component.V;
+
+            for(int v=0; v<blocksV; v++)
+            {
+                for(int h=0; h<blocksH; h++)
+                {
+                    //== DC ==--
+
+                    int symbol = DecodeSymbol(bits, dc.FastLength, dc.FastSymbol, dc.MaxCode, dc.ValueOffset, dc.Values);
+
+                    if(symbol<0 || symbol>15)
+                        return false;
+
+                    predictor[s] += bits.Receive(symbol);
+
+                    int  x    = mcuX + h*8;
+                    int  y    = mcuY + v*8;
+                    bool keep = luminance && x<mWidth && y<mHeight
+                                && (Mask==0 || Mask[(y/8)*blocksPerRow + x/8]);
+
+                    if(keep)
+                    {
+                        memset(coefficients, 0, sizeof(coefficients));
+                        coefficients[0] = (short) predictor[s];
+                    }
+
+                    //== AC ==--
+
+                    for(int k=1; k<64; )
+                    {
+                        symbol = DecodeSymbol(bits, ac.FastLength, ac.FastSymbol, ac.MaxCode, ac.ValueOffset, ac.Values);
+
+                        if(symbol<0)
+                            return false;
+
+                        int run  = symbol >> 4;
+                        int size = symbol & 15;
+
+                        if(size==0)
+                        {
+                            if(run!=15)
+                                break;              //== end of block ==--
+
+                            k += 16;
+                            continue;
+                        }
+
+                        k += run;
+
+                        int value = bits.Receive(size);
+
+                        if(keep)
+                            coefficients[kZigZag[k]] = (short) value;
+
+                        k++;
+                    }
+
+                    if(!keep)
+                        continue;
+
+                    const float *quant = mQuant[component.QuantTable];
+
+                    if(x+8<=mWidth && y+8<=mHeight)
+                    {
+                        InverseDCT(coefficients, quant, Image + y*Span + x, Span);
+                    }
+                    else
+                    {
+                        InverseDCT(coefficients, quant, edge, 8);
+
+                        int width  = (mWidth -x<8) ? mWidth -x : 8;
+                        int height = (mHeight-y<8) ? mHeight-y : 8;
+
+                        for(int row=0; row<height; row++)
+                            memcpy(Image + (y+row)*Span + x, edge + row*8, width);
+                    }
+                }
+            }
+        }
+
+        if(bits.Overrun>kMaxOverrunBytes)
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,131 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Baseline JPEG decoder with a single channel (luminance only) output path.  Intended for camera
+//== MJPEG frames (see Frame::JPEGImage), which are 8-bit baseline Huffman images.
+//==
+//== Parse() indexes the entropy coded scan at restart marker boundaries.  Every restart interval
+//== can be decoded independently, so after a successful Parse() DecodeSegments() may be called
+//== for disjoint segment ranges from several threads at once.  The JPEG data must stay valid
+//== until decoding finishes.
+//==
+//== DecodeRegions() only transforms the 8x8 blocks touching a list of rectangles, e.g. object
+//== bounding boxes, and stops entropy decoding each restart interval after the last block it
+//== needs; intervals that miss every rectangle are skipped outright.  Pixels outside the blocks
+//== are left untouched.  With restart markers the cost follows the region area, without them
+//== the scan still has to be Huffman decoded up to the last region.
+//==
+//== Chroma blocks of colour images are entropy decoded (they are interleaved with luminance) but
+//== never dequantized or transformed.  The IDCT is the AAN float transform, SSE2 on x86/x64.
+//==
+
+#ifndef __CAMERALIBRARY__JPEGDECODER_H__
+#define __CAMERALIBRARY__JPEGDECODER_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <vector>
+#include "cameralibraryglobals.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cJPEGDecoder
+    {
+    public:
+        cJPEGDecoder();
+
+        bool    Parse(const unsigned char *Data, int Size);     //== Headers & restart index ==----
+
+        int     Width() const               { return mWidth;  }
+        int     Height() const              { return mHeight; }
+        int     RestartInterval() const     { return mRestartInterval; }   //== MCUs, 0 if none
+        int     SegmentCount() const        { return (int) mSegments.size(); }
+
+        //== Decode restart segments [First, First+Count) into an 8-bit Width x Height image. ==--
+
+        bool    DecodeSegments(int First, int Count, unsigned char *Image, int Span) const;
+
+        bool    Decode(const unsigned char *Data, int Size, unsigned char *Image, int Span);
+
+        //== Partial decode, rectangles are inclusive pixel bounds and may extend past the image ==--
+
+        struct sRect
+        {
+            int Left;
+            int Top;
+            int Right;
+            int Bottom;
+        };
+
+        bool    DecodeRegions(const sRect *Rects, int RectCount, unsigned char *Image, int Span) const;
+        bool    DecodeRegions(const sRect *Rects, int RectCount, int First, int Count,
+                              unsigned char *Image, int Span) const;
+
+    private:
+        struct sHuffmanTable
+        {
+            bool           Valid;
+            unsigned char  FastLength[512];         //== 9 bit lookup, 0: longer code ======----
+            unsigned char  FastSymbol[512];
+            int            MaxCode[18];
+            int            ValueOffset[17];
+            unsigned char  Values[256];
+        };
+
+        struct sComponent
+        {
+            int ID;
+            int H;
+            int V;
+            int QuantTable;
+            int DCTable;
+            int ACTable;
+        };
+
+        struct sSegment
+        {
+            const unsigned char * Data;
+            int                   Size;
+            int                   FirstMCU;
+        };
+
+        bool    ParseQuantization(const unsigned char *Data, int Length);
+        bool    ParseHuffman     (const unsigned char *Data, int Length);
+        bool    ParseFrame       (const unsigned char *Data, int Length);
+        bool    ParseScan        (const unsigned char *Data, int Length);
+        void    IndexSegments    (const unsigned char *Scan, const unsigned char *End);
+
+        bool    DecodeSegment(const sSegment &Segment, unsigned char *Image, int Span,
+                              const unsigned char *Mask) const;     //== Mask 0: whole image ==--
+
+        bool    BuildBlockMask(const sRect *Rects, int RectCount, std::vector<unsigned char> &Mask) const;
+        bool    MCUInMask(const unsigned char *Mask, int MCU) const;
+
+        static void BuildHuffman(sHuffmanTable &Table, const unsigned char *Counts, const unsigned char *Values);
+
+        float           mQuant[4][64];              //== Dequantization with AAN scaling ==----
+        sHuffmanTable   mDC[4];
+        sHuffmanTable   mAC[4];
+
+        sComponent      mComponents[4];
+        int             mComponentCount;
+        int             mScanComponents[4];         //== Indices into mComponents ===========----
+        int             mScanComponentCount;
+
+        int             mWidth;
+        int             mHeight;
+        int             mMCUWidth;                  //== Pixels =============================----
+        int             mMCUHeight;
+        int             mMCUsPerRow;
+        int             mMCUCount;
+        int             mRestartInterval;
+
+        std::vector<sSegment> mSegments;
+    };
+}
+
+#endif
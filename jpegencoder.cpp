@@ -0,0 +1,357 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <math.h>
+
+#include "jpegencoder.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    //== Zigzag position -> natural (row major) position ==--
+
+    const unsigned char kZigZag[64] =
+    {
+         0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+        12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+    };
+
+    //== Annex K.1 luminance quantization, natural order, for quality 50 ==--
+
+    const unsigned char kLuminanceQuant[64] =
+    {
+        16,  11,  10,  16,  24,  40,  51,  61,
+        12,  12,  14,  19,  26,  58,  60,  55,
+        14,  13,  16,  24,  40,  57,  69,  56,
+        14,  17,  22,  29,  51,  87,  80,  62,
+        18,  22,  37,  56,  68, 109, 103,  77,
+        24,  35,  55,  64,  81, 104, 113,  92,
+        49,  64,  78,  87, 103, 121, 120, 101,
+        72,  92,  95,  98, 112, 100, 103,  99
+    };
+
+    //== Annex K.3 luminance Huffman tables, code counts by length then symbols ==--
+
+    const unsigned char kDCCounts[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+    const unsigned char kDCValues[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+    const unsigned char kACCounts[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+    const unsigned char kACValues[162] =
+    {
+        0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+        0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+        0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+        0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+        0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+        0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+        0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+        0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+        0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa
+    };
+
+    struct sHuffmanCodes
+    {
+        unsigned short Code[256];
+        unsigned char  Length[256];
+    };
+
+    void BuildCodes(sHuffmanCodes &Codes, const unsigned char *Counts, const unsigned char *Values)
+    {
+        int code  = 0;
+        int index = 0;
+
+        for(int i=0; i<256; i++)
+        {
+            Codes.Code[i]   = 0;
+            Codes.Length[i] = 0;
+        }
+
+        for(int length=1; length<=16; length++)
+        {
+            for(int i=0; i<Counts[length-1]; i++, code++, index++)
+            {
+                Codes.Code  [Values[index]] = (unsigned short) code;
+                Codes.Length[Values[index]] = (unsigned char) length;
+            }
+
+            code <<= 1;
+        }
+    }
+
+    //== Entropy coding ==--
+
+    struct sBitWriter
+    {
+        sBitWriter(std::vector<unsigned char> &Output) : Output(Output), Buffer(0), Count(0) {}
+
+        void Put(unsigned int Value, int Bits)
+        {
+            Buffer  = (Buffer << Bits) | (Value & ((1u << Bits) - 1));
+            Count  += Bits;
+
+            while(Count>=8)
+            {
+                unsigned char byte = (unsigned char) (Buffer >> (Count-8));
+
+                Output.push_back(byte);
+
+                if(byte==0xFF)
+                    Output.push_back(0x00);         //== stuffed zero ==--
+
+                Count -= 8;
+            }
+        }
+
+        void Flush()
+        {
+            if(Count>0)
+                Put(0x7F, 8-Count);                 //== pad with ones, F.1.2.3 ==--
+
+            Buffer = 0;
+        }
+
+        std::vector<unsigned char> & Output;
+        unsigned int                 Buffer;
+        int                          Count;
+    };
+
+    inline int Category(int Value)
+    {
+        int magnitude = (Value<0) ? -Value : Value;
+        int bits      = 0;
+
+        while(magnitude)
+        {
+            bits++;
+            magnitude >>= 1;
+        }
+
+        return bits;
+    }
+
+    void EncodeBlock(sBitWriter &Bits, const short *Coefficients, int &Predictor,
+                     const sHuffmanCodes &DC, const sHuffmanCodes &AC)
+    {
+        int difference = Coefficients[0] - Predictor;
+        int category   = Category(difference);
+
+        Predictor = Coefficients[0];
+
+        Bits.Put(DC.Code[category], DC.Length[category]);
+
+        if(category)
+            Bits.Put(difference<0 ? difference-1 : difference, category);
+
+        int run = 0;
+
+        for(int k=1; k<64; k++)
+        {
+            int value = Coefficients[kZigZag[k]];
+
+            if(value==0)
+            {
+                run++;
+                continue;
+            }
+
+            for(; run>15; run-=16)
+                Bits.Put(AC.Code[0xF0], AC.Length[0xF0]);
+
+            category = Category(value);
+
+            int symbol = (run << 4) | category;
+
+            Bits.Put(AC.Code[symbol], AC.Length[symbol]);
+            Bits.Put(value<0 ? value-1 : value, category);
+
+            run = 0;
+        }
+
+        if(run)
+            Bits.Put(AC.Code[0x00], AC.Length[0x00]);     //== end of block ==--
+    }
+
+    //== Headers ==--
+
+    void PutMarker(std::vector<unsigned char> &Output, unsigned char Marker, int Length)
+    {
+        Output.push_back(0xFF);
+        Output.push_back(Marker);
+
+        if(Length>0)
+        {
+            Output.push_back((unsigned char) (Length >> 8));
+            Output.push_back((unsigned char) Length);
+        }
+    }
+
+    void PutHuffman(std::vector<unsigned char> &Output, int Class, const unsigned char *Counts,
+                    const unsigned char *Values)
+    {
+        int count = 0;
+
+        for(int i=0; i<16; i++)
+            count += Counts[i];
+
+        PutMarker(Output, 0xC4, 2 + 1 + 16 + count);
+
+        Output.push_back((unsigned char) (Class << 4));
+        Output.insert(Output.end(), Counts, Counts + 16);
+        Output.insert(Output.end(), Values, Values + count);
+    }
+}
+
+int cJPEGEncoder::Encode(const unsigned char *Image, int Width, int Height, int Span, int Quality,
+                         int RestartInterval, std::vector<unsigned char> &Output)
+{
+    if(Image==0 || Width<=0 || Height<=0 || Width>65535 || Height>65535)
+        return 0;
+
+    size_t start = Output.size();
+
+    //== Quantization, libjpeg's quality scaling ==--
+
+    Quality = (Quality<1) ? 1 : (Quality>100 ? 100 : Quality);
+
+    int scale = (Quality<50) ? 5000/Quality : 200 - 2*Quality;
+
+    unsigned char quant[64];
+
+    for(int i=0; i<64; i++)
+    {
+        int value = (kLuminanceQuant[i]*scale + 50)/100;
+
+        quant[i] = (unsigned char) (value<1 ? 1 : (value>255 ? 255 : value));
+    }
+
+    //== SOI, JFIF, DQT, SOF0, DHT, DRI, SOS ==--
+
+    static const unsigned char jfif[14] = { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+
+    PutMarker(Output, 0xD8, 0);
+    PutMarker(Output, 0xE0, 2 + sizeof(jfif));
+    Output.insert(Output.end(), jfif, jfif + sizeof(jfif));
+
+    PutMarker(Output, 0xDB, 2 + 1 + 64);
+    Output.push_back(0x00);
+
+    for(int k=0; k<64; k++)
+        Output.push_back(quant[kZigZag[k]]);
+
+    const unsigned char frame[9] =
+    {
+        8, (unsigned char) (Height >> 8), (unsigned char) Height, (unsigned char) (Width >> 8), (unsigned char) Width,
+        1, 1, 0x11, 0
+    };
+
+    PutMarker(Output, 0xC0, 2 + sizeof(frame));
+    Output.insert(Output.end(), frame, frame + sizeof(frame));
+
+    PutHuffman(Output, 0, kDCCounts, kDCValues);
+    PutHuffman(Output, 1, kACCounts, kACValues);
+
+    if(RestartInterval>0)
+    {
+        RestartInterval = (RestartInterval>65535) ? 65535 : RestartInterval;
+
+        PutMarker(Output, 0xDD, 4);
+        Output.push_back((unsigned char) (RestartInterval >> 8));
+        Output.push_back((unsigned char) RestartInterval);
+    }
+
+    static const unsigned char scan[6] = { 1, 1, 0x00, 0, 63, 0 };
+
+    PutMarker(Output, 0xDA, 2 + sizeof(scan));
+    Output.insert(Output.end(), scan, scan + sizeof(scan));
+
+    //== Forward DCT basis with the 1/4 C(u) C(v) normalisation split across both passes ==--
+
+    float basis[8][8];
+
+    for(int u=0; u<8; u++)
+    {
+        for(int x=0; x<8; x++)
+            basis[u][x] = (float) ((u ? 0.5 : 0.5/sqrt(2.0))*cos((2*x+1)*u*3.14159265358979323846/16.0));
+    }
+
+    sHuffmanCodes dc, ac;
+
+    BuildCodes(dc, kDCCounts, kDCValues);
+    BuildCodes(ac, kACCounts, kACValues);
+
+    sBitWriter bits(Output);
+
+    int blocksPerRow = (Width +7)/8;
+    int blockCount   = blocksPerRow * ((Height+7)/8);
+    int predictor    = 0;
+    int restarts     = 0;
+
+    for(int block=0; block<blockCount; block++)
+    {
+        if(RestartInterval>0 && block>0 && block%RestartInterval==0)
+        {
+            bits.Flush();
+            PutMarker(Output, (unsigned char) (0xD0 + (restarts++ & 7)), 0);
+
+            predictor = 0;
+        }
+
+        int left = (block % blocksPerRow)*8;
+        int top  = (block / blocksPerRow)*8;
+
+        //== Edge blocks repeat the last column and row ==--
+
+        float samples[64];
+
+        for(int y=0; y<8; y++)
+        {
+            const unsigned char *row = Image + ((top+y<Height) ? top+y : Height-1)*Span;
+
+            for(int x=0; x<8; x++)
+                samples[y*8+x] = row[(left+x<Width) ? left+x : Width-1] - 128.0f;
+        }
+
+        float rows[64];
+
+        for(int y=0; y<8; y++)
+        {
+            for(int u=0; u<8; u++)
+            {
+                float sum = 0;
+
+                for(int x=0; x<8; x++)
+                    sum += basis[u][x]*samples[y*8+x];
+
+                rows[y*8+u] = sum;
+            }
+        }
+
+        short coefficients[64];
+
+        for(int v=0; v<8; v++)
+        {
+            for(int u=0; u<8; u++)
+            {
+                float sum = 0;
+
+                for(int y=0; y<8; y++)
+                    sum += basis[v][y]*rows[y*8+u];
+
+                coefficients[v*8+u] = (short) floorf(sum/quant[v*8+u] + 0.5f);
+            }
+        }
+
+        EncodeBlock(bits, coefficients, predictor, dc, ac);
+    }
+
+    bits.Flush();
+    PutMarker(Output, 0xD9, 0);
+
+    return (int) (Output.size() - start);
+}
@@ -0,0 +1,36 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Baseline single channel JPEG encoder, the counterpart of cJPEGDecoder for building frames with a
+//== known source image: the self-test and decoder benchmarks compare what comes back against it.
+//==
+//== Output is an 8-bit Huffman coded JFIF image with the Annex K luminance tables, the quantization
+//== table scaled to Quality (1-100, as libjpeg) and, when RestartInterval is set, a restart marker
+//== every RestartInterval blocks the way camera MJPEG frames are split.  The forward DCT is a plain
+//== separable float transform, accurate rather than fast; nothing on the capture path encodes.
+//==
+
+#ifndef __CAMERALIBRARY__JPEGENCODER_H__
+#define __CAMERALIBRARY__JPEGENCODER_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <vector>
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cJPEGEncoder
+    {
+    public:
+        //== Appends the JPEG to Output and returns its size, 0 for an empty image ==--
+
+        static int Encode(const unsigned char *Image, int Width, int Height, int Span, int Quality,
+                          int RestartInterval, std::vector<unsigned char> &Output);
+    };
+}
+
+#endif
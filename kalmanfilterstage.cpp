@@ -0,0 +1,296 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <math.h>
+
+#include "kalmanfilterstage.h"
+#include "benchmarknoise.h"
+#include "Core/Timer.h"
+#include "Core/RotationVector.h"
+
+#if !defined(__PLATFORM__LINUX__)
+#include "Core/RigidBody.h"
+#endif
+
+using namespace CameraLibrary;
+
+cKalmanFilterStage::cKalmanFilterStage()
+{
+    mSettings.PositionProcessNoise = 20.0;
+    mSettings.RotationProcessNoise = 200.0;
+    mSettings.MinimumError         = 0.0002;
+    mSettings.MarkerRadius         = 0.05;
+    mSettings.MaxGap               = 0.1;
+}
+
+void cKalmanFilterStage::Reset()
+{
+    for(int i=0; i<(int) mMarkerTracks.size(); i++)
+        ResetMarkerTrack(i);
+
+    mRigidBodyTracks.clear();
+}
+
+bool cKalmanFilterStage::Advance(double &LastTime, double TimeStamp, double &Interval) const
+{
+    //== false: the track is too old (or time went backwards) and has to restart ==--
+
+    Interval = TimeStamp - LastTime;
+    LastTime = TimeStamp;
+
+    return Interval>=0 && Interval<=mSettings.MaxGap;
+}
+
+void cKalmanFilterStage::SetMarkerTrackCount(int Count)
+{
+    int previous = (int) mMarkerTracks.size();
+
+    mMarkerTracks.resize(Count<0 ? 0 : Count);
+
+    for(int i=previous; i<(int) mMarkerTracks.size(); i++)
+        ResetMarkerTrack(i);
+}
+
+void cKalmanFilterStage::ResetMarkerTrack(int Track)
+{
+    sMarkerTrack &track = mMarkerTracks[Track];
+
+    track.Position.Reset();
+    track.Position.SetProcessNoise(mSettings.PositionProcessNoise);
+    track.LastTime = 0;
+}
+
+void cKalmanFilterStage::FilterMarker(int Track, double TimeStamp, float Position[3], float Residual)
+{
+    if(Track<0 || Track>=(int) mMarkerTracks.size())
+        return;
+
+    sMarkerTrack &track = mMarkerTracks[Track];
+
+    double interval;
+
+    if(!Advance(track.LastTime, TimeStamp, interval))
+        track.Position.Reset();
+
+    track.Position.SetProcessNoise(mSettings.PositionProcessNoise);
+    track.Position.Predict(interval);
+
+    double error    = (Residual>mSettings.MinimumError) ? Residual : mSettings.MinimumError;
+    double position[3] = { Position[0], Position[1], Position[2] };
+
+    track.Position.Update(position, error*error);
+    track.Position.Position(position);
+
+    Position[0] = (float) position[0];
+    Position[1] = (float) position[1];
+    Position[2] = (float) position[2];
+}
+
+void cKalmanFilterStage::UpdateRigidBody(sRigidBodyTrack &Track, double TimeStamp, double Position[3], double Quaternion[4],
+                                         double PositionVariance, double RotationVariance) const
+{
+    double interval;
+
+    if(!Advance(Track.LastTime, TimeStamp, interval))
+    {
+        Track.Position.Reset();
+        Track.Rotation.Reset();
+    }
+
+    Track.Position.SetProcessNoise(mSettings.PositionProcessNoise);
+    Track.Rotation.SetProcessNoise(mSettings.RotationProcessNoise);
+
+    Track.Position.Predict(interval);
+    Track.Rotation.Predict(interval);
+
+    Track.Position.Update(Position, PositionVariance);
+    Track.Rotation.Update(Quaternion, RotationVariance);
+
+    Track.Position.Position(Position);
+    Track.Rotation.Rotation(Quaternion);
+}
+
+#if !defined(__PLATFORM__LINUX__)
+void cKalmanFilterStage::Filter(std::vector<Core::cRigidBody> &RigidBodies, double TimeStamp)
+{
+    for(int i=0; i<(int) RigidBodies.size(); i++)
+    {
+        Core::cRigidBody &body = RigidBodies[i];
+
+        if(!body.Tracked)
+            continue;
+
+        //== bodies usually come in the same order every frame, so start looking at i ==--
+
+        sRigidBodyTrack *track = 0;
+        int count = (int) mRigidBodyTracks.size();
+
+        for(int n=0; n<count && track==0; n++)
+        {
+            int index = (i+n)%count;
+
+            if(mRigidBodyTracks[index].ID==body.ID)
+                track = &mRigidBodyTracks[index];
+        }
+
+        if(track==0)
+        {
+            mRigidBodyTracks.push_back(sRigidBodyTrack());
+
+            track = &mRigidBodyTracks.back();
+            track->ID       = body.ID;
+            track->LastTime = TimeStamp;
+        }
+
+        //== the solver's error, shared by the markers it had, weighted by their quality ==--
+
+        double weight = 0;
+
+        for(int m=0; m<body.MarkerCount && m<Core::cRigidBody::kMaxRigidBodyMarkers; m++)
+        {
+            if(body.MarkerTracked[m])
+                weight += (body.MarkerQuality[m]>0) ? body.MarkerQuality[m] : 0;
+        }
+
+        if(weight<1)
+            weight = 1;
+
+        double error = (body.ErrorPerMarker>mSettings.MinimumError) ? body.ErrorPerMarker : mSettings.MinimumError;
+
+        double positionVariance = error*error/weight;
+        double rotationVariance = positionVariance/(mSettings.MarkerRadius*mSettings.MarkerRadius);
+
+        double position[3]   = { body.Position().X(), body.Position().Y(), body.Position().Z() };
+        double quaternion[4] = { body.Rotation().X(), body.Rotation().Y(), body.Rotation().Z(), body.Rotation().W() };
+
+        UpdateRigidBody(*track, TimeStamp, position, quaternion, positionVariance, rotationVariance);
+
+        body.SetPosition(Core::cVector3f((float) position[0], (float) position[1], (float) position[2]));
+        body.SetRotation(Core::cQuaternionf((float) quaternion[0], (float) quaternion[1], (float) quaternion[2], (float) quaternion[3]));
+    }
+
+    //== drop tracks of bodies that have been gone for a while ==--
+
+    for(int i=(int) mRigidBodyTracks.size()-1; i>=0; i--)
+    {
+        if(TimeStamp - mRigidBodyTracks[i].LastTime>mSettings.MaxGap)
+        {
+            mRigidBodyTracks[i] = mRigidBodyTracks.back();
+            mRigidBodyTracks.pop_back();
+        }
+    }
+}
+#endif
+
+void cKalmanFilterStage::Benchmark(int Tracks, int Frames, double Rate, sBenchmark &Result)
+{
+    if(Tracks<1) Tracks = 1;
+    if(Frames<1) Frames = 1;
+
+    const double noise      = 0.0005;
+    const double angleNoise = 0.01;
+
+    cKalmanFilterStage stage;
+
+    stage.SetMarkerTrackCount(Tracks);
+
+    std::vector<sRigidBodyTrack> bodies(Tracks);
+
+    cBenchmarkNoise random(12345);
+    Core::cTimer    timer;
+
+    double markerSeconds = 0;
+    double bodySeconds   = 0;
+    double rawError      = 0;
+    double filteredError = 0;
+    double rawAngle      = 0;
+    double filteredAngle = 0;
+
+    std::vector<float>  raw(Tracks*3);
+    std::vector<float>  filtered(Tracks*3);
+    std::vector<double> measured(Tracks*4);
+    std::vector<double> rotations(Tracks*4);
+
+    for(int f=0; f<Frames; f++)
+    {
+        double time = f/Rate;
+
+        //== every track walks a circle at 1 m/s and turns at 3 rad/s, measured with noise ==--
+
+        double truth[3]      = { 0.5*cos(2*time), 1.0, 0.5*sin(2*time) };
+        double angle         = 3.0*time;
+        double quaternion[4] = { 0, sin(0.5*angle), 0, cos(0.5*angle) };
+
+        for(int t=0; t<Tracks; t++)
+        {
+            double error[3];
+            double delta[4];
+
+            for(int k=0; k<3; k++)
+            {
+                raw[t*3+k] = (float) (truth[k] + noise*random.Normal());
+                error[k]   = angleNoise*random.Normal();
+            }
+
+            Core::RotationVectorToQuaternion(error, delta);
+            Core::MultiplyQuaternions(delta, quaternion, &measured[t*4]);
+        }
+
+        filtered  = raw;
+        rotations = measured;
+
+        timer.CatchUp();
+
+        for(int t=0; t<Tracks; t++)
+            stage.FilterMarker(t, time, &filtered[t*3], (float) noise);
+
+        markerSeconds += timer.Elapsed();
+
+        timer.CatchUp();
+
+        for(int t=0; t<Tracks; t++)
+        {
+            double position[3] = { raw[t*3], raw[t*3+1], raw[t*3+2] };
+
+            stage.UpdateRigidBody(bodies[t], time, position, &rotations[t*4], noise*noise, angleNoise*angleNoise);
+        }
+
+        bodySeconds += timer.Elapsed();
+
+        //== accuracy once the filters had time to converge ==--
+
+        if(f>=Frames/2)
+        {
+            for(int t=0; t<Tracks; t++)
+            {
+                for(int k=0; k<3; k++)
+                {
+                    rawError      += (raw[t*3+k] - truth[k])*(raw[t*3+k] - truth[k]);
+                    filteredError += (filtered[t*3+k] - truth[k])*(filtered[t*3+k] - truth[k]);
+                }
+
+                double rawOff      = Core::QuaternionAngle(&measured[t*4], quaternion);
+                double filteredOff = Core::QuaternionAngle(&rotations[t*4], quaternion);
+
+                rawAngle      += rawOff*rawOff;
+                filteredAngle += filteredOff*filteredOff;
+            }
+        }
+    }
+
+    const double degrees = 180.0/3.14159265358979;
+
+    double updates = (double) Tracks*Frames;
+    double samples = (double) Tracks*(Frames - Frames/2);
+
+    Result.Tracks                  = Tracks;
+    Result.NanosecondsPerMarker    = 1e9*markerSeconds/updates;
+    Result.NanosecondsPerRigidBody = 1e9*bodySeconds/updates;
+    Result.MarkerTracksAtRate      = (markerSeconds>0) ? updates/(markerSeconds*Rate) : 0.0;
+    Result.RigidBodyTracksAtRate   = (bodySeconds>0) ? updates/(bodySeconds*Rate) : 0.0;
+    Result.PositionErrorRaw        = sqrt(rawError/(3*samples));
+    Result.PositionErrorFiltered   = sqrt(filteredError/(3*samples));
+    Result.RotationErrorRaw        = degrees*sqrt(rawAngle/samples);
+    Result.RotationErrorFiltered   = degrees*sqrt(filteredAngle/samples);
+}
@@ -0,0 +1,116 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Optional Kalman filtering stage for rigid bodies and individual markers, an alternative to
+//== fixed smoothing factors.  Every track is a constant velocity filter (Core/KalmanFilter.h) with
+//== fixed-size matrices, so filtering never allocates; rigid bodies add a constant angular
+//== velocity filter for their orientation.
+//==
+//== Measurement noise follows the solver's own error estimates each frame: a marker's residual,
+//== a rigid body's ErrorPerMarker spread over its tracked markers weighted by MarkerQuality.  A
+//== clean solve is followed closely, a poor one is mostly predicted through.
+//==
+//== Rigid bodies are matched to tracks by ID.  Markers have no usable ID in Core::cMarker, the
+//== caller addresses marker tracks by index and passes position and residual directly.
+//==
+
+#ifndef __CAMERALIBRARY__KALMANFILTERSTAGE_H__
+#define __CAMERALIBRARY__KALMANFILTERSTAGE_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <vector>
+#include "Core/KalmanFilter.h"
+#include "Core/Platform.h"
+#include "Core/UID.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace Core
+{
+    class cRigidBody;
+}
+
+namespace CameraLibrary
+{
+    class cKalmanFilterStage
+    {
+    public:
+        struct sSettings
+        {
+            double  PositionProcessNoise;       //== Acceleration density, m^2/s^3 =============----
+            double  RotationProcessNoise;       //== Angular acceleration density, rad^2/s^3 ===----
+            double  MinimumError;               //== Floor for residuals, meters ===============----
+            double  MarkerRadius;               //== Turns rigid body error into rotation error -
+            double  MaxGap;                     //== Seconds a track may coast before restarting
+        };
+
+        cKalmanFilterStage();
+
+        void    SetSettings(const sSettings &Settings)      { mSettings = Settings; }
+        const sSettings & Settings() const                  { return mSettings; }
+
+        void    Reset();
+
+        //== Rigid bodies, filtered in place.  Untracked bodies are left alone, their tracks
+        //== coast until MaxGap and then restart.  Fills the same vector cRigidBodyBundle::
+        //== SetRigidBodies() takes.
+
+#if !defined(__PLATFORM__LINUX__)
+        void    Filter(std::vector<Core::cRigidBody> &RigidBodies, double TimeStamp);
+#endif
+
+        //== Markers, by caller assigned track index ==--
+
+        void    SetMarkerTrackCount(int Count);
+        int     MarkerTrackCount() const            { return (int) mMarkerTracks.size(); }
+        void    ResetMarkerTrack(int Track);
+
+        void    FilterMarker(int Track, double TimeStamp, float Position[3], float Residual);
+
+        //== Cost of one marker update and one rigid body (position + orientation) update at
+        //== Rate Hz with noisy synthetic motion, and how many tracks of each fit in one core.
+
+        struct sBenchmark
+        {
+            int     Tracks;
+            double  NanosecondsPerMarker;
+            double  NanosecondsPerRigidBody;
+            double  MarkerTracksAtRate;         //== Per core, at Rate Hz ======================----
+            double  RigidBodyTracksAtRate;
+            double  PositionErrorRaw;           //== RMS over all marker tracks, unfiltered ====----
+            double  PositionErrorFiltered;      //== RMS after filtering =======================----
+            double  RotationErrorRaw;           //== Degrees RMS over all rigid bodies =========----
+            double  RotationErrorFiltered;
+        };
+
+        static void Benchmark(int Tracks, int Frames, double Rate, sBenchmark &Result);
+
+    private:
+        struct sMarkerTrack
+        {
+            Core::cConstantVelocityKalman<3> Position;
+            double  LastTime;
+        };
+
+        struct sRigidBodyTrack
+        {
+            Core::cUID                       ID;
+            Core::cConstantVelocityKalman<3> Position;
+            Core::cOrientationKalman         Rotation;
+            double  LastTime;
+        };
+
+        bool    Advance(double &LastTime, double TimeStamp, double &Interval) const;
+        void    UpdateRigidBody(sRigidBodyTrack &Track, double TimeStamp, double Position[3], double Quaternion[4],
+                                double PositionVariance, double RotationVariance) const;
+
+        sSettings                       mSettings;
+        std::vector<sMarkerTrack>       mMarkerTracks;
+        std::vector<sRigidBodyTrack>    mRigidBodyTracks;
+    };
+}
+
+#endif
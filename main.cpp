@@ -11,8 +11,15 @@
 #include "modulevector.h"
 #include "modulevectorprocessing.h"
 #include "coremath.h"
+#include "framerasterizer.h"
+#include "vectorrenderer.h"
+#include "posepublisher.h"
+#include "posestreamer.h"
 
 #include <gl/glu.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 using namespace CameraLibrary; 
 
@@ -24,6 +31,35 @@ int main(int argc, char* argv[])
 
     CameraLibrary_EnableDevelopment();
 
+    //== "-publish name" shares every tracked pose with other processes (see posereader.h),
+    //== "-stream address [port]" sends it over UDP, repeat for several destinations.  The
+    //== window-less run lives in consolemain.cpp.
+
+    const char *publishName = 0;
+
+    cPoseStreamer streamer;
+
+    for(int arg=1; arg<argc; arg++)
+    {
+        if(strcmp(argv[arg], "-publish")==0 && arg+1<argc)
+        {
+            publishName = argv[++arg];
+        }
+        else if(strcmp(argv[arg], "-stream")==0 && arg+1<argc)
+        {
+            const char *address = argv[++arg];
+            int         port    = kPoseStreamDefaultPort;
+
+            if(arg+1<argc && argv[arg+1][0]!='-')
+                port = atoi(argv[++arg]);
+
+            if((streamer.IsOpen() || streamer.Open()) && streamer.AddDestination(address, port))
+                continue;
+
+            printf("Unable to stream poses to %s:%d\n", address, port);
+        }
+    }
+
 	//== Initialize Camera SDK ==--
 
 	CameraLibrary::CameraManager::X();
@@ -71,6 +107,14 @@ int main(int argc, char* argv[])
     Bitmap * framebuffer = new Bitmap(cameraWidth, cameraHeight, Texture.PixelSpan()*4,
                                Bitmap::ThirtyTwoBit, Texture.GetBuffer());
 
+    cFrameRasterizer rasterizer;
+
+    cVectorRenderer lines;
+    cPosePublisher  publisher;
+
+    if(publishName && !publisher.Open(publishName))
+        printf("Unable to publish poses as '%s', another publisher may own it\n", publishName);
+
     //== Set Video Mode ==--
 
     //== We set the camera to Segment Mode here.  This mode is support by all of our products.
@@ -154,10 +198,11 @@ int main(int argc, char* argv[])
             //== Ok, we've received a new frame, lets do something
             //== with it.
 
-            //== Lets have the Camera Library raster the camera's
-            //== image into our texture.
+            //== Lets raster the camera's image into our texture.
+            //== Grayscale video is converted on all cores, other
+            //== frames are handed to the Camera Library.
 
-            frame->Rasterize(framebuffer);
+            rasterizer.Rasterize(frame, framebuffer);
 
             vec->BeginFrame();
 
@@ -174,7 +219,18 @@ int main(int argc, char* argv[])
             }
             vec->Calculate();
             vecprocessor->PushData(vec);
-            
+
+            //== Hand the pose to out-of-process consumers ==--
+
+            if(publisher.IsOpen())
+                publisher.Publish(vecprocessor, frame->FrameID(), frame->TimeStamp());
+
+            if(streamer.IsOpen())
+                streamer.Submit(vecprocessor, frame->FrameID(), frame->TimeStamp());
+
+            //== Fetch all marker positions at once (scaled for display) ==--
+
+            lines.Update(vecprocessor);
 
             StartScene();
 
@@ -186,28 +242,10 @@ int main(int argc, char* argv[])
             glVertex3f(0,0,10);glVertex3f( 0, 0,-10);
             glEnd();
 
-            if(vecprocessor->MarkerCount()>0)
-            {
-                glColor3f(0,1,1);
-                glBegin(GL_LINES);
-                
-                for(int i=0; i<vecprocessor->MarkerCount(); i++)
-                    for(int j=0; j<vecprocessor->MarkerCount(); j++)
-                    {
-                        if(i!=j)
-                        {
-                            float x,y,z;
-                            vecprocessor->GetResult(i,x,y,z);
-                            glVertex3f(x/200,y/200,z/200);
-                            vecprocessor->GetResult(j,x,y,z);
-                            glVertex3f(x/200,y/200,z/200);
-
-                        }
-                    }
-
-                glEnd();
+            //== Lines between every pair of markers, one draw call ==--
 
-            }
+            glColor3f(0,1,1);
+            lines.Draw();
 
             //== Display Camera Image ============--
 
@@ -0,0 +1,201 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "mappedreader.h"
+
+#include "Core/UID.h"
+
+using namespace CameraLibrary;
+
+cMappedReader::cMappedReader()
+    : mData(0)
+    , mSize(0)
+    , mPosition(0)
+    , mMapped(false)
+    , mFileHandle(0)
+    , mMappingHandle(0)
+{
+}
+
+cMappedReader::~cMappedReader()
+{
+    Close();
+}
+
+//== Open / Close ======================================================================================----
+
+bool cMappedReader::Open(const char *Filename)
+{
+    Close();
+
+#ifdef WIN32
+    HANDLE file = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 0);
+
+    if(file==INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+
+    if(!GetFileSizeEx(file, &size) || size.QuadPart==0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+
+    if(mapping==0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if(view==0)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    mFileHandle    = file;
+    mMappingHandle = mapping;
+    mData          = (const unsigned char*) view;
+    mSize          = (unsigned long long) size.QuadPart;
+#else
+    int file = open(Filename, O_RDONLY);
+
+    if(file<0)
+        return false;
+
+    struct stat info;
+
+    if(fstat(file, &info)!=0 || info.st_size==0)
+    {
+        close(file);
+        return false;
+    }
+
+    void *view = mmap(0, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+    //== the mapping holds its own reference to the file ==--
+
+    close(file);
+
+    if(view==MAP_FAILED)
+        return false;
+
+    madvise(view, (size_t) info.st_size, MADV_SEQUENTIAL);
+
+    mData = (const unsigned char*) view;
+    mSize = (unsigned long long) info.st_size;
+#endif
+
+    mPosition = 0;
+    mMapped   = true;
+
+    return true;
+}
+
+void cMappedReader::Attach(const unsigned char *Data, unsigned long long Size)
+{
+    Close();
+
+    mData     = Data;
+    mSize     = (Data ? Size : 0);
+    mPosition = 0;
+    mMapped   = false;
+}
+
+void cMappedReader::Close()
+{
+    if(mMapped)
+    {
+#ifdef WIN32
+        UnmapViewOfFile(mData);
+        CloseHandle((HANDLE) mMappingHandle);
+        CloseHandle((HANDLE) mFileHandle);
+#else
+        munmap((void*) mData, (size_t) mSize);
+#endif
+    }
+
+    mData          = 0;
+    mSize          = 0;
+    mPosition      = 0;
+    mMapped        = false;
+    mFileHandle    = 0;
+    mMappingHandle = 0;
+}
+
+//== Core::cIReader ====================================================================================----
+
+unsigned int cMappedReader::ReadData(unsigned char *buffer, unsigned int bufferSize)
+{
+    unsigned long long remaining = mSize-mPosition;
+    unsigned int       count     = (remaining<bufferSize) ? (unsigned int) remaining : bufferSize;
+
+    memcpy(buffer, mData + mPosition, count);
+    mPosition += count;
+
+    return count;
+}
+
+std::string cMappedReader::ReadString()
+{
+    int length = Read<int>();
+
+    const unsigned char *span = (length>0) ? Span((unsigned long long) length) : 0;
+
+    if(span==0)
+        return std::string();
+
+    return std::string((const char*) span, length);
+}
+
+std::wstring cMappedReader::ReadWString()
+{
+    int length = Read<int>();
+
+    const unsigned char *span = (length>0) ? Span((unsigned long long) length*sizeof(wchar_t)) : 0;
+
+    if(span==0)
+        return std::wstring();
+
+    //== the span is not necessarily wchar_t aligned ==--
+
+    std::wstring result(length, L'\0');
+    memcpy(&result[0], span, length*sizeof(wchar_t));
+
+    return result;
+}
+
+Core::cUID cMappedReader::ReadUID()
+{
+    unsigned long long high = Read<unsigned long long>();
+    unsigned long long low  = Read<unsigned long long>();
+
+    return Core::cUID(high, low);
+}
+
+bool cMappedReader::Seek(unsigned long long pos)
+{
+    if(pos>mSize)
+        return false;
+
+    mPosition = pos;
+
+    return true;
+}
@@ -0,0 +1,119 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Zero-copy reader.  Presents a memory-mapped file, or any caller owned buffer (e.g. shared
+//== memory), as a Core::cIReader without staging it through an intermediate copy.
+//==
+//== Besides the cIReader interface the reader offers a non-virtual fast path for code that knows
+//== it is talking to a cMappedReader:
+//==
+//==   Read<T>()        Reads a POD straight out of the mapping, inlined, no virtual dispatch.
+//==   Span(Size)       Returns a pointer into the mapping for bulk fields and advances past it.
+//==                    The pointer stays valid until the reader is closed.
+//==
+//== Overruns never read past the mapping; they position the reader at the end, return zeroed
+//== values / null spans and IsEOF() becomes true.
+//==
+
+#ifndef __CAMERALIBRARY__MAPPEDREADER_H__
+#define __CAMERALIBRARY__MAPPEDREADER_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <string.h>
+#include <string>
+#include "cameralibraryglobals.h"
+
+#include "Core/IReader.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cMappedReader : public Core::cIReader
+    {
+    public:
+        cMappedReader();
+        virtual ~cMappedReader();
+
+        bool            Open  (const char *Filename);     //== Map an entire file read-only ====----
+        void            Attach(const unsigned char *Data, unsigned long long Size);  //== Caller owned
+        void            Close ();
+
+        bool            IsOpen() const      { return mData!=0; }
+
+        const unsigned char * Data() const  { return mData; }
+        unsigned long long    Remaining() const { return mSize-mPosition; }
+
+        //== Fast path ==--
+
+        template <typename T> inline T Read()
+        {
+            T value;
+
+            if(mSize-mPosition<sizeof(T))
+            {
+                mPosition = mSize;
+                memset(&value, 0, sizeof(T));
+                return value;
+            }
+
+            memcpy(&value, mData + mPosition, sizeof(T));   //== unaligned safe, compiles to a load
+            mPosition += sizeof(T);
+
+            return value;
+        }
+
+        inline const unsigned char * Span(unsigned long long Size)
+        {
+            if(mSize-mPosition<Size)
+            {
+                mPosition = mSize;
+                return 0;
+            }
+
+            const unsigned char *span = mData + mPosition;
+            mPosition += Size;
+
+            return span;
+        }
+
+        //== Core::cIReader ==--
+
+        virtual unsigned int ReadData( unsigned char *buffer, unsigned int bufferSize );
+
+        virtual int     ReadInt()           { return Read<int>();       }
+        virtual long long ReadLongLong()    { return Read<long long>(); }
+        virtual long    ReadLong ()         { return Read<long>();      }
+        virtual short   ReadShort()         { return Read<short>();     }
+
+        virtual double  ReadDouble()        { return Read<double>();    }
+        virtual float   ReadFloat()         { return Read<float>();     }
+        virtual bool    ReadBool()          { return Read<unsigned char>()!=0; }
+        virtual bool    IsEOF() const       { return mPosition>=mSize;  }
+
+        virtual std::string  ReadString();
+        virtual std::wstring ReadWString();
+
+        virtual Core::cUID ReadUID();
+
+        virtual unsigned char ReadByte()    { return Read<unsigned char>(); }
+
+        virtual unsigned long long Tell() const { return mPosition; }
+        virtual bool    Seek( unsigned long long pos );
+        virtual unsigned long long Size() const { return mSize; }
+
+    private:
+        const unsigned char * mData;
+        unsigned long long    mSize;
+        unsigned long long    mPosition;
+
+        bool                  mMapped;              //== Mapping owned by the reader ========----
+        void *                mFileHandle;          //== Windows file & mapping handles =====----
+        void *                mMappingHandle;
+    };
+}
+
+#endif
@@ -0,0 +1,405 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <math.h>
+#include <algorithm>
+
+#include "markerlinker2d.h"
+#include "benchmarknoise.h"
+#include "frame.h"
+#include "object.h"
+#include "Core/Timer.h"
+
+using namespace CameraLibrary;
+using namespace Core;
+
+namespace
+{
+    //== Beyond this many cells a track's gate covers, scanning every bucket is cheaper ==--
+
+    const int kMaxGateCells = 64;
+}
+
+cMarkerLinker2D::cMarkerLinker2D()
+    : mNextLabel(1)
+    , mCellSize(1.0f)
+    , mCellMask(0)
+{
+    mSettings.SearchRadius   = 8.0f;
+    mSettings.CoastGrowth    = 2.0f;
+    mSettings.VelocityBlend  = 0.5f;
+    mSettings.MaxCoastFrames = 3;
+    mSettings.MaxClusterSize = 64;
+
+    mStatistics.Candidates     = 0;
+    mStatistics.DirectMatches  = 0;
+    mStatistics.Clusters       = 0;
+    mStatistics.GreedyClusters = 0;
+    mStatistics.LargestCluster = 0;
+    mStatistics.ClusterObjects = 0;
+}
+
+void cMarkerLinker2D::Reset()
+{
+    mTracks.clear();
+    mLabels.clear();
+    mNextLabel = 1;
+}
+
+void cMarkerLinker2D::Update(CameraLibrary::Frame *Frame)
+{
+    int count = Frame->ObjectCount();
+
+    mObjectX.resize(count);
+    mObjectY.resize(count);
+    mLabels.resize(count);
+
+    for(int i=0; i<count; i++)
+    {
+        CameraLibrary::cObject *object = Frame->Object(i);
+
+        mObjectX[i] = object->X();
+        mObjectY[i] = object->Y();
+    }
+
+    if(count>0)
+        Update(&mObjectX[0], &mObjectY[0], count, &mLabels[0]);
+    else
+        Update(0, 0, 0, 0);
+}
+
+void cMarkerLinker2D::Update(const float *X, const float *Y, int Count, int *Labels)
+{
+    int trackCount = (int) mTracks.size();
+
+    //== predict, coasting tracks extrapolate over the frames they missed ==--
+
+    for(int t=0; t<trackCount; t++)
+    {
+        sTrack &track = mTracks[t];
+
+        float steps = (float) (track.Missed + 1);
+
+        track.PredictedX = track.X + steps*track.VX;
+        track.PredictedY = track.Y + steps*track.VY;
+        track.Gate       = mSettings.SearchRadius + mSettings.CoastGrowth*track.Missed;
+    }
+
+    mCandidates.clear();
+
+    if(Count>0 && trackCount>0)
+    {
+        BuildGrid(X, Y, Count);
+        Gather(X, Y, Count);
+    }
+
+    mAssignment.SetMaxClusterSize(mSettings.MaxClusterSize);
+    mAssignment.Solve(trackCount, Count, mCandidates, mTrackMatch, mObjectMatch);
+
+    const cClusterAssignment::sStatistics &assignment = mAssignment.Statistics();
+
+    mStatistics.Candidates     = (int) mCandidates.size();
+    mStatistics.DirectMatches  = assignment.DirectMatches;
+    mStatistics.Clusters       = assignment.Clusters;
+    mStatistics.GreedyClusters = assignment.GreedyClusters;
+    mStatistics.LargestCluster = assignment.LargestCluster;
+    mStatistics.ClusterObjects = assignment.ClusterColumns;
+
+    Commit(X, Y, Count, Labels);
+}
+
+int cMarkerLinker2D::Cell(int CellX, int CellY) const
+{
+    return (int) (((unsigned int) CellX*73856093u ^ (unsigned int) CellY*19349663u) & (unsigned int) mCellMask);
+}
+
+void cMarkerLinker2D::BuildGrid(const float *X, const float *Y, int Count)
+{
+    //== one cell per gate, about two buckets per object so chains stay short ==--
+
+    mCellSize = std::max(mSettings.SearchRadius, 1.0f);
+
+    int buckets = 16;
+
+    while(buckets<2*Count)
+        buckets <<= 1;
+
+    mCellMask = buckets - 1;
+
+    mCellStart.assign(buckets + 1, 0);
+    mObjectCell.resize(Count);
+    mCellObjects.resize(Count);
+
+    float scale = 1.0f/mCellSize;
+
+    for(int i=0; i<Count; i++)
+    {
+        int cell = Cell((int) floorf(X[i]*scale), (int) floorf(Y[i]*scale));
+
+        mObjectCell[i] = cell;
+        mCellStart[cell + 1]++;
+    }
+
+    for(int b=0; b<buckets; b++)
+        mCellStart[b + 1] += mCellStart[b];
+
+    //== counting sort, mObjectStamp doubles as the fill cursor ==--
+
+    mObjectStamp.assign(mCellStart.begin(), mCellStart.end() - 1);
+
+    for(int i=0; i<Count; i++)
+        mCellObjects[mObjectStamp[mObjectCell[i]]++] = i;
+}
+
+void cMarkerLinker2D::Gather(const float *X, const float *Y, int Count)
+{
+    int   trackCount = (int) mTracks.size();
+    float scale      = 1.0f/mCellSize;
+
+    mObjectStamp.assign(Count, -1);
+
+    for(int t=0; t<trackCount; t++)
+    {
+        const sTrack &track = mTracks[t];
+
+        float gate = track.Gate;
+
+        int left   = (int) floorf((track.PredictedX - gate)*scale);
+        int right  = (int) floorf((track.PredictedX + gate)*scale);
+        int top    = (int) floorf((track.PredictedY - gate)*scale);
+        int bottom = (int) floorf((track.PredictedY + gate)*scale);
+
+        if((right - left + 1)*(bottom - top + 1)>kMaxGateCells)
+        {
+            for(int o=0; o<Count; o++)
+                Consider(t, o, X, Y);
+
+            continue;
+        }
+
+        for(int cy=top; cy<=bottom; cy++)
+        {
+            for(int cx=left; cx<=right; cx++)
+            {
+                int cell = Cell(cx, cy);
+
+                for(int s=mCellStart[cell]; s<mCellStart[cell + 1]; s++)
+                {
+                    int o = mCellObjects[s];
+
+                    //== hashed cells can share a bucket, see each object once per track ==--
+
+                    if(mObjectStamp[o]==t)
+                        continue;
+
+                    mObjectStamp[o] = t;
+
+                    Consider(t, o, X, Y);
+                }
+            }
+        }
+    }
+}
+
+void cMarkerLinker2D::Consider(int Track, int Object, const float *X, const float *Y)
+{
+    const sTrack &track = mTracks[Track];
+
+    float dx = X[Object] - track.PredictedX;
+    float dy = Y[Object] - track.PredictedY;
+    float d2 = dx*dx + dy*dy;
+
+    if(d2<=track.Gate*track.Gate)
+    {
+        cClusterAssignment::sCandidate candidate;
+
+        candidate.Row    = Track;
+        candidate.Column = Object;
+        candidate.Cost   = d2/(track.Gate*track.Gate);
+
+        mCandidates.push_back(candidate);
+    }
+}
+
+void cMarkerLinker2D::Commit(const float *X, const float *Y, int Count, int *Labels)
+{
+    int trackCount = (int) mTracks.size();
+    int alive      = 0;
+
+    //== update matched tracks, age unmatched ones, compact in place ==--
+
+    for(int t=0; t<trackCount; t++)
+    {
+        sTrack track = mTracks[t];
+        int    o     = mTrackMatch[t];
+
+        if(o>=0)
+        {
+            float steps = (float) (track.Missed + 1);
+            float vx    = (X[o] - track.X)/steps;
+            float vy    = (Y[o] - track.Y)/steps;
+
+            if(track.Hits<2)
+            {
+                track.VX = vx;
+                track.VY = vy;
+            }
+            else
+            {
+                track.VX += mSettings.VelocityBlend*(vx - track.VX);
+                track.VY += mSettings.VelocityBlend*(vy - track.VY);
+            }
+
+            track.X      = X[o];
+            track.Y      = Y[o];
+            track.Missed = 0;
+            track.Hits++;
+
+            Labels[o] = track.Label;
+        }
+        else if(++track.Missed>mSettings.MaxCoastFrames)
+        {
+            continue;
+        }
+
+        mTracks[alive++] = track;
+    }
+
+    mTracks.resize(alive);
+
+    //== everything left over starts a track ==--
+
+    for(int o=0; o<Count; o++)
+    {
+        if(mObjectMatch[o]>=0)
+            continue;
+
+        sTrack track;
+
+        track.X          = X[o];
+        track.Y          = Y[o];
+        track.VX         = 0;
+        track.VY         = 0;
+        track.PredictedX = X[o];
+        track.PredictedY = Y[o];
+        track.Gate       = mSettings.SearchRadius;
+        track.Label      = mNextLabel++;
+        track.Missed     = 0;
+        track.Hits       = 1;
+
+        mTracks.push_back(track);
+
+        Labels[o] = track.Label;
+    }
+}
+
+void cMarkerLinker2D::Benchmark(int Objects, int Frames, float Speed, sBenchmark &Result)
+{
+    const float kWidth     = 1280.0f;
+    const float kHeight    = 1024.0f;
+    const float kNoise     = 0.15f;         //== Centroid jitter, pixels =============================----
+    const float kTurn      = 0.5f;          //== Velocity change per frame, pixels ===================----
+    const float kDropout   = 0.02f;         //== Chance an object is missing from a frame ===========----
+
+    cMarkerLinker2D  linker;
+    sSettings        settings = linker.Settings();
+
+    //== a new track has no velocity yet, its first gate has to cover a full step ==--
+
+    settings.SearchRadius = std::max(settings.SearchRadius, 1.5f*Speed + 2.0f);
+    linker.SetSettings(settings);
+
+    cBenchmarkNoise random(2463534242u);
+
+    std::vector<float> px(Objects), py(Objects), vx(Objects), vy(Objects);
+
+    for(int i=0; i<Objects; i++)
+    {
+        px[i] = random.Uniform()*kWidth;
+        py[i] = random.Uniform()*kHeight;
+        vx[i] = random.Signed()*Speed;
+        vy[i] = random.Signed()*Speed;
+    }
+
+    std::vector<float> x, y;
+    std::vector<int>   truth, labels;
+    std::vector<int>   labelTruth;
+
+    Core::cTimer timer;
+
+    double seconds       = 0;
+    long   continuations = 0;
+    long   wrong         = 0;
+    long   objects       = 0;
+    long   conflicted    = 0;
+
+    for(int f=0; f<Frames; f++)
+    {
+        x.clear();
+        y.clear();
+        truth.clear();
+
+        //== move, bounce off the image edges, and report in a rotating order ==--
+
+        int start = (int) (random.Next()%(unsigned int) Objects);
+
+        for(int k=0; k<Objects; k++)
+        {
+            int i = (start + k)%Objects;
+
+            vx[i] = std::max(-Speed, std::min(Speed, vx[i] + kTurn*random.Signed()));
+            vy[i] = std::max(-Speed, std::min(Speed, vy[i] + kTurn*random.Signed()));
+
+            px[i] += vx[i];
+            py[i] += vy[i];
+
+            if(px[i]<0 || px[i]>=kWidth)  { vx[i] = -vx[i]; px[i] += 2*vx[i]; }
+            if(py[i]<0 || py[i]>=kHeight) { vy[i] = -vy[i]; py[i] += 2*vy[i]; }
+
+            if(random.Uniform()<kDropout)
+                continue;
+
+            x.push_back(px[i] + kNoise*random.Signed());
+            y.push_back(py[i] + kNoise*random.Signed());
+            truth.push_back(i);
+        }
+
+        int count = (int) x.size();
+
+        labels.resize(count);
+
+        timer.CatchUp();
+        linker.Update(count ? &x[0] : 0, count ? &y[0] : 0, count, count ? &labels[0] : 0);
+        seconds += timer.Elapsed();
+
+        const sStatistics &statistics = linker.Statistics();
+
+        conflicted += statistics.ClusterObjects;
+        objects    += count;
+
+        for(int o=0; o<count; o++)
+        {
+            int label = labels[o];
+
+            if(label>=(int) labelTruth.size())
+                labelTruth.resize(label + 1, -1);
+
+            if(labelTruth[label]>=0)
+            {
+                continuations++;
+
+                if(labelTruth[label]!=truth[o])
+                    wrong++;
+            }
+
+            labelTruth[label] = truth[o];
+        }
+    }
+
+    Result.Objects              = Objects;
+    Result.MicrosecondsPerFrame = (Frames>0) ? 1e6*seconds/Frames : 0.0;
+    Result.NanosecondsPerObject = (objects>0) ? 1e9*seconds/objects : 0.0;
+    Result.LabelErrorRate       = (continuations>0) ? (double) wrong/continuations : 0.0;
+    Result.ConflictFraction     = (objects>0) ? (double) conflicted/objects : 0.0;
+}
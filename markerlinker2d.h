@@ -0,0 +1,142 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Frame to frame 2D correspondence for a single camera's centroids.  Every track predicts its
+//== next position with a constant (pixels per frame) velocity, then the frame's objects are
+//== bucketed into a uniform grid hashed on cell coordinates so each track only visits the cells
+//== its gate overlaps.  Cost per frame is linear in objects plus candidate pairs.
+//==
+//== Candidate pairs are split into clusters of tracks and objects that compete for each other.
+//== A track with a single candidate that no other track wants is matched outright; only real
+//== conflicts go through an optimal (Hungarian) assignment, with the option of leaving a track or
+//== object unmatched (cClusterAssignment).  Clusters too big for the dense solve, a swarm of
+//== markers inside one gate, fall back to cheapest-pair-first greedy matching.
+//==
+//== Labels are positive, stable for as long as a track lives, and never reused.  Tracks coast on
+//== their prediction for up to MaxCoastFrames missed frames with a growing gate.
+//==
+
+#ifndef __CAMERALIBRARY__MARKERLINKER2D_H__
+#define __CAMERALIBRARY__MARKERLINKER2D_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <vector>
+#include "clusterassignment.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class Frame;
+
+    class cMarkerLinker2D
+    {
+    public:
+        struct sSettings
+        {
+            float   SearchRadius;               //== Gate around the prediction, pixels ========----
+            float   CoastGrowth;                //== Gate growth per missed frame, pixels ======----
+            float   VelocityBlend;              //== 0..1, weight of the newest displacement ===----
+            int     MaxCoastFrames;             //== Missed frames before a track is dropped ===----
+            int     MaxClusterSize;             //== Larger conflicts are matched greedily =====----
+        };
+
+        cMarkerLinker2D();
+
+        void    SetSettings(const sSettings &Settings)      { mSettings = Settings; }
+        const sSettings & Settings() const                  { return mSettings; }
+
+        void    Reset();
+
+        //== Match one frame.  Labels receives Count labels, one per object. ==--
+
+        void    Update(const float *X, const float *Y, int Count, int *Labels);
+
+        //== Match a camera frame's objects, results through Label() ==--
+
+        void    Update(Frame *Frame);
+        int     Label(int Object) const             { return mLabels[Object]; }
+        int     LabelCount() const                  { return (int) mLabels.size(); }
+
+        int     TrackCount() const                  { return (int) mTracks.size(); }
+
+        //== Per frame work of the last Update() ==--
+
+        struct sStatistics
+        {
+            int     Candidates;                 //== Gated track/object pairs ==================----
+            int     DirectMatches;              //== Matched without an assignment solve =======----
+            int     Clusters;                   //== Conflicts solved optimally ================----
+            int     GreedyClusters;             //== Conflicts above MaxClusterSize ============----
+            int     LargestCluster;             //== Tracks + objects ==========================----
+            int     ClusterObjects;             //== Objects decided inside clusters ===========----
+        };
+
+        const sStatistics & Statistics() const      { return mStatistics; }
+
+        //== Objects moving at up to Speed pixels per frame with centroid noise and dropouts;
+        //== reports cost per frame and how often a label is carried over to the wrong object.
+
+        struct sBenchmark
+        {
+            int     Objects;
+            double  MicrosecondsPerFrame;
+            double  NanosecondsPerObject;
+            double  LabelErrorRate;             //== Wrong continuations / continuations ======----
+            double  ConflictFraction;           //== Objects decided by an assignment solve ===----
+        };
+
+        static void Benchmark(int Objects, int Frames, float Speed, sBenchmark &Result);
+
+    private:
+        struct sTrack
+        {
+            float   X;                          //== Last position, pixels =====================----
+            float   Y;
+            float   VX;                         //== Pixels per frame ==========================----
+            float   VY;
+            float   PredictedX;
+            float   PredictedY;
+            float   Gate;
+            int     Label;
+            int     Missed;
+            int     Hits;                       //== Frames matched, velocity valid after 2 ====----
+        };
+
+        void    BuildGrid(const float *X, const float *Y, int Count);
+        void    Gather(const float *X, const float *Y, int Count);
+        void    Consider(int Track, int Object, const float *X, const float *Y);
+        void    Commit(const float *X, const float *Y, int Count, int *Labels);
+
+        int     Cell(int CellX, int CellY) const;
+
+        sSettings                   mSettings;
+        sStatistics                 mStatistics;
+        int                         mNextLabel;
+
+        std::vector<sTrack>         mTracks;
+        std::vector<int>            mLabels;
+        std::vector<float>          mObjectX;           //== Frame overload's centroids =====----
+        std::vector<float>          mObjectY;
+
+        //== Per frame scratch, kept to avoid reallocating ==--
+
+        float                       mCellSize;
+        int                         mCellMask;
+        std::vector<int>            mCellStart;         //== Hash bucket -> first slot ======----
+        std::vector<int>            mCellObjects;       //== Objects ordered by bucket =======----
+        std::vector<int>            mObjectCell;
+
+        std::vector<Core::cClusterAssignment::sCandidate> mCandidates;   //== Cost: distance^2/gate^2 ----
+        std::vector<int>            mObjectStamp;       //== Last track that saw the object =----
+        std::vector<int>            mTrackMatch;        //== Object per track, -1 none =======----
+        std::vector<int>            mObjectMatch;
+
+        Core::cClusterAssignment    mAssignment;
+    };
+}
+
+#endif
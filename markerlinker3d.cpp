@@ -0,0 +1,514 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <math.h>
+#include <algorithm>
+
+#include "markerlinker3d.h"
+#include "benchmarknoise.h"
+#include "Core/Timer.h"
+
+using namespace CameraLibrary;
+using namespace Core;
+
+namespace
+{
+    //== Voxels a gate may span before its track is checked against every marker instead ==--
+
+    const int kMaxGateVoxels = 7*7*7;
+}
+
+cMarkerLinker3D::cMarkerLinker3D()
+    : mNextID(1)
+    , mVoxelSize(1.0f)
+    , mVoxelMask(0)
+{
+    mSettings.SearchRadius   = 0.02f;
+    mSettings.CoastGrowth    = 0.002f;
+    mSettings.MaxGate        = 0.05f;
+    mSettings.VelocityBlend  = 0.5f;
+    mSettings.MaxCoastFrames = 30;
+    mSettings.MaxClusterSize = 64;
+    mSettings.EntityType     = cLabel::None;
+    mSettings.EntityID       = 0;
+
+    mStatistics.Candidates     = 0;
+    mStatistics.DirectMatches  = 0;
+    mStatistics.Clusters       = 0;
+    mStatistics.GreedyClusters = 0;
+    mStatistics.ClusterMarkers = 0;
+    mStatistics.Coasting       = 0;
+}
+
+void cMarkerLinker3D::Reset()
+{
+    mTracks.clear();
+    mNextID = 1;
+}
+
+void cMarkerLinker3D::Update(const float *Positions, int Count, Core::cUID *Labels)
+{
+    mIDs.resize(Count);
+
+    Update(Positions, Count, Count>0 ? &mIDs[0] : 0);
+
+    for(int m=0; m<Count; m++)
+    {
+        sTrack &track = mTracks[mMarkerTrack[m]];
+
+        if(!track.UID.Valid())
+            track.UID = cLabel::EncodeUID(mSettings.EntityType, mSettings.EntityID, (unsigned int) track.ID);
+
+        Labels[m] = track.UID;
+    }
+}
+
+void cMarkerLinker3D::Update(const float *Positions, int Count, int *IDs)
+{
+    int trackCount = (int) mTracks.size();
+
+    Predict();
+
+    mCandidates.clear();
+
+    if(Count>0 && trackCount>0)
+    {
+        BuildHash();
+        Gather(Positions, Count);
+    }
+
+    mAssignment.SetMaxClusterSize(mSettings.MaxClusterSize);
+    mAssignment.Solve(trackCount, Count, mCandidates, mTrackMatch, mMarkerMatch);
+
+    const cClusterAssignment::sStatistics &assignment = mAssignment.Statistics();
+
+    mStatistics.Candidates     = (int) mCandidates.size();
+    mStatistics.DirectMatches  = assignment.DirectMatches;
+    mStatistics.Clusters       = assignment.Clusters;
+    mStatistics.GreedyClusters = assignment.GreedyClusters;
+    mStatistics.ClusterMarkers = assignment.ClusterColumns;
+
+    Commit(Positions, Count, IDs);
+}
+
+void cMarkerLinker3D::Predict()
+{
+    //== coasting tracks extrapolate over the frames they missed ==--
+
+    for(int t=0; t<(int) mTracks.size(); t++)
+    {
+        sTrack &track = mTracks[t];
+
+        float steps = (float) (track.Missed + 1);
+
+        for(int k=0; k<3; k++)
+            track.Predicted[k] = track.Position[k] + steps*track.Velocity[k];
+
+        track.Gate = std::min(mSettings.SearchRadius + mSettings.CoastGrowth*track.Missed,
+                              std::max(mSettings.MaxGate, mSettings.SearchRadius));
+    }
+}
+
+unsigned int cMarkerLinker3D::Voxel(int X, int Y, int Z) const
+{
+    return (unsigned int) X*73856093u ^ (unsigned int) Y*19349663u ^ (unsigned int) Z*83492791u;
+}
+
+int cMarkerLinker3D::VoxelCoordinate(float Value) const
+{
+    return (int) floorf(Value/mVoxelSize);
+}
+
+void cMarkerLinker3D::BuildHash()
+{
+    //== voxels are two search radii wide and a marker looks at the 2x2x2 block on its side of
+    //== its own voxel, which holds every prediction within half a voxel of it.  A gate that
+    //== fits in half a voxel is entered once at its prediction; wider (coasting) gates go into
+    //== every voxel their box touches, which always includes the marker's own voxel.
+
+    mVoxelSize = std::max(2.0f*mSettings.SearchRadius, 1e-4f);
+
+    mEntries.clear();
+    mWideTracks.clear();
+
+    for(int t=0; t<(int) mTracks.size(); t++)
+    {
+        const sTrack &track = mTracks[t];
+
+        if(2.0f*track.Gate<=mVoxelSize)
+        {
+            mEntries.push_back(std::make_pair(Voxel(VoxelCoordinate(track.Predicted[0]),
+                                                    VoxelCoordinate(track.Predicted[1]),
+                                                    VoxelCoordinate(track.Predicted[2])), t));
+            continue;
+        }
+
+        int low[3], high[3];
+
+        for(int k=0; k<3; k++)
+        {
+            low[k]  = VoxelCoordinate(track.Predicted[k] - track.Gate);
+            high[k] = VoxelCoordinate(track.Predicted[k] + track.Gate);
+        }
+
+        if((high[0] - low[0] + 1)*(high[1] - low[1] + 1)*(high[2] - low[2] + 1)>kMaxGateVoxels)
+        {
+            mWideTracks.push_back(t);
+            continue;
+        }
+
+        for(int z=low[2]; z<=high[2]; z++)
+            for(int y=low[1]; y<=high[1]; y++)
+                for(int x=low[0]; x<=high[0]; x++)
+                    mEntries.push_back(std::make_pair(Voxel(x, y, z), t));
+    }
+
+    //== about two buckets per entry, counting sorted by bucket ==--
+
+    int entries = (int) mEntries.size();
+    int buckets = 16;
+
+    while(buckets<2*entries)
+        buckets <<= 1;
+
+    mVoxelMask = buckets - 1;
+
+    mVoxelStart.assign(buckets + 1, 0);
+    mVoxelEntries.resize(entries);
+
+    for(int e=0; e<entries; e++)
+    {
+        mEntries[e].first &= (unsigned int) mVoxelMask;
+        mVoxelStart[mEntries[e].first + 1]++;
+    }
+
+    for(int b=0; b<buckets; b++)
+        mVoxelStart[b + 1] += mVoxelStart[b];
+
+    //== fill advances every bucket's start to its end, shift back afterwards.  Entries carry a
+    //== copy of the prediction so the marker side never touches mTracks.
+
+    for(int e=0; e<entries; e++)
+    {
+        const sTrack &track = mTracks[mEntries[e].second];
+        sVoxelEntry  &entry = mVoxelEntries[mVoxelStart[mEntries[e].first]++];
+
+        entry.Predicted[0] = track.Predicted[0];
+        entry.Predicted[1] = track.Predicted[1];
+        entry.Predicted[2] = track.Predicted[2];
+        entry.Gate2        = track.Gate*track.Gate;
+        entry.Track        = mEntries[e].second;
+    }
+
+    for(int b=buckets; b>0; b--)
+        mVoxelStart[b] = mVoxelStart[b - 1];
+
+    mVoxelStart[0] = 0;
+}
+
+void cMarkerLinker3D::Gather(const float *Positions, int Count)
+{
+    mTrackStamp.assign(mTracks.size(), -1);
+
+    float scale = 1.0f/mVoxelSize;
+
+    for(int m=0; m<Count; m++)
+    {
+        const float *position = Positions + 3*m;
+
+        //== lower corner of the 2x2x2 block, on the side of the voxel the marker is in ==--
+
+        int low[3];
+
+        for(int k=0; k<3; k++)
+        {
+            float scaled = position[k]*scale;
+            float base   = floorf(scaled);
+
+            low[k] = (int) base - ((scaled - base<0.5f) ? 1 : 0);
+        }
+
+        for(int v=0; v<8; v++)
+        {
+            int bucket = (int) (Voxel(low[0] + (v&1), low[1] + ((v>>1)&1), low[2] + (v>>2))
+                                & (unsigned int) mVoxelMask);
+
+            for(int s=mVoxelStart[bucket]; s<mVoxelStart[bucket + 1]; s++)
+            {
+                const sVoxelEntry &entry = mVoxelEntries[s];
+
+                float dx = position[0] - entry.Predicted[0];
+                float dy = position[1] - entry.Predicted[1];
+                float dz = position[2] - entry.Predicted[2];
+                float d2 = dx*dx + dy*dy + dz*dz;
+
+                //== buckets are shared by hashed voxels and wide gates, pair each track once ==--
+
+                if(d2>entry.Gate2 || mTrackStamp[entry.Track]==m)
+                    continue;
+
+                mTrackStamp[entry.Track] = m;
+
+                AddCandidate(entry.Track, m, d2/entry.Gate2);
+            }
+        }
+
+        for(int w=0; w<(int) mWideTracks.size(); w++)
+        {
+            const sTrack &track = mTracks[mWideTracks[w]];
+
+            float dx = position[0] - track.Predicted[0];
+            float dy = position[1] - track.Predicted[1];
+            float dz = position[2] - track.Predicted[2];
+            float d2 = dx*dx + dy*dy + dz*dz;
+            float g2 = track.Gate*track.Gate;
+
+            if(d2<=g2)
+                AddCandidate(mWideTracks[w], m, d2/g2);
+        }
+    }
+}
+
+void cMarkerLinker3D::AddCandidate(int Track, int Marker, float Cost)
+{
+    cClusterAssignment::sCandidate candidate;
+
+    candidate.Row    = Track;
+    candidate.Column = Marker;
+    candidate.Cost   = Cost;
+
+    mCandidates.push_back(candidate);
+}
+
+void cMarkerLinker3D::Commit(const float *Positions, int Count, int *IDs)
+{
+    int trackCount = (int) mTracks.size();
+    int alive      = 0;
+
+    mMarkerTrack.resize(Count);
+    mStatistics.Coasting = 0;
+
+    //== update matched tracks, age unmatched ones, compact in place ==--
+
+    for(int t=0; t<trackCount; t++)
+    {
+        sTrack track = mTracks[t];
+        int    m     = mTrackMatch[t];
+
+        if(m>=0)
+        {
+            const float *position = Positions + 3*m;
+
+            float steps = (float) (track.Missed + 1);
+
+            for(int k=0; k<3; k++)
+            {
+                float velocity = (position[k] - track.Position[k])/steps;
+
+                if(track.Hits<2)
+                    track.Velocity[k] = velocity;
+                else
+                    track.Velocity[k] += mSettings.VelocityBlend*(velocity - track.Velocity[k]);
+
+                track.Position[k] = position[k];
+            }
+
+            track.Missed = 0;
+            track.Hits++;
+
+            IDs[m]           = track.ID;
+            mMarkerTrack[m]  = alive;
+        }
+        else if(++track.Missed>mSettings.MaxCoastFrames)
+        {
+            continue;
+        }
+        else
+        {
+            mStatistics.Coasting++;
+        }
+
+        mTracks[alive++] = track;
+    }
+
+    mTracks.resize(alive);
+
+    //== everything left over starts a track ==--
+
+    for(int m=0; m<Count; m++)
+    {
+        if(mMarkerMatch[m]>=0)
+            continue;
+
+        sTrack track;
+
+        for(int k=0; k<3; k++)
+        {
+            track.Position[k]  = Positions[3*m + k];
+            track.Velocity[k]  = 0;
+            track.Predicted[k] = Positions[3*m + k];
+        }
+
+        track.Gate   = mSettings.SearchRadius;
+        track.ID     = mNextID++;
+        track.Missed = 0;
+        track.Hits   = 1;
+
+        IDs[m]          = track.ID;
+        mMarkerTrack[m] = (int) mTracks.size();
+
+        mTracks.push_back(track);
+    }
+}
+
+void cMarkerLinker3D::Benchmark(int Markers, int Frames, float Speed, float Rate, sBenchmark &Result)
+{
+    const int   kGroupSize  = 10;
+    const float kVolume[3]  = { 8.0f, 2.5f, 8.0f };     //== Capture volume, meters ================----
+    const float kSpread     = 0.08f;                    //== Marker offsets within a group ========----
+    const float kNoise      = 0.0002f;                  //== Reconstruction noise, meters =========----
+    const float kOcclusion  = 0.005f;                   //== Chance per frame a marker drops out ===----
+
+    cMarkerLinker3D  linker;
+    sSettings        settings = linker.Settings();
+
+    //== a new track has no velocity yet, its first gate has to cover a full step ==--
+
+    float step = Speed/Rate;
+
+    settings.SearchRadius = std::max(settings.SearchRadius, 1.5f*step + 0.002f);
+    settings.MaxGate      = std::max(settings.MaxGate, 2.0f*settings.SearchRadius);
+    linker.SetSettings(settings);
+
+    cBenchmarkNoise random(88172645u);
+
+    int groups = (Markers + kGroupSize - 1)/kGroupSize;
+
+    std::vector<float> center(3*groups), velocity(3*groups), offset(3*Markers);
+    std::vector<int>   hidden(Markers, 0);          //== Frames of occlusion left ==============----
+    std::vector<int>   lastID(Markers, 0);
+    std::vector<char>  returning(Markers, 0);
+
+    for(int g=0; g<groups; g++)
+    {
+        for(int k=0; k<3; k++)
+        {
+            center[3*g + k]   = random.Uniform()*kVolume[k];
+            velocity[3*g + k] = random.Signed()*step;
+        }
+    }
+
+    for(int i=0; i<3*Markers; i++)
+        offset[i] = random.Signed()*kSpread;
+
+    std::vector<float> positions;
+    std::vector<int>   truth, ids, idTruth;
+
+    Core::cTimer timer;
+
+    double seconds       = 0;
+    long   continuations = 0;
+    long   wrong         = 0;
+    long   occlusions    = 0;
+    long   recovered     = 0;
+    long   linked        = 0;
+    long   conflicted    = 0;
+
+    for(int f=0; f<Frames; f++)
+    {
+        //== groups wander inside the volume, speed limited to Speed ==--
+
+        for(int g=0; g<groups; g++)
+        {
+            for(int k=0; k<3; k++)
+            {
+                float &v = velocity[3*g + k];
+                float &c = center[3*g + k];
+
+                v = std::max(-step, std::min(step, v + 0.05f*step*random.Signed()));
+                c += v;
+
+                if(c<0 || c>=kVolume[k])
+                {
+                    v = -v;
+                    c += 2*v;
+                }
+            }
+        }
+
+        positions.clear();
+        truth.clear();
+
+        for(int i=0; i<Markers; i++)
+        {
+            if(hidden[i]>0)
+            {
+                hidden[i]--;
+                continue;
+            }
+
+            if(f>0 && random.Uniform()<kOcclusion)
+            {
+                hidden[i]    = 1 + (int) (random.Next()%(unsigned int) settings.MaxCoastFrames);
+                returning[i] = 1;
+                continue;
+            }
+
+            int g = i/kGroupSize;
+
+            for(int k=0; k<3; k++)
+                positions.push_back(center[3*g + k] + offset[3*i + k] + kNoise*random.Signed());
+
+            truth.push_back(i);
+        }
+
+        int count = (int) truth.size();
+
+        ids.resize(count);
+
+        timer.CatchUp();
+        linker.Update(count ? &positions[0] : 0, count, count ? &ids[0] : 0);
+        seconds += timer.Elapsed();
+
+        linked     += count;
+        conflicted += linker.Statistics().ClusterMarkers;
+
+        for(int o=0; o<count; o++)
+        {
+            int id = ids[o];
+            int i  = truth[o];
+
+            if(id>=(int) idTruth.size())
+                idTruth.resize(id + 1, -1);
+
+            if(idTruth[id]>=0)
+            {
+                continuations++;
+
+                if(idTruth[id]!=i)
+                    wrong++;
+            }
+
+            if(returning[i])
+            {
+                occlusions++;
+
+                if(id==lastID[i])
+                    recovered++;
+
+                returning[i] = 0;
+            }
+
+            idTruth[id] = i;
+            lastID[i]   = id;
+        }
+    }
+
+    Result.Markers              = Markers;
+    Result.MicrosecondsPerFrame = (Frames>0) ? 1e6*seconds/Frames : 0.0;
+    Result.MarkersPerSecond     = (seconds>0) ? linked/seconds : 0.0;
+    Result.LabelErrorRate       = (continuations>0) ? (double) wrong/continuations : 0.0;
+    Result.OcclusionRecovery    = (occlusions>0) ? (double) recovered/occlusions : 0.0;
+    Result.ConflictFraction     = (linked>0) ? (double) conflicted/linked : 0.0;
+}
@@ -0,0 +1,150 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Links reconstructed 3D markers over time.  Every track predicts its next position with a
+//== constant (meters per frame) velocity and is entered in a voxel hash at that prediction; the
+//== frame's markers then only look at the 2x2x2 voxels nearest them.  A fresh track occupies one
+//== voxel, an occluded track's growing gate spans the few voxels it overlaps.  Gated pairs go
+//== through cClusterAssignment, so only markers that really compete pay for an optimal solve.
+//==
+//== Tracks coast through occlusions for up to MaxCoastFrames with a gate that widens by
+//== CoastGrowth per missed frame (capped at MaxGate) and pick up their old ID when the marker
+//== reappears near the extrapolated path.  IDs are positive and never reused.
+//==
+//== Core::cMarker has no public interface in this tree, so labels come back in input order as
+//== cLabel encoded cUIDs (entity type and ID from the settings, member = track ID) for the
+//== caller to stamp on its markers before handing them to cMarkerBundle::SetMarkers().  With
+//== the default cLabel::None they stay in the unlabeled partition, but keep a stable identity.
+//==
+
+#ifndef __CAMERALIBRARY__MARKERLINKER3D_H__
+#define __CAMERALIBRARY__MARKERLINKER3D_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <vector>
+#include "clusterassignment.h"
+#include "Core/Label.h"
+#include "Core/UID.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cMarkerLinker3D
+    {
+    public:
+        struct sSettings
+        {
+            float   SearchRadius;               //== Gate around the prediction, meters ========----
+            float   CoastGrowth;                //== Gate growth per missed frame, meters ======----
+            float   MaxGate;                    //== Upper bound for coasting gates, meters ====----
+            float   VelocityBlend;              //== 0..1, weight of the newest displacement ===----
+            int     MaxCoastFrames;             //== Missed frames before a track is dropped ===----
+            int     MaxClusterSize;             //== Larger conflicts are matched greedily =====----
+
+            Core::cLabel::eEntityType EntityType;   //== Encoding of the labels handed out =======----
+            unsigned int              EntityID;
+        };
+
+        cMarkerLinker3D();
+
+        void    SetSettings(const sSettings &Settings)      { mSettings = Settings; }
+        const sSettings & Settings() const                  { return mSettings; }
+
+        void    Reset();
+
+        //== Link one frame.  Positions are Count x,y,z triplets; IDs / Labels receive one entry
+        //== per marker.  Frames are assumed to arrive at a steady rate.
+
+        void    Update(const float *Positions, int Count, int *IDs);
+        void    Update(const float *Positions, int Count, Core::cUID *Labels);
+
+        int     TrackCount() const                  { return (int) mTracks.size(); }
+
+        struct sStatistics
+        {
+            int     Candidates;                 //== Gated track/marker pairs ==================----
+            int     DirectMatches;              //== Matched without an assignment solve =======----
+            int     Clusters;                   //== Conflicts solved optimally ================----
+            int     GreedyClusters;             //== Conflicts above MaxClusterSize ============----
+            int     ClusterMarkers;             //== Markers decided inside clusters ===========----
+            int     Coasting;                   //== Tracks currently occluded =================----
+        };
+
+        const sStatistics & Statistics() const      { return mStatistics; }
+
+        //== Markers in rigid groups of ten moving at up to Speed m/s, sampled at Rate Hz, with
+        //== measurement noise and random occlusions of up to MaxCoastFrames.  Reports linking
+        //== throughput, wrong continuations and how many occlusions resumed with the same ID.
+
+        struct sBenchmark
+        {
+            int     Markers;
+            double  MicrosecondsPerFrame;
+            double  MarkersPerSecond;           //== Linking throughput, one core ==============----
+            double  LabelErrorRate;             //== Wrong continuations / continuations ======----
+            double  OcclusionRecovery;          //== Occlusions resumed with the same ID =======----
+            double  ConflictFraction;           //== Markers decided by an assignment solve ====----
+        };
+
+        static void Benchmark(int Markers, int Frames, float Speed, float Rate, sBenchmark &Result);
+
+    private:
+        struct sTrack
+        {
+            float   Position[3];                //== Last measured, meters =====================----
+            float   Velocity[3];                //== Meters per frame ==========================----
+            float   Predicted[3];
+            float   Gate;
+            int     ID;
+            int     Missed;
+            int     Hits;                       //== Frames matched, velocity valid after 2 ====----
+            Core::cUID UID;                     //== Encoded on first use ======================----
+        };
+
+        struct sVoxelEntry
+        {
+            float   Predicted[3];
+            float   Gate2;
+            int     Track;
+        };
+
+        void    Predict();
+        void    BuildHash();
+        void    Gather(const float *Positions, int Count);
+        void    AddCandidate(int Track, int Marker, float Cost);
+        void    Commit(const float *Positions, int Count, int *IDs);
+
+        unsigned int Voxel(int X, int Y, int Z) const;      //== Unmasked hash =========----
+        int     VoxelCoordinate(float Value) const;
+
+        sSettings                   mSettings;
+        sStatistics                 mStatistics;
+        int                         mNextID;
+
+        std::vector<sTrack>         mTracks;
+        std::vector<int>            mIDs;               //== cUID overload's scratch ========----
+        std::vector<int>            mMarkerTrack;       //== Track index per marker =========----
+
+        //== Per frame scratch, kept to avoid reallocating ==--
+
+        float                       mVoxelSize;
+        int                         mVoxelMask;
+        std::vector<int>            mVoxelStart;        //== Hash bucket -> first slot ======----
+        std::vector<sVoxelEntry>    mVoxelEntries;      //== Ordered by bucket ==============----
+        std::vector<std::pair<unsigned int, int> > mEntries;   //== (bucket, track) =========----
+        std::vector<int>            mWideTracks;        //== Gates too wide to hash =========----
+
+        std::vector<Core::cClusterAssignment::sCandidate> mCandidates;   //== Cost: distance^2/gate^2 ----
+        std::vector<int>            mTrackStamp;        //== Last marker that saw the track =----
+        std::vector<int>            mTrackMatch;        //== Marker per track, -1 none =======----
+        std::vector<int>            mMarkerMatch;
+
+        Core::cClusterAssignment    mAssignment;
+    };
+}
+
+#endif
@@ -0,0 +1,627 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "mjpegdecoderpool.h"
+#include "jpegencoder.h"
+#include "benchmarknoise.h"
+#include "cameramanager.h"
+#include "camera.h"
+#include "frame.h"
+#include "object.h"
+
+#include "Core/Timer.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    const int kMaxJPEGSize = 16*1024*1024;
+
+#ifdef WIN32
+    unsigned long __stdcall DecoderThreadProc(void *Param)
+    {
+        cMJPEGDecoderPool::sWorker *worker = (cMJPEGDecoderPool::sWorker*) Param;
+        worker->Pool->WorkerThread(worker);
+        return 0;
+    }
+#else
+    void DecoderThreadProc(void *Param)
+    {
+        cMJPEGDecoderPool::sWorker *worker = (cMJPEGDecoderPool::sWorker*) Param;
+        worker->Pool->WorkerThread(worker);
+    }
+#endif
+
+    int ProcessorCount()
+    {
+#ifdef WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return (int) info.dwNumberOfProcessors;
+#else
+        return (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    }
+}
+
+//== cMJPEGImage ========================================================================================----
+
+cMJPEGImage::cMJPEGImage()
+    : mSerial(0)
+    , mFrameID(0)
+    , mTimeStamp(0)
+    , mValid(false)
+    , mDone(false)
+    , mPartial(false)
+    , mRegionWidth(0)
+    , mTasksRemaining(0)
+{
+}
+
+//== cMJPEGDecoderPool ==================================================================================----
+
+cMJPEGDecoderPool::cMJPEGDecoderPool(int ThreadCount, int MaxPendingFrames)
+    : mRegionsOfInterest(false)
+    , mRegionMargin(8)
+    , mRunning(true)
+{
+    if(ThreadCount<=0)
+        ThreadCount = ProcessorCount();
+
+    if(ThreadCount<1)
+        ThreadCount = 1;
+
+    //== enough frames in flight to keep every thread busy plus a little slack ==--
+
+    mMaxPending = (MaxPendingFrames>0) ? MaxPendingFrames : 2*ThreadCount + 2;
+
+    ResetStatistics();
+
+    for(int i=0; i<ThreadCount; i++)
+    {
+        sWorker *worker = new sWorker();
+        worker->Pool = this;
+
+        mWorkers.push_back(worker);
+
+#ifdef WIN32
+        worker->Thread.StartThread((void*) DecoderThreadProc, worker);
+#else
+        worker->Thread.StartThread(DecoderThreadProc, worker);
+#endif
+    }
+}
+
+cMJPEGDecoderPool::~cMJPEGDecoderPool()
+{
+    //== let outstanding decodes finish so no thread touches a deleted image ==--
+
+    cMJPEGImage *image;
+
+    while((image = NextDecoded(true))!=0)
+        Release(image);
+
+    mRunning = false;
+
+    for(int i=0; i<(int) mWorkers.size(); i++)
+    {
+        mWorkAvailable.Trigger();
+        mWorkers[i]->Thread.StopThread();
+        delete mWorkers[i];
+    }
+
+    for(int i=0; i<(int) mAllImages.size(); i++)
+        delete mAllImages[i];
+}
+
+void cMJPEGDecoderPool::AttachedTo(Camera *Camera)
+{
+    //== JPEG data is only kept around for us when the library doesn't decode it ==--
+
+    Camera->SetLateMJPEGDecompression(true);
+}
+
+void cMJPEGDecoderPool::SetRegionsOfInterest(bool Enable, int Margin)
+{
+    mRegionMargin      = (Margin<0) ? 0 : Margin;
+    mRegionsOfInterest = Enable;
+}
+
+bool cMJPEGDecoderPool::PostFrame(Camera *Camera, Frame *Frame)
+{
+    Submit(Camera, Frame);
+
+    return false;
+}
+
+cMJPEGImage * cMJPEGDecoderPool::AcquireImage()
+{
+    //== called with mLock held ==--
+
+    cMJPEGImage *image = 0;
+
+    if(!mFreeImages.empty())
+    {
+        image = mFreeImages.back();
+        mFreeImages.pop_back();
+    }
+    else if((int) mAllImages.size()<mMaxPending)
+    {
+        image = new cMJPEGImage();
+        mAllImages.push_back(image);
+    }
+
+    return image;
+}
+
+bool cMJPEGDecoderPool::Submit(Camera *Camera, Frame *Frame)
+{
+    int size = Frame->JPEGImageSize();
+
+    if(size<=0 || size>kMaxJPEGSize)
+        return false;
+
+    mLock.Lock();
+    cMJPEGImage *image = AcquireImage();
+
+    if(image==0)
+        mFramesDropped++;
+
+    mLock.UnLock();
+
+    if(image==0)
+        return false;
+
+    image->mJPEG.resize(size);
+
+    size = Frame->JPEGImage(&image->mJPEG[0], size);
+
+    if(size<=0)
+    {
+        Release(image);
+        return false;
+    }
+
+    image->mJPEG.resize(size);
+    image->mSerial    = (Camera ? Camera->Serial() : 0);
+    image->mFrameID   = Frame->FrameID();
+    image->mTimeStamp = Frame->TimeStamp();
+    image->mPartial   = mRegionsOfInterest;
+    image->mRegions.clear();
+
+    if(image->mPartial)
+    {
+        //== object bounds are in frame coordinates, scaled to the JPEG once it is parsed ==--
+
+        image->mRegionWidth = Frame->Width();
+
+        int count = Frame->ObjectCount();
+
+        for(int i=0; i<count; i++)
+        {
+            cObject *object = Frame->Object(i);
+
+            cJPEGDecoder::sRect rect;
+
+            rect.Left   = object->Left()   - mRegionMargin;
+            rect.Top    = object->Top()    - mRegionMargin;
+            rect.Right  = object->Right()  + mRegionMargin;
+            rect.Bottom = object->Bottom() + mRegionMargin;
+
+            image->mRegions.push_back(rect);
+        }
+    }
+
+    Enqueue(image);
+
+    return true;
+}
+
+bool cMJPEGDecoderPool::Submit(int Serial, int FrameID, double TimeStamp, const unsigned char *JPEG, int Size,
+                               const cJPEGDecoder::sRect *Regions, int RegionCount)
+{
+    if(JPEG==0 || Size<=0 || Size>kMaxJPEGSize)
+        return false;
+
+    mLock.Lock();
+    cMJPEGImage *image = AcquireImage();
+
+    if(image==0)
+        mFramesDropped++;
+
+    mLock.UnLock();
+
+    if(image==0)
+        return false;
+
+    image->mJPEG.assign(JPEG, JPEG + Size);
+    image->mSerial      = Serial;
+    image->mFrameID     = FrameID;
+    image->mTimeStamp   = TimeStamp;
+    image->mPartial     = (Regions!=0);
+    image->mRegionWidth = 0;
+    image->mRegions.assign(Regions, Regions + (Regions ? RegionCount : 0));
+
+    Enqueue(image);
+
+    return true;
+}
+
+void cMJPEGDecoderPool::Enqueue(cMJPEGImage *Image)
+{
+    //== parse happens on a worker, the submitting camera thread only copies ==--
+
+    sTask task = { Image, 0, 0 };
+
+    mLock.Lock();
+
+    Image->mValid = false;
+    Image->mDone  = false;
+
+    if(mFramesSubmitted++==0)
+        mFirstSubmitTime = CameraManager::X().TimeStamp();
+
+    mTasks.push_back(task);
+    mOrder.push_back(Image);
+
+    mLock.UnLock();
+
+    mWorkAvailable.Trigger();
+}
+
+cMJPEGImage * cMJPEGDecoderPool::NextDecoded(bool Wait)
+{
+    for(;;)
+    {
+        mLock.Lock();
+
+        if(mOrder.empty())
+        {
+            mLock.UnLock();
+            return 0;
+        }
+
+        cMJPEGImage *image = mOrder.front();
+
+        if(image->mDone)
+        {
+            mOrder.pop_front();
+            mLock.UnLock();
+
+            return image;
+        }
+
+        mLock.UnLock();
+
+        if(!Wait)
+            return 0;
+
+        mImageDone.Wait(100);
+    }
+}
+
+void cMJPEGDecoderPool::Release(cMJPEGImage *Image)
+{
+    if(Image==0)
+        return;
+
+    mLock.Lock();
+    mFreeImages.push_back(Image);
+    mLock.UnLock();
+}
+
+int cMJPEGDecoderPool::Pending()
+{
+    mLock.Lock();
+    int pending = (int) mOrder.size();
+    mLock.UnLock();
+
+    return pending;
+}
+
+void cMJPEGDecoderPool::Statistics(sStatistics &Stats)
+{
+    mLock.Lock();
+
+    Stats.FramesSubmitted     = mFramesSubmitted;
+    Stats.FramesDecoded       = mFramesDecoded;
+    Stats.FramesDropped       = mFramesDropped;
+    Stats.DecodeErrors        = mDecodeErrors;
+    Stats.QueueDepth          = (int) mOrder.size();
+    Stats.FramesPerSecond     = 0;
+    Stats.MegapixelsPerSecond = 0;
+
+    double elapsed = mLastDoneTime - mFirstSubmitTime;
+
+    if(mFramesDecoded>0 && elapsed>0)
+    {
+        Stats.FramesPerSecond     = mFramesDecoded / elapsed;
+        Stats.MegapixelsPerSecond = mPixelsDecoded / elapsed / 1000000.0;
+    }
+
+    mLock.UnLock();
+}
+
+void cMJPEGDecoderPool::ResetStatistics()
+{
+    mLock.Lock();
+
+    mFramesSubmitted = 0;
+    mFramesDecoded   = 0;
+    mFramesDropped   = 0;
+    mDecodeErrors    = 0;
+    mPixelsDecoded   = 0;
+    mFirstSubmitTime = 0;
+    mLastDoneTime    = 0;
+
+    mLock.UnLock();
+}
+
+void cMJPEGDecoderPool::ParseImage(cMJPEGImage *Image)
+{
+    if(!Image->mDecoder.Parse(&Image->mJPEG[0], (int) Image->mJPEG.size())
+       || Image->mDecoder.SegmentCount()<1)
+    {
+        mLock.Lock();
+        Image->mTasksRemaining = 1;
+        mLock.UnLock();
+
+        FinishTask(Image, false);
+        return;
+    }
+
+    int width  = Image->mDecoder.Width();
+    int height = Image->mDecoder.Height();
+
+    Image->mPixels.resize(width*height);
+
+    if(Image->mRegionWidth>0 && Image->mRegionWidth!=width)
+    {
+        //== MJPEG images can be a decimated copy of the sensor ==--
+
+        for(int i=0; i<(int) Image->mRegions.size(); i++)
+        {
+            cJPEGDecoder::sRect &rect = Image->mRegions[i];
+
+            rect.Left   = (int) ((long long) rect.Left   * width / Image->mRegionWidth);
+            rect.Top    = (int) ((long long) rect.Top    * width / Image->mRegionWidth);
+            rect.Right  = (int) ((long long) rect.Right  * width / Image->mRegionWidth);
+            rect.Bottom = (int) ((long long) rect.Bottom * width / Image->mRegionWidth);
+        }
+    }
+
+    Image->mRegionWidth = 0;
+
+    //== split restart intervals into at most one contiguous run per thread ==--
+
+    int segments = Image->mDecoder.SegmentCount();
+    int tasks    = (segments<ThreadCount()) ? segments : ThreadCount();
+
+    mLock.Lock();
+
+    Image->mValid          = true;
+    Image->mTasksRemaining = tasks;
+
+    //== queue at the front so frames complete in order instead of all at once ==--
+
+    for(int i=tasks-1; i>=0; i--)
+    {
+        int first = (segments*i)/tasks;
+        int last  = (segments*(i+1))/tasks;
+
+        sTask task = { Image, first, last-first };
+
+        mTasks.push_front(task);
+    }
+
+    mLock.UnLock();
+
+    for(int i=1; i<tasks; i++)
+        mWorkAvailable.Trigger();
+}
+
+void cMJPEGDecoderPool::FinishTask(cMJPEGImage *Image, bool Success)
+{
+    mLock.Lock();
+
+    if(!Success)
+        Image->mValid = false;
+
+    bool done = (--Image->mTasksRemaining==0);
+
+    if(done)
+    {
+        Image->mDone  = true;
+        mLastDoneTime = CameraManager::X().TimeStamp();
+
+        if(Image->mValid)
+        {
+            mFramesDecoded++;
+            mPixelsDecoded += (long long) Image->Width() * Image->Height();
+        }
+        else
+        {
+            mDecodeErrors++;
+        }
+    }
+
+    mLock.UnLock();
+
+    if(done)
+        mImageDone.Trigger();
+}
+
+void cMJPEGDecoderPool::WorkerThread(sWorker *Worker)
+{
+    while(mRunning && Worker->Thread.IsSteadyState())
+    {
+        sTask task  = { 0, 0, 0 };
+        bool  found = false;
+
+        mLock.Lock();
+
+        if(!mTasks.empty())
+        {
+            task  = mTasks.front();
+            found = true;
+            mTasks.pop_front();
+        }
+
+        mLock.UnLock();
+
+        if(!found)
+        {
+            mWorkAvailable.Wait(100);
+            continue;
+        }
+
+        if(task.SegmentCount==0)
+        {
+            ParseImage(task.Image);
+            continue;
+        }
+
+        cMJPEGImage *image = task.Image;
+
+        bool success;
+
+        if(image->mPartial)
+        {
+            success = image->mRegions.empty() ||
+                      image->mDecoder.DecodeRegions(&image->mRegions[0], (int) image->mRegions.size(),
+                                                    task.FirstSegment, task.SegmentCount,
+                                                    &image->mPixels[0], image->mDecoder.Width());
+        }
+        else
+        {
+            success = image->mDecoder.DecodeSegments(task.FirstSegment, task.SegmentCount,
+                                                     &image->mPixels[0], image->mDecoder.Width());
+        }
+
+        FinishTask(image, success);
+    }
+
+    Worker->Thread.mThreadRunning = false;
+}
+
+//== Benchmark =========================================================================================----
+
+void cMJPEGDecoderPool::Benchmark(int ThreadCount, int Width, int Height, int Frames, sBenchmark &Result)
+{
+    const int kImages  = 4;                     //== Distinct frames, submitted in turn ========----
+    const int kQuality = 90;
+
+    Width  = std::max(Width, 16);
+    Height = std::max(Height, 16);
+    Frames = std::max(Frames, 1);
+
+    int total = Width*Height;
+
+    //== Marker-like blobs on a dark, speckled background, JPEG encoded and decoded once as the
+    //== reference every pooled decode has to reproduce exactly ==--
+
+    cBenchmarkNoise noise(521288629u);
+
+    std::vector<unsigned char> image(total);
+    std::vector<unsigned char> encoded[kImages];
+    std::vector<unsigned char> reference[kImages];
+
+    for(int i=0; i<kImages; i++)
+    {
+        for(int p=0; p<total; p++)
+            image[p] = (unsigned char) ((noise.Uniform()<0.01f) ? 8 + (noise.Next() & 15) : 4);
+
+        for(int b=0; b<100; b++)
+        {
+            float radius = 2 + 6*noise.Uniform();
+            float peak   = 160 + 95*noise.Uniform();
+            float cx     = radius + (Width  - 2*radius)*noise.Uniform();
+            float cy     = radius + (Height - 2*radius)*noise.Uniform();
+
+            int reach = (int) (radius + 2);
+
+            for(int y=std::max((int) cy-reach, 0); y<=std::min((int) cy+reach, Height-1); y++)
+            {
+                for(int x=std::max((int) cx-reach, 0); x<=std::min((int) cx+reach, Width-1); x++)
+                {
+                    float distance = sqrtf((x-cx)*(x-cx) + (y-cy)*(y-cy));
+                    float value    = peak*std::min(1.0f, std::max(0.0f, radius + 1 - distance));
+
+                    image[y*Width + x] = (unsigned char) std::max((float) image[y*Width + x], value);
+                }
+            }
+        }
+
+        cJPEGEncoder::Encode(&image[0], Width, Height, Width, kQuality, (Width+7)/8, encoded[i]);
+
+        cJPEGDecoder decoder;
+
+        reference[i].resize(total);
+        decoder.Decode(&encoded[i][0], (int) encoded[i].size(), &reference[i][0], Width);
+    }
+
+    int decodeErrors = 0;
+    int mismatches   = 0;
+    int decoded      = 0;
+
+    Core::cTimer timer;
+    double       seconds = 0;
+
+    {
+        cMJPEGDecoderPool pool(ThreadCount, 0);
+
+        ThreadCount = pool.ThreadCount();
+
+        timer.CatchUp();
+
+        for(int submitted=0; decoded<Frames; )
+        {
+            //== keep the pool full, collecting in order whenever it refuses a frame ==--
+
+            if(submitted<Frames)
+            {
+                const std::vector<unsigned char> &jpeg = encoded[submitted%kImages];
+
+                if(pool.Submit(0, submitted, 0, &jpeg[0], (int) jpeg.size()))
+                {
+                    submitted++;
+                    continue;
+                }
+            }
+
+            cMJPEGImage *done = pool.NextDecoded(true);
+
+            if(done==0)
+                break;
+
+            if(!done->IsValid())
+                decodeErrors++;
+            else if(memcmp(done->Data(), &reference[done->FrameID()%kImages][0], total)!=0)
+                mismatches++;
+
+            pool.Release(done);
+            decoded++;
+        }
+
+        seconds = timer.CatchUp();                  //== before the workers are joined ===----
+    }
+
+    Result.ThreadCount         = ThreadCount;
+    Result.Width               = Width;
+    Result.Height              = Height;
+    Result.Frames              = decoded;
+    Result.FramesPerSecond     = seconds>0 ? decoded/seconds : 0;
+    Result.MegapixelsPerSecond = seconds>0 ? (double) total*decoded/seconds/1000000.0 : 0;
+    Result.DecodeErrors        = decodeErrors + (Frames - decoded);
+    Result.Mismatches          = mismatches;
+}
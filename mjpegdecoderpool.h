@@ -0,0 +1,181 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Parallel MJPEG decoding.  Attach the pool to MJPEG cameras as a camera module (or call Submit()
+//== directly) and each frame's JPEG data is copied out and decoded on a pool of worker threads into
+//== recycled single channel 8-bit images.  Attaching the module enables late MJPEG decompression
+//== on the camera so the library no longer decodes frames itself.
+//==
+//== Work is spread across frames from all cameras and, for JPEGs with restart markers, across
+//== restart intervals of a single frame, so latency also drops when only a few cameras stream.
+//== With SetRegionsOfInterest() enabled only the blocks around each frame's objects are decoded
+//== (see cJPEGDecoder::DecodeRegions), the rest of the image is left stale.
+//==
+//== Decoded images are handed back in submission order.  When MaxPendingFrames are queued new
+//== frames are dropped rather than blocking the camera thread.
+//==
+
+#ifndef __CAMERALIBRARY__MJPEGDECODERPOOL_H__
+#define __CAMERALIBRARY__MJPEGDECODERPOOL_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <deque>
+#include <vector>
+#include "cameramodulebase.h"
+#include "jpegdecoder.h"
+#include "threading.h"
+#include "lock.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class Camera;
+    class Frame;
+
+    class cMJPEGImage
+    {
+    public:
+        int     Serial() const              { return mSerial;    }
+        int     FrameID() const             { return mFrameID;   }
+        double  TimeStamp() const           { return mTimeStamp; }
+        int     Width() const               { return mDecoder.Width();  }
+        int     Height() const              { return mDecoder.Height(); }
+        bool    IsValid() const             { return mValid;     }   //== Decoded without error ---
+        bool    IsPartial() const           { return mPartial;   }   //== Only Region()s valid ===---
+
+        int     RegionCount() const         { return (int) mRegions.size(); }
+        const cJPEGDecoder::sRect & Region(int Index) const { return mRegions[Index]; }
+
+        const unsigned char * Data() const  { return mPixels.empty() ? 0 : &mPixels[0]; }
+
+    private:
+        friend class cMJPEGDecoderPool;
+
+        cMJPEGImage();
+
+        int                        mSerial;
+        int                        mFrameID;
+        double                     mTimeStamp;
+        bool                       mValid;
+        bool                       mDone;
+        bool                       mPartial;
+        int                        mRegionWidth;        //== Frame width of mRegions, 0: JPEG --
+        int                        mTasksRemaining;
+        std::vector<cJPEGDecoder::sRect> mRegions;
+        std::vector<unsigned char> mJPEG;
+        std::vector<unsigned char> mPixels;
+        cJPEGDecoder               mDecoder;
+    };
+
+    class cMJPEGDecoderPool : public cCameraModule
+    {
+    public:
+        cMJPEGDecoderPool(int ThreadCount = 0, int MaxPendingFrames = 0);   //== 0: automatic ==----
+        ~cMJPEGDecoderPool();
+
+        bool    Submit(Camera *Camera, Frame *Frame);   //== False if dropped or not MJPEG ======----
+        bool    Submit(int Serial, int FrameID, double TimeStamp, const unsigned char *JPEG, int Size,
+                       const cJPEGDecoder::sRect *Regions = 0, int RegionCount = 0);
+
+        //== Decode only object bounding boxes grown by Margin pixels for frames from cameras ==--
+
+        void    SetRegionsOfInterest(bool Enable, int Margin = 8);
+        bool    RegionsOfInterest() const   { return mRegionsOfInterest; }
+
+        //== Oldest submitted frame once it is decoded, 0 when nothing is pending or, unless Wait
+        //== is set, the oldest frame is not finished yet.  Release() every returned image.
+
+        cMJPEGImage * NextDecoded(bool Wait);
+        void    Release(cMJPEGImage *Image);
+
+        int     Pending();
+        int     ThreadCount() const         { return (int) mWorkers.size(); }
+
+        struct sStatistics
+        {
+            int     FramesSubmitted;
+            int     FramesDecoded;
+            int     FramesDropped;              //== Pool full ============================----
+            int     DecodeErrors;
+            int     QueueDepth;
+            double  FramesPerSecond;            //== Decoded frames over wall time ========----
+            double  MegapixelsPerSecond;
+        };
+
+        void    Statistics(sStatistics &Stats);
+        void    ResetStatistics();
+
+        //== Decode Frames synthetic Width x Height JPEGs, a restart marker every block row, on
+        //== ThreadCount threads and compare each image with a single threaded decode ==--
+
+        struct sBenchmark
+        {
+            int     ThreadCount;
+            int     Width;
+            int     Height;
+            int     Frames;
+            double  FramesPerSecond;
+            double  MegapixelsPerSecond;
+            int     DecodeErrors;
+            int     Mismatches;                 //== Valid, but not the single threaded image --
+        };
+
+        static void Benchmark(int ThreadCount, int Width, int Height, int Frames, sBenchmark &Result);
+
+        //== cCameraModule ==--
+
+        virtual bool PostFrame (Camera *Camera, Frame *Frame);
+        virtual void AttachedTo(Camera *Camera);
+
+        //== Internal use, thread entry point needs to be public ==--
+
+        struct sWorker
+        {
+            cMJPEGDecoderPool * Pool;
+            ThreadInfo          Thread;
+        };
+
+        void    WorkerThread(sWorker *Worker);
+
+    private:
+        struct sTask
+        {
+            cMJPEGImage * Image;
+            int           FirstSegment;
+            int           SegmentCount;         //== 0: parse and split into decode tasks -
+        };
+
+        cMJPEGImage * AcquireImage();
+        void    Enqueue    (cMJPEGImage *Image);
+        void    ParseImage (cMJPEGImage *Image);
+        void    FinishTask (cMJPEGImage *Image, bool Success);
+
+        std::vector<sWorker*>     mWorkers;
+        std::vector<cMJPEGImage*> mAllImages;
+        std::vector<cMJPEGImage*> mFreeImages;
+        std::deque<sTask>         mTasks;
+        std::deque<cMJPEGImage*>  mOrder;       //== Pending, submission order ============----
+        int                       mMaxPending;
+        bool                      mRegionsOfInterest;
+        int                       mRegionMargin;
+
+        LockItem                  mLock;
+        cEvent                    mWorkAvailable;
+        cEvent                    mImageDone;
+        volatile bool             mRunning;
+
+        int                       mFramesSubmitted;
+        int                       mFramesDecoded;
+        int                       mFramesDropped;
+        int                       mDecodeErrors;
+        long long                 mPixelsDecoded;
+        double                    mFirstSubmitTime;
+        double                    mLastDoneTime;
+    };
+}
+
+#endif
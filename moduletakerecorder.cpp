@@ -0,0 +1,273 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include "moduletakerecorder.h"
+#include "camera.h"
+#include "frame.h"
+
+#include "Core/IWriter.h"
+
+using namespace CameraLibrary;
+
+cModuleTakeRecorder::cModuleTakeRecorder(Core::cIWriter *Stream)
+    : mStream(0)
+    , mDeltaFrame(&mDeltaCodec)
+    , mDeltaCompression(false)
+    , mGrayscaleEncoder(0)
+    , mEnabled(true)
+    , mHeaderWritten(false)
+    , mFramesRecorded(0)
+    , mBytesRecorded(0)
+{
+    SetStream(Stream);
+}
+
+cModuleTakeRecorder::~cModuleTakeRecorder()
+{
+    SetGrayscaleRecording(false);
+
+    for(int i=0; i<(int) mFreeFrames.size(); i++)
+        delete mFreeFrames[i];
+}
+
+void cModuleTakeRecorder::SetStream(Core::cIWriter *Stream)
+{
+    mLock.Lock();
+
+    //== frames still being encoded belong to the previous take ==--
+
+    WriteQueuedFrames(true);
+
+    mStream         = Stream;
+    mHeaderWritten  = false;
+    mFramesRecorded = 0;
+    mBytesRecorded  = 0;
+
+    mRecordedCameras.clear();
+
+    //== a new take starts without references ==--
+
+    mDeltaCodec.Reset();
+    mDeltaCodec.ResetStatistics();
+
+    mLock.UnLock();
+}
+
+void cModuleTakeRecorder::SetDeltaCompression(bool Enable, bool EntropyCoding)
+{
+    mLock.Lock();
+
+    mDeltaCompression = Enable;
+    mDeltaCodec.SetEntropyCoding(EntropyCoding);
+
+    mLock.UnLock();
+}
+
+void cModuleTakeRecorder::SetEnabled(bool Enabled)
+{
+    mEnabled = Enabled;
+}
+
+bool cModuleTakeRecorder::Enabled()
+{
+    return mEnabled;
+}
+
+void cModuleTakeRecorder::SetGrayscaleRecording(bool Enable, int EncoderThreads)
+{
+    mLock.Lock();
+
+    if(mGrayscaleEncoder)
+    {
+        WriteQueuedFrames(true);
+
+        delete mGrayscaleEncoder;
+        mGrayscaleEncoder = 0;
+    }
+
+    if(Enable)
+        mGrayscaleEncoder = new cTakeGrayscaleEncoder(EncoderThreads);
+
+    mLock.UnLock();
+}
+
+void cModuleTakeRecorder::Flush()
+{
+    mLock.Lock();
+
+    WriteQueuedFrames(true);
+
+    mLock.UnLock();
+}
+
+bool cModuleTakeRecorder::PostFrame(Camera *Camera, Frame *Frame)
+{
+    if(!mEnabled || mStream==0)
+        return false;
+
+    //== Modules are invoked from each camera's own thread, serialize access to the stream ==--
+
+    mLock.Lock();
+
+    if(!mHeaderWritten)
+    {
+        cTakeFile::WriteHeader(mStream);
+        mBytesRecorded += 2*sizeof(int);
+        mHeaderWritten  = true;
+    }
+
+    if(mRecordedCameras.find(Camera->Serial())==mRecordedCameras.end())
+        WriteCameraRecord(Camera);
+
+    if(mGrayscaleEncoder && Frame->IsGrayscale())
+        RecordGrayscaleFrame(Camera, Frame);
+    else if(!mQueue.empty())
+        QueueFrame(Camera, Frame);
+    else
+        RecordFrame(Camera, Frame);
+
+    WriteQueuedFrames(false);
+
+    mFramesRecorded++;
+
+    mLock.UnLock();
+
+    return false;
+}
+
+void cModuleTakeRecorder::WriteCameraRecord(Camera *Camera)
+{
+    cTakeCameraInfo info;
+
+    info.PopulateFrom(Camera);
+
+    int payloadSize = info.SerializedSize();
+
+    cTakeFile::WriteRecordHeader(mStream, TakeRecordCamera, payloadSize);
+    info.Save(mStream);
+
+    mBytesRecorded += cTakeFile::kRecordHeaderSize + payloadSize;
+
+    mRecordedCameras.insert(Camera->Serial());
+}
+
+void cModuleTakeRecorder::RecordFrame(Camera *Camera, Frame *Frame)
+{
+    if(mDeltaCompression)
+    {
+        mDeltaFrame.PopulateFrom(Camera, Frame);
+        mDeltaFrame.Encode();
+
+        WriteFrameRecord(mDeltaFrame, mDeltaFrame.SerializedSize());
+        return;
+    }
+
+    mFrame.PopulateFrom(Camera, Frame);
+
+    WriteFrameRecord(mFrame, mFrame.SerializedSize());
+}
+
+void cModuleTakeRecorder::RecordGrayscaleFrame(Camera *Camera, Frame *Frame)
+{
+    //== Only the image copy happens here, compression runs on the encoder threads ==--
+
+    cTakeGrayscaleFrame *grayscale = mGrayscaleEncoder->AcquireFrame();
+
+    if(grayscale->PopulateFrom(Camera, Frame))
+    {
+        mGrayscaleEncoder->Submit(grayscale);
+
+        sQueuedFrame queued = { grayscale, 0 };
+        mQueue.push_back(queued);
+    }
+    else
+    {
+        mGrayscaleEncoder->ReleaseFrame(grayscale);
+
+        if(mQueue.empty())
+            RecordFrame(Camera, Frame);
+        else
+            QueueFrame(Camera, Frame);
+    }
+}
+
+void cModuleTakeRecorder::QueueFrame(Camera *Camera, Frame *Frame)
+{
+    //== The live frame is gone once PostFrame() returns, keep a copy.  Delta frames are only
+    //== encoded when written so the codec sees them in file order.
+
+    cTakeFrame *copy;
+
+    if(mFreeFrames.empty())
+    {
+        copy = new cTakeFrame();
+    }
+    else
+    {
+        copy = mFreeFrames.back();
+        mFreeFrames.pop_back();
+    }
+
+    copy->PopulateFrom(Camera, Frame);
+
+    sQueuedFrame queued = { 0, copy };
+    mQueue.push_back(queued);
+}
+
+void cModuleTakeRecorder::WriteQueuedFrames(bool Flush)
+{
+    //== Keep a couple of frames per worker in flight, beyond that recording waits so memory
+    //== stays bounded when the encoders fall behind.
+
+    while(!mQueue.empty())
+    {
+        sQueuedFrame &queued = mQueue.front();
+
+        if(queued.Grayscale)
+        {
+            //== the encoder hands frames back in submission order, this is queued.Grayscale ==--
+
+            bool wait = Flush || mGrayscaleEncoder->Pending()>2*mGrayscaleEncoder->ThreadCount();
+
+            cTakeGrayscaleFrame *frame = mGrayscaleEncoder->NextEncoded(wait);
+
+            if(frame==0)
+                break;
+
+            WriteFrameRecord(*frame, frame->SerializedSize());
+
+            mGrayscaleEncoder->ReleaseFrame(frame);
+        }
+        else
+        {
+            WriteQueuedFrame(*queued.Objects);
+
+            mFreeFrames.push_back(queued.Objects);
+        }
+
+        mQueue.pop_front();
+    }
+}
+
+void cModuleTakeRecorder::WriteQueuedFrame(const cTakeFrame &Frame)
+{
+    if(mDeltaCompression)
+    {
+        static_cast<cTakeFrame&>(mDeltaFrame) = Frame;
+        mDeltaFrame.Encode();
+
+        WriteFrameRecord(mDeltaFrame, mDeltaFrame.SerializedSize());
+        return;
+    }
+
+    WriteFrameRecord(Frame, Frame.SerializedSize());
+}
+
+void cModuleTakeRecorder::WriteFrameRecord(const cTakeFrame &Frame, int PayloadSize)
+{
+    cTakeFile::WriteRecordHeader(mStream, TakeRecordFrame, PayloadSize);
+    Frame.Save(mStream);
+
+    mBytesRecorded += cTakeFile::kRecordHeaderSize + PayloadSize;
+}
@@ -0,0 +1,106 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Take recorder.  Attach to one or more cameras and every posted frame is appended to the take
+//== stream in the format described in takefile.h.  The module never consumes frames, so it can be
+//== stacked with any other module.  Replay takes with cInputManagerFile.  Not to be confused with
+//== the library's own cModuleFileOutput, which writes its own format.
+//==
+
+#ifndef __CAMERALIBRARY__MODULETAKERECORDER_H__
+#define __CAMERALIBRARY__MODULETAKERECORDER_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <set>
+#include <deque>
+#include <vector>
+#include "cameramodulebase.h"
+#include "lock.h"
+#include "takefile.h"
+#include "takedeltaframe.h"
+#include "takegrayscaleframe.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace Core
+{
+    class cIWriter;
+}
+
+namespace CameraLibrary
+{
+    class Camera;
+    class Frame;
+
+    class cModuleTakeRecorder : public cCameraModule
+    {
+    public:
+        cModuleTakeRecorder(Core::cIWriter *Stream = 0);
+        ~cModuleTakeRecorder();
+
+        void SetStream(Core::cIWriter *Stream);     //== Caller owns stream, new take header ----
+        Core::cIWriter * Stream() { return mStream; }
+
+        void SetEnabled(bool Enabled);
+        bool Enabled();
+
+        bool PostFrame(Camera *Camera, Frame *Frame);
+
+        //== Record DeltaObjectOnly frames instead of TinyObjectOnly, see takedeltaframe.h ==--
+
+        void SetDeltaCompression(bool Enable, bool EntropyCoding = true);
+        bool DeltaCompression()        { return mDeltaCompression; }
+        cTakeDeltaCodec & DeltaCodec() { return mDeltaCodec; }  //== Compression statistics ----
+
+        //== Record grayscale frames losslessly as LosslessGrayscale frames.  Compression runs on
+        //== EncoderThreads worker threads (0: one per processor).  Frames are still written in the
+        //== order they were posted: while a grayscale frame is being encoded, object frames posted
+        //== after it are copied and wait for it.
+
+        void SetGrayscaleRecording(bool Enable, int EncoderThreads = 0);
+        bool GrayscaleRecording()      { return mGrayscaleEncoder!=0; }
+
+        void Flush();                               //== Write frames still being encoded ===----
+
+        int  FramesRecorded()          { return mFramesRecorded; }
+        long long BytesRecorded()      { return mBytesRecorded;  }
+
+    protected:
+        virtual void RecordFrame(Camera *Camera, Frame *Frame);
+        void RecordGrayscaleFrame(Camera *Camera, Frame *Frame);
+
+        void QueueFrame(Camera *Camera, Frame *Frame);
+
+        void WriteCameraRecord(Camera *Camera);
+        void WriteQueuedFrames(bool Flush);
+        void WriteQueuedFrame (const cTakeFrame &Frame);
+        void WriteFrameRecord (const cTakeFrame &Frame, int PayloadSize);
+
+        struct sQueuedFrame                         //== One of the two is set ==============----
+        {
+            cTakeGrayscaleFrame * Grayscale;        //== Submitted to the encoder ===========----
+            cTakeFrame *          Objects;
+        };
+
+        Core::cIWriter * mStream;
+        LockItem         mLock;
+        std::set<int>    mRecordedCameras;
+        cTakeFrame       mFrame;
+        cTakeDeltaCodec  mDeltaCodec;
+        cTakeDeltaFrame  mDeltaFrame;
+        bool             mDeltaCompression;
+        cTakeGrayscaleEncoder * mGrayscaleEncoder;
+        std::deque<sQueuedFrame>  mQueue;           //== Posted, not yet written ============----
+        std::vector<cTakeFrame*>  mFreeFrames;      //== Recycled object frame copies =======----
+
+        bool             mEnabled;
+        bool             mHeaderWritten;
+        int              mFramesRecorded;
+        long long        mBytesRecorded;
+    };
+}
+
+#endif
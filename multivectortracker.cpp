@@ -0,0 +1,806 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <math.h>
+#include <algorithm>
+
+#include "multivectortracker.h"
+#include "benchmarknoise.h"
+#include "modulevector.h"
+#include "Core/Timer.h"
+
+using namespace CameraLibrary;
+
+cMultiVectorTracker::cMultiVectorTracker()
+    : mCellSize(1.0f)
+    , mCellMask(0)
+{
+    mSettings.LinkRadius   = 150.0f;
+    mSettings.MotionRadius = 20.0f;
+
+    mStatistics.Tracked   = 0;
+    mStatistics.Acquired  = 0;
+    mStatistics.Clusters  = 0;
+    mStatistics.Labelings = 0;
+}
+
+int cMultiVectorTracker::AddTarget(const cVectorSettings &Settings, int Winding)
+{
+    sTarget target;
+
+    if(!target.Solver.SetSettings(Settings))
+        return -1;
+
+    double distances[3][3] = { { 0,                   Settings.Distance12, Settings.Distance13 },
+                               { Settings.Distance12, 0,                   Settings.Distance23 },
+                               { Settings.Distance13, Settings.Distance23, 0                   } };
+
+    target.Markers = 3;
+    target.Winding = (Winding>0) - (Winding<0);
+
+    for(int i=0; i<3; i++)
+        for(int j=0; j<3; j++)
+            target.Distance[i][j] = distances[i][j];
+
+    return Add(target);
+}
+
+int cMultiVectorTracker::AddCustomTarget(int Markers, const double *Distances, const cVectorPoseSolver::sCamera &Camera,
+                                         int Winding)
+{
+    sTarget target;
+
+    if(!target.Solver.SetCustom(Markers, Distances, Camera))
+        return -1;
+
+    target.Markers = Markers;
+    target.Winding = (Winding>0) - (Winding<0);
+
+    for(int i=0; i<Markers; i++)
+        for(int j=0; j<Markers; j++)
+            target.Distance[i][j] = Distances[i*Markers + j];
+
+    return Add(target);
+}
+
+int cMultiVectorTracker::Add(const sTarget &Target)
+{
+    mTargets.push_back(Target);
+
+    sTarget &target = mTargets.back();
+
+    target.Distance2Sum    = 0;
+    target.Tracked         = false;
+    target.Result.Markers  = 0;
+    target.Result.Acquired = false;
+
+    for(int i=0; i<target.Markers; i++)
+    {
+        target.Object[i] = -1;
+
+        for(int j=i + 1; j<target.Markers; j++)
+            target.Distance2Sum += target.Distance[i][j]*target.Distance[i][j];
+    }
+
+    return (int) mTargets.size() - 1;
+}
+
+void cMultiVectorTracker::Reset()
+{
+    for(size_t t=0; t<mTargets.size(); t++)
+    {
+        mTargets[t].Tracked        = false;
+        mTargets[t].Result.Markers = 0;
+        mTargets[t].Solver.Reset();
+    }
+}
+
+void cMultiVectorTracker::BeginFrame()
+{
+    mX.clear();
+    mY.clear();
+}
+
+void cMultiVectorTracker::PushMarkerData(float X, float Y)
+{
+    mX.push_back(X);
+    mY.push_back(Y);
+}
+
+void cMultiVectorTracker::GetResult(int Target, int Index, float &X, float &Y, float &Z) const
+{
+    const double *position = mTargets[Target].Result.Position[Index];
+
+    X = (float) position[0];
+    Y = (float) position[1];
+    Z = (float) position[2];
+}
+
+void cMultiVectorTracker::Get2DMarker(int Target, int Index, float &X, float &Y) const
+{
+    X = mTargets[Target].Image[Index][0];
+    Y = mTargets[Target].Image[Index][1];
+}
+
+void cMultiVectorTracker::Calculate()
+{
+    int count       = (int) mX.size();
+    int targetCount = (int) mTargets.size();
+
+    mStatistics.Tracked   = 0;
+    mStatistics.Acquired  = 0;
+    mStatistics.Clusters  = 0;
+    mStatistics.Labelings = 0;
+
+    mClaimed.assign(count, 0);
+    mBatch.clear();
+
+    BuildGrid();
+
+    //== tracked targets claim their objects first ==--
+
+    bool lost = false;
+
+    for(int t=0; t<targetCount; t++)
+    {
+        if(mTargets[t].Tracked)
+            Follow(t);
+
+        lost = lost || !mTargets[t].Tracked;
+    }
+
+    //== the lost ones look for themselves in what is left ==--
+
+    if(lost)
+    {
+        Cluster();
+        Acquire();
+    }
+
+    //== and everyone followed is solved in one go ==--
+
+    for(size_t b=0; b<mBatch.size(); b++)
+    {
+        sTarget &target = mTargets[mBatch[b]];
+
+        if(Solve(target, true))
+            mStatistics.Tracked++;
+    }
+}
+
+int cMultiVectorTracker::Cell(int X, int Y) const
+{
+    return (int) (((unsigned int) X*73856093u ^ (unsigned int) Y*19349663u) & (unsigned int) mCellMask);
+}
+
+int cMultiVectorTracker::CellCoordinate(float Value) const
+{
+    return (int) floorf(Value/mCellSize);
+}
+
+void cMultiVectorTracker::BuildGrid()
+{
+    //== one cell per link radius, about two buckets per object so chains stay short ==--
+
+    int count = (int) mX.size();
+
+    mCellSize = std::max(std::max(mSettings.LinkRadius, mSettings.MotionRadius), 1.0f);
+
+    int buckets = 16;
+
+    while(buckets<2*count)
+        buckets <<= 1;
+
+    mCellMask = buckets - 1;
+
+    mCellStart.assign(buckets + 1, 0);
+    mObjectCell.resize(count);
+    mCellObjects.resize(count);
+
+    for(int i=0; i<count; i++)
+    {
+        int cell = Cell(CellCoordinate(mX[i]), CellCoordinate(mY[i]));
+
+        mObjectCell[i] = cell;
+        mCellStart[cell + 1]++;
+    }
+
+    for(int b=0; b<buckets; b++)
+        mCellStart[b + 1] += mCellStart[b];
+
+    //== counting sort, filling moves each start one bucket on; shift them back ==--
+
+    for(int i=0; i<count; i++)
+        mCellObjects[mCellStart[mObjectCell[i]]++] = i;
+
+    for(int b=buckets; b>0; b--)
+        mCellStart[b] = mCellStart[b - 1];
+
+    mCellStart[0] = 0;
+}
+
+int cMultiVectorTracker::Nearest(float X, float Y, float Radius) const
+{
+    //== cells are at least MotionRadius wide, so this is 2 x 2 of them at most ==--
+
+    int left   = CellCoordinate(X - Radius);
+    int right  = CellCoordinate(X + Radius);
+    int top    = CellCoordinate(Y - Radius);
+    int bottom = CellCoordinate(Y + Radius);
+
+    int   nearest = -1;
+    float best    = Radius*Radius;
+
+    //== a bucket shared by two of the cells is just looked at twice ==--
+
+    for(int cy=top; cy<=bottom; cy++)
+    {
+        for(int cx=left; cx<=right; cx++)
+        {
+            int cell = Cell(cx, cy);
+
+            for(int s=mCellStart[cell]; s<mCellStart[cell + 1]; s++)
+            {
+                int   o  = mCellObjects[s];
+                float dx = mX[o] - X;
+                float dy = mY[o] - Y;
+
+                if(!mClaimed[o] && dx*dx + dy*dy<=best)
+                {
+                    best    = dx*dx + dy*dy;
+                    nearest = o;
+                }
+            }
+        }
+    }
+
+    return nearest;
+}
+
+void cMultiVectorTracker::Follow(int Target)
+{
+    sTarget &target = mTargets[Target];
+
+    for(int m=0; m<target.Markers; m++)
+    {
+        int o = Nearest(target.Image[m][0] + target.Motion[m][0], target.Image[m][1] + target.Motion[m][1],
+                        mSettings.MotionRadius);
+
+        if(o<0)
+        {
+            //== a marker went missing: let go of the others and reacquire ==--
+
+            for(int k=0; k<m; k++)
+                mClaimed[target.Object[k]] = 0;
+
+            target.Tracked        = false;
+            target.Result.Markers = 0;
+            target.Solver.Reset();
+
+            return;
+        }
+
+        target.Object[m] = o;
+        mClaimed[o]      = 1;
+    }
+
+    mBatch.push_back(Target);
+}
+
+int cMultiVectorTracker::Root(int Object)
+{
+    while(mParent[Object]!=Object)
+    {
+        mParent[Object] = mParent[mParent[Object]];
+        Object          = mParent[Object];
+    }
+
+    return Object;
+}
+
+void cMultiVectorTracker::Cluster()
+{
+    int   count  = (int) mX.size();
+    float radius = mSettings.LinkRadius;
+
+    mParent.resize(count);
+
+    for(int o=0; o<count; o++)
+        mParent[o] = o;
+
+    //== link every free pair closer than the radius; the cells are that size, so the 3 x 3
+    //== around an object hold all of them
+
+    for(int o=0; o<count; o++)
+    {
+        if(mClaimed[o])
+            continue;
+
+        int x = CellCoordinate(mX[o]);
+        int y = CellCoordinate(mY[o]);
+
+        for(int cy=y - 1; cy<=y + 1; cy++)
+        {
+            for(int cx=x - 1; cx<=x + 1; cx++)
+            {
+                int cell = Cell(cx, cy);
+
+                for(int s=mCellStart[cell]; s<mCellStart[cell + 1]; s++)
+                {
+                    int p = mCellObjects[s];
+
+                    if(p<=o || mClaimed[p])
+                        continue;
+
+                    float dx = mX[p] - mX[o];
+                    float dy = mY[p] - mY[o];
+
+                    if(dx*dx + dy*dy>radius*radius)
+                        continue;
+
+                    int a = Root(o);
+                    int b = Root(p);
+
+                    if(a!=b)
+                        mParent[std::max(a, b)] = std::min(a, b);
+                }
+            }
+        }
+    }
+
+    //== clusters numbered by root (roots come first, parents being the smaller index), objects
+    //== ordered by cluster
+
+    int clusters = 0;
+
+    mObjectCluster.resize(count);
+
+    for(int o=0; o<count; o++)
+    {
+        if(mClaimed[o])
+            mObjectCluster[o] = -1;
+        else if(Root(o)==o)
+            mObjectCluster[o] = clusters++;
+        else
+            mObjectCluster[o] = mObjectCluster[Root(o)];
+    }
+
+    mClusterStart.assign(clusters + 1, 0);
+    mClusterObjects.resize(count);
+
+    for(int o=0; o<count; o++)
+        if(mObjectCluster[o]>=0)
+            mClusterStart[mObjectCluster[o] + 1]++;
+
+    for(int c=0; c<clusters; c++)
+        mClusterStart[c + 1] += mClusterStart[c];
+
+    for(int o=0; o<count; o++)
+        if(mObjectCluster[o]>=0)
+            mClusterObjects[mClusterStart[mObjectCluster[o]]++] = o;
+
+    for(int c=clusters; c>0; c--)
+        mClusterStart[c] = mClusterStart[c - 1];
+
+    mClusterStart[0] = 0;
+
+    mStatistics.Clusters = clusters;
+}
+
+void cMultiVectorTracker::Label(const sTarget &Target, const int *Objects, sPairing &Pairing) const
+{
+    //== every assignment of the cluster's objects to the target's markers, scored by how far the
+    //== image distances are from a scaled copy of the real ones: 1 - cos^2 of the angle between
+    //== the two as vectors over all pairs.  Only right for a clip facing the camera, which is
+    //== why the best few are kept for the solver to settle.  Markers! orders: nothing for a clip,
+    //== about a millisecond for eight markers, and only paid while a target is lost.
+
+    int    markers = Target.Markers;
+    double image[kMaxMarkers][kMaxMarkers];
+    int    order[kMaxMarkers];
+
+    for(int i=0; i<markers; i++)
+    {
+        order[i] = i;
+
+        for(int j=i + 1; j<markers; j++)
+        {
+            double dx = mX[Objects[j]] - mX[Objects[i]];
+            double dy = mY[Objects[j]] - mY[Objects[i]];
+
+            image[i][j] = image[j][i] = sqrt(dx*dx + dy*dy);
+        }
+    }
+
+    Pairing.Count = 0;
+
+    do
+    {
+        //== a mirror order runs the other way round ==--
+
+        if(Target.Winding)
+        {
+            int a = Objects[order[0]], b = Objects[order[1]], c = Objects[order[2]];
+
+            double cross = (mX[b] - mX[a])*(mY[c] - mY[a]) - (mY[b] - mY[a])*(mX[c] - mX[a]);
+
+            if(cross*Target.Winding<=0)
+                continue;
+        }
+
+        double across = 0, squared = 0;
+
+        for(int i=0; i<markers; i++)
+        {
+            for(int j=i + 1; j<markers; j++)
+            {
+                double d = image[order[i]][order[j]];
+
+                across  += d*Target.Distance[i][j];
+                squared += d*d;
+            }
+        }
+
+        if(squared<=0)
+            continue;
+
+        double cost = 1 - across*across/(squared*Target.Distance2Sum);
+
+        //== insert into the sorted best few ==--
+
+        int slot = Pairing.Count;
+
+        while(slot>0 && Pairing.Cost[slot - 1]>cost)
+            slot--;
+
+        if(slot>=kLabelings)
+            continue;
+
+        int last = std::min(Pairing.Count, kLabelings - 1);
+
+        for(int k=last; k>slot; k--)
+        {
+            Pairing.Cost[k] = Pairing.Cost[k - 1];
+
+            for(int m=0; m<markers; m++)
+                Pairing.Labeling[k][m] = Pairing.Labeling[k - 1][m];
+        }
+
+        Pairing.Cost[slot] = cost;
+
+        for(int m=0; m<markers; m++)
+            Pairing.Labeling[slot][m] = Objects[order[m]];
+
+        Pairing.Count = std::min(Pairing.Count + 1, kLabelings);
+    }
+    while(std::next_permutation(order, order + markers));
+}
+
+void cMultiVectorTracker::Acquire()
+{
+    int targetCount = (int) mTargets.size();
+    int clusters    = (int) mClusterStart.size() - 1;
+
+    mPairings.clear();
+
+    for(int c=0; c<clusters; c++)
+    {
+        int size = mClusterStart[c + 1] - mClusterStart[c];
+
+        for(int t=0; t<targetCount; t++)
+        {
+            if(mTargets[t].Tracked || mTargets[t].Markers!=size)
+                continue;
+
+            sPairing pairing;
+
+            pairing.Target  = t;
+            pairing.Cluster = c;
+
+            Label(mTargets[t], &mClusterObjects[mClusterStart[c]], pairing);
+
+            if(pairing.Count>0)
+                mPairings.push_back(pairing);
+        }
+    }
+
+    //== best looking pairs first, each cluster and target taken once ==--
+
+    std::sort(mPairings.begin(), mPairings.end());
+
+    for(size_t p=0; p<mPairings.size(); p++)
+    {
+        const sPairing &pairing = mPairings[p];
+        sTarget        &target  = mTargets[pairing.Target];
+
+        const int *objects = &mClusterObjects[mClusterStart[pairing.Cluster]];
+
+        if(target.Tracked || mClaimed[objects[0]])
+            continue;
+
+        //== the first that solves; three markers nearly always do, more have to fit ==--
+
+        for(int l=0; l<pairing.Count && !target.Tracked; l++)
+        {
+            for(int m=0; m<target.Markers; m++)
+                target.Object[m] = pairing.Labeling[l][m];
+
+            target.Solver.Reset();
+            mStatistics.Labelings++;
+
+            if(Solve(target, false))
+            {
+                mStatistics.Acquired++;
+
+                for(int m=0; m<target.Markers; m++)
+                    mClaimed[objects[m]] = 1;
+            }
+        }
+    }
+}
+
+bool cMultiVectorTracker::Solve(sTarget &Target, bool Followed)
+{
+    float x[kMaxMarkers], y[kMaxMarkers];
+
+    for(int m=0; m<Target.Markers; m++)
+    {
+        x[m] = mX[Target.Object[m]];
+        y[m] = mY[Target.Object[m]];
+    }
+
+    if(!Target.Solver.Solve(x, y, Target.Markers, Target.Result))
+    {
+        Target.Tracked        = false;
+        Target.Result.Markers = 0;
+
+        return false;
+    }
+
+    for(int m=0; m<Target.Markers; m++)
+    {
+        Target.Motion[m][0] = Followed ? x[m] - Target.Image[m][0] : 0.0f;
+        Target.Motion[m][1] = Followed ? y[m] - Target.Image[m][1] : 0.0f;
+        Target.Image[m][0]  = x[m];
+        Target.Image[m][1]  = y[m];
+    }
+
+    Target.Tracked = true;
+
+    return true;
+}
+
+void cMultiVectorTracker::Benchmark(int Targets, int Markers, int Frames, sBenchmark &Result)
+{
+    const double kNoise = 0.05;             //== Pixels ===========================================----
+    const double kFocal = 1000;             //== Pixels, 1280 x 1024 imager =======================----
+
+    Targets = std::max(Targets, 1);
+    Markers = std::max(3, std::min(Markers, 4));
+    Frames  = std::max(Frames, 2);
+
+    Result.Targets = Targets;
+    Result.Markers = Markers;
+
+    //== 9 x 12 x 10 cm triangles, a fourth marker standing 4 cm off them; spread 45 x 35 cm
+    //== apart about 1.5 m out
+
+    double local[4][3] = { { 0, 0, 0 }, { 90, 0, 0 }, { 0, 0, 0 }, { 45, 35, 40 } };
+
+    local[2][0] = (120*120 - 100*100 + 90*90)/(2.0*90);
+    local[2][1] = sqrt(120*120 - local[2][0]*local[2][0]);
+
+    double distances[16];
+
+    for(int i=0; i<Markers; i++)
+    {
+        for(int j=0; j<Markers; j++)
+        {
+            double squared = 0;
+
+            for(int k=0; k<3; k++)
+                squared += (local[i][k] - local[j][k])*(local[i][k] - local[j][k]);
+
+            distances[i*Markers + j] = sqrt(squared);
+        }
+    }
+
+    cVectorPoseSolver::sCamera camera;
+
+    camera.FocalLength = kFocal;
+    camera.PrincipalX  = 640;
+    camera.PrincipalY  = 512;
+
+    sSettings settings;
+
+    settings.LinkRadius   = 90;
+    settings.MotionRadius = 20;
+
+    cMultiVectorTracker tracker;
+    std::vector<cMultiVectorTracker> separate(Targets);
+
+    tracker.SetSettings(settings);
+
+    //== local x and y run with the image's, so the first three wind positive ==--
+
+    for(int t=0; t<Targets; t++)
+    {
+        tracker.AddCustomTarget(Markers, distances, camera, 1);
+
+        separate[t].SetSettings(settings);
+        separate[t].AddCustomTarget(Markers, distances, camera, 1);
+    }
+
+    int columns = (int) ceil(sqrt((double) Targets));
+    int rows    = (Targets + columns - 1)/columns;
+
+    cBenchmarkNoise random(3141592653u);
+
+    std::vector<double> phase(Targets);
+
+    for(int t=0; t<Targets; t++)
+        phase[t] = 6.2831853*random.Uniform();
+
+    //== frames: objects pushed in a shuffled order, remembering whose they are ==--
+
+    int objects = Markers*Targets;
+
+    std::vector<float>  xs(Frames*objects), ys(Frames*objects);
+    std::vector<int>    owner(Frames*objects);              //== Markers * clip + marker ===----
+    std::vector<double> truth(Frames*objects*3);            //== By owner ==================----
+    std::vector<int>    shuffle(objects);
+
+    for(int f=0; f<Frames; f++)
+    {
+        for(int t=0; t<Targets; t++)
+        {
+            double s     = f/120.0 + phase[t];
+            double yaw   = 0.35*sin(0.9*s);
+            double pitch = 0.30*sin(1.3*s + 1);
+            double roll  = 0.40*sin(0.7*s + 2);
+
+            double cy = cos(yaw),   sy = sin(yaw);
+            double cp = cos(pitch), sp = sin(pitch);
+            double cr = cos(roll),  sr = sin(roll);
+
+            double rotation[3][3] = { { cy*cr + sy*sp*sr, -cy*sr + sy*sp*cr, sy*cp },
+                                      { cp*sr,             cp*cr,            -sp    },
+                                      { -sy*cr + cy*sp*sr, sy*sr + cy*sp*cr,  cy*cp } };
+
+            double position[3] = { 450*(t%columns - 0.5*(columns - 1)) + 40*sin(0.5*s) - 50,
+                                   350*(t/columns - 0.5*(rows - 1))    + 40*sin(0.8*s + 1) - 50,
+                                   1500 + 100*sin(0.3*s) };
+
+            for(int m=0; m<Markers; m++)
+            {
+                double *world = &truth[3*(f*objects + Markers*t + m)];
+
+                for(int k=0; k<3; k++)
+                    world[k] = position[k] + rotation[k][0]*local[m][0] + rotation[k][1]*local[m][1] + rotation[k][2]*local[m][2];
+            }
+        }
+
+        for(int o=0; o<objects; o++)
+            shuffle[o] = o;
+
+        for(int o=objects - 1; o>0; o--)
+            std::swap(shuffle[o], shuffle[(int) (random.Uniform()*(o + 1))]);
+
+        for(int o=0; o<objects; o++)
+        {
+            const double *world = &truth[3*(f*objects + shuffle[o])];
+
+            owner[f*objects + o] = shuffle[o];
+            xs[f*objects + o]    = (float) (camera.PrincipalX + kFocal*world[0]/world[2] + kNoise*random.Normal());
+            ys[f*objects + o]    = (float) (camera.PrincipalY + kFocal*world[1]/world[2] + kNoise*random.Normal());
+        }
+    }
+
+    Core::cTimer timer;
+
+    //== all targets in one tracker ==--
+
+    double error      = 0;
+    long   samples    = 0;
+    long   solved     = 0;
+    long   mislabeled = 0;
+    long   mirrored   = 0;
+    double steady     = 0;
+
+    for(int f=0; f<Frames; f++)
+    {
+        timer.CatchUp();
+
+        tracker.BeginFrame();
+
+        for(int o=0; o<objects; o++)
+            tracker.PushMarkerData(xs[f*objects + o], ys[f*objects + o]);
+
+        tracker.Calculate();
+
+        if(f==0)
+            Result.ColdMicroseconds = 1e6*timer.Elapsed();
+        else
+            steady += timer.Elapsed();
+
+        for(int t=0; t<Targets; t++)
+        {
+            if(!tracker.Tracked(t))
+                continue;
+
+            solved++;
+
+            //== labeled right if marker m sits on marker m of one clip ==--
+
+            int  clip    = owner[f*objects + tracker.Object(t, 0)]/Markers;
+            bool labeled = true;
+
+            for(int m=0; m<Markers; m++)
+                labeled = labeled && owner[f*objects + tracker.Object(t, m)]==Markers*clip + m;
+
+            if(!labeled)
+            {
+                mislabeled++;
+                continue;
+            }
+
+            double squared = 0;
+            bool   off     = false;
+
+            for(int m=0; m<Markers; m++)
+            {
+                const double *world  = &truth[3*(f*objects + Markers*clip + m)];
+                double        marker = 0;
+                float         p[3];
+
+                tracker.GetResult(t, m, p[0], p[1], p[2]);
+
+                for(int k=0; k<3; k++)
+                    marker += (p[k] - world[k])*(p[k] - world[k]);
+
+                off      = off || marker>25*25;
+                squared += marker;
+            }
+
+            if(off)
+            {
+                mirrored++;
+                continue;
+            }
+
+            error   += squared;
+            samples += Markers;
+        }
+    }
+
+    Result.MicrosecondsPerFrame = 1e6*steady/(Frames - 1);
+    Result.TrackedFraction      = (double) solved/((double) Frames*Targets);
+    Result.MislabeledFraction   = (solved>0) ? (double) mislabeled/solved : 0.0;
+    Result.OffFraction          = (solved>0) ? (double) mirrored/solved : 0.0;
+    Result.PositionError        = (samples>0) ? sqrt(error/samples) : 0.0;
+
+    //== one tracker per target, every one fed the whole frame ==--
+
+    steady = 0;
+
+    for(int f=0; f<Frames; f++)
+    {
+        timer.CatchUp();
+
+        for(int t=0; t<Targets; t++)
+        {
+            separate[t].BeginFrame();
+
+            for(int o=0; o<objects; o++)
+                separate[t].PushMarkerData(xs[f*objects + o], ys[f*objects + o]);
+
+            separate[t].Calculate();
+        }
+
+        if(f>0)
+            steady += timer.Elapsed();
+    }
+
+    Result.SeparateMicroseconds = 1e6*steady/(Frames - 1);
+}
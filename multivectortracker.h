@@ -0,0 +1,185 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Several clips in one camera's frame, in one pass.  Where running a cModuleVector per clip
+//== pushes every object to every instance and each rescans the whole list, here the frame's
+//== objects are pushed once, bucketed into a hashed grid, and handed out to the targets:
+//==
+//==   - a tracked target's markers each claim the nearest free object to where they are heading
+//==     (last position plus last motion, within MotionRadius)
+//==   - the objects nobody claimed are split into clusters, objects closer than LinkRadius being
+//==     in the same one.  A cluster with as many objects as a lost target has markers is labeled
+//==     by the assignment whose image distances are most nearly a scaled copy of the target's
+//==     (tried best first until one solves), so a target needs to be apart from the rest to be
+//==     acquired, but not to be tracked.  Distances are the same for a clip and its mirror image,
+//==     so three markers tilted a little can look more like another order than their own; given
+//==     the way round its markers run, a target only takes orders that run the same way
+//==
+//== The tracked targets are then solved as one batch with their cVectorPoseSolver.  Targets with
+//== the same distances can only be told apart by continuity: a lost one may come back as any
+//== of them.
+//==
+
+#ifndef __CAMERALIBRARY__MULTIVECTORTRACKER_H__
+#define __CAMERALIBRARY__MULTIVECTORTRACKER_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <vector>
+#include "vectorposesolver.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cVectorSettings;
+
+    class cMultiVectorTracker
+    {
+    public:
+        static const int kMaxMarkers = cVectorPoseSolver::kMaxMarkers;
+
+        struct sSettings
+        {
+            float   LinkRadius;                 //== Largest marker gap inside a clip, pixels ==----
+            float   MotionRadius;               //== Marker travel per frame, pixels ===========----
+        };
+
+        cMultiVectorTracker();
+
+        void    SetSettings(const sSettings &Settings)      { mSettings = Settings; }
+        const sSettings & Settings() const                  { return mSettings; }
+
+        //== Targets: a clip arrangement from its settings or any constellation the solver takes.
+        //== Winding is the sign of (m2 - m1) x (m3 - m1) in the image while the target faces the
+        //== camera, 0 if not known.  Both return the target index, -1 if the solver refused it.
+
+        int     AddTarget(const cVectorSettings &Settings, int Winding = 0);
+        int     AddCustomTarget(int Markers, const double *Distances, const cVectorPoseSolver::sCamera &Camera,
+                                int Winding = 0);
+        void    ClearTargets()                      { mTargets.clear(); }
+        int     TargetCount() const                 { return (int) mTargets.size(); }
+
+        //== As cModuleVector: push a frame's undistorted objects, then Calculate().  Only the
+        //== centroid is used, labeling goes by image distances alone ==--
+
+        void    BeginFrame();
+        void    PushMarkerData(float X, float Y);
+        void    Calculate();
+
+        //== Per target results of the last Calculate() ==--
+
+        bool    Tracked(int Target) const           { return mTargets[Target].Tracked; }
+        int     MarkerCount(int Target) const       { return mTargets[Target].Tracked ? mTargets[Target].Markers : 0; }
+        int     Object(int Target, int Marker) const    { return mTargets[Target].Object[Marker]; }  //== Push order
+
+        void    GetResult(int Target, int Index, float &X, float &Y, float &Z) const;
+        void    Get2DMarker(int Target, int Index, float &X, float &Y) const;
+
+        const cVectorPoseSolver::sResult & Result(int Target) const { return mTargets[Target].Result; }
+
+        void    Reset();                        //== Every target reacquires ===================----
+
+        struct sStatistics
+        {
+            int     Tracked;                    //== Targets followed from last frame ==========----
+            int     Acquired;                   //== Targets found in a cluster ================----
+            int     Clusters;                   //== Of unclaimed objects ======================----
+            int     Labelings;                  //== Cluster labelings tried by solving ========----
+        };
+
+        const sStatistics & Statistics() const      { return mStatistics; }
+
+        //== Targets identical clips of three markers, or four with one off their plane, each
+        //== turning and drifting in its own part of the image with 0.05 px marker noise.  Reports
+        //== the first frame's cost, the steady per frame cost against one single target tracker
+        //== per clip fed the whole frame, and how well the clips were kept.  Three markers can
+        //== be taken for another order or for their mirror tilt; a fourth settles both.
+
+        struct sBenchmark
+        {
+            int     Targets;
+            int     Markers;
+            double  ColdMicroseconds;           //== First frame, everything acquired ==========----
+            double  MicrosecondsPerFrame;
+            double  SeparateMicroseconds;       //== Per frame, one tracker per target =========----
+            double  TrackedFraction;            //== Target frames solved ======================----
+            double  MislabeledFraction;         //== ... on the wrong objects or order =========----
+            double  OffFraction;                //== ... labeled right, off by 25+ mm ==========----
+            double  PositionError;              //== RMS, mm, of the rest ======================----
+        };
+
+        static void Benchmark(int Targets, int Markers, int Frames, sBenchmark &Result);
+
+    private:
+        struct sTarget
+        {
+            cVectorPoseSolver           Solver;
+            int                         Markers;
+            int                         Winding;                    //== Image, 0 unknown =====----
+            double                      Distance[kMaxMarkers][kMaxMarkers];
+            double                      Distance2Sum;
+
+            bool                        Tracked;
+            int                         Object[kMaxMarkers];        //== This frame, -1 none ==----
+            float                       Image[kMaxMarkers][2];      //== Last frame, pixels ===----
+            float                       Motion[kMaxMarkers][2];     //== Pixels per frame =====----
+            cVectorPoseSolver::sResult  Result;
+        };
+
+        static const int kLabelings = 4;    //== Best cluster labelings kept per target ====----
+
+        struct sPairing                     //== A lost target and a cluster of its size ==----
+        {
+            double  Cost[kLabelings];
+            int     Labeling[kLabelings][kMaxMarkers];
+            int     Count;
+            int     Target;
+            int     Cluster;
+
+            bool operator<(const sPairing &Other) const     { return Cost[0]<Other.Cost[0]; }
+        };
+
+        int     Add(const sTarget &Target);
+
+        int     Cell(int X, int Y) const;
+        int     CellCoordinate(float Value) const;
+
+        void    BuildGrid();
+        int     Nearest(float X, float Y, float Radius) const;      //== Unclaimed ==========----
+        int     Root(int Object);
+
+        void    Follow(int Target);
+        void    Cluster();
+        void    Acquire();
+        void    Label(const sTarget &Target, const int *Objects, sPairing &Pairing) const;
+        bool    Solve(sTarget &Target, bool Followed);
+
+        sSettings                   mSettings;
+        sStatistics                 mStatistics;
+        std::vector<sTarget>        mTargets;
+
+        //== This frame ==--
+
+        std::vector<float>          mX;
+        std::vector<float>          mY;
+        std::vector<char>           mClaimed;
+
+        float                       mCellSize;
+        int                         mCellMask;
+        std::vector<int>            mCellStart;         //== Hash bucket -> first slot ======----
+        std::vector<int>            mCellObjects;       //== Ordered by bucket ==============----
+        std::vector<int>            mObjectCell;
+
+        std::vector<int>            mParent;            //== Union find over objects ========----
+        std::vector<int>            mObjectCluster;     //== -1: claimed ====================----
+        std::vector<int>            mClusterStart;      //== Cluster -> first slot ==========----
+        std::vector<int>            mClusterObjects;    //== Ordered by cluster =============----
+        std::vector<sPairing>       mPairings;
+        std::vector<int>            mBatch;             //== Followed targets to solve ======----
+    };
+}
+
+#endif
@@ -0,0 +1,76 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Shared memory layout used by cPosePublisher and cPoseReader.  A header followed by a ring
+//== of slots, each holding one sVectorResults sample guarded by its own sequence lock:
+//==
+//==     writer:  Sequence++ (odd), copy sample, Sequence++ (even), Published++
+//==     reader:  s = Sequence, copy, retry unless s is even and Sequence is still s
+//==
+//== The writer never waits on readers and readers never make system calls, they only load from
+//== the mapping.  This header has no camera library dependencies so consumers can include it
+//== without linking the SDK.
+//==
+
+#ifndef __CAMERALIBRARY__POSEMEMORY_H__
+#define __CAMERALIBRARY__POSEMEMORY_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include "vectorresults.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+//== Ordering between the sequence counter and the sample.  Compiler barriers suffice on x86/x64,
+//== other architectures need a real fence.
+
+#if defined(_MSC_VER) && (defined(_M_ARM) || defined(_M_ARM64))
+#define POSEMEMORY_ACQUIRE() __dmb(_ARM_BARRIER_ISH)
+#define POSEMEMORY_RELEASE() __dmb(_ARM_BARRIER_ISH)
+#elif defined(_MSC_VER)
+#define POSEMEMORY_ACQUIRE() _ReadWriteBarrier()
+#define POSEMEMORY_RELEASE() _ReadWriteBarrier()
+#else
+#define POSEMEMORY_ACQUIRE() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define POSEMEMORY_RELEASE() __atomic_thread_fence(__ATOMIC_RELEASE)
+#endif
+
+namespace CameraLibrary
+{
+    const unsigned int kPoseMemoryMagic      = 0x45534F50;  //== "POSE" ======================----
+    const unsigned int kPoseMemoryVersion    = 1;
+    const unsigned int kPoseMemoryHeaderSize = 64;
+    const unsigned int kPoseMemoryAlignment  = 64;           //== Slots start on cache lines =----
+
+    struct sPoseMemoryHeader
+    {
+        volatile unsigned int Magic;            //== Written last, once the rest is valid =====----
+        unsigned int          Version;
+        unsigned int          HeaderSize;       //== Offset of slot 0 =========================----
+        unsigned int          SlotSize;         //== Stride between slots =====================----
+        unsigned int          SlotCount;
+        unsigned int          SampleSize;       //== sizeof(sVectorResults) of the writer =====----
+        volatile unsigned int Published;        //== Samples written, latest is Published-1 ===----
+        unsigned int          WriterProcess;
+    };
+
+    struct sPoseMemorySlot
+    {
+        volatile unsigned int Sequence;         //== Odd while the slot is being written =======----
+        unsigned int          Index;            //== Published count this sample was written at -
+        sVectorResults        Sample;           //== SampleSize bytes of it are valid ==========----
+    };
+
+    inline unsigned int PoseMemorySlotSize()
+    {
+        return (unsigned int) ((sizeof(sPoseMemorySlot) + kPoseMemoryAlignment-1) & ~(kPoseMemoryAlignment-1));
+    }
+}
+
+#endif
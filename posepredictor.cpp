@@ -0,0 +1,309 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <math.h>
+#include <vector>
+
+#include "posepredictor.h"
+#include "frame.h"
+#include "Core/Timer.h"
+#include "Core/RotationVector.h"
+
+using namespace CameraLibrary;
+
+cPosePredictor::cPosePredictor(int History)
+    : mHistory(6)
+    , mMaxPrediction(0.1)
+    , mMaxGap(0.25)
+{
+    SetHistory(History);
+    Reset();
+}
+
+void cPosePredictor::SetHistory(int Samples)
+{
+    mHistory = (Samples<2) ? 2 : (Samples>kMaxHistory) ? kMaxHistory : Samples;
+
+    Reset();
+}
+
+void cPosePredictor::SetMaxPrediction(double Seconds)
+{
+    mMaxPrediction = (Seconds<0) ? 0 : Seconds;
+}
+
+void cPosePredictor::SetMaxGap(double Seconds)
+{
+    mMaxGap = Seconds;
+}
+
+void cPosePredictor::Reset()
+{
+    mCount  = 0;
+    mLatest = 0;
+
+    for(int i=0; i<3; i++)
+    {
+        mVelocity[i]        = 0;
+        mAngularVelocity[i] = 0;
+    }
+}
+
+double cPosePredictor::FrameTime(Frame *Frame, bool HardwareClock)
+{
+    if(HardwareClock && Frame->IsHardwareTimeStamp() && Frame->HardwareTimeFreq()>0)
+        return (double) Frame->HardwareTimeStamp()/Frame->HardwareTimeFreq();
+
+    return Frame->TimeStamp();
+}
+
+void cPosePredictor::AddSample(double TimeStamp, const double Position[3], const double Quaternion[4])
+{
+    if(mCount>0)
+    {
+        double gap = TimeStamp - mTime[mLatest];
+
+        //== repeated frame, nothing new to learn ==--
+
+        if(gap==0)
+            return;
+
+        //== time went backwards or tracking dropped out, old motion no longer applies ==--
+
+        if(gap<0 || gap>mMaxGap)
+            Reset();
+    }
+
+    mLatest = (mCount==0) ? 0 : (mLatest+1)%mHistory;
+
+    if(mCount<mHistory)
+        mCount++;
+
+    mTime[mLatest] = TimeStamp;
+
+    for(int i=0; i<3; i++)
+        mPosition[mLatest][i] = Position[i];
+
+    for(int i=0; i<4; i++)
+        mQuaternion[mLatest][i] = Quaternion[i];
+
+    Core::NormalizeQuaternion(mQuaternion[mLatest]);
+
+    Fit();
+}
+
+void cPosePredictor::AddSample(const sVectorResults &Results)
+{
+    AddSample(Results.TimeStamp, Results.Position, Results.Quaternion);
+}
+
+bool cPosePredictor::AddSample(cModuleVectorProcessing *Processor, Frame *Frame)
+{
+    sVectorResults results;
+
+    bool complete = ExportResults(Processor, &results, Frame->FrameID(), FrameTime(Frame));
+
+    AddSample(results);
+
+    return complete;
+}
+
+void cPosePredictor::Fit()
+{
+    for(int i=0; i<3; i++)
+    {
+        mVelocity[i]        = 0;
+        mAngularVelocity[i] = 0;
+    }
+
+    if(mCount<2)
+        return;
+
+    //== times relative to the latest sample, rotations as rotation vectors relative to it
+    //== too, so the latest sample sits at the origin of both fits ==--
+
+    const double *latest = mQuaternion[mLatest];
+
+    double inverse[4] = { -latest[0], -latest[1], -latest[2], latest[3] };
+
+    double t[kMaxHistory];
+    double r[kMaxHistory][3];
+    double meanT    = 0;
+    double meanP[3] = { 0, 0, 0 };
+    double meanR[3] = { 0, 0, 0 };
+
+    for(int n=0; n<mCount; n++)
+    {
+        int slot = (mLatest + mHistory - n)%mHistory;
+
+        double relative[4];
+
+        Core::MultiplyQuaternions(mQuaternion[slot], inverse, relative);
+        Core::QuaternionToRotationVector(relative, r[n]);
+
+        t[n]   = mTime[slot] - mTime[mLatest];
+        meanT += t[n];
+
+        for(int i=0; i<3; i++)
+        {
+            meanP[i] += mPosition[slot][i];
+            meanR[i] += r[n][i];
+        }
+    }
+
+    double scale = 1.0/mCount;
+
+    meanT *= scale;
+
+    for(int i=0; i<3; i++)
+    {
+        meanP[i] *= scale;
+        meanR[i] *= scale;
+    }
+
+    double varianceT = 0;
+    double covarianceP[3] = { 0, 0, 0 };
+    double covarianceR[3] = { 0, 0, 0 };
+
+    for(int n=0; n<mCount; n++)
+    {
+        int    slot = (mLatest + mHistory - n)%mHistory;
+        double dt   = t[n] - meanT;
+
+        varianceT += dt*dt;
+
+        for(int i=0; i<3; i++)
+        {
+            covarianceP[i] += dt*(mPosition[slot][i] - meanP[i]);
+            covarianceR[i] += dt*(r[n][i] - meanR[i]);
+        }
+    }
+
+    if(varianceT<1e-18)
+        return;
+
+    for(int i=0; i<3; i++)
+    {
+        mVelocity[i]        = covarianceP[i]/varianceT;
+        mAngularVelocity[i] = covarianceR[i]/varianceT;
+    }
+}
+
+bool cPosePredictor::Predict(double TimeStamp, double Position[3], double Quaternion[4]) const
+{
+    if(mCount==0)
+        return false;
+
+    double dt = TimeStamp - mTime[mLatest];
+
+    if(dt> mMaxPrediction) dt =  mMaxPrediction;
+    if(dt<-mMaxPrediction) dt = -mMaxPrediction;
+
+    for(int i=0; i<3; i++)
+        Position[i] = mPosition[mLatest][i] + mVelocity[i]*dt;
+
+    double rotation[3] = { mAngularVelocity[0]*dt, mAngularVelocity[1]*dt, mAngularVelocity[2]*dt };
+    double delta[4];
+
+    Core::RotationVectorToQuaternion(rotation, delta);
+    Core::MultiplyQuaternions(delta, mQuaternion[mLatest], Quaternion);
+
+    return true;
+}
+
+void cPosePredictor::Velocity(double Velocity[3]) const
+{
+    for(int i=0; i<3; i++)
+        Velocity[i] = mVelocity[i];
+}
+
+void cPosePredictor::AngularVelocity(double Velocity[3]) const
+{
+    for(int i=0; i<3; i++)
+        Velocity[i] = mAngularVelocity[i];
+}
+
+void cPosePredictor::Benchmark(int Iterations, double Horizon, sBenchmark &Result)
+{
+    const double rate     = 1.0/240.0;
+    const double linear[3]  = { 0.3, 0.1, -0.2 };
+    const double angular[3] = { 0.5, 2.0, -1.0 };
+    const double start[4]   = { 0.1, 0.2, 0.3, 0.927 };
+
+    if(Iterations<1)
+        Iterations = 1;
+
+    cPosePredictor predictor;
+    Core::cTimer   timer;
+
+    double position[3];
+    double quaternion[4];
+    double rotation[3];
+    double delta[4];
+
+    //== motion is generated up front so only AddSample() is timed ==--
+
+    std::vector<double> samples(Iterations*7);
+
+    for(int i=0; i<Iterations; i++)
+    {
+        double  t      = i*rate;
+        double *sample = &samples[i*7];
+
+        for(int k=0; k<3; k++)
+        {
+            sample[k]   = linear[k]*t;
+            rotation[k] = angular[k]*t;
+        }
+
+        Core::RotationVectorToQuaternion(rotation, delta);
+        Core::MultiplyQuaternions(delta, start, sample+3);
+    }
+
+    timer.CatchUp();
+
+    for(int i=0; i<Iterations; i++)
+        predictor.AddSample(i*rate, &samples[i*7], &samples[i*7+3]);
+
+    double sampleSeconds = timer.Elapsed();
+
+    double          latest = predictor.LatestTime();
+    volatile double sink   = 0;
+
+    timer.CatchUp();
+
+    for(int i=0; i<Iterations; i++)
+    {
+        predictor.Predict(latest + Horizon*(i&7)*0.125, position, quaternion);
+        sink += position[0] + quaternion[3];
+    }
+
+    double querySeconds = timer.Elapsed();
+
+    //== compare against the true motion Horizon seconds after the last sample ==--
+
+    double t = latest + Horizon;
+
+    predictor.Predict(t, position, quaternion);
+
+    double positionError = 0;
+
+    for(int k=0; k<3; k++)
+    {
+        double error = position[k] - linear[k]*t;
+        positionError += error*error;
+        rotation[k] = angular[k]*t;
+    }
+
+    double truth[4];
+
+    Core::RotationVectorToQuaternion(rotation, delta);
+    Core::MultiplyQuaternions(delta, start, truth);
+    Core::NormalizeQuaternion(truth);
+
+    Result.NanosecondsPerSample = 1e9*sampleSeconds/Iterations;
+    Result.NanosecondsPerQuery  = 1e9*querySeconds/Iterations;
+    Result.PositionError        = sqrt(positionError);
+    Result.RotationErrorDegrees = Core::QuaternionAngle(truth, quaternion)*180.0/3.14159265358979;
+}
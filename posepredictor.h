@@ -0,0 +1,96 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Extrapolates the vector processing pose to a later time, e.g. when the next display refresh
+//== will show it, to hide the latency of the camera, tracking and rendering pipeline.
+//==
+//== Every AddSample() fits linear and angular velocity by least squares over the last few
+//== samples (angular velocity from the rotation vectors of each orientation relative to the
+//== latest one, i.e. the quaternion derivative), so Predict() is only a constant time
+//== extrapolation from the latest sample:
+//==
+//==     position(t)    = position + velocity * dt
+//==     quaternion(t)  = exp(angular velocity * dt / 2) * quaternion
+//==
+//== Timestamps are seconds in whichever time base the samples use.  FrameTime() returns
+//== Frame::TimeStamp(), the host clock the publisher and streamer also stamp poses with; the
+//== camera's hardware clock is only used when asked for and present.  Predict() must be asked
+//== for a time in that same base.
+//==
+
+#ifndef __CAMERALIBRARY__POSEPREDICTOR_H__
+#define __CAMERALIBRARY__POSEPREDICTOR_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include "vectorresults.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class Frame;
+    class cModuleVectorProcessing;
+
+    class cPosePredictor
+    {
+    public:
+        static const int kMaxHistory = 16;
+
+        cPosePredictor(int History = 6);
+
+        void    SetHistory(int Samples);                    //== 2 - kMaxHistory ==============----
+        void    SetMaxPrediction(double Seconds);           //== Extrapolation limit, 0.1s ====----
+        void    SetMaxGap(double Seconds);                  //== Restart after dropouts, 0.25s -
+        void    Reset();
+
+        void    AddSample(double TimeStamp, const double Position[3], const double Quaternion[4]);
+        void    AddSample(const sVectorResults &Results);
+        bool    AddSample(cModuleVectorProcessing *Processor, Frame *Frame);
+
+        static double FrameTime(Frame *Frame, bool HardwareClock = false);  //== Seconds =======----
+
+        //== Pose at TimeStamp, false until a sample was added ==--
+
+        bool    Predict(double TimeStamp, double Position[3], double Quaternion[4]) const;
+
+        int     SampleCount() const                 { return mCount; }
+        double  LatestTime() const                  { return mCount ? mTime[mLatest] : 0.0; }
+
+        void    Velocity(double Velocity[3]) const;                 //== Units per second ====----
+        void    AngularVelocity(double Velocity[3]) const;          //== Radians per second, world
+
+        //== Cost of AddSample() and Predict() plus the error predicting Horizon seconds ahead
+        //== on a synthetic, constant velocity motion.
+
+        struct sBenchmark
+        {
+            double NanosecondsPerSample;
+            double NanosecondsPerQuery;
+            double PositionError;
+            double RotationErrorDegrees;
+        };
+
+        static void Benchmark(int Iterations, double Horizon, sBenchmark &Result);
+
+    private:
+        void    Fit();
+
+        int     mHistory;
+        int     mCount;
+        int     mLatest;                        //== Ring index of the newest sample ===========----
+        double  mMaxPrediction;
+        double  mMaxGap;
+
+        double  mTime[kMaxHistory];
+        double  mPosition[kMaxHistory][3];
+        double  mQuaternion[kMaxHistory][4];    //== x, y, z, w ================================----
+
+        double  mVelocity[3];
+        double  mAngularVelocity[3];
+    };
+}
+
+#endif
@@ -0,0 +1,403 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sched.h>
+#include <errno.h>
+#endif
+#include <string.h>
+
+#include "posepublisher.h"
+#include "posereader.h"
+#include "threading.h"
+#include "Core/Timer.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    bool IsRunning(unsigned int Process)
+    {
+#ifdef WIN32
+        HANDLE handle = OpenProcess(SYNCHRONIZE, FALSE, (DWORD) Process);
+
+        if(handle==0)
+            return GetLastError()==ERROR_ACCESS_DENIED;
+
+        bool running = (WaitForSingleObject(handle, 0)==WAIT_TIMEOUT);
+
+        CloseHandle(handle);
+
+        return running;
+#else
+        return kill((pid_t) Process, 0)==0 || errno==EPERM;
+#endif
+    }
+
+    //== A publisher owns its header from creation until Close() clears the magic.  No writer
+    //== process yet means one is still setting the header up, which counts as owned too.
+
+    bool IsOwned(const sPoseMemoryHeader *Header)
+    {
+        unsigned int process = Header->WriterProcess;
+
+        if(Header->Magic!=kPoseMemoryMagic)
+            return process==0;
+
+        return IsRunning(process);
+    }
+
+#ifndef WIN32
+    bool IsOwned(const char *Name)
+    {
+        int descriptor = shm_open(Name, O_RDONLY, 0);
+
+        if(descriptor<0)
+            return errno!=ENOENT;
+
+        struct stat status;
+        bool owned = true;
+
+        if(fstat(descriptor, &status)==0 && status.st_size>=(off_t) kPoseMemoryHeaderSize)
+        {
+            void *mapping = mmap(0, kPoseMemoryHeaderSize, PROT_READ, MAP_SHARED, descriptor, 0);
+
+            if(mapping!=MAP_FAILED)
+            {
+                owned = IsOwned((const sPoseMemoryHeader*) mapping);
+                munmap(mapping, kPoseMemoryHeaderSize);
+            }
+        }
+
+        close(descriptor);
+
+        return owned;
+    }
+#endif
+
+    void YieldThread()
+    {
+#ifdef WIN32
+        SwitchToThread();
+#else
+        sched_yield();
+#endif
+    }
+}
+
+cPosePublisher::cPosePublisher()
+    : mHeader(0)
+    , mMappingSize(0)
+#ifdef WIN32
+    , mMapping(0)
+#endif
+{
+}
+
+cPosePublisher::~cPosePublisher()
+{
+    Close();
+}
+
+bool cPosePublisher::Open(const char *Name, int SlotCount)
+{
+    Close();
+
+    if(Name==0 || Name[0]==0 || SlotCount<1)
+        return false;
+
+    mMappingSize = kPoseMemoryHeaderSize + (size_t) SlotCount*PoseMemorySlotSize();
+
+#ifdef WIN32
+    mName = Name;
+
+    mMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, 0, (DWORD) mMappingSize, Name);
+
+    if(mMapping==0)
+        return false;
+
+    //== readers keep a mapping alive after its publisher, which is then free to take over ==--
+
+    bool existed = (GetLastError()==ERROR_ALREADY_EXISTS);
+
+    mHeader = (sPoseMemoryHeader*) MapViewOfFile(mMapping, FILE_MAP_ALL_ACCESS, 0, 0, mMappingSize);
+
+    if(mHeader==0 || (existed && IsOwned(mHeader)))
+    {
+        if(mHeader)
+            UnmapViewOfFile(mHeader);
+
+        CloseHandle(mMapping);
+        mHeader  = 0;
+        mMapping = 0;
+        return false;
+    }
+
+    unsigned int process = (unsigned int) GetCurrentProcessId();
+#else
+    mName = (Name[0]=='/') ? Name : std::string("/") + Name;
+
+    int descriptor = shm_open(mName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+
+    //== start over only if the publisher that left the name behind is gone ==--
+
+    if(descriptor<0 && errno==EEXIST && !IsOwned(mName.c_str()))
+    {
+        shm_unlink(mName.c_str());
+        descriptor = shm_open(mName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+
+    if(descriptor<0)
+        return false;
+
+    void *mapping = MAP_FAILED;
+
+    if(ftruncate(descriptor, (off_t) mMappingSize)==0)
+        mapping = mmap(0, mMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+
+    close(descriptor);
+
+    if(mapping==MAP_FAILED)
+    {
+        shm_unlink(mName.c_str());
+        return false;
+    }
+
+    mHeader = (sPoseMemoryHeader*) mapping;
+
+    unsigned int process = (unsigned int) getpid();
+#endif
+
+    //== readers only trust the header once the magic is in place ==--
+
+    mHeader->Magic = 0;
+
+    POSEMEMORY_RELEASE();
+
+    memset((unsigned char*) mHeader + sizeof(unsigned int), 0, mMappingSize - sizeof(unsigned int));
+
+    mHeader->Version       = kPoseMemoryVersion;
+    mHeader->HeaderSize    = kPoseMemoryHeaderSize;
+    mHeader->SlotSize      = PoseMemorySlotSize();
+    mHeader->SlotCount     = (unsigned int) SlotCount;
+    mHeader->SampleSize    = sizeof(sVectorResults);
+    mHeader->Published     = 0;
+    mHeader->WriterProcess = process;
+
+    POSEMEMORY_RELEASE();
+
+    mHeader->Magic = kPoseMemoryMagic;
+
+    return true;
+}
+
+void cPosePublisher::Close()
+{
+    if(mHeader==0)
+        return;
+
+    mHeader->Magic = 0;
+
+#ifdef WIN32
+    UnmapViewOfFile(mHeader);
+    CloseHandle(mMapping);
+    mMapping = 0;
+#else
+    munmap(mHeader, mMappingSize);
+    shm_unlink(mName.c_str());
+#endif
+
+    mHeader      = 0;
+    mMappingSize = 0;
+}
+
+sPoseMemorySlot * cPosePublisher::Slot(unsigned int Index) const
+{
+    unsigned char *base = (unsigned char*) mHeader + mHeader->HeaderSize;
+
+    return (sPoseMemorySlot*) (base + (size_t) (Index % mHeader->SlotCount) * mHeader->SlotSize);
+}
+
+void cPosePublisher::Publish(const sVectorResults &Sample)
+{
+    if(mHeader==0)
+        return;
+
+    unsigned int     index = mHeader->Published;
+    sPoseMemorySlot *slot  = Slot(index);
+
+    unsigned int sequence = slot->Sequence;
+
+    slot->Sequence = sequence+1;
+
+    POSEMEMORY_RELEASE();
+
+    slot->Index = index;
+    memcpy(&slot->Sample, &Sample, sizeof(sVectorResults));
+
+    POSEMEMORY_RELEASE();
+
+    slot->Sequence = sequence+2;
+
+    POSEMEMORY_RELEASE();
+
+    mHeader->Published = index+1;
+}
+
+bool cPosePublisher::Publish(cModuleVectorProcessing *Processor, int FrameID, double TimeStamp)
+{
+    sVectorResults sample;
+
+    bool complete = ExportResults(Processor, &sample, FrameID, TimeStamp);
+
+    Publish(sample);
+
+    return complete;
+}
+
+//== Benchmark =========================================================================================----
+
+namespace
+{
+    struct sLatencyReader
+    {
+        cPoseReader           Reader;
+        const Core::cTimer *  Timer;
+        ThreadInfo            Thread;
+        volatile bool         Running;
+
+        int                   Seen;
+        volatile int          LastFrame;
+        double                LatencySum;
+        double                LatencyMax;
+    };
+
+    void ReadLatency(sLatencyReader *Reader)
+    {
+        sVectorResults sample;
+        unsigned int   published = 0;
+
+        while(Reader->Running && Reader->Thread.IsSteadyState())
+        {
+            if(Reader->Reader.Published()==published || !Reader->Reader.Latest(sample))
+            {
+                YieldThread();
+                continue;
+            }
+
+            double latency = Reader->Timer->Elapsed() - sample.TimeStamp;
+
+            published = (unsigned int) sample.FrameID + 1;
+
+            Reader->LastFrame   = sample.FrameID;
+            Reader->LatencySum += latency;
+            Reader->LatencyMax  = (latency>Reader->LatencyMax) ? latency : Reader->LatencyMax;
+            Reader->Seen++;
+        }
+
+        Reader->Thread.mThreadRunning = false;
+    }
+
+#ifdef WIN32
+    unsigned long __stdcall ReadLatencyProc(void *Param)
+    {
+        ReadLatency((sLatencyReader*) Param);
+        return 0;
+    }
+#else
+    void ReadLatencyProc(void *Param)
+    {
+        ReadLatency((sLatencyReader*) Param);
+    }
+#endif
+}
+
+bool cPosePublisher::Benchmark(const char *Name, int Frames, double Interval, sBenchmark &Result)
+{
+    memset(&Result, 0, sizeof(Result));
+
+    cPosePublisher publisher;
+
+    if(!publisher.Open(Name, 256))
+        return false;
+
+    Core::cTimer   timer;
+    sLatencyReader reader;
+
+    reader.Timer      = &timer;
+    reader.Running    = true;
+    reader.Seen       = 0;
+    reader.LastFrame  = -1;
+    reader.LatencySum = 0;
+    reader.LatencyMax = 0;
+
+    if(!reader.Reader.Open(Name))
+        return false;
+
+#ifdef WIN32
+    reader.Thread.StartThread((void*) ReadLatencyProc, &reader);
+#else
+    reader.Thread.StartThread(ReadLatencyProc, &reader);
+#endif
+
+    sVectorResults sample;
+
+    memset(&sample, 0, sizeof(sample));
+
+    sample.Version     = kVectorResultsVersion;
+    sample.Size        = sizeof(sVectorResults);
+    sample.MarkerCount = 3;
+
+    double publishing = 0;
+
+    for(int i=0; i<Frames; i++)
+    {
+        //== pace like a camera would, leaving the reader the processor meanwhile ==--
+
+        while(Interval>0 && timer.Elapsed()<i*Interval)
+            YieldThread();
+
+        sample.FrameID   = i;
+        sample.TimeStamp = timer.Elapsed();
+
+        publisher.Publish(sample);
+
+        publishing += timer.Elapsed() - sample.TimeStamp;
+    }
+
+    //== let the reader catch the last one ==--
+
+    double finish = timer.Elapsed();
+
+    while(reader.LastFrame!=Frames-1 && timer.Elapsed()-finish<0.1)
+        YieldThread();
+
+    reader.Running = false;
+    reader.Thread.StopThread();
+
+    const int kReads = 100000;
+
+    Core::cTimer reading;
+
+    for(int i=0; i<kReads; i++)
+        reader.Reader.Latest(sample);
+
+    double seconds = reading.Elapsed();
+
+    Result.SamplesPublished        = Frames;
+    Result.SamplesSeen             = reader.Seen;
+    Result.MeanLatencyMicroseconds = (reader.Seen>0) ? 1e6*reader.LatencySum/reader.Seen : 0.0;
+    Result.MaxLatencyMicroseconds  = 1e6*reader.LatencyMax;
+    Result.PublishNanoseconds      = (Frames>0) ? 1e9*publishing/Frames : 0.0;
+    Result.LatestNanoseconds       = 1e9*seconds/kReads;
+
+    return true;
+}
@@ -0,0 +1,75 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Publishes vector processing results to other processes through named shared memory (POSIX
+//== shm_open on Linux, a named file mapping on Windows) in the layout described in posememory.h.
+//== Readers link cPoseReader only, not the camera library.
+//==
+//== Publish() is wait-free and meant to be called once per frame from the tracking thread.
+//==
+//== A name belongs to the publisher that created it.  Open() fails while that publisher's process
+//== is running, and only takes the name over when it was closed or its process has gone, so a
+//== second tracker can't pull the mapping from under the readers of the first.
+//==
+
+#ifndef __CAMERALIBRARY__POSEPUBLISHER_H__
+#define __CAMERALIBRARY__POSEPUBLISHER_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <string>
+#include "posememory.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cModuleVectorProcessing;
+
+    class cPosePublisher
+    {
+    public:
+        cPosePublisher();
+        ~cPosePublisher();
+
+        bool    Open(const char *Name, int SlotCount = 256);    //== False while Name is owned =----
+        void    Close();                                        //== Removes the name ==========----
+        bool    IsOpen() const                      { return mHeader!=0; }
+
+        void    Publish(const sVectorResults &Sample);
+        bool    Publish(cModuleVectorProcessing *Processor, int FrameID, double TimeStamp);
+
+        unsigned int Published() const             { return mHeader ? mHeader->Published : 0; }
+
+        //== Publishes Frames samples under Name every Interval seconds while another thread reads
+        //== them back through cPoseReader, polling Latest() the way a consumer would.  Latency is
+        //== from Publish() until the reader holds the sample.
+
+        struct sBenchmark
+        {
+            int     SamplesPublished;
+            int     SamplesSeen;                //== Distinct samples the reader caught ========----
+            double  MeanLatencyMicroseconds;
+            double  MaxLatencyMicroseconds;
+            double  PublishNanoseconds;         //== Per Publish() =============================----
+            double  LatestNanoseconds;          //== Per Latest(), no writer running ===========----
+        };
+
+        static bool Benchmark(const char *Name, int Frames, double Interval, sBenchmark &Result);
+
+    private:
+        sPoseMemorySlot * Slot(unsigned int Index) const;
+
+        sPoseMemoryHeader * mHeader;
+        size_t              mMappingSize;
+        std::string         mName;
+
+#ifdef WIN32
+        void *              mMapping;
+#endif
+    };
+}
+
+#endif
@@ -0,0 +1,232 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <string.h>
+#include <string>
+
+#include "posereader.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    const int kReadAttempts = 16;
+}
+
+cPoseReader::cPoseReader()
+    : mHeader(0)
+    , mMappingSize(0)
+#ifdef WIN32
+    , mMapping(0)
+#endif
+{
+}
+
+cPoseReader::~cPoseReader()
+{
+    Close();
+}
+
+bool cPoseReader::Open(const char *Name)
+{
+    Close();
+
+    if(Name==0 || Name[0]==0)
+        return false;
+
+#ifdef WIN32
+    mMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, Name);
+
+    if(mMapping==0)
+        return false;
+
+    mHeader = (const sPoseMemoryHeader*) MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+
+    if(mHeader==0)
+    {
+        CloseHandle(mMapping);
+        mMapping = 0;
+        return false;
+    }
+
+    MEMORY_BASIC_INFORMATION info;
+
+    mMappingSize = VirtualQuery(mHeader, &info, sizeof(info)) ? (size_t) info.RegionSize : 0;
+#else
+    std::string name = (Name[0]=='/') ? Name : std::string("/") + Name;
+
+    int descriptor = shm_open(name.c_str(), O_RDONLY, 0);
+
+    if(descriptor<0)
+        return false;
+
+    struct stat status;
+    void *mapping = MAP_FAILED;
+
+    if(fstat(descriptor, &status)==0 && status.st_size>=(off_t) kPoseMemoryHeaderSize)
+    {
+        mMappingSize = (size_t) status.st_size;
+        mapping      = mmap(0, mMappingSize, PROT_READ, MAP_SHARED, descriptor, 0);
+    }
+
+    close(descriptor);
+
+    if(mapping==MAP_FAILED)
+        return false;
+
+    mHeader = (const sPoseMemoryHeader*) mapping;
+#endif
+
+    //== reject mappings that are half initialized or laid out differently ==--
+
+    bool valid = (mHeader->Magic==kPoseMemoryMagic);
+
+    POSEMEMORY_ACQUIRE();
+
+    valid = valid && mHeader->Version==kPoseMemoryVersion
+                  && mHeader->HeaderSize>=sizeof(sPoseMemoryHeader)
+                  && mHeader->SlotSize>=offsetof(sPoseMemorySlot, Sample) + mHeader->SampleSize
+                  && mHeader->SlotCount>0
+                  && mHeader->HeaderSize + (size_t) mHeader->SlotCount*mHeader->SlotSize<=mMappingSize;
+
+    if(!valid)
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void cPoseReader::Close()
+{
+    if(mHeader==0)
+        return;
+
+#ifdef WIN32
+    UnmapViewOfFile(mHeader);
+    CloseHandle(mMapping);
+    mMapping = 0;
+#else
+    munmap((void*) mHeader, mMappingSize);
+#endif
+
+    mHeader      = 0;
+    mMappingSize = 0;
+}
+
+const sPoseMemorySlot * cPoseReader::Slot(unsigned int Index) const
+{
+    const unsigned char *base = (const unsigned char*) mHeader + mHeader->HeaderSize;
+
+    return (const sPoseMemorySlot*) (base + (size_t) (Index % mHeader->SlotCount) * mHeader->SlotSize);
+}
+
+bool cPoseReader::Read(unsigned int Index, sVectorResults &Sample) const
+{
+    if(mHeader==0)
+        return false;
+
+    const sPoseMemorySlot *slot = Slot(Index);
+
+    //== samples from an older writer are shorter, the missing tail reads as zero ==--
+
+    size_t size = mHeader->SampleSize;
+
+    if(size>sizeof(sVectorResults))
+        size = sizeof(sVectorResults);
+
+    for(int attempt=0; attempt<kReadAttempts; attempt++)
+    {
+        unsigned int sequence = slot->Sequence;
+
+        if(sequence & 1)
+            continue;
+
+        POSEMEMORY_ACQUIRE();
+
+        unsigned int index = slot->Index;
+
+        memcpy(&Sample, (const void*) &slot->Sample, size);
+
+        POSEMEMORY_ACQUIRE();
+
+        if(slot->Sequence!=sequence)
+            continue;
+
+        if(index!=Index || sequence==0)
+            return false;                   //== Overwritten by a newer sample or never written -
+
+        if(size<sizeof(sVectorResults))
+            memset((unsigned char*) &Sample + size, 0, sizeof(sVectorResults) - size);
+
+        return true;
+    }
+
+    return false;
+}
+
+bool cPoseReader::Latest(sVectorResults &Sample) const
+{
+    if(mHeader==0)
+        return false;
+
+    for(int attempt=0; attempt<kReadAttempts; attempt++)
+    {
+        unsigned int published = mHeader->Published;
+
+        if(published==0)
+            return false;
+
+        POSEMEMORY_ACQUIRE();
+
+        //== the writer may have lapped the ring meanwhile, then start over from the new latest ==--
+
+        if(Read(published-1, Sample))
+            return true;
+    }
+
+    return false;
+}
+
+int cPoseReader::History(sVectorResults *Samples, int MaxCount) const
+{
+    if(mHeader==0 || Samples==0 || MaxCount<=0)
+        return 0;
+
+    unsigned int published = mHeader->Published;
+
+    POSEMEMORY_ACQUIRE();
+
+    //== leave the slot the writer fills next alone, it is the most likely to be torn ==--
+
+    unsigned int available = published;
+
+    if(available>mHeader->SlotCount-1)
+        available = mHeader->SlotCount-1;
+
+    if(available==0 && published>0)
+        available = 1;
+
+    if(available>(unsigned int) MaxCount)
+        available = (unsigned int) MaxCount;
+
+    int count = 0;
+
+    for(unsigned int index=published-available; index!=published; index++)
+    {
+        if(Read(index, Samples[count]))
+            count++;
+    }
+
+    return count;
+}
@@ -0,0 +1,68 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Out-of-process reader for poses published by cPosePublisher.  Only depends on posememory.h,
+//== consumers compile posereader.cpp into their own application and never link the camera
+//== library.
+//==
+//== Open() maps the shared memory once, after that every read is a handful of loads and a copy
+//== from the mapping: no system calls, no locks, and the publisher is never blocked.  A read
+//== that races the writer retries, and gives up after a few attempts rather than spinning.
+//==
+
+#ifndef __CAMERALIBRARY__POSEREADER_H__
+#define __CAMERALIBRARY__POSEREADER_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <stddef.h>
+#include "posememory.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cPoseReader
+    {
+    public:
+        cPoseReader();
+        ~cPoseReader();
+
+        bool    Open(const char *Name);         //== False until a publisher has created it ====----
+        void    Close();
+        bool    IsOpen() const                  { return mHeader!=0; }
+
+        //== True while the publisher that was opened is still publishing ==--
+
+        bool    IsLive() const                  { return mHeader!=0 && mHeader->Magic==kPoseMemoryMagic; }
+
+        unsigned int Published() const         { return mHeader ? mHeader->Published : 0; }
+        unsigned int SlotCount() const         { return mHeader ? mHeader->SlotCount : 0; }
+
+        //== Most recent sample, false when nothing was published or the writer kept the slot busy
+
+        bool    Latest(sVectorResults &Sample) const;
+
+        //== Sample written at Published count Index, false once it was overwritten ==--
+
+        bool    Read(unsigned int Index, sVectorResults &Sample) const;
+
+        //== Up to MaxCount most recent samples, oldest first.  Returns the number copied.
+
+        int     History(sVectorResults *Samples, int MaxCount) const;
+
+    private:
+        const sPoseMemorySlot * Slot(unsigned int Index) const;
+
+        const sPoseMemoryHeader * mHeader;
+        size_t                    mMappingSize;
+
+#ifdef WIN32
+        void *                    mMapping;
+#endif
+    };
+}
+
+#endif
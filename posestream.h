@@ -0,0 +1,56 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== UDP pose stream wire format shared by cPoseStreamer and cPoseStreamClient.  All fields are
+//== little-endian and unaligned, datagrams stay below one Ethernet MTU so they never fragment.
+//==
+//==     datagram   Magic u32, Version u8, FrameCount u8, Reserved u16, Sequence u32    12 bytes
+//==     frame      FrameID i32, TimeStamp f64, PoseCount u16, Flags u16              16 bytes
+//==     pose       ID u32, Position f32 x3, Rotation i16 x3, Flags u8, Error u8      24 bytes
+//==
+//== Rotations use "smallest three" quaternion compression: the largest component is dropped
+//== (its index goes into the pose flags, sign made positive) and the other three, which lie in
+//== +-1/sqrt(2), are stored as 16-bit fixed point.  A frame with more poses than fit into the
+//== remaining datagram is split: the part with kPoseStreamFrameSplit set continues with the
+//== next frame record (same FrameID) at the start of the next datagram.
+//==
+//== Sequence counts datagrams per streamer so receivers can tell how many were lost.
+//==
+
+#ifndef __CAMERALIBRARY__POSESTREAM_H__
+#define __CAMERALIBRARY__POSESTREAM_H__
+
+//== INCLUDES ===========================================================================================----
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    const unsigned int kPoseStreamMagic           = 0x5453504E;    //== "NPST" ===============----
+    const int          kPoseStreamVersion         = 1;
+    const int          kPoseStreamDefaultPort     = 1515;
+    const int          kPoseStreamMaxDatagramSize = 1400;           //== Payload, below MTU ==----
+
+    const int          kPoseStreamHeaderSize      = 12;
+    const int          kPoseStreamFrameSize       = 16;
+    const int          kPoseStreamPoseSize        = 24;
+
+    const int          kPoseStreamFrameSplit      = 0x0001;         //== Frame flags ==========----
+
+    const int          kPoseStreamPoseTracked     = 0x01;           //== Pose flags ===========----
+    const int          kPoseStreamPoseLargestMask = 0x06;           //== Dropped quaternion index
+    const int          kPoseStreamPoseLargestShift= 1;
+
+    struct sPoseStreamPose
+    {
+        unsigned int ID;
+        bool         Tracked;
+        float        Position[3];
+        float        Rotation[4];               //== Quaternion x, y, z, w ======================----
+        float        Error;                     //== Per marker, 0-0.255 after transmission =====----
+    };
+}
+
+#endif
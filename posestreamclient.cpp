@@ -0,0 +1,340 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+#include <math.h>
+#include <string.h>
+
+#include "posestreamclient.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+#ifdef WIN32
+    typedef SOCKET Socket;
+    void CloseSocket(Socket S)  { closesocket(S); }
+#else
+    typedef int Socket;
+    void CloseSocket(Socket S)  { close(S); }
+#endif
+
+    unsigned int GetU32(const unsigned char *P)
+    {
+        return (unsigned int) P[0] | ((unsigned int) P[1]<<8) | ((unsigned int) P[2]<<16) | ((unsigned int) P[3]<<24);
+    }
+
+    unsigned short GetU16(const unsigned char *P)
+    {
+        return (unsigned short) (P[0] | (P[1]<<8));
+    }
+
+    float GetFloat(const unsigned char *P)
+    {
+        unsigned int bits = GetU32(P);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    double GetDouble(const unsigned char *P)
+    {
+        unsigned long long bits = (unsigned long long) GetU32(P) | ((unsigned long long) GetU32(P+4)<<32);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    //== Smallest three back to a full quaternion, the dropped component is the positive root ==--
+
+    void DecodeRotation(const unsigned char *P, int Largest, float Rotation[4])
+    {
+        const float scale = 0.70710678f/32767.0f;
+
+        float sum = 0;
+        int   in  = 0;
+
+        for(int i=0; i<4; i++)
+        {
+            if(i==Largest)
+                continue;
+
+            float value = (float) (short) GetU16(P + in*2) * scale;
+
+            Rotation[i] = value;
+            sum += value*value;
+            in++;
+        }
+
+        Rotation[Largest] = (sum<1.0f) ? sqrtf(1.0f - sum) : 0.0f;
+    }
+}
+
+cPoseStreamClient::cPoseStreamClient()
+    : mSocket(kInvalidSocket)
+    , mSequenceValid(false)
+    , mNextSequence(0)
+    , mPartial(0)
+    , mDatagram(65536)
+{
+    ResetStatistics();
+}
+
+cPoseStreamClient::~cPoseStreamClient()
+{
+    Close();
+
+    for(int i=0; i<(int) mFreeFrames.size(); i++)
+        delete mFreeFrames[i];
+}
+
+bool cPoseStreamClient::Open(int Port, const char *Group, const char *Interface)
+{
+    Close();
+
+#ifdef WIN32
+    WSADATA wsaData;
+
+    if(WSAStartup(MAKEWORD(2,2), &wsaData)!=0)
+        return false;
+#endif
+
+    Socket s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+    if(s==(Socket) kInvalidSocket)
+    {
+#ifdef WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+
+    mSocket = (size_t) s;
+
+    //== several clients on one machine may listen to the same multicast stream ==--
+
+    int enable = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*) &enable, sizeof(enable));
+
+    int bufferSize = 1<<20;
+    setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char*) &bufferSize, sizeof(bufferSize));
+
+    sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+
+    local.sin_family      = AF_INET;
+    local.sin_port        = htons((unsigned short) Port);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if(bind(s, (sockaddr*) &local, sizeof(local))!=0)
+    {
+        Close();
+        return false;
+    }
+
+    if(Group)
+    {
+        ip_mreq request;
+        memset(&request, 0, sizeof(request));
+
+        request.imr_multiaddr.s_addr = inet_addr(Group);
+        request.imr_interface.s_addr = Interface ? inet_addr(Interface) : htonl(INADDR_ANY);
+
+        if(setsockopt(s, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*) &request, sizeof(request))!=0)
+        {
+            Close();
+            return false;
+        }
+    }
+
+    mSequenceValid = false;
+
+    return true;
+}
+
+void cPoseStreamClient::Close()
+{
+    if(mSocket==kInvalidSocket)
+        return;
+
+    CloseSocket((Socket) mSocket);
+    mSocket = kInvalidSocket;
+
+#ifdef WIN32
+    WSACleanup();
+#endif
+
+    for(int i=0; i<(int) mFrames.size(); i++)
+        mFreeFrames.push_back(mFrames[i]);
+
+    mFrames.clear();
+
+    if(mPartial)
+        mFreeFrames.push_back(mPartial);
+
+    mPartial = 0;
+}
+
+void cPoseStreamClient::ResetStatistics()
+{
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+bool cPoseStreamClient::Receive(sFrame &Frame, int TimeoutMilliseconds)
+{
+    while(mFrames.empty())
+    {
+        if(mSocket==kInvalidSocket)
+            return false;
+
+        Socket s = (Socket) mSocket;
+
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(s, &readable);
+
+        timeval timeout;
+        timeout.tv_sec  = TimeoutMilliseconds/1000;
+        timeout.tv_usec = (TimeoutMilliseconds%1000)*1000;
+
+        if(select((int) s+1, &readable, 0, 0, &timeout)<=0)
+            return false;
+
+        int size = (int) recv(s, (char*) &mDatagram[0], (int) mDatagram.size(), 0);
+
+        if(size<=0)
+            return false;
+
+        if(!Parse(&mDatagram[0], size))
+            mStats.Malformed++;
+
+        //== later datagrams are already waiting, don't hold up the caller any longer ==--
+
+        TimeoutMilliseconds = 0;
+    }
+
+    sFrame *frame = mFrames.front();
+    mFrames.pop_front();
+
+    Frame.FrameID   = frame->FrameID;
+    Frame.TimeStamp = frame->TimeStamp;
+    Frame.Sequence  = frame->Sequence;
+    Frame.Poses.swap(frame->Poses);
+
+    frame->Poses.clear();
+    mFreeFrames.push_back(frame);
+
+    return true;
+}
+
+bool cPoseStreamClient::Parse(const unsigned char *Data, int Size)
+{
+    if(Size<kPoseStreamHeaderSize || GetU32(Data)!=kPoseStreamMagic || Data[4]!=kPoseStreamVersion)
+        return false;
+
+    int          frameCount = Data[5];
+    unsigned int sequence   = GetU32(Data+8);
+
+    mStats.Datagrams++;
+    mStats.Bytes += Size;
+
+    if(mSequenceValid && sequence!=mNextSequence && sequence-mNextSequence<0x80000000u)
+        mStats.DatagramsLost += (int) (sequence-mNextSequence);
+
+    mSequenceValid = true;
+    mNextSequence  = sequence+1;
+
+    const unsigned char *read = Data + kPoseStreamHeaderSize;
+    const unsigned char *end  = Data + Size;
+
+    for(int f=0; f<frameCount; f++)
+    {
+        if(end-read<kPoseStreamFrameSize)
+            return false;
+
+        int    frameID   = (int) GetU32(read);
+        double timeStamp = GetDouble(read+4);
+        int    poseCount = GetU16(read+12);
+        int    flags     = GetU16(read+14);
+
+        read += kPoseStreamFrameSize;
+
+        if(end-read<poseCount*kPoseStreamPoseSize)
+            return false;
+
+        //== continue a split frame or start a new one ==--
+
+        sFrame *frame = 0;
+
+        if(mPartial)
+        {
+            if(f==0 && mPartial->FrameID==frameID)
+                frame = mPartial;
+            else
+            {
+                mStats.FramesIncomplete++;
+                mFreeFrames.push_back(mPartial);
+            }
+
+            mPartial = 0;
+        }
+
+        if(frame==0)
+        {
+            if(mFreeFrames.empty())
+                frame = new sFrame();
+            else
+            {
+                frame = mFreeFrames.back();
+                mFreeFrames.pop_back();
+            }
+
+            frame->FrameID   = frameID;
+            frame->TimeStamp = timeStamp;
+            frame->Poses.clear();
+        }
+
+        frame->Sequence = sequence;
+
+        size_t first = frame->Poses.size();
+        frame->Poses.resize(first + poseCount);
+
+        for(int i=0; i<poseCount; i++, read+=kPoseStreamPoseSize)
+        {
+            sPoseStreamPose &pose = frame->Poses[first+i];
+
+            int poseFlags = read[22];
+
+            pose.ID          = GetU32(read);
+            pose.Position[0] = GetFloat(read+4);
+            pose.Position[1] = GetFloat(read+8);
+            pose.Position[2] = GetFloat(read+12);
+            pose.Tracked     = (poseFlags & kPoseStreamPoseTracked)!=0;
+            pose.Error       = read[23]*0.001f;
+
+            DecodeRotation(read+16, (poseFlags & kPoseStreamPoseLargestMask)>>kPoseStreamPoseLargestShift, pose.Rotation);
+        }
+
+        if(flags & kPoseStreamFrameSplit)
+            mPartial = frame;
+        else
+        {
+            mFrames.push_back(frame);
+            mStats.Frames++;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,81 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Receiver for cPoseStreamer datagrams.  Like cPoseReader it only depends on the wire format
+//== header, so consumers compile posestreamclient.cpp into their own application.  Joining a
+//== multicast group is optional, the client receives unicast datagrams sent to its port either
+//== way, which is also how the loopback benchmark talks to it.
+//==
+
+#ifndef __CAMERALIBRARY__POSESTREAMCLIENT_H__
+#define __CAMERALIBRARY__POSESTREAMCLIENT_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <stddef.h>
+#include <deque>
+#include <vector>
+#include "posestream.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cPoseStreamClient
+    {
+    public:
+        cPoseStreamClient();
+        ~cPoseStreamClient();
+
+        //== Group: multicast address to join, Interface: local address to join it on (0: any)
+
+        bool    Open(int Port = kPoseStreamDefaultPort, const char *Group = 0, const char *Interface = 0);
+        void    Close();
+        bool    IsOpen() const                      { return mSocket!=kInvalidSocket; }
+
+        struct sFrame
+        {
+            int          FrameID;
+            double       TimeStamp;
+            unsigned int Sequence;              //== Datagram the frame (or its last part) came in
+            std::vector<sPoseStreamPose> Poses;
+        };
+
+        //== Next frame in arrival order, waits up to TimeoutMilliseconds for one to arrive ==--
+
+        bool    Receive(sFrame &Frame, int TimeoutMilliseconds = 0);
+
+        struct sStatistics
+        {
+            int       Datagrams;
+            int       DatagramsLost;            //== Gaps in the sequence numbers ==============----
+            int       Malformed;
+            int       Frames;
+            int       FramesIncomplete;         //== Split frames whose remainder was lost =====----
+            long long Bytes;
+        };
+
+        void    Statistics(sStatistics &Stats) const    { Stats = mStats; }
+        void    ResetStatistics();
+
+    private:
+        static const size_t kInvalidSocket = ~(size_t) 0;
+
+        bool    Parse(const unsigned char *Data, int Size);
+
+        size_t                      mSocket;
+        bool                        mSequenceValid;
+        unsigned int                mNextSequence;
+
+        std::deque<sFrame*>         mFrames;    //== Parsed, not yet returned =================----
+        std::vector<sFrame*>        mFreeFrames;
+        sFrame *                    mPartial;   //== Split frame waiting for its remainder =====----
+        std::vector<unsigned char>  mDatagram;
+
+        sStatistics                 mStats;
+    };
+}
+
+#endif
@@ -0,0 +1,688 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+#include <math.h>
+#include <string.h>
+
+#include "posestreamer.h"
+#include "posestreamclient.h"
+#include "vectorresults.h"
+
+#if !defined(__PLATFORM__LINUX__)
+#include "Core/RigidBodyBundle.h"
+#endif
+
+using namespace CameraLibrary;
+
+namespace
+{
+#ifdef WIN32
+    typedef SOCKET Socket;
+    void CloseSocket(Socket S)  { closesocket(S); }
+
+    unsigned long __stdcall SenderThreadProc(void *Param)
+    {
+        cPoseStreamer::sWorker *worker = (cPoseStreamer::sWorker*) Param;
+        worker->Streamer->SenderThread(worker);
+        return 0;
+    }
+#else
+    typedef int Socket;
+    void CloseSocket(Socket S)  { close(S); }
+
+    void SenderThreadProc(void *Param)
+    {
+        cPoseStreamer::sWorker *worker = (cPoseStreamer::sWorker*) Param;
+        worker->Streamer->SenderThread(worker);
+    }
+#endif
+
+    void SleepMilliseconds(int Milliseconds)
+    {
+#ifdef WIN32
+        Sleep(Milliseconds);
+#else
+        usleep(Milliseconds*1000);
+#endif
+    }
+
+    unsigned char * PutU32(unsigned char *P, unsigned int Value)
+    {
+        P[0] = (unsigned char) (Value);
+        P[1] = (unsigned char) (Value>>8);
+        P[2] = (unsigned char) (Value>>16);
+        P[3] = (unsigned char) (Value>>24);
+        return P+4;
+    }
+
+    unsigned char * PutU16(unsigned char *P, unsigned int Value)
+    {
+        P[0] = (unsigned char) (Value);
+        P[1] = (unsigned char) (Value>>8);
+        return P+2;
+    }
+
+    unsigned char * PutFloat(unsigned char *P, float Value)
+    {
+        unsigned int bits;
+        memcpy(&bits, &Value, sizeof(bits));
+        return PutU32(P, bits);
+    }
+
+    unsigned char * PutDouble(unsigned char *P, double Value)
+    {
+        unsigned long long bits;
+        memcpy(&bits, &Value, sizeof(bits));
+        P = PutU32(P, (unsigned int) bits);
+        return PutU32(P, (unsigned int) (bits>>32));
+    }
+
+    //== Smallest three: drop the largest component, the other three fit in +-1/sqrt(2) ==--
+
+    int EncodeRotation(unsigned char *P, const float Rotation[4])
+    {
+        float q[4] = { Rotation[0], Rotation[1], Rotation[2], Rotation[3] };
+
+        float length = sqrtf(q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
+
+        if(length<1e-6f)
+        {
+            q[0] = q[1] = q[2] = 0;
+            q[3] = 1;
+            length = 1;
+        }
+
+        int largest = 0;
+
+        for(int i=1; i<4; i++)
+            if(fabsf(q[i])>fabsf(q[largest]))
+                largest = i;
+
+        //== q and -q are the same rotation, keep the dropped component positive ==--
+
+        float scale = ((q[largest]<0) ? -32767.0f : 32767.0f)/(length*0.70710678f);
+
+        for(int i=0; i<4; i++)
+        {
+            if(i==largest)
+                continue;
+
+            float value = q[i]*scale;
+
+            if(value> 32767.0f) value =  32767.0f;
+            if(value<-32767.0f) value = -32767.0f;
+
+            P = PutU16(P, (unsigned int) (short) floorf(value+0.5f));
+        }
+
+        return largest;
+    }
+}
+
+cPoseStreamer::cPoseStreamer()
+    : mSocket(kInvalidSocket)
+    , mThread(0)
+    , mRunning(false)
+    , mMulticastTTL(1)
+    , mMaxBatchFrames(32)
+    , mMaxQueuedFrames(256)
+    , mMaxDatagramSize(kPoseStreamMaxDatagramSize)
+    , mSequence(0)
+    , mDatagram(kPoseStreamMaxDatagramSize)
+{
+    ResetStatistics();
+}
+
+cPoseStreamer::~cPoseStreamer()
+{
+    Close();
+
+    for(int i=0; i<(int) mFreeFrames.size(); i++)
+        delete mFreeFrames[i];
+}
+
+bool cPoseStreamer::Open()
+{
+    Close();
+
+#ifdef WIN32
+    WSADATA wsaData;
+
+    if(WSAStartup(MAKEWORD(2,2), &wsaData)!=0)
+        return false;
+#endif
+
+    Socket s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+    if(s==(Socket) kInvalidSocket)
+    {
+#ifdef WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+
+    mSocket = (size_t) s;
+
+    int bufferSize = 1<<20;
+    setsockopt(s, SOL_SOCKET, SO_SNDBUF, (const char*) &bufferSize, sizeof(bufferSize));
+
+    //== multicast loops back so clients on this machine receive it too ==--
+
+    unsigned char loop = 1;
+    setsockopt(s, IPPROTO_IP, IP_MULTICAST_LOOP, (const char*) &loop, sizeof(loop));
+
+    SetMulticastTTL(mMulticastTTL);
+
+    mRunning = true;
+
+    mThread = new sWorker();
+    mThread->Streamer = this;
+
+#ifdef WIN32
+    mThread->Thread.StartThread((void*) SenderThreadProc, mThread);
+#else
+    mThread->Thread.StartThread(SenderThreadProc, mThread);
+#endif
+
+    return true;
+}
+
+void cPoseStreamer::Close()
+{
+    if(mSocket==kInvalidSocket)
+        return;
+
+    //== give the sender a moment to flush what was submitted ==--
+
+    for(int i=0; i<100; i++)
+    {
+        mLock.Lock();
+        bool empty = mQueue.empty();
+        mLock.UnLock();
+
+        if(empty)
+            break;
+
+        mWorkAvailable.Trigger();
+        SleepMilliseconds(1);
+    }
+
+    mRunning = false;
+    mWorkAvailable.Trigger();
+
+    mThread->Thread.StopThread();
+    delete mThread;
+    mThread = 0;
+
+    CloseSocket((Socket) mSocket);
+    mSocket = kInvalidSocket;
+
+#ifdef WIN32
+    WSACleanup();
+#endif
+
+    for(int i=0; i<(int) mQueue.size(); i++)
+        mFreeFrames.push_back(mQueue[i]);
+
+    mQueue.clear();
+}
+
+bool cPoseStreamer::AddDestination(const char *Address, int Port)
+{
+    if(Address==0 || Port<=0 || Port>65535)
+        return false;
+
+    sDestination destination;
+
+    destination.Address = inet_addr(Address);
+    destination.Port    = htons((unsigned short) Port);
+
+    if(destination.Address==INADDR_NONE)
+        return false;
+
+    mLock.Lock();
+    mDestinations.push_back(destination);
+    mLock.UnLock();
+
+    return true;
+}
+
+void cPoseStreamer::ClearDestinations()
+{
+    mLock.Lock();
+    mDestinations.clear();
+    mLock.UnLock();
+}
+
+void cPoseStreamer::SetMulticastTTL(int TTL)
+{
+    mMulticastTTL = (TTL<1) ? 1 : (TTL>255) ? 255 : TTL;
+
+    if(mSocket!=kInvalidSocket)
+    {
+        unsigned char ttl = (unsigned char) mMulticastTTL;
+        setsockopt((Socket) mSocket, IPPROTO_IP, IP_MULTICAST_TTL, (const char*) &ttl, sizeof(ttl));
+    }
+}
+
+void cPoseStreamer::SetMaxBatchFrames(int Frames)
+{
+    mLock.Lock();
+    mMaxBatchFrames = (Frames<1) ? 1 : (Frames>255) ? 255 : Frames;
+    mLock.UnLock();
+}
+
+void cPoseStreamer::SetMaxQueuedFrames(int Frames)
+{
+    mLock.Lock();
+    mMaxQueuedFrames = (Frames<1) ? 1 : Frames;
+    mLock.UnLock();
+}
+
+void cPoseStreamer::SetMaxDatagramSize(int Size)
+{
+    int minimum = kPoseStreamHeaderSize + kPoseStreamFrameSize + kPoseStreamPoseSize;
+
+    mLock.Lock();
+    mMaxDatagramSize = (Size<minimum) ? minimum : (Size>kPoseStreamMaxDatagramSize) ? kPoseStreamMaxDatagramSize : Size;
+    mLock.UnLock();
+}
+
+cPoseStreamer::sQueuedFrame * cPoseStreamer::AcquireFrame(int FrameID, double TimeStamp, int PoseCount)
+{
+    sQueuedFrame *frame = 0;
+
+    mLock.Lock();
+
+    if(!mFreeFrames.empty())
+    {
+        frame = mFreeFrames.back();
+        mFreeFrames.pop_back();
+    }
+
+    mLock.UnLock();
+
+    if(frame==0)
+        frame = new sQueuedFrame();
+
+    frame->FrameID   = FrameID;
+    frame->TimeStamp = TimeStamp;
+    frame->Poses.resize(PoseCount);
+
+    return frame;
+}
+
+bool cPoseStreamer::Enqueue(sQueuedFrame *Frame)
+{
+    bool dropped = false;
+
+    Frame->SubmitTime = mClock.Elapsed();
+
+    mLock.Lock();
+
+    mStats.FramesSubmitted++;
+
+    //== a stalled network must not grow the queue without bound, stale poses go first ==--
+
+    while((int) mQueue.size()>=mMaxQueuedFrames)
+    {
+        mFreeFrames.push_back(mQueue.front());
+        mQueue.pop_front();
+        mStats.FramesDropped++;
+        dropped = true;
+    }
+
+    mQueue.push_back(Frame);
+
+    mLock.UnLock();
+
+    mWorkAvailable.Trigger();
+
+    return !dropped;
+}
+
+bool cPoseStreamer::Submit(int FrameID, double TimeStamp, const sPoseStreamPose *Poses, int PoseCount)
+{
+    if(mSocket==kInvalidSocket || PoseCount<0 || (PoseCount>0 && Poses==0))
+        return false;
+
+    sQueuedFrame *frame = AcquireFrame(FrameID, TimeStamp, PoseCount);
+
+    if(PoseCount>0)
+        memcpy(&frame->Poses[0], Poses, PoseCount*sizeof(sPoseStreamPose));
+
+    return Enqueue(frame);
+}
+
+bool cPoseStreamer::Submit(cModuleVectorProcessing *Processor, int FrameID, double TimeStamp)
+{
+    if(mSocket==kInvalidSocket)
+        return false;
+
+    sVectorResults results;
+
+    ExportResults(Processor, &results, FrameID, TimeStamp);
+
+    sQueuedFrame    *frame = AcquireFrame(FrameID, TimeStamp, 1);
+    sPoseStreamPose &pose  = frame->Poses[0];
+
+    pose.ID      = 0;
+    pose.Tracked = (results.MarkerCount>=3);     //== Vector solution needs three markers ====----
+    pose.Error   = 0;
+
+    for(int i=0; i<3; i++)
+        pose.Position[i] = (float) results.Position[i];
+
+    for(int i=0; i<4; i++)
+        pose.Rotation[i] = (float) results.Quaternion[i];
+
+    return Enqueue(frame);
+}
+
+#if !defined(__PLATFORM__LINUX__)
+bool cPoseStreamer::Submit(const Core::cRigidBodyBundle &RigidBodies, int FrameID, double TimeStamp)
+{
+    if(mSocket==kInvalidSocket)
+        return false;
+
+    Core::cRigidBodyBundle::RigidBodyIteratorPair all = RigidBodies.AllRigidBodies();
+
+    sQueuedFrame *frame = AcquireFrame(FrameID, TimeStamp, (int) RigidBodies.RigidBodyCount());
+
+    int index = 0;
+
+    for(Core::cRigidBodyBundle::RigidBodyIterator body=all.first; body!=all.second; ++body, index++)
+    {
+        sPoseStreamPose &pose = frame->Poses[index];
+
+        pose.ID          = (unsigned int) body->ID.LowBits();
+        pose.Tracked     = body->Tracked;
+        pose.Error       = body->ErrorPerMarker;
+
+        pose.Position[0] = body->Position().X();
+        pose.Position[1] = body->Position().Y();
+        pose.Position[2] = body->Position().Z();
+
+        pose.Rotation[0] = body->Rotation().X();
+        pose.Rotation[1] = body->Rotation().Y();
+        pose.Rotation[2] = body->Rotation().Z();
+        pose.Rotation[3] = body->Rotation().W();
+    }
+
+    return Enqueue(frame);
+}
+#endif
+
+void cPoseStreamer::ResetStatistics()
+{
+    mLock.Lock();
+    memset(&mStats, 0, sizeof(mStats));
+    mLatencySum = 0;
+    mLock.UnLock();
+}
+
+void cPoseStreamer::Statistics(sStatistics &Stats)
+{
+    mLock.Lock();
+
+    Stats = mStats;
+
+    Stats.BytesPerPose            = (Stats.Poses>0) ? (double) Stats.Bytes/Stats.Poses : 0.0;
+    Stats.FramesPerDatagram       = (Stats.Datagrams>0) ? (double) Stats.FramesSent/Stats.Datagrams : 0.0;
+    Stats.MeanLatencyMicroseconds = (Stats.FramesSent>0) ? 1e6*mLatencySum/Stats.FramesSent : 0.0;
+
+    mLock.UnLock();
+}
+
+void cPoseStreamer::SenderThread(sWorker *Worker)
+{
+    std::vector<sQueuedFrame*> batch;
+
+    while(mRunning && Worker->Thread.IsSteadyState())
+    {
+        //== whatever queued up while the last batch was sent goes out together ==--
+
+        mLock.Lock();
+
+        while(!mQueue.empty() && (int) batch.size()<mMaxBatchFrames)
+        {
+            batch.push_back(mQueue.front());
+            mQueue.pop_front();
+        }
+
+        mSendDestinations = mDestinations;
+
+        mLock.UnLock();
+
+        if(batch.empty())
+        {
+            mWorkAvailable.Wait(100);
+            continue;
+        }
+
+        SendBatch(batch);
+
+        double now = mClock.Elapsed();
+
+        mLock.Lock();
+
+        for(int i=0; i<(int) batch.size(); i++)
+        {
+            double latency = now - batch[i]->SubmitTime;
+
+            mLatencySum += latency;
+
+            if(1e6*latency>mStats.MaxLatencyMicroseconds)
+                mStats.MaxLatencyMicroseconds = 1e6*latency;
+
+            mStats.Poses += batch[i]->Poses.size();
+            mFreeFrames.push_back(batch[i]);
+        }
+
+        mStats.FramesSent += (int) batch.size();
+
+        mLock.UnLock();
+
+        batch.clear();
+    }
+
+    Worker->Thread.mThreadRunning = false;
+}
+
+void cPoseStreamer::SendBatch(std::vector<sQueuedFrame*> &Batch)
+{
+    unsigned char *datagram = &mDatagram[0];
+    unsigned char *write    = datagram + kPoseStreamHeaderSize;
+    unsigned char *end      = datagram + mMaxDatagramSize;
+    int            frames   = 0;
+    bool           full     = false;
+
+    for(int f=0; f<(int) Batch.size(); f++)
+    {
+        const sQueuedFrame *frame = Batch[f];
+
+        int poseCount = (int) frame->Poses.size();
+        int pose      = 0;
+
+        do
+        {
+            //== start a new datagram unless this record and at least one pose fit ==--
+
+            int needed = kPoseStreamFrameSize + ((poseCount>pose) ? kPoseStreamPoseSize : 0);
+
+            if(full || frames==255 || end-write<needed)
+            {
+                SendDatagram((int) (write-datagram));
+
+                write  = datagram + kPoseStreamHeaderSize;
+                datagram[5] = 0;
+                frames = 0;
+                full   = false;
+            }
+
+            int count = (int) ((end-write-kPoseStreamFrameSize)/kPoseStreamPoseSize);
+
+            if(count>poseCount-pose)
+                count = poseCount-pose;
+
+            bool split = (pose+count<poseCount);
+
+            write = PutU32   (write, (unsigned int) frame->FrameID);
+            write = PutDouble(write, frame->TimeStamp);
+            write = PutU16   (write, (unsigned int) count);
+            write = PutU16   (write, split ? kPoseStreamFrameSplit : 0);
+
+            for(int i=0; i<count; i++, pose++)
+            {
+                const sPoseStreamPose &p = frame->Poses[pose];
+
+                write = PutU32  (write, p.ID);
+                write = PutFloat(write, p.Position[0]);
+                write = PutFloat(write, p.Position[1]);
+                write = PutFloat(write, p.Position[2]);
+
+                int largest = EncodeRotation(write, p.Rotation);
+                write += 6;
+
+                float error = p.Error*1000.0f + 0.5f;
+
+                *write++ = (unsigned char) ((p.Tracked ? kPoseStreamPoseTracked : 0) | (largest<<kPoseStreamPoseLargestShift));
+                *write++ = (unsigned char) ((error>255.0f) ? 255 : (error<0.0f) ? 0 : (int) error);
+            }
+
+            frames++;
+            datagram[5] = (unsigned char) frames;
+
+            //== the rest of a split frame continues at the start of the next datagram ==--
+
+            full = split;
+
+        } while(pose<poseCount);
+    }
+
+    if(frames>0)
+        SendDatagram((int) (write-datagram));
+}
+
+void cPoseStreamer::SendDatagram(int Size)
+{
+    unsigned char *header = &mDatagram[0];
+
+    //== SendBatch() fills in the frame count, the rest of the header is stamped here ==--
+
+    PutU32(header, kPoseStreamMagic);
+    header[4] = (unsigned char) kPoseStreamVersion;
+    PutU16(header+6, 0);
+    PutU32(header+8, mSequence++);
+
+    int errors = 0;
+
+    for(int i=0; i<(int) mSendDestinations.size(); i++)
+    {
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+
+        address.sin_family      = AF_INET;
+        address.sin_port        = mSendDestinations[i].Port;
+        address.sin_addr.s_addr = mSendDestinations[i].Address;
+
+        if(sendto((Socket) mSocket, (const char*) header, Size, 0, (sockaddr*) &address, sizeof(address))!=Size)
+            errors++;
+    }
+
+    mLock.Lock();
+    mStats.Datagrams++;
+    mStats.Bytes      += Size;
+    mStats.SendErrors += errors;
+    mLock.UnLock();
+}
+
+bool cPoseStreamer::Benchmark(int Port, int Frames, int PosesPerFrame, double Interval, sBenchmark &Result)
+{
+    memset(&Result, 0, sizeof(Result));
+
+    Result.PosesPerFrame = PosesPerFrame;
+
+    cPoseStreamClient client;
+    cPoseStreamer     streamer;
+
+    if(!client.Open(Port) || !streamer.Open() || !streamer.AddDestination("127.0.0.1", Port))
+        return false;
+
+    std::vector<sPoseStreamPose> poses(PosesPerFrame>0 ? PosesPerFrame : 1);
+
+    for(int i=0; i<(int) poses.size(); i++)
+    {
+        sPoseStreamPose &pose = poses[i];
+
+        pose.ID          = (unsigned int) i;
+        pose.Tracked     = true;
+        pose.Error       = 0.0005f;
+        pose.Position[0] = 0.1f*i;
+        pose.Position[1] = 1.5f;
+        pose.Position[2] = -0.2f*i;
+        pose.Rotation[0] = 0.0f;
+        pose.Rotation[1] = 0.38268343f;
+        pose.Rotation[2] = 0.0f;
+        pose.Rotation[3] = 0.92387953f;
+    }
+
+    cPoseStreamClient::sFrame frame;
+    Core::cTimer              timer;
+
+    for(int i=0; i<Frames; i++)
+    {
+        //== pace like a camera would, draining the client meanwhile ==--
+
+        while(Interval>0 && timer.Elapsed()<i*Interval)
+        {
+            int wait = (int) (1000.0*(i*Interval - timer.Elapsed()));
+
+            if(client.Receive(frame, wait))
+                Result.FramesReceived++;
+        }
+
+        streamer.Submit(i, i*Interval, &poses[0], PosesPerFrame);
+
+        while(client.Receive(frame, 0))
+            Result.FramesReceived++;
+    }
+
+    streamer.Close();
+
+    double seconds = timer.Elapsed();
+
+    while(client.Receive(frame, 50))
+        Result.FramesReceived++;
+
+    sStatistics                      stats;
+    cPoseStreamClient::sStatistics   clientStats;
+
+    streamer.Statistics(stats);
+    client.Statistics(clientStats);
+
+    Result.FramesSent              = stats.FramesSent;
+    Result.FramesDropped           = stats.FramesDropped;
+    Result.DatagramsLost           = clientStats.DatagramsLost + (stats.Datagrams - clientStats.Datagrams - clientStats.DatagramsLost);
+    Result.PacketsPerSecond        = (seconds>0) ? stats.Datagrams/seconds : 0.0;
+    Result.FramesPerSecond         = (seconds>0) ? stats.FramesSent/seconds : 0.0;
+    Result.BytesPerPose            = stats.BytesPerPose;
+    Result.FramesPerDatagram       = stats.FramesPerDatagram;
+    Result.MeanLatencyMicroseconds = stats.MeanLatencyMicroseconds;
+    Result.MaxLatencyMicroseconds  = stats.MaxLatencyMicroseconds;
+
+    return true;
+}
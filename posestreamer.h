@@ -0,0 +1,165 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Streams poses to other machines over UDP in the format described in posestream.h.  Poses come
+//== from cModuleVectorProcessing, a Core::cRigidBodyBundle or straight from the caller.
+//==
+//== Submit() only copies the poses into a queue, a sender thread packs and sends them, so the
+//== tracking thread never blocks on the network.  A lone frame goes out in its own datagram right
+//== away; when the sender falls behind, everything that queued up meanwhile (up to the batch
+//== limit) shares datagrams, trading a little latency for far fewer packets.  Each datagram is
+//== sent to every destination, unicast or multicast.
+//==
+
+#ifndef __CAMERALIBRARY__POSESTREAMER_H__
+#define __CAMERALIBRARY__POSESTREAMER_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <stddef.h>
+#include <deque>
+#include <vector>
+#include "posestream.h"
+#include "threading.h"
+#include "lock.h"
+#include "Core/Timer.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace Core
+{
+    class cRigidBodyBundle;
+}
+
+namespace CameraLibrary
+{
+    class cModuleVectorProcessing;
+
+    class cPoseStreamer
+    {
+    public:
+        cPoseStreamer();
+        ~cPoseStreamer();
+
+        bool    Open();                                         //== Socket & sender thread ===----
+        void    Close();                                        //== Flushes queued frames ====----
+        bool    IsOpen() const                      { return mSocket!=kInvalidSocket; }
+
+        //== Dotted IPv4 address, 224.0.0.0-239.255.255.255 are sent as multicast ==--
+
+        bool    AddDestination(const char *Address, int Port = kPoseStreamDefaultPort);
+        void    ClearDestinations();
+        int     DestinationCount() const            { return (int) mDestinations.size(); }
+
+        void    SetMulticastTTL(int TTL);                       //== Default 1, local subnet ===----
+        void    SetMaxBatchFrames(int Frames);                  //== 1 disables batching =======----
+        void    SetMaxQueuedFrames(int Frames);                 //== Oldest dropped beyond this -
+        void    SetMaxDatagramSize(int Size);                   //== Clamped to the MTU payload -
+
+        //== Queue a frame of poses, false if it was dropped ==--
+
+        bool    Submit(int FrameID, double TimeStamp, const sPoseStreamPose *Poses, int PoseCount);
+        bool    Submit(cModuleVectorProcessing *Processor, int FrameID, double TimeStamp);
+#if !defined(__PLATFORM__LINUX__)
+        bool    Submit(const Core::cRigidBodyBundle &RigidBodies, int FrameID, double TimeStamp);
+#endif
+
+        struct sStatistics
+        {
+            int     FramesSubmitted;
+            int     FramesSent;
+            int     FramesDropped;
+            int     Datagrams;                  //== Packed, each goes to every destination ====----
+            int     SendErrors;
+            long long Bytes;
+            long long Poses;
+            double  BytesPerPose;               //== Including datagram & frame overhead =======----
+            double  FramesPerDatagram;
+            double  MeanLatencyMicroseconds;    //== Submit() until the last sendto() returned ==-
+            double  MaxLatencyMicroseconds;
+        };
+
+        void    Statistics(sStatistics &Stats);
+        void    ResetStatistics();
+
+        //== Loopback benchmark: streams Frames frames of PosesPerFrame poses to a client on
+        //== 127.0.0.1:Port every Interval seconds, or as fast as possible when Interval is 0,
+        //== which exercises batching and queue overflow.
+
+        struct sBenchmark
+        {
+            int     PosesPerFrame;
+            int     FramesSent;
+            int     FramesDropped;              //== Queue overflow, unpaced runs only =========----
+            int     FramesReceived;
+            int     DatagramsLost;
+            double  PacketsPerSecond;
+            double  FramesPerSecond;
+            double  BytesPerPose;
+            double  FramesPerDatagram;
+            double  MeanLatencyMicroseconds;
+            double  MaxLatencyMicroseconds;
+        };
+
+        static bool Benchmark(int Port, int Frames, int PosesPerFrame, double Interval, sBenchmark &Result);
+
+        //== Internal use, thread entry point needs to be public ==--
+
+        struct sWorker
+        {
+            cPoseStreamer * Streamer;
+            ThreadInfo      Thread;
+        };
+
+        void    SenderThread(sWorker *Worker);
+
+    private:
+        static const size_t kInvalidSocket = ~(size_t) 0;
+
+        struct sQueuedFrame
+        {
+            int          FrameID;
+            double       TimeStamp;
+            double       SubmitTime;
+            std::vector<sPoseStreamPose> Poses;
+        };
+
+        struct sDestination
+        {
+            unsigned int Address;               //== Network byte order ========================----
+            unsigned short Port;                //== Network byte order ========================----
+        };
+
+        sQueuedFrame * AcquireFrame(int FrameID, double TimeStamp, int PoseCount);
+        bool    Enqueue(sQueuedFrame *Frame);
+        void    SendBatch(std::vector<sQueuedFrame*> &Batch);
+        void    SendDatagram(int Size);                     //== Of mDatagram ==================----
+
+        size_t                      mSocket;
+        sWorker *                   mThread;
+        volatile bool               mRunning;
+
+        std::vector<sDestination>   mDestinations;
+        std::vector<sDestination>   mSendDestinations;      //== Sender thread's copy =====----
+        int                         mMulticastTTL;
+        int                         mMaxBatchFrames;
+        int                         mMaxQueuedFrames;
+        int                         mMaxDatagramSize;
+        unsigned int                mSequence;
+
+        std::deque<sQueuedFrame*>   mQueue;
+        std::vector<sQueuedFrame*>  mFreeFrames;
+        std::vector<unsigned char>  mDatagram;
+
+        LockItem                    mLock;
+        cEvent                      mWorkAvailable;
+        Core::cTimer                mClock;
+
+        sStatistics                 mStats;
+        double                      mLatencySum;
+    };
+}
+
+#endif
@@ -0,0 +1,845 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <math.h>
+#include <algorithm>
+
+#include "rigidbodyidentifier.h"
+#include "benchmarknoise.h"
+#include "rigidbodysolver.h"
+#include "Core/Timer.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    //== A marker last seen up to this many frames ago still seeds its body ==--
+
+    const int kSeedAge = 8;
+
+    inline float Distance(const float A[3], const float B[3])
+    {
+        float x = A[0] - B[0];
+        float y = A[1] - B[1];
+        float z = A[2] - B[2];
+
+        return sqrtf(x*x + y*y + z*z);
+    }
+
+    inline float Determinant(const float A[3], const float B[3], const float C[3], const float D[3])
+    {
+        float u[3] = { B[0] - A[0], B[1] - A[1], B[2] - A[2] };
+        float v[3] = { C[0] - A[0], C[1] - A[1], C[2] - A[2] };
+        float w[3] = { D[0] - A[0], D[1] - A[1], D[2] - A[2] };
+
+        return u[0]*(v[1]*w[2] - v[2]*w[1]) - u[1]*(v[0]*w[2] - v[2]*w[0]) + u[2]*(v[0]*w[1] - v[1]*w[0]);
+    }
+
+    void Rotate(const float Q[4], const float V[3], float Result[3])
+    {
+        //== v + 2 w (u x v) + 2 u x (u x v), u = (x, y, z) ==--
+
+        float t[3] = { 2*(Q[1]*V[2] - Q[2]*V[1]), 2*(Q[2]*V[0] - Q[0]*V[2]), 2*(Q[0]*V[1] - Q[1]*V[0]) };
+
+        Result[0] = V[0] + Q[3]*t[0] + Q[1]*t[2] - Q[2]*t[1];
+        Result[1] = V[1] + Q[3]*t[1] + Q[2]*t[0] - Q[0]*t[2];
+        Result[2] = V[2] + Q[3]*t[2] + Q[0]*t[1] - Q[1]*t[0];
+    }
+}
+
+cRigidBodyIdentifier::cRigidBodyIdentifier()
+    : mNeighborRadius(0)
+    , mPoints(0)
+    , mCount(0)
+    , mCellSize(1.0f)
+    , mCellMask(0)
+{
+    mSettings.Tolerance    = 0.003f;
+    mSettings.MinMarkers   = 3;
+    mSettings.MotionRadius = 0.02f;
+
+    mStatistics.Seeded   = 0;
+    mStatistics.Searched = 0;
+    mStatistics.Nodes    = 0;
+}
+
+int cRigidBodyIdentifier::AddDefinition(const Core::cUID &ID, const float *Markers, int Count)
+{
+    mBodies.push_back(sBody());
+
+    sBody &body = mBodies.back();
+
+    body.ID          = ID;
+    body.MarkerCount = std::max(0, std::min(Count, (int) kMaxMarkers));
+    body.Diameter    = 0;
+    body.Found       = false;
+
+    for(int m=0; m<body.MarkerCount; m++)
+    {
+        for(int k=0; k<3; k++)
+            body.Local[m][k] = Markers[3*m + k];
+
+        body.Assigned[m] = -1;
+        body.Age[m]      = kSeedAge + 1;
+    }
+
+    for(int a=0; a<body.MarkerCount; a++)
+    {
+        for(int b=0; b<body.MarkerCount; b++)
+        {
+            body.Distance[a][b] = Distance(body.Local[a], body.Local[b]);
+            body.Diameter       = std::max(body.Diameter, body.Distance[a][b]);
+        }
+    }
+
+    return (int) mBodies.size() - 1;
+}
+
+void cRigidBodyIdentifier::ClearDefinitions()
+{
+    mBodies.clear();
+}
+
+unsigned int cRigidBodyIdentifier::Cell(int X, int Y, int Z) const
+{
+    return (unsigned int) X*73856093u ^ (unsigned int) Y*19349663u ^ (unsigned int) Z*83492791u;
+}
+
+int cRigidBodyIdentifier::CellCoordinate(float Value) const
+{
+    return (int) floorf(Value/mCellSize);
+}
+
+int cRigidBodyIdentifier::Identify(const float *Points, int Count)
+{
+    mPoints = Points;
+    mCount  = std::max(Count, 0);
+
+    mClaimed.assign(mCount, 0);
+    mNeighborRange.assign(2*mCount, -1);
+    mNeighbors.clear();
+
+    mStatistics.Seeded   = 0;
+    mStatistics.Searched = 0;
+    mStatistics.Nodes    = 0;
+
+    mNeighborRadius = 0;
+
+    for(int b=0; b<(int) mBodies.size(); b++)
+        mNeighborRadius = std::max(mNeighborRadius, mBodies[b].Diameter + mSettings.Tolerance);
+
+    BuildGrid();
+
+    //== last frame's bodies first, they are cheap and take their points out of the way ==--
+
+    mOrder.clear();
+
+    for(int b=0; b<(int) mBodies.size(); b++)
+    {
+        if(!Seed(b))
+            mOrder.push_back(b);
+    }
+
+    //== then the rest, larger bodies first: they are the least likely to match by chance ==--
+
+    for(int i=1; i<(int) mOrder.size(); i++)
+    {
+        int body = mOrder[i];
+        int j    = i;
+
+        for(; j>0 && mBodies[mOrder[j - 1]].MarkerCount<mBodies[body].MarkerCount; j--)
+            mOrder[j] = mOrder[j - 1];
+
+        mOrder[j] = body;
+    }
+
+    for(int i=0; i<(int) mOrder.size(); i++)
+    {
+        sBody &body = mBodies[mOrder[i]];
+
+        if(!Search(mOrder[i], 0))
+        {
+            body.Found = false;
+
+            for(int m=0; m<body.MarkerCount; m++)
+            {
+                body.Assigned[m] = -1;
+                body.Age[m]      = kSeedAge + 1;
+            }
+        }
+    }
+
+    int found = 0;
+
+    for(int b=0; b<(int) mBodies.size(); b++)
+        if(mBodies[b].Found)
+            found++;
+
+    return found;
+}
+
+void cRigidBodyIdentifier::BuildGrid()
+{
+    //== cells span the largest body, so a neighbor query looks at no more than 3x3x3 of them,
+    //== and at least two motion radii so seeding looks at no more than 2x2x2
+
+    mCellSize = std::max(std::max(2.0f*mSettings.MotionRadius, mNeighborRadius), 1e-4f);
+
+    int buckets = 16;
+
+    while(buckets<2*mCount)
+        buckets <<= 1;
+
+    mCellMask = buckets - 1;
+
+    mCellStart.assign(buckets + 1, 0);
+    mCellPoints.resize(mCount);
+
+    std::vector<int> &bucket = mBucket;
+
+    bucket.resize(mCount);
+
+    for(int p=0; p<mCount; p++)
+    {
+        const float *position = Position(p);
+
+        bucket[p] = (int) (Cell(CellCoordinate(position[0]), CellCoordinate(position[1]), CellCoordinate(position[2]))
+                           & (unsigned int) mCellMask);
+        mCellStart[bucket[p] + 1]++;
+    }
+
+    for(int b=0; b<buckets; b++)
+        mCellStart[b + 1] += mCellStart[b];
+
+    //== fill advances every bucket's start to its end, shift back afterwards ==--
+
+    for(int p=0; p<mCount; p++)
+        mCellPoints[mCellStart[bucket[p]]++] = p;
+
+    for(int b=buckets; b>0; b--)
+        mCellStart[b] = mCellStart[b - 1];
+
+    mCellStart[0] = 0;
+}
+
+void cRigidBodyIdentifier::Neighbors(int Point, const sNeighbor *&First, const sNeighbor *&Last)
+{
+    //== a point's neighbors within the largest body, claimed or not, nearest first.  Gathered
+    //== the first time the point is asked for, most are never needed in steady frames.
+
+    if(mNeighborRange[2*Point]<0)
+    {
+        const float *position = Position(Point);
+
+        int low[3], high[3];
+
+        for(int k=0; k<3; k++)
+        {
+            low[k]  = CellCoordinate(position[k] - mNeighborRadius);
+            high[k] = CellCoordinate(position[k] + mNeighborRadius);
+        }
+
+        //== cells may share a bucket, every bucket is visited once ==--
+
+        mVisited.clear();
+
+        for(int x=low[0]; x<=high[0]; x++)
+            for(int y=low[1]; y<=high[1]; y++)
+                for(int z=low[2]; z<=high[2]; z++)
+                    mVisited.push_back((int) (Cell(x, y, z) & (unsigned int) mCellMask));
+
+        std::sort(mVisited.begin(), mVisited.end());
+        mVisited.erase(std::unique(mVisited.begin(), mVisited.end()), mVisited.end());
+
+        int first = (int) mNeighbors.size();
+
+        for(int v=0; v<(int) mVisited.size(); v++)
+        {
+            for(int s=mCellStart[mVisited[v]]; s<mCellStart[mVisited[v] + 1]; s++)
+            {
+                sNeighbor neighbor;
+
+                neighbor.Point    = mCellPoints[s];
+                neighbor.Distance = Distance(position, Position(neighbor.Point));
+
+                if(neighbor.Point!=Point && neighbor.Distance<=mNeighborRadius)
+                    mNeighbors.push_back(neighbor);
+            }
+        }
+
+        std::sort(mNeighbors.begin() + first, mNeighbors.end());
+
+        mNeighborRange[2*Point]     = first;
+        mNeighborRange[2*Point + 1] = (int) mNeighbors.size();
+    }
+
+    const sNeighbor *neighbors = mNeighbors.empty() ? 0 : &mNeighbors[0];
+
+    First = neighbors + mNeighborRange[2*Point];
+    Last  = neighbors + mNeighborRange[2*Point + 1];
+}
+
+int cRigidBodyIdentifier::Nearest(const float Position[3], float Radius) const
+{
+    int   nearest  = -1;
+    float distance = Radius;
+
+    int low[3], high[3];
+
+    for(int k=0; k<3; k++)
+    {
+        low[k]  = CellCoordinate(Position[k] - Radius);
+        high[k] = CellCoordinate(Position[k] + Radius);
+    }
+
+    for(int x=low[0]; x<=high[0]; x++)
+    {
+        for(int y=low[1]; y<=high[1]; y++)
+        {
+            for(int z=low[2]; z<=high[2]; z++)
+            {
+                int bucket = (int) (Cell(x, y, z) & (unsigned int) mCellMask);
+
+                for(int s=mCellStart[bucket]; s<mCellStart[bucket + 1]; s++)
+                {
+                    int   p = mCellPoints[s];
+                    float d = Distance(Position, this->Position(p));
+
+                    if(!mClaimed[p] && d<=distance)
+                    {
+                        distance = d;
+                        nearest  = p;
+                    }
+                }
+            }
+        }
+    }
+
+    return nearest;
+}
+
+bool cRigidBodyIdentifier::Agree(const sBody &Body, const sVertex &A, const sVertex &B) const
+{
+    if(A.Marker==B.Marker || A.Point==B.Point)
+        return false;
+
+    return fabsf(Distance(Position(A.Point), Position(B.Point)) - Body.Distance[A.Marker][B.Marker])<=mSettings.Tolerance;
+}
+
+bool cRigidBodyIdentifier::Seed(int Body)
+{
+    sBody &body = mBodies[Body];
+
+    if(!body.Found)
+        return false;
+
+    //== every recently seen marker takes the nearest free point to where it was ==--
+
+    mFound.clear();
+
+    for(int m=0; m<body.MarkerCount; m++)
+    {
+        if(body.Age[m]>kSeedAge)
+            continue;
+
+        sVertex vertex;
+
+        vertex.Marker = m;
+        vertex.Point  = Nearest(body.Previous[m], mSettings.MotionRadius);
+
+        bool taken = vertex.Point<0;
+
+        for(int v=0; v<(int) mFound.size() && !taken; v++)
+            taken = mFound[v].Point==vertex.Point;
+
+        if(!taken)
+            mFound.push_back(vertex);
+    }
+
+    //== drop the most contradicted until the rest agree ==--
+
+    for(;;)
+    {
+        int worst     = -1;
+        int conflicts = 0;
+
+        for(int a=0; a<(int) mFound.size(); a++)
+        {
+            int count = 0;
+
+            for(int b=0; b<(int) mFound.size(); b++)
+                if(a!=b && !Agree(body, mFound[a], mFound[b]))
+                    count++;
+
+            if(count>conflicts)
+            {
+                worst     = a;
+                conflicts = count;
+            }
+        }
+
+        if(worst<0)
+            break;
+
+        mFound.erase(mFound.begin() + worst);
+    }
+
+    if(mFound.empty())
+        return false;
+
+    if((int) mFound.size()==body.MarkerCount && Handed(body, mFound))
+    {
+        Claim(Body, mFound);
+        mStatistics.Seeded++;
+        return true;
+    }
+
+    //== markers are missing (or moved too far): search around the part that still agrees.  If
+    //== that fails the body waits for a full search, after every other seeded body.
+
+    std::vector<sVertex> seed(mFound);
+
+    return Search(Body, &seed);
+}
+
+bool cRigidBodyIdentifier::Search(int Body, const std::vector<sVertex> *Seed)
+{
+    sBody &body = mBodies[Body];
+
+    mStatistics.Searched++;
+
+    std::vector<sVertex> best;
+    std::vector<sVertex> clique;
+
+    if(Seed)
+    {
+        if(Anchor(Body, (*Seed)[0], Seed, clique)<mSettings.MinMarkers || !Handed(body, clique))
+            return false;
+
+        Claim(Body, clique);
+        return true;
+    }
+
+    //== every point is tried as every marker.  A labeling found with anchors up to marker i
+    //== can only be beaten by one that does not contain them, which has at most count - i.
+
+    for(int m=0; m<body.MarkerCount && (int) best.size()<body.MarkerCount - m; m++)
+    {
+        for(int p=0; p<mCount && (int) best.size()<body.MarkerCount; p++)
+        {
+            if(mClaimed[p])
+                continue;
+
+            sVertex anchor;
+
+            anchor.Marker = m;
+            anchor.Point  = p;
+
+            if(Anchor(Body, anchor, 0, clique)>(int) best.size() && Handed(body, clique))
+                best = clique;
+        }
+    }
+
+    if((int) best.size()<mSettings.MinMarkers)
+        return false;
+
+    Claim(Body, best);
+    return true;
+}
+
+int cRigidBodyIdentifier::Anchor(int Body, const sVertex &Anchor, const std::vector<sVertex> *Seed,
+                                 std::vector<sVertex> &Clique)
+{
+    const sBody &body = mBodies[Body];
+
+    Clique.clear();
+
+    //== the anchor, then every free neighbor at one of the anchor marker's distances ==--
+
+    mVertices.clear();
+    mVertices.push_back(Anchor);
+
+    const sNeighbor *first, *last;
+
+    Neighbors(Anchor.Point, first, last);
+
+    for(int m=0; m<body.MarkerCount; m++)
+    {
+        if(m==Anchor.Marker)
+            continue;
+
+        sNeighbor low;
+
+        low.Distance = body.Distance[Anchor.Marker][m] - mSettings.Tolerance;
+        low.Point    = 0;
+
+        for(const sNeighbor *n=std::lower_bound(first, last, low);
+            n<last && n->Distance<=body.Distance[Anchor.Marker][m] + mSettings.Tolerance; n++)
+        {
+            if(!mClaimed[n->Point])
+            {
+                sVertex vertex;
+
+                vertex.Marker = m;
+                vertex.Point  = n->Point;
+
+                mVertices.push_back(vertex);
+            }
+        }
+    }
+
+    int vertices = (int) mVertices.size();
+
+    if(vertices<mSettings.MinMarkers)
+        return 0;
+
+    //== the anchor agrees with all of them by construction ==--
+
+    mSearch.Reset(vertices);
+
+    for(int v=1; v<vertices; v++)
+        mSearch.Connect(0, v);
+
+    for(int a=1; a<vertices; a++)
+        for(int b=a + 1; b<vertices; b++)
+            if(Agree(body, mVertices[a], mVertices[b]))
+                mSearch.Connect(a, b);
+
+    //== seed vertices agree with the anchor, so they are all in the graph ==--
+
+    const std::vector<int> *seed = 0;
+
+    if(Seed)
+    {
+        mSeedIndices.clear();
+
+        for(int s=0; s<(int) Seed->size(); s++)
+        {
+            for(int v=0; v<vertices; v++)
+            {
+                if(mVertices[v].Marker==(*Seed)[s].Marker && mVertices[v].Point==(*Seed)[s].Point)
+                {
+                    mSeedIndices.push_back(v);
+                    break;
+                }
+            }
+        }
+
+        if(mSeedIndices.size()==Seed->size())
+            seed = &mSeedIndices;
+    }
+
+    int size = mSearch.Search(mClique, mSettings.MinMarkers, body.MarkerCount, seed);
+
+    mStatistics.Nodes += mSearch.NodeCount();
+
+    for(int i=0; i<size; i++)
+        Clique.push_back(mVertices[mClique[i]]);
+
+    return size;
+}
+
+bool cRigidBodyIdentifier::Handed(const sBody &Body, const std::vector<sVertex> &Clique) const
+{
+    //== the fourth marker spanning the most volume with the first three decides, if it spans
+    //== enough that the tolerance can not flip the sign
+
+    if(Clique.size()<4)
+        return true;
+
+    const float *local[3] = { Body.Local[Clique[0].Marker], Body.Local[Clique[1].Marker], Body.Local[Clique[2].Marker] };
+
+    int   fourth = -1;
+    float volume = 0;
+
+    for(int v=3; v<(int) Clique.size(); v++)
+    {
+        float determinant = fabsf(Determinant(local[0], local[1], local[2], Body.Local[Clique[v].Marker]));
+
+        if(determinant>volume)
+        {
+            volume = determinant;
+            fourth = v;
+        }
+    }
+
+    if(volume<=6.0f*mSettings.Tolerance*Body.Diameter*Body.Diameter)
+        return true;
+
+    float world = Determinant(Position(Clique[0].Point), Position(Clique[1].Point), Position(Clique[2].Point),
+                              Position(Clique[fourth].Point));
+    float model = Determinant(local[0], local[1], local[2], Body.Local[Clique[fourth].Marker]);
+
+    return (world>0)==(model>0);
+}
+
+void cRigidBodyIdentifier::Claim(int Body, const std::vector<sVertex> &Clique)
+{
+    sBody &body = mBodies[Body];
+
+    body.Found = true;
+
+    for(int m=0; m<body.MarkerCount; m++)
+    {
+        body.Assigned[m] = -1;
+        body.Age[m]++;
+    }
+
+    for(int v=0; v<(int) Clique.size(); v++)
+    {
+        const sVertex &vertex = Clique[v];
+
+        body.Assigned[vertex.Marker] = vertex.Point;
+        body.Age[vertex.Marker]      = 0;
+        mClaimed[vertex.Point]       = 1;
+
+        for(int k=0; k<3; k++)
+            body.Previous[vertex.Marker][k] = Position(vertex.Point)[k];
+    }
+}
+
+void cRigidBodyIdentifier::Apply(cRigidBodySolver &Solver, const float *Points) const
+{
+    Solver.BeginFrame();
+
+    for(int b=0; b<(int) mBodies.size(); b++)
+    {
+        const sBody &body = mBodies[b];
+
+        if(!body.Found)
+            continue;
+
+        int definition = Solver.Definition(body.ID);
+
+        if(definition<0)
+            continue;
+
+        for(int m=0; m<body.MarkerCount; m++)
+            if(body.Assigned[m]>=0)
+                Solver.SetMarker(definition, m, &Points[3*body.Assigned[m]]);
+    }
+}
+
+void cRigidBodyIdentifier::Benchmark(int Bodies, int Clutter, int Frames, sBenchmark &Result)
+{
+    const float kNoise     = 0.0002f;       //== Marker noise, meters =============================----
+    const float kOcclusion = 0.05f;         //== Chance a marker is missing in a frame ============----
+    const float kSpin      = 0.05f;         //== Up to, radians per frame =========================----
+    const float kSpeed     = 0.005f;        //== Up to, meters per frame ==========================----
+    const float kSpacing   = 0.015f;        //== Closest two markers of a body, meters ============----
+
+    if(Bodies<1)  Bodies  = 1;
+    if(Clutter<0) Clutter = 0;
+    if(Frames<2)  Frames  = 2;
+
+    cRigidBodyIdentifier identifier;
+    cBenchmarkNoise random(2463534242u);
+
+    std::vector<float> position(3*Bodies), velocity(3*Bodies), rotation(4*Bodies), step(4*Bodies);
+    std::vector<float> clutter(3*Clutter);
+
+    for(int b=0; b<Bodies; b++)
+    {
+        float markers[3*8];
+        int   count = 4 + (int) (random.Uniform()*5);
+
+        for(int m=0; m<count; m++)
+        {
+            bool spaced = false;
+
+            while(!spaced)
+            {
+                float radius = 0.03f + 0.05f*random.Uniform();
+                float length = 0;
+
+                for(int k=0; k<3; k++)
+                {
+                    markers[3*m + k] = random.Normal();
+                    length          += markers[3*m + k]*markers[3*m + k];
+                }
+
+                length = radius/sqrtf(length);
+                spaced = true;
+
+                for(int k=0; k<3; k++)
+                    markers[3*m + k] *= length;
+
+                for(int o=0; o<m && spaced; o++)
+                    spaced = Distance(&markers[3*m], &markers[3*o])>=kSpacing;
+            }
+        }
+
+        identifier.AddDefinition(Core::cUID(2, b + 1), markers, count);
+
+        float q[4], axis[4], length = 0, norm = 0;
+
+        for(int k=0; k<4; k++)
+        {
+            q[k]    = random.Normal();
+            axis[k] = (k<3) ? random.Normal() : 0.0f;
+            length += q[k]*q[k];
+            norm   += axis[k]*axis[k];
+        }
+
+        float angle = 0.5f*kSpin*random.Uniform();
+
+        for(int k=0; k<4; k++)
+        {
+            rotation[4*b + k] = q[k]/sqrtf(length);
+            step[4*b + k]     = (k<3) ? axis[k]/sqrtf(norm)*sinf(angle) : cosf(angle);
+        }
+
+        for(int k=0; k<3; k++)
+        {
+            position[3*b + k] = random.Uniform();
+            velocity[3*b + k] = kSpeed*(2*random.Uniform() - 1);
+        }
+    }
+
+    for(int c=0; c<3*Clutter; c++)
+        clutter[c] = random.Uniform();
+
+    Core::cTimer timer;
+
+    std::vector<float> points, shuffled;
+    std::vector<int>   truth, slot;
+
+    double cold       = 0;
+    double elapsed    = 0;
+    long   visible    = 0;
+    long   correct    = 0;
+    long   labels     = 0;
+    long   wrong      = 0;
+    long   searched   = 0;
+
+    for(int f=0; f<Frames; f++)
+    {
+        //== move, observe, shuffle ==--
+
+        points.clear();
+        truth.clear();
+
+        for(int b=0; b<Bodies; b++)
+        {
+            float *q = &rotation[4*b];
+            const float *s = &step[4*b];
+
+            float next[4] = { s[3]*q[0] + s[0]*q[3] + s[1]*q[2] - s[2]*q[1],
+                              s[3]*q[1] - s[0]*q[2] + s[1]*q[3] + s[2]*q[0],
+                              s[3]*q[2] + s[0]*q[1] - s[1]*q[0] + s[2]*q[3],
+                              s[3]*q[3] - s[0]*q[0] - s[1]*q[1] - s[2]*q[2] };
+
+            float norm = sqrtf(next[0]*next[0] + next[1]*next[1] + next[2]*next[2] + next[3]*next[3]);
+
+            for(int k=0; k<4; k++)
+                q[k] = next[k]/norm;
+
+            for(int k=0; k<3; k++)
+            {
+                position[3*b + k] += velocity[3*b + k];
+
+                if(position[3*b + k]<0 || position[3*b + k]>1)
+                    velocity[3*b + k] = -velocity[3*b + k];
+            }
+
+            const sBody &body = identifier.mBodies[b];
+
+            for(int m=0; m<body.MarkerCount; m++)
+            {
+                if(random.Uniform()<kOcclusion)
+                    continue;
+
+                float world[3];
+
+                Rotate(q, body.Local[m], world);
+
+                for(int k=0; k<3; k++)
+                    points.push_back(world[k] + position[3*b + k] + kNoise*random.Normal());
+
+                truth.push_back(b*kMaxMarkers + m);
+            }
+        }
+
+        for(int c=0; c<Clutter; c++)
+        {
+            for(int k=0; k<3; k++)
+            {
+                clutter[3*c + k] += 0.002f*random.Normal();
+                points.push_back(clutter[3*c + k]);
+            }
+
+            truth.push_back(-1);
+        }
+
+        int count = (int) truth.size();
+
+        slot.resize(count);
+
+        for(int i=0; i<count; i++)
+            slot[i] = i;
+
+        for(int i=count - 1; i>0; i--)
+            std::swap(slot[i], slot[(int) (random.Uniform()*(i + 1))]);
+
+        shuffled.resize(3*count);
+
+        std::vector<int> label(count);
+
+        for(int i=0; i<count; i++)
+        {
+            for(int k=0; k<3; k++)
+                shuffled[3*slot[i] + k] = points[3*i + k];
+
+            label[slot[i]] = truth[i];
+        }
+
+        //== identify ==--
+
+        timer.CatchUp();
+
+        identifier.Identify(&shuffled[0], count);
+
+        if(f==0)
+        {
+            cold = timer.Elapsed();
+            continue;
+        }
+
+        elapsed  += timer.Elapsed();
+        searched += identifier.Statistics().Searched;
+
+        for(int i=0; i<count; i++)
+            if(label[i]>=0)
+                visible++;
+
+        for(int b=0; b<Bodies; b++)
+        {
+            if(!identifier.Found(b))
+                continue;
+
+            for(int m=0; m<identifier.mBodies[b].MarkerCount; m++)
+            {
+                int p = identifier.Point(b, m);
+
+                if(p<0)
+                    continue;
+
+                labels++;
+
+                if(label[p]==b*kMaxMarkers + m)
+                    correct++;
+                else
+                    wrong++;
+            }
+        }
+    }
+
+    Result.Bodies               = Bodies;
+    Result.Clutter              = Clutter;
+    Result.ColdMilliseconds     = 1e3*cold;
+    Result.MicrosecondsPerFrame = 1e6*elapsed/(Frames - 1);
+    Result.Recall               = (visible>0) ? (double) correct/visible : 0.0;
+    Result.Mislabeled           = (labels>0) ? (double) wrong/labels : 0.0;
+    Result.SearchedPerFrame     = (double) searched/(Frames - 1);
+}
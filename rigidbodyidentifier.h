@@ -0,0 +1,179 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Rigid body marker identification.  Given a frame's unlabeled 3D markers, finds which of them
+//== are which marker of which rigid body definition.  Distances between the markers of a rigid
+//== body do not change, so a labeling is a set of (definition marker, point) pairs that agree
+//== pairwise on distance: a clique in the correspondence graph, and the best labeling is the
+//== largest one.
+//==
+//== The graphs stay small by anchoring: a point's neighbors within the largest body diameter
+//== are gathered when it is first used (sorted by distance), and a pair (marker i, point p) only
+//== connects to the neighbors of p whose distance matches one of marker i's.  Each anchor's
+//== graph is searched with Core::cCliqueSearch.
+//==
+//== Bodies found last frame are seeded: each marker takes the nearest point to where it was
+//== last seen.  If those agree and every marker is seen, the body is done without building a
+//== graph; otherwise their consistent part seeds the search around it.  Bodies are identified
+//== one after another and claim their points, seeded ones first.
+//==
+//== Distances can not tell a body from its mirror image; a labeling of four or more markers
+//== that spans a volume is checked for handedness.
+//==
+
+#ifndef __CAMERALIBRARY__RIGIDBODYIDENTIFIER_H__
+#define __CAMERALIBRARY__RIGIDBODYIDENTIFIER_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <vector>
+#include "Core/UID.h"
+#include "Core/CliqueSearch.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cRigidBodySolver;
+
+    class cRigidBodyIdentifier
+    {
+    public:
+        static const int kMaxMarkers = 20;      //== As cRigidBodySolver ========================----
+
+        struct sSettings
+        {
+            float   Tolerance;                  //== Allowed distance mismatch, meters ==========----
+            int     MinMarkers;                 //== Smallest labeling accepted ==================----
+            float   MotionRadius;               //== Marker travel per frame for seeding, meters -----
+        };
+
+        cRigidBodyIdentifier();
+
+        void    SetSettings(const sSettings &Settings)      { mSettings = Settings; }
+        const sSettings & Settings() const                  { return mSettings; }
+
+        //== Definitions: Count body space marker positions (x,y,z), at most kMaxMarkers ==--
+
+        int     AddDefinition(const Core::cUID &ID, const float *Markers, int Count);
+        void    ClearDefinitions();
+        int     DefinitionCount() const             { return (int) mBodies.size(); }
+
+        //== Labels Count points (x,y,z), returns the number of bodies found ==--
+
+        int     Identify(const float *Points, int Count);
+
+        bool    Found(int Body) const               { return mBodies[Body].Found; }
+        int     Point(int Body, int Marker) const   { return mBodies[Body].Assigned[Marker]; }  //== -1: none
+        const Core::cUID & ID(int Body) const       { return mBodies[Body].ID; }
+
+        //== BeginFrame() and SetMarker() for every labeled point of the solver's definitions with
+        //== the same IDs; Solve() is left to the caller.
+
+        void    Apply(cRigidBodySolver &Solver, const float *Points) const;
+
+        struct sStatistics
+        {
+            int     Seeded;                     //== Bodies confirmed from last frame alone =====----
+            int     Searched;                   //== Bodies that needed a clique search =========----
+            long    Nodes;                      //== Clique search nodes ========================----
+        };
+
+        const sStatistics & Statistics() const      { return mStatistics; }
+
+        //== Bodies of four to eight markers packed into a cubic meter with clutter points, all
+        //== moving, with measurement noise and random occlusions.  Reports the first (unseeded)
+        //== frame's cost, the steady per frame cost and how well markers were labeled.
+
+        struct sBenchmark
+        {
+            int     Bodies;
+            int     Clutter;
+            double  ColdMilliseconds;
+            double  MicrosecondsPerFrame;
+            double  Recall;                     //== Visible body markers labeled correctly =====----
+            double  Mislabeled;                 //== Labels that are wrong, of all labels =======----
+            double  SearchedPerFrame;
+        };
+
+        static void Benchmark(int Bodies, int Clutter, int Frames, sBenchmark &Result);
+
+    private:
+        struct sBody
+        {
+            Core::cUID ID;
+            int     MarkerCount;
+            float   Local[kMaxMarkers][3];
+            float   Distance[kMaxMarkers][kMaxMarkers];
+            float   Diameter;
+
+            bool    Found;
+            int     Assigned[kMaxMarkers];      //== Point index, -1: not seen ==================----
+            float   Previous[kMaxMarkers][3];   //== Where each marker was last seen ============----
+            int     Age[kMaxMarkers];           //== Frames since ===============================----
+        };
+
+        struct sVertex
+        {
+            int     Marker;
+            int     Point;
+        };
+
+        struct sNeighbor
+        {
+            float   Distance;
+            int     Point;
+
+            bool operator<(const sNeighbor &Other) const    { return Distance<Other.Distance; }
+        };
+
+        unsigned int Cell(int X, int Y, int Z) const;       //== Unmasked hash ==========----
+        int     CellCoordinate(float Value) const;
+        const float * Position(int Point) const     { return &mPoints[3*Point]; }
+
+        void    BuildGrid();
+        void    Neighbors(int Point, const sNeighbor *&First, const sNeighbor *&Last);
+        int     Nearest(const float Position[3], float Radius) const;     //== Unclaimed ======----
+
+        bool    Seed(int Body);
+        bool    Search(int Body, const std::vector<sVertex> *Seed);
+        int     Anchor(int Body, const sVertex &Anchor, const std::vector<sVertex> *Seed,
+                       std::vector<sVertex> &Clique);
+        bool    Agree(const sBody &Body, const sVertex &A, const sVertex &B) const;
+        bool    Handed(const sBody &Body, const std::vector<sVertex> &Clique) const;
+        void    Claim(int Body, const std::vector<sVertex> &Clique);
+
+        sSettings                   mSettings;
+        std::vector<sBody>          mBodies;
+        float                       mNeighborRadius;    //== Largest diameter + tolerance ====----
+
+        //== This frame ==--
+
+        const float *               mPoints;
+        int                         mCount;
+        std::vector<char>           mClaimed;
+
+        float                       mCellSize;
+        int                         mCellMask;
+        std::vector<int>            mCellStart;         //== Hash bucket -> first slot ======----
+        std::vector<int>            mCellPoints;        //== Ordered by bucket ==============----
+        std::vector<int>            mBucket;            //== Of every point =================----
+
+        std::vector<int>            mNeighborRange;     //== Point -> first, last; -1: not yet --
+        std::vector<sNeighbor>      mNeighbors;         //== Ascending distance per point ===----
+        std::vector<int>            mVisited;           //== Buckets of one neighbor query ==----
+
+        Core::cCliqueSearch         mSearch;
+        std::vector<sVertex>        mVertices;
+        std::vector<int>            mClique;
+        std::vector<int>            mSeedIndices;
+        std::vector<sVertex>        mFound;
+        std::vector<sVertex>        mBest;
+        std::vector<int>            mOrder;
+        sStatistics                 mStatistics;
+    };
+}
+
+#endif
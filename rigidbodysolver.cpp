@@ -0,0 +1,772 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "rigidbodysolver.h"
+#include "benchmarknoise.h"
+#include "Core/Timer.h"
+
+#if !defined(__PLATFORM__LINUX__)
+#include "Core/RigidBody.h"
+#include "Core/RigidBodyBundle.h"
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define RIGIDBODYSOLVER_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace CameraLibrary;
+
+namespace
+{
+    //== Newton steps on the characteristic quartic.  The start is an upper bound off by half the
+    //== squared residual sum, steps converge quadratically from there.
+
+    const int kNewtonSteps = 8;
+
+    //== Four bodies processed together, one per lane.  The math runs in double: the adjugate of
+    //== N - lambda I cancels to about the eigenvalue gap cubed, which single precision loses for
+    //== nearly collinear marker sets.
+
+#ifdef RIGIDBODYSOLVER_SSE2
+    class cLanes
+    {
+    public:
+        cLanes() { }
+        cLanes(double Value) : mLow(_mm_set1_pd(Value)), mHigh(_mm_set1_pd(Value)) { }
+        cLanes(__m128d Low, __m128d High) : mLow(Low), mHigh(High) { }
+
+        static cLanes Load(const float *Values)
+        {
+            __m128 values = _mm_loadu_ps(Values);
+
+            return cLanes(_mm_cvtps_pd(values), _mm_cvtps_pd(_mm_movehl_ps(values, values)));
+        }
+
+        void    Store(float *Values) const
+        {
+            _mm_storeu_ps(Values, _mm_movelh_ps(_mm_cvtpd_ps(mLow), _mm_cvtpd_ps(mHigh)));
+        }
+
+        friend cLanes operator+(cLanes A, cLanes B) { return cLanes(_mm_add_pd(A.mLow, B.mLow), _mm_add_pd(A.mHigh, B.mHigh)); }
+        friend cLanes operator-(cLanes A, cLanes B) { return cLanes(_mm_sub_pd(A.mLow, B.mLow), _mm_sub_pd(A.mHigh, B.mHigh)); }
+        friend cLanes operator*(cLanes A, cLanes B) { return cLanes(_mm_mul_pd(A.mLow, B.mLow), _mm_mul_pd(A.mHigh, B.mHigh)); }
+        friend cLanes operator/(cLanes A, cLanes B) { return cLanes(_mm_div_pd(A.mLow, B.mLow), _mm_div_pd(A.mHigh, B.mHigh)); }
+
+        friend cLanes Sqrt(cLanes A)                { return cLanes(_mm_sqrt_pd(A.mLow), _mm_sqrt_pd(A.mHigh)); }
+        friend cLanes Max(cLanes A, cLanes B)       { return cLanes(_mm_max_pd(A.mLow, B.mLow), _mm_max_pd(A.mHigh, B.mHigh)); }
+        friend cLanes Abs(cLanes A)
+        {
+            __m128d sign = _mm_set1_pd(-0.0);
+
+            return cLanes(_mm_andnot_pd(sign, A.mLow), _mm_andnot_pd(sign, A.mHigh));
+        }
+
+        //== Masks: all bits set where true ==--
+
+        friend cLanes Greater(cLanes A, cLanes B)   { return cLanes(_mm_cmpgt_pd(A.mLow, B.mLow), _mm_cmpgt_pd(A.mHigh, B.mHigh)); }
+        friend cLanes Select(cLanes Mask, cLanes A, cLanes B)
+        {
+            return cLanes(_mm_or_pd(_mm_and_pd(Mask.mLow, A.mLow), _mm_andnot_pd(Mask.mLow, B.mLow)),
+                          _mm_or_pd(_mm_and_pd(Mask.mHigh, A.mHigh), _mm_andnot_pd(Mask.mHigh, B.mHigh)));
+        }
+
+    private:
+        __m128d mLow;                           //== Lanes 0 and 1 ===========================----
+        __m128d mHigh;
+    };
+#else
+    class cLanes
+    {
+    public:
+        cLanes() { }
+        cLanes(double Value) { for(int i=0; i<4; i++) m[i] = Value; }
+
+        static cLanes Load(const float *Values)     { cLanes r; for(int i=0; i<4; i++) r.m[i] = Values[i]; return r; }
+        void    Store(float *Values) const          { for(int i=0; i<4; i++) Values[i] = (float) m[i]; }
+
+        friend cLanes operator+(cLanes A, cLanes B) { for(int i=0; i<4; i++) A.m[i] += B.m[i]; return A; }
+        friend cLanes operator-(cLanes A, cLanes B) { for(int i=0; i<4; i++) A.m[i] -= B.m[i]; return A; }
+        friend cLanes operator*(cLanes A, cLanes B) { for(int i=0; i<4; i++) A.m[i] *= B.m[i]; return A; }
+        friend cLanes operator/(cLanes A, cLanes B) { for(int i=0; i<4; i++) A.m[i] /= B.m[i]; return A; }
+
+        friend cLanes Sqrt(cLanes A)                { for(int i=0; i<4; i++) A.m[i] = sqrt(A.m[i]); return A; }
+        friend cLanes Max(cLanes A, cLanes B)       { for(int i=0; i<4; i++) A.m[i] = std::max(A.m[i], B.m[i]); return A; }
+        friend cLanes Abs(cLanes A)                 { for(int i=0; i<4; i++) A.m[i] = fabs(A.m[i]); return A; }
+
+        //== Masks: 1 where true ==--
+
+        friend cLanes Greater(cLanes A, cLanes B)   { for(int i=0; i<4; i++) A.m[i] = (A.m[i]>B.m[i]) ? 1.0 : 0.0; return A; }
+        friend cLanes Select(cLanes Mask, cLanes A, cLanes B)
+        {
+            for(int i=0; i<4; i++) A.m[i] = (Mask.m[i]!=0) ? A.m[i] : B.m[i];
+            return A;
+        }
+
+    private:
+        double  m[4];
+    };
+#endif
+
+    //== Adjugate of a symmetric 4x4 matrix (upper triangle given) and its determinant, through
+    //== the 2x2 minors of the first two and the last two rows
+
+    void Adjugate(const cLanes M[4][4], cLanes Adjugate[4][4], cLanes &Determinant)
+    {
+        cLanes s0 = M[0][0]*M[1][1] - M[1][0]*M[0][1];
+        cLanes s1 = M[0][0]*M[1][2] - M[1][0]*M[0][2];
+        cLanes s2 = M[0][0]*M[1][3] - M[1][0]*M[0][3];
+        cLanes s3 = M[0][1]*M[1][2] - M[1][1]*M[0][2];
+        cLanes s4 = M[0][1]*M[1][3] - M[1][1]*M[0][3];
+        cLanes s5 = M[0][2]*M[1][3] - M[1][2]*M[0][3];
+
+        cLanes c5 = M[2][2]*M[3][3] - M[3][2]*M[2][3];
+        cLanes c4 = M[2][1]*M[3][3] - M[3][1]*M[2][3];
+        cLanes c3 = M[2][1]*M[3][2] - M[3][1]*M[2][2];
+        cLanes c2 = M[2][0]*M[3][3] - M[3][0]*M[2][3];
+        cLanes c1 = M[2][0]*M[3][2] - M[3][0]*M[2][2];
+        cLanes c0 = M[2][0]*M[3][1] - M[3][0]*M[2][1];
+
+        Determinant = s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0;
+
+        //== symmetric, so only the upper triangle is computed ==--
+
+        Adjugate[0][0] = M[1][1]*c5 - M[1][2]*c4 + M[1][3]*c3;
+        Adjugate[0][1] = M[0][2]*c4 - M[0][1]*c5 - M[0][3]*c3;
+        Adjugate[0][2] = M[3][1]*s5 - M[3][2]*s4 + M[3][3]*s3;
+        Adjugate[0][3] = M[2][2]*s4 - M[2][1]*s5 - M[2][3]*s3;
+        Adjugate[1][1] = M[0][0]*c5 - M[0][2]*c2 + M[0][3]*c1;
+        Adjugate[1][2] = M[3][2]*s2 - M[3][0]*s5 - M[3][3]*s1;
+        Adjugate[1][3] = M[2][0]*s5 - M[2][2]*s2 + M[2][3]*s1;
+        Adjugate[2][2] = M[3][0]*s4 - M[3][1]*s2 + M[3][3]*s0;
+        Adjugate[2][3] = M[2][1]*s2 - M[2][0]*s4 - M[2][3]*s0;
+        Adjugate[3][3] = M[2][0]*s3 - M[2][1]*s1 + M[2][2]*s0;
+
+        for(int i=1; i<4; i++)
+            for(int j=0; j<i; j++)
+                Adjugate[i][j] = Adjugate[j][i];
+    }
+
+    void Rotate(const float Q[4], const float V[3], float Result[3])
+    {
+        //== v + 2 w (u x v) + 2 u x (u x v), u = (x, y, z) ==--
+
+        float t[3] = { 2*(Q[1]*V[2] - Q[2]*V[1]), 2*(Q[2]*V[0] - Q[0]*V[2]), 2*(Q[0]*V[1] - Q[1]*V[0]) };
+
+        Result[0] = V[0] + Q[3]*t[0] + Q[1]*t[2] - Q[2]*t[1];
+        Result[1] = V[1] + Q[3]*t[1] + Q[2]*t[0] - Q[0]*t[2];
+        Result[2] = V[2] + Q[3]*t[2] + Q[0]*t[1] - Q[1]*t[0];
+    }
+}
+
+cRigidBodySolver::cRigidBodySolver()
+{
+    mSettings.MinMarkers        = 3;
+    mSettings.MaxErrorPerMarker = 0.01f;
+}
+
+int cRigidBodySolver::AddDefinition(const Core::cUID &ID, const float *Markers, int Count)
+{
+    int index = (int) mBodies.size();
+
+    mBodies.push_back(sBody());
+
+    sBody &body = mBodies.back();
+
+    body.ID          = ID;
+    body.MarkerCount = std::max(0, std::min(Count, (int) kMaxMarkers));
+    body.Rotation[3] = 1;
+
+    for(int m=0; m<body.MarkerCount; m++)
+        for(int k=0; k<3; k++)
+            body.Local[m][k] = Markers[3*m + k];
+
+    //== body space never changes, it goes into its lane once ==--
+
+    if(index%kLanes==0)
+        mGroups.push_back(sGroup());
+
+    sGroup &group = mGroups.back();
+    int     lane  = index%kLanes;
+
+    for(int m=0; m<body.MarkerCount; m++)
+        for(int k=0; k<3; k++)
+            group.Local[m][k][lane] = body.Local[m][k];
+
+    group.Markers = std::max(group.Markers, body.MarkerCount);
+
+    return index;
+}
+
+void cRigidBodySolver::ClearDefinitions()
+{
+    mBodies.clear();
+    mGroups.clear();
+}
+
+int cRigidBodySolver::Definition(const Core::cUID &ID) const
+{
+    for(int b=0; b<(int) mBodies.size(); b++)
+        if(mBodies[b].ID==ID)
+            return b;
+
+    return -1;
+}
+
+void cRigidBodySolver::BeginFrame()
+{
+    for(int b=0; b<(int) mBodies.size(); b++)
+    {
+        memset(mBodies[b].Quality, 0, sizeof(mBodies[b].Quality));
+        mBodies[b].Seen = 0;
+    }
+}
+
+void cRigidBodySolver::SetMarker(int Body, int Marker, const float Position[3], float Quality)
+{
+    sBody &body = mBodies[Body];
+
+    if(Marker<0 || Marker>=body.MarkerCount || Quality<=0)
+        return;
+
+    if(body.Quality[Marker]==0)
+        body.Seen++;
+
+    body.Quality[Marker]   = Quality;
+    body.World[Marker][0]  = Position[0];
+    body.World[Marker][1]  = Position[1];
+    body.World[Marker][2]  = Position[2];
+}
+
+float cRigidBodySolver::MarkerResidual(int Body, int Marker) const
+{
+    const sBody &body = mBodies[Body];
+
+    return (Marker>=0 && Marker<body.MarkerCount) ? body.Residual[Marker] : 0.0f;
+}
+
+int cRigidBodySolver::Solve()
+{
+    int tracked = 0;
+
+    for(int g=0; g<(int) mGroups.size(); g++)
+    {
+        Pack(g);
+        SolveGroup(mGroups[g]);
+        Unpack(g);
+    }
+
+    for(int b=0; b<(int) mBodies.size(); b++)
+        if(mBodies[b].Tracked)
+            tracked++;
+
+    return tracked;
+}
+
+void cRigidBodySolver::Pack(int Group)
+{
+    sGroup &group = mGroups[Group];
+
+    for(int lane=0; lane<kLanes; lane++)
+    {
+        int body = Group*kLanes + lane;
+
+        //== lanes of missing or starved bodies solve nothing ==--
+
+        if(body>=(int) mBodies.size() || mBodies[body].Seen<mSettings.MinMarkers)
+        {
+            for(int m=0; m<group.Markers; m++)
+                group.Weight[m][lane] = 0;
+
+            continue;
+        }
+
+        const sBody &source = mBodies[body];
+
+        //== world positions relative to the first seen marker ==--
+
+        int first = 0;
+
+        while(source.Quality[first]==0)
+            first++;
+
+        for(int k=0; k<3; k++)
+            group.Reference[k][lane] = source.World[first][k];
+
+        for(int m=0; m<group.Markers; m++)
+        {
+            float weight = (m<source.MarkerCount) ? source.Quality[m] : 0.0f;
+
+            group.Weight[m][lane] = weight;
+
+            for(int k=0; k<3; k++)
+                group.World[m][k][lane] = (weight>0) ? source.World[m][k] - source.World[first][k] : 0.0f;
+        }
+    }
+}
+
+void cRigidBodySolver::SolveGroup(sGroup &Group) const
+{
+    //== weighted sums over the markers ==--
+
+    cLanes total(0.0);
+    cLanes sumLocal[3] = { 0.0, 0.0, 0.0 };
+    cLanes sumWorld[3] = { 0.0, 0.0, 0.0 };
+    cLanes normLocal(0.0);
+    cLanes normWorld(0.0);
+    cLanes s[3][3];
+
+    for(int i=0; i<3; i++)
+        for(int j=0; j<3; j++)
+            s[i][j] = 0.0;
+
+    for(int m=0; m<Group.Markers; m++)
+    {
+        cLanes weight = cLanes::Load(Group.Weight[m]);
+        cLanes local[3], world[3], weighted[3];
+
+        total = total + weight;
+
+        for(int k=0; k<3; k++)
+        {
+            local[k]    = cLanes::Load(Group.Local[m][k]);
+            world[k]    = cLanes::Load(Group.World[m][k]);
+            weighted[k] = weight*local[k];
+
+            sumLocal[k] = sumLocal[k] + weighted[k];
+            sumWorld[k] = sumWorld[k] + weight*world[k];
+            normLocal   = normLocal + weighted[k]*local[k];
+            normWorld   = normWorld + weight*world[k]*world[k];
+        }
+
+        for(int i=0; i<3; i++)
+            for(int j=0; j<3; j++)
+                s[i][j] = s[i][j] + weighted[i]*world[j];
+    }
+
+    //== centered: S = sum w l p^T - W cl cw^T, G = sum w |x|^2 - W |c|^2 ==--
+
+    cLanes inverse = cLanes(1.0)/Max(total, cLanes(1e-20));
+
+    cLanes centerLocal[3], centerWorld[3];
+
+    for(int k=0; k<3; k++)
+    {
+        centerLocal[k] = sumLocal[k]*inverse;
+        centerWorld[k] = sumWorld[k]*inverse;
+
+        normLocal = normLocal - sumLocal[k]*centerLocal[k];
+        normWorld = normWorld - sumWorld[k]*centerWorld[k];
+    }
+
+    for(int i=0; i<3; i++)
+        for(int j=0; j<3; j++)
+            s[i][j] = s[i][j] - sumLocal[i]*centerWorld[j];
+
+    //== Horn's matrix, ordered w x y z ==--
+
+    cLanes n[4][4];
+
+    n[0][0] = s[0][0] + s[1][1] + s[2][2];
+    n[0][1] = s[1][2] - s[2][1];
+    n[0][2] = s[2][0] - s[0][2];
+    n[0][3] = s[0][1] - s[1][0];
+    n[1][1] = s[0][0] - s[1][1] - s[2][2];
+    n[1][2] = s[0][1] + s[1][0];
+    n[1][3] = s[2][0] + s[0][2];
+    n[2][2] = s[1][1] - s[0][0] - s[2][2];
+    n[2][3] = s[1][2] + s[2][1];
+    n[3][3] = s[2][2] - s[0][0] - s[1][1];
+
+    for(int i=1; i<4; i++)
+        for(int j=0; j<i; j++)
+            n[i][j] = n[j][i];
+
+    //== characteristic polynomial l^4 + c2 l^2 + c1 l + c0 (N is traceless) ==--
+
+    cLanes squares(0.0);
+
+    for(int i=0; i<3; i++)
+        for(int j=0; j<3; j++)
+            squares = squares + s[i][j]*s[i][j];
+
+    cLanes determinantS = s[0][0]*(s[1][1]*s[2][2] - s[1][2]*s[2][1])
+                        - s[0][1]*(s[1][0]*s[2][2] - s[1][2]*s[2][0])
+                        + s[0][2]*(s[1][0]*s[2][1] - s[1][1]*s[2][0]);
+
+    cLanes adjugate[4][4];
+    cLanes c0;
+
+    Adjugate(n, adjugate, c0);
+
+    cLanes c2 = cLanes(-2.0)*squares;
+    cLanes c1 = cLanes(-8.0)*determinantS;
+
+    //== largest eigenvalue: Newton from (G_local + G_world) / 2 ==--
+
+    cLanes lambda = cLanes(0.5)*(normLocal + normWorld);
+    cLanes tiny(1e-60);
+
+    for(int i=0; i<kNewtonSteps; i++)
+    {
+        cLanes square = lambda*lambda;
+        cLanes value  = (square + c2)*square + c1*lambda + c0;
+        cLanes slope  = cLanes(4.0)*square*lambda + cLanes(2.0)*c2*lambda + c1;
+
+        slope  = Select(Greater(Abs(slope), tiny), slope, cLanes(1.0));
+        lambda = lambda - value/slope;
+    }
+
+    //== eigenvector: the longest column of adj(N - lambda I) ==--
+
+    cLanes m[4][4];
+
+    for(int i=0; i<4; i++)
+        for(int j=0; j<4; j++)
+            m[i][j] = (i==j) ? n[i][j] - lambda : n[i][j];
+
+    cLanes determinant;
+
+    Adjugate(m, adjugate, determinant);
+
+    cLanes q[4] = { adjugate[0][0], adjugate[0][1], adjugate[0][2], adjugate[0][3] };
+    cLanes longest = q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3];
+
+    for(int c=1; c<4; c++)
+    {
+        cLanes length = adjugate[c][0]*adjugate[c][0] + adjugate[c][1]*adjugate[c][1] +
+                        adjugate[c][2]*adjugate[c][2] + adjugate[c][3]*adjugate[c][3];
+        cLanes longer = Greater(length, longest);
+
+        for(int k=0; k<4; k++)
+            q[k] = Select(longer, adjugate[c][k], q[k]);
+
+        longest = Select(longer, length, longest);
+    }
+
+    //== a (nearly) zero adjugate means a degenerate fit: too few or collinear markers ==--
+
+    cLanes scale  = Abs(lambda)*Abs(lambda)*Abs(lambda);
+    cLanes valid  = Greater(longest, cLanes(1e-20)*scale*scale + tiny);
+    cLanes length = cLanes(1.0)/Sqrt(Select(valid, longest, cLanes(1.0)));
+
+    cLanes w = Select(valid, q[0]*length, cLanes(1.0));
+    cLanes x = Select(valid, q[1]*length, cLanes(0.0));
+    cLanes y = Select(valid, q[2]*length, cLanes(0.0));
+    cLanes z = Select(valid, q[3]*length, cLanes(0.0));
+
+    x.Store(Group.Rotation[0]);
+    y.Store(Group.Rotation[1]);
+    z.Store(Group.Rotation[2]);
+    w.Store(Group.Rotation[3]);
+    Select(valid, cLanes(1.0), cLanes(0.0)).Store(Group.Valid);
+
+    //== rotation matrix, position = reference + cw - R cl ==--
+
+    cLanes two(2.0);
+    cLanes r[3][3];
+
+    r[0][0] = cLanes(1.0) - two*(y*y + z*z);
+    r[0][1] = two*(x*y - w*z);
+    r[0][2] = two*(x*z + w*y);
+    r[1][0] = two*(x*y + w*z);
+    r[1][1] = cLanes(1.0) - two*(x*x + z*z);
+    r[1][2] = two*(y*z - w*x);
+    r[2][0] = two*(x*z - w*y);
+    r[2][1] = two*(y*z + w*x);
+    r[2][2] = cLanes(1.0) - two*(x*x + y*y);
+
+    cLanes translation[3];
+
+    for(int k=0; k<3; k++)
+    {
+        translation[k] = centerWorld[k] - (r[k][0]*centerLocal[0] + r[k][1]*centerLocal[1] + r[k][2]*centerLocal[2]);
+
+        (translation[k] + cLanes::Load(Group.Reference[k])).Store(Group.Position[k]);
+    }
+
+    //== residuals of the seen markers and their weighted mean ==--
+
+    cLanes error(0.0);
+
+    for(int mk=0; mk<Group.Markers; mk++)
+    {
+        cLanes weight = cLanes::Load(Group.Weight[mk]);
+        cLanes local[3] = { cLanes::Load(Group.Local[mk][0]), cLanes::Load(Group.Local[mk][1]), cLanes::Load(Group.Local[mk][2]) };
+        cLanes squared(0.0);
+
+        for(int k=0; k<3; k++)
+        {
+            cLanes d = r[k][0]*local[0] + r[k][1]*local[1] + r[k][2]*local[2] + translation[k] -
+                       cLanes::Load(Group.World[mk][k]);
+
+            squared = squared + d*d;
+        }
+
+        cLanes residual = Select(Greater(weight, cLanes(0.0)), Sqrt(squared), cLanes(0.0));
+
+        residual.Store(Group.Residual[mk]);
+        error = error + weight*residual;
+    }
+
+    (error*inverse).Store(Group.Error);
+}
+
+void cRigidBodySolver::Unpack(int Group)
+{
+    const sGroup &group = mGroups[Group];
+
+    for(int lane=0; lane<kLanes; lane++)
+    {
+        int b = Group*kLanes + lane;
+
+        if(b>=(int) mBodies.size())
+            break;
+
+        sBody &body = mBodies[b];
+
+        bool tracked = body.Seen>=mSettings.MinMarkers && group.Valid[lane]!=0 &&
+                       group.Error[lane]<=mSettings.MaxErrorPerMarker;
+
+        if(!tracked)
+        {
+            //== keep the last pose, like an occluded body ==--
+
+            body.Tracked = false;
+            body.FramesUntracked++;
+            continue;
+        }
+
+        float q[4] = { group.Rotation[0][lane], group.Rotation[1][lane], group.Rotation[2][lane], group.Rotation[3][lane] };
+
+        //== q and -q are the same rotation, stay on the last frame's side ==--
+
+        float dot  = q[0]*body.Rotation[0] + q[1]*body.Rotation[1] + q[2]*body.Rotation[2] + q[3]*body.Rotation[3];
+        float sign = (dot<0) ? -1.0f : 1.0f;
+
+        for(int k=0; k<4; k++)
+            body.Rotation[k] = sign*q[k];
+
+        for(int k=0; k<3; k++)
+            body.Position[k] = group.Position[k][lane];
+
+        for(int m=0; m<body.MarkerCount; m++)
+            body.Residual[m] = group.Residual[m][lane];
+
+        body.Error           = group.Error[lane];
+        body.Tracked         = true;
+        body.FramesUntracked = 0;
+    }
+}
+
+#if !defined(__PLATFORM__LINUX__)
+
+void cRigidBodySolver::Fill(std::vector<Core::cRigidBody> &RigidBodies) const
+{
+    RigidBodies.resize(mBodies.size());
+
+    for(int b=0; b<(int) mBodies.size(); b++)
+    {
+        const sBody &source = mBodies[b];
+        Core::cRigidBody &body = RigidBodies[b];
+
+        body.ID              = source.ID;
+        body.Selected        = false;
+        body.MarkerCount     = source.MarkerCount;
+        body.Tracked         = source.Tracked;
+        body.FramesUntracked = source.FramesUntracked;
+        body.ErrorPerMarker  = source.Error;
+
+        body.SetPosition(Core::cVector3f(source.Position[0], source.Position[1], source.Position[2]));
+        body.SetRotation(Core::cQuaternionf(source.Rotation[0], source.Rotation[1], source.Rotation[2], source.Rotation[3]));
+
+        for(int m=0; m<Core::cRigidBody::kMaxRigidBodyMarkers; m++)
+        {
+            bool seen = m<source.MarkerCount && source.Quality[m]>0;
+
+            body.MarkerTracked[m] = seen && source.Tracked;
+            body.MarkerQuality[m] = seen ? source.Quality[m] : 0.0f;
+        }
+    }
+}
+
+void cRigidBodySolver::Fill(Core::cRigidBodyBundle &Bundle) const
+{
+    std::vector<Core::cRigidBody> bodies;
+
+    Fill(bodies);
+    Bundle.SetRigidBodies(bodies);
+}
+
+#endif
+
+void cRigidBodySolver::Benchmark(int Bodies, int Frames, double Rate, sBenchmark &Result)
+{
+    const float kNoise     = 0.0002f;       //== Marker noise, meters =============================----
+    const float kOcclusion = 0.1f;          //== Chance a marker is missing in a frame ============----
+    const float kSpin      = 12.0f;         //== Up to, radians per second ========================----
+    const float kSpeed     = 2.0f;          //== Up to, meters per second =========================----
+
+    if(Bodies<1) Bodies = 1;
+    if(Frames<1) Frames = 1;
+
+    cRigidBodySolver solver;
+    cBenchmarkNoise random(88172645u);
+
+    std::vector<float> position(3*Bodies), velocity(3*Bodies), axis(3*Bodies), spin(Bodies);
+    std::vector<float> rotation(4*Bodies);
+
+    for(int b=0; b<Bodies; b++)
+    {
+        float markers[3*8];
+        int   count = 4 + (int) (random.Uniform()*5);
+
+        for(int m=0; m<count; m++)
+        {
+            float radius = 0.03f + 0.05f*random.Uniform();
+
+            for(int k=0; k<3; k++)
+                markers[3*m + k] = radius*(2*random.Uniform() - 1);
+        }
+
+        solver.AddDefinition(Core::cUID(1, b + 1), markers, count);
+
+        float length = 0;
+
+        for(int k=0; k<3; k++)
+        {
+            position[3*b + k] = 4*random.Uniform() - 2;
+            velocity[3*b + k] = kSpeed*(2*random.Uniform() - 1)/(float) sqrt(3.0);
+            axis[3*b + k]     = random.Normal();
+            length           += axis[3*b + k]*axis[3*b + k];
+        }
+
+        length = sqrtf(length);
+
+        for(int k=0; k<3; k++)
+            axis[3*b + k] /= length;
+
+        spin[b] = kSpin*random.Uniform();
+
+        rotation[4*b]     = 0;
+        rotation[4*b + 1] = 0;
+        rotation[4*b + 2] = 0;
+        rotation[4*b + 3] = 1;
+    }
+
+    Core::cTimer timer;
+
+    double elapsed       = 0;
+    double rotationError = 0;
+    double positionError = 0;
+    long   samples       = 0;
+    float  interval      = (float) (1.0/Rate);
+
+    for(int f=0; f<Frames; f++)
+    {
+        //== move every body, observe its markers ==--
+
+        std::vector<float> observed;
+
+        for(int b=0; b<Bodies; b++)
+        {
+            float half = 0.5f*spin[b]*interval;
+            float step[4] = { axis[3*b]*sinf(half), axis[3*b + 1]*sinf(half), axis[3*b + 2]*sinf(half), cosf(half) };
+            float *q = &rotation[4*b];
+
+            float next[4] = { step[3]*q[0] + step[0]*q[3] + step[1]*q[2] - step[2]*q[1],
+                              step[3]*q[1] - step[0]*q[2] + step[1]*q[3] + step[2]*q[0],
+                              step[3]*q[2] + step[0]*q[1] - step[1]*q[0] + step[2]*q[3],
+                              step[3]*q[3] - step[0]*q[0] - step[1]*q[1] - step[2]*q[2] };
+
+            float norm = sqrtf(next[0]*next[0] + next[1]*next[1] + next[2]*next[2] + next[3]*next[3]);
+
+            for(int k=0; k<4; k++)
+                q[k] = next[k]/norm;
+
+            for(int k=0; k<3; k++)
+            {
+                position[3*b + k] += velocity[3*b + k]*interval;
+
+                if(fabsf(position[3*b + k])>2)
+                    velocity[3*b + k] = -velocity[3*b + k];
+            }
+        }
+
+        observed.resize(3*kMaxMarkers*Bodies);
+
+        std::vector<char> seen(kMaxMarkers*Bodies);
+
+        for(int b=0; b<Bodies; b++)
+        {
+            const sBody &body = solver.mBodies[b];
+
+            for(int m=0; m<body.MarkerCount; m++)
+            {
+                float world[3];
+
+                Rotate(&rotation[4*b], body.Local[m], world);
+
+                for(int k=0; k<3; k++)
+                    observed[3*(b*kMaxMarkers + m) + k] = world[k] + position[3*b + k] + kNoise*random.Normal();
+
+                seen[b*kMaxMarkers + m] = (random.Uniform()>=kOcclusion);
+            }
+        }
+
+        //== hand the labeled markers over and solve ==--
+
+        timer.CatchUp();
+
+        solver.BeginFrame();
+
+        for(int b=0; b<Bodies; b++)
+            for(int m=0; m<solver.mBodies[b].MarkerCount; m++)
+                if(seen[b*kMaxMarkers + m])
+                    solver.SetMarker(b, m, &observed[3*(b*kMaxMarkers + m)]);
+
+        solver.Solve();
+
+        elapsed += timer.Elapsed();
+
+        for(int b=0; b<Bodies; b++)
+        {
+            if(!solver.Tracked(b))
+                continue;
+
+            const float *q = solver.Rotation(b);
+            const float *t = &rotation[4*b];
+
+            //== angle of conj(t) q; acos of the dot product would lose the small ones ==--
+
+            double w = (double) t[3]*q[3] + (double) t[0]*q[0] + (double) t[1]*q[1] + (double) t[2]*q[2];
+            double x = (double) t[3]*q[0] - (double) t[0]*q[3] - (double) t[1]*q[2] + (double) t[2]*q[1];
+            double y = (double) t[3]*q[1] + (double) t[0]*q[2] - (double) t[1]*q[3] - (double) t[2]*q[0];
+            double z = (double) t[3]*q[2] - (double) t[0]*q[1] + (double) t[1]*q[0] - (double) t[2]*q[3];
+
+            double angle = 2*atan2(sqrt(x*x + y*y + z*z), fabs(w))*57.29577951;
+
+            rotationError += angle*angle;
+
+            for(int k=0; k<3; k++)
+            {
+                float d = solver.Position(b)[k] - position[3*b + k];
+                positionError += d*d;
+            }
+
+            samples++;
+        }
+    }
+
+    Result.Bodies               = Bodies;
+    Result.MicrosecondsPerFrame = 1e6*elapsed/Frames;
+    Result.NanosecondsPerBody   = 1e9*elapsed/((double) Frames*Bodies);
+    Result.BodiesAtRate         = (Result.NanosecondsPerBody>0) ? 1e9/(Rate*Result.NanosecondsPerBody) : 0.0;
+    Result.RotationError        = (samples>0) ? sqrt(rotationError/samples) : 0.0;
+    Result.PositionError        = (samples>0) ? sqrt(positionError/samples) : 0.0;
+}
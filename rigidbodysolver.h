@@ -0,0 +1,148 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Rigid body pose solver.  Every definition lists its markers in body space; each frame the
+//== caller hands over the labeled world positions it found (by definition and marker index) and
+//== Solve() fits all bodies at once with Horn's closed-form quaternion method:
+//==
+//==   - the weighted cross covariance of body and world markers gives Horn's symmetric 4x4
+//==     matrix N, whose largest eigenvalue's eigenvector is the rotation
+//==   - the eigenvalue is found by a fixed number of Newton steps on N's characteristic quartic
+//==     from an upper bound (Theobald's QCP), the eigenvector is the largest column of the
+//==     adjugate of N - lambda I, so there are no iterations to converge and no branches
+//==   - bodies are laid out in groups of four and solved as four SIMD lanes in double precision
+//==     (SSE2 with a scalar fallback), untracked markers simply have zero weight
+//==
+//== World positions are stored relative to one of each body's markers so single precision keeps
+//== sub-micron accuracy anywhere in the volume.  Results fill the cRigidBody vector that
+//== cRigidBodyBundle::SetRigidBodies() takes.
+//==
+
+#ifndef __CAMERALIBRARY__RIGIDBODYSOLVER_H__
+#define __CAMERALIBRARY__RIGIDBODYSOLVER_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <vector>
+#include "Core/Platform.h"
+#include "Core/UID.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace Core
+{
+    class cRigidBody;
+    class cRigidBodyBundle;
+}
+
+namespace CameraLibrary
+{
+    class cRigidBodySolver
+    {
+    public:
+        static const int kMaxMarkers = 20;      //== Core::cRigidBody::kMaxRigidBodyMarkers ====----
+        static const int kLanes      = 4;
+
+        struct sSettings
+        {
+            int     MinMarkers;                 //== Tracked markers needed for a pose =========----
+            float   MaxErrorPerMarker;          //== Above this a pose is rejected, meters =====----
+        };
+
+        cRigidBodySolver();
+
+        void    SetSettings(const sSettings &Settings)      { mSettings = Settings; }
+        const sSettings & Settings() const                  { return mSettings; }
+
+        //== Definitions: Count body space marker positions (x,y,z), at most kMaxMarkers ==--
+
+        int     AddDefinition(const Core::cUID &ID, const float *Markers, int Count);
+        void    ClearDefinitions();
+        int     DefinitionCount() const             { return (int) mBodies.size(); }
+        int     Definition(const Core::cUID &ID) const;     //== -1 if unknown ============----
+
+        //== Per frame: BeginFrame(), SetMarker() for every labeled marker, Solve() ==--
+
+        void    BeginFrame();
+        void    SetMarker(int Body, int Marker, const float Position[3], float Quality = 1.0f);
+        int     Solve();                            //== Returns the tracked body count ========----
+
+        //== Results ==--
+
+        bool    Tracked(int Body) const             { return mBodies[Body].Tracked; }
+        const float * Position(int Body) const      { return mBodies[Body].Position; }
+        const float * Rotation(int Body) const      { return mBodies[Body].Rotation; }  //== x,y,z,w
+        float   ErrorPerMarker(int Body) const      { return mBodies[Body].Error; }
+        float   MarkerResidual(int Body, int Marker) const;
+
+#if !defined(__PLATFORM__LINUX__)
+        void    Fill(std::vector<Core::cRigidBody> &RigidBodies) const;
+        void    Fill(Core::cRigidBodyBundle &Bundle) const;
+#endif
+
+        //== Bodies of four to eight markers spinning through the volume with measurement noise
+        //== and random occlusions.  Reports the solve cost per frame and per body, how many
+        //== bodies fit in one core at Rate Hz, and the pose errors.
+
+        struct sBenchmark
+        {
+            int     Bodies;
+            double  MicrosecondsPerFrame;
+            double  NanosecondsPerBody;
+            double  BodiesAtRate;               //== Per core, at Rate Hz ======================----
+            double  RotationError;              //== RMS, degrees ==============================----
+            double  PositionError;              //== RMS, meters ===============================----
+        };
+
+        static void Benchmark(int Bodies, int Frames, double Rate, sBenchmark &Result);
+
+    private:
+        struct sBody
+        {
+            Core::cUID ID;
+            int     MarkerCount;
+            float   Local[kMaxMarkers][3];      //== Body space ================================----
+
+            float   World[kMaxMarkers][3];      //== This frame's input ========================----
+            float   Quality[kMaxMarkers];       //== 0: not seen ===============================----
+            int     Seen;
+
+            bool    Tracked;
+            int     FramesUntracked;
+            float   Position[3];
+            float   Rotation[4];                //== x, y, z, w ================================----
+            float   Error;
+            float   Residual[kMaxMarkers];
+        };
+
+        //== One group of four bodies, structure of arrays: [marker][axis][lane] ==--
+
+        struct sGroup
+        {
+            float   Local[kMaxMarkers][3][kLanes];
+            float   World[kMaxMarkers][3][kLanes];
+            float   Weight[kMaxMarkers][kLanes];
+            float   Reference[3][kLanes];       //== Subtracted from World =====================----
+
+            float   Rotation[4][kLanes];        //== Results, x y z w ==========================----
+            float   Position[3][kLanes];
+            float   Error[kLanes];
+            float   Residual[kMaxMarkers][kLanes];
+            float   Valid[kLanes];              //== Nonzero: well defined rotation ============----
+
+            int     Markers;                    //== Most markers of the group's bodies ========----
+        };
+
+        void    Pack(int Group);
+        void    SolveGroup(sGroup &Group) const;
+        void    Unpack(int Group);
+
+        sSettings                   mSettings;
+        std::vector<sBody>          mBodies;
+        std::vector<sGroup>         mGroups;
+    };
+}
+
+#endif
@@ -0,0 +1,69 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include "smoothedvectorprocessing.h"
+#include "vectorresults.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    const float kMaxAmount  = 0.99f;        //== Keep some of every new measurement ========----
+    const float kTrendRatio = 0.5f;         //== Trend factor relative to alpha ============----
+
+    float Alpha(float Amount)
+    {
+        if(Amount<0)          Amount = 0;
+        if(Amount>kMaxAmount) Amount = kMaxAmount;
+
+        return 1.0f - Amount;
+    }
+}
+
+cSmoothedVectorProcessing::cSmoothedVectorProcessing()
+{
+    mFilter.SetCount(1);
+}
+
+void cSmoothedVectorProcessing::Recenter()
+{
+    cModuleVectorProcessing::Recenter();
+
+    mFilter.Reset();
+}
+
+void cSmoothedVectorProcessing::Smooth(float  AmountX, float AmountY, float AmountZ,
+    float   AmountRotational,
+    double &mRawX,   double &mRawY,     double &mRawZ,
+    double &mRawYaw, double &mRawPitch, double &mRawRoll)
+{
+    float amount[3] = { AmountX, AmountY, AmountZ };
+
+    for(int axis=0; axis<3; axis++)
+        mFilter.SetPositionSmoothing(axis, Alpha(amount[axis]), kTrendRatio*Alpha(amount[axis]));
+
+    mFilter.SetRotationSmoothing(Alpha(AmountRotational), kTrendRatio*Alpha(AmountRotational));
+
+    double quaternion[4];
+
+    OrientationToQuaternion(mRawYaw, mRawPitch, mRawRoll, quaternion);
+
+    float position[3] = { (float) mRawX, (float) mRawY, (float) mRawZ };
+    float rotation[4] = { (float) quaternion[0], (float) quaternion[1], (float) quaternion[2], (float) quaternion[3] };
+
+    mFilter.SetInput(0, position, rotation);
+    mFilter.Update();
+
+    mFilter.Position(0, position);
+    mFilter.Rotation(0, rotation);
+
+    for(int i=0; i<4; i++)
+        quaternion[i] = rotation[i];
+
+    mRawX = position[0];
+    mRawY = position[1];
+    mRawZ = position[2];
+
+    QuaternionToOrientation(quaternion, mRawYaw, mRawPitch, mRawRoll);
+}
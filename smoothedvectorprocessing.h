@@ -0,0 +1,47 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== cModuleVectorProcessing with its Smooth() hook implemented as a Holt double-exponential
+//== filter (Core/DoubleExponentialSmoothing.h): position per axis and orientation on the
+//== quaternion manifold, so smoothing no longer lags behind steady motion the way plain
+//== exponential smoothing does.
+//==
+//== The Smoothing settings (0 none, towards 1 heavier) set each filter's alpha to 1-Amount and
+//== its trend factor to half of that.  Use it in place of cModuleVectorProcessing.
+//==
+//== The filter is a bank of one; the bank pads its storage to whole SSE2 blocks, so this one pose
+//== still runs through the vector loop rather than the scalar remainder.
+//==
+
+#ifndef __CAMERALIBRARY__SMOOTHEDVECTORPROCESSING_H__
+#define __CAMERALIBRARY__SMOOTHEDVECTORPROCESSING_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include "modulevectorprocessing.h"
+#include "Core/DoubleExponentialSmoothing.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cSmoothedVectorProcessing : public cModuleVectorProcessing
+    {
+    public:
+        cSmoothedVectorProcessing();
+
+        virtual void Recenter();                        //== Also restarts the filters ======----
+
+        virtual void Smooth(float  AmountX, float AmountY, float AmountZ,
+            float   AmountRotational,
+            double &mRawX,   double &mRawY,     double &mRawZ,
+            double &mRawYaw, double &mRawPitch, double &mRawRoll);
+
+    private:
+        Core::cDoubleExponentialSmoothing<1> mFilter;
+    };
+}
+
+#endif
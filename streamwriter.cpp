@@ -0,0 +1,596 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#ifdef WIN32
+#include <windows.h>
+#include <malloc.h>
+#else
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE                                 //== O_DIRECT ==--
+#endif
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#endif
+#include <stdio.h>
+
+#include "streamwriter.h"
+
+#include "Core/UID.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+#ifdef WIN32
+    unsigned long __stdcall WriterThreadProc(void *Param)
+    {
+        ((cStreamWriter*) Param)->WriterThread();
+        return 0;
+    }
+#else
+    void WriterThreadProc(void *Param)
+    {
+        ((cStreamWriter*) Param)->WriterThread();
+    }
+#endif
+
+    unsigned char * AlignedAlloc(int Size)
+    {
+#ifdef WIN32
+        return (unsigned char*) _aligned_malloc(Size, kStreamWriterAlignment);
+#else
+        void *memory = 0;
+
+        if(posix_memalign(&memory, kStreamWriterAlignment, Size)!=0)
+            return 0;
+
+        return (unsigned char*) memory;
+#endif
+    }
+
+    void AlignedFree(unsigned char *Memory)
+    {
+#ifdef WIN32
+        _aligned_free(Memory);
+#else
+        free(Memory);
+#endif
+    }
+
+    int AlignUp(int Size)
+    {
+        return (Size + kStreamWriterAlignment-1) & ~(kStreamWriterAlignment-1);
+    }
+}
+
+cStreamWriter::cStreamWriter(int BufferSize, int MaxBufferCount)
+    : mBufferSize(AlignUp(BufferSize>0 ? BufferSize : kStreamWriterBufferSize))
+    , mMaxBufferCount(MaxBufferCount<2 ? 2 : MaxBufferCount)
+    , mOpen(false)
+    , mDirectIO(false)
+    , mFileHandle(0)
+    , mFileDescriptor(-1)
+    , mActive(0)
+    , mLogicalSize(0)
+    , mSubmittedOffset(0)
+    , mRunning(false)
+    , mInFlight(0)
+    , mPeakInFlight(0)
+    , mCaptureStalls(0)
+    , mWriteErrors(0)
+    , mBytesDropped(0)
+    , mBytesCompleted(0)
+    , mFirstSubmitTime(0)
+    , mLastCompleteTime(0)
+{
+}
+
+cStreamWriter::~cStreamWriter()
+{
+    Close();
+}
+
+//== Open / Close ======================================================================================----
+
+bool cStreamWriter::Open(const char *Filename, bool DirectIO)
+{
+    Close();
+
+    if(!OpenFile(Filename, DirectIO))
+        return false;
+
+    mLogicalSize     = 0;
+    mSubmittedOffset = 0;
+    mInFlight        = 0;
+    mPeakInFlight    = 0;
+    mCaptureStalls   = 0;
+    mWriteErrors     = 0;
+    mBytesDropped    = 0;
+    mBytesCompleted  = 0;
+    mFirstSubmitTime = 0;
+    mLastCompleteTime= 0;
+
+    mClock.CatchUp();
+
+    mRunning = true;
+
+#ifdef WIN32
+    mThread.StartThread((void*) WriterThreadProc, this);
+#else
+    mThread.StartThread(WriterThreadProc, this);
+#endif
+
+    mOpen   = true;
+    mActive = AcquireBuffer();
+
+    if(mActive==0)
+    {
+        //== Not even one buffer, nothing could ever be written.  Stop the writer thread and
+        //== close the file rather than stay open and drop everything ==--
+
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+bool cStreamWriter::Close()
+{
+    if(!mOpen)
+        return true;
+
+    //== Push out the final partial buffer.  Direct I/O needs the length padded to the
+    //== alignment, the padding is trimmed by the truncation below.
+
+    if(mActive && mActive->Used>0)
+        SubmitActive();
+    else if(mActive)
+        mFreeBuffers.push_back(mActive);
+
+    mActive = 0;
+
+    WaitForIdle();
+
+    mRunning = false;
+    mWorkAvailable.Trigger();
+    mThread.StopThread();
+
+    CloseFile();
+
+    for(int i=0; i<(int) mAllBuffers.size(); i++)
+    {
+        AlignedFree(mAllBuffers[i]->Data);
+        delete mAllBuffers[i];
+    }
+
+    mAllBuffers.clear();
+    mFreeBuffers.clear();
+    mPendingBuffers.clear();
+
+    mOpen = false;
+
+    return (mWriteErrors==0);
+}
+
+//== Statistics ========================================================================================----
+
+void cStreamWriter::Statistics(sStatistics &Stats) const
+{
+    LockItem &lock = const_cast<LockItem&>(mLock);
+
+    lock.Lock();
+
+    Stats.BytesWritten   = (long long) mLogicalSize;
+    Stats.BytesCompleted = mBytesCompleted;
+    Stats.QueueDepth     = mInFlight;
+    Stats.PeakQueueDepth = mPeakInFlight;
+    Stats.BufferCount    = (int) mAllBuffers.size();
+    Stats.CaptureStalls  = mCaptureStalls;
+    Stats.WriteErrors    = mWriteErrors;
+    Stats.BytesDropped   = mBytesDropped;
+
+    double elapsed = mLastCompleteTime - mFirstSubmitTime;
+
+    Stats.ThroughputMBps = (elapsed>0) ? (mBytesCompleted/(1024.0*1024.0))/elapsed : 0;
+
+    lock.UnLock();
+}
+
+//== Benchmark =========================================================================================----
+
+bool cStreamWriter::Benchmark(const char *Filename, int Megabytes, bool DirectIO, sBenchmark &Result)
+{
+    memset(&Result, 0, sizeof(Result));
+
+    //== A TinyObjectOnly record: record header, frame header and 40 objects of 8 bytes ==--
+
+    const int kRecordSize = 5 + 48 + 40*8;
+
+    unsigned char record[kRecordSize];
+
+    for(int i=0; i<kRecordSize; i++)
+        record[i] = (unsigned char) (i*31);
+
+    long long total = (long long) (Megabytes>0 ? Megabytes : 1)*1024*1024;
+    long long count = (total + kRecordSize-1)/kRecordSize;
+
+    cStreamWriter writer;
+
+    if(!writer.Open(Filename, DirectIO))
+        return false;
+
+    Core::cTimer timer;
+
+    for(long long i=0; i<count; i++)
+        writer.WriteData(record, kRecordSize);
+
+    double appendSeconds = timer.Elapsed();
+
+    sStatistics stats;
+    writer.Statistics(stats);
+
+    Result.DirectIO       = writer.DirectIO();
+    Result.BufferCount    = stats.BufferCount;
+
+    bool success = writer.Close();
+
+    double totalSeconds = timer.Elapsed();
+
+    writer.Statistics(stats);
+
+    double megabytes = (count*kRecordSize)/(1024.0*1024.0);
+
+    Result.AppendMBps     = appendSeconds>0 ? megabytes/appendSeconds : 0;
+    Result.ThroughputMBps = totalSeconds>0  ? megabytes/totalSeconds  : 0;
+    Result.PeakQueueDepth = stats.PeakQueueDepth;
+    Result.CaptureStalls  = stats.CaptureStalls;
+    Result.WriteErrors    = stats.WriteErrors;
+
+    remove(Filename);
+
+    return success;
+}
+
+//== cIWriter ==========================================================================================----
+
+void cStreamWriter::WriteData(const unsigned char *buffer, unsigned int bufferSize)
+{
+    Append(buffer, bufferSize);
+}
+
+void cStreamWriter::WriteString(const std::string &str)
+{
+    int length = (int) str.size();
+
+    WriteInt(length);
+    Append(str.data(), length);
+}
+
+void cStreamWriter::WriteWString(const std::wstring &str)
+{
+    int length = (int) str.size();
+
+    WriteInt(length);
+    Append(str.data(), length*sizeof(wchar_t));
+}
+
+void cStreamWriter::WriteUID(const Core::cUID &id)
+{
+    WriteLongLong((long long) id.HighBits());
+    WriteLongLong((long long) id.LowBits());
+}
+
+//== Buffer Management =================================================================================----
+
+void cStreamWriter::AppendSlow(const unsigned char *Data, unsigned int Size)
+{
+    while(Size>0 && mActive)
+    {
+        unsigned int space = (unsigned int) (mBufferSize - mActive->Used);
+        unsigned int count = (Size<space) ? Size : space;
+
+        memcpy(mActive->Data + mActive->Used, Data, count);
+
+        mActive->Used += count;
+        mLogicalSize  += count;
+        Data          += count;
+        Size          -= count;
+
+        if(mActive->Used==mBufferSize)
+        {
+            SubmitActive();
+            mActive = AcquireBuffer();
+        }
+    }
+
+    if(Size>0 && mOpen)
+    {
+        //== No buffer to put it in.  Later data can not be kept either without leaving a hole,
+        //== so the stream ends here and the loss is reported on Close() ==--
+
+        mLock.Lock();
+
+        if(mBytesDropped==0)
+            mWriteErrors++;
+
+        mBytesDropped += Size;
+
+        mLock.UnLock();
+    }
+}
+
+void cStreamWriter::SubmitActive()
+{
+    sBuffer *buffer = mActive;
+
+    mActive = 0;
+
+    //== Only the final buffer is ever partial ==--
+
+    buffer->Submitted = buffer->Used;
+
+    if(mDirectIO)
+    {
+        buffer->Submitted = AlignUp(buffer->Used);
+        memset(buffer->Data + buffer->Used, 0, buffer->Submitted - buffer->Used);
+    }
+
+    buffer->FileOffset = mSubmittedOffset;
+    mSubmittedOffset  += buffer->Used;
+
+    mLock.Lock();
+
+    if(mFirstSubmitTime==0)
+        mFirstSubmitTime = mClock.Elapsed();
+
+    mInFlight++;
+
+    if(mInFlight>mPeakInFlight)
+        mPeakInFlight = mInFlight;
+
+    mPendingBuffers.push_back(buffer);
+
+    mLock.UnLock();
+
+    mWorkAvailable.Trigger();
+}
+
+cStreamWriter::sBuffer * cStreamWriter::AcquireBuffer()
+{
+    for(;;)
+    {
+        mLock.Lock();
+
+        sBuffer *buffer = 0;
+
+        if(!mFreeBuffers.empty())
+        {
+            buffer = mFreeBuffers.back();
+            mFreeBuffers.pop_back();
+        }
+        else if((int) mAllBuffers.size()<mMaxBufferCount)
+        {
+            //== grow the pool rather than wait on the disk ==--
+
+            unsigned char *data = AlignedAlloc(mBufferSize);
+
+            if(data)
+            {
+                buffer = new sBuffer();
+                buffer->Data = data;
+                mAllBuffers.push_back(buffer);
+            }
+        }
+
+        bool stalled = (buffer==0);
+
+        if(stalled)
+            mCaptureStalls++;
+
+        mLock.UnLock();
+
+        if(buffer)
+        {
+            buffer->Used       = 0;
+            buffer->Submitted  = 0;
+            buffer->FileOffset = 0;
+            return buffer;
+        }
+
+        if(mAllBuffers.empty())
+            return 0;                               //== out of memory ==--
+
+        //== Every buffer is in flight, the disk can not keep up ==--
+
+        mBufferReleased.Wait(100);
+    }
+}
+
+void cStreamWriter::ReleaseBuffer(sBuffer *Buffer, long long BytesWritten)
+{
+    mLock.Lock();
+
+    if(BytesWritten<0)
+        mWriteErrors++;
+    else
+        mBytesCompleted += (BytesWritten<Buffer->Used) ? BytesWritten : Buffer->Used;
+
+    mLastCompleteTime = mClock.Elapsed();
+
+    mInFlight--;
+    mFreeBuffers.push_back(Buffer);
+
+    mLock.UnLock();
+
+    mBufferReleased.Trigger();
+}
+
+void cStreamWriter::WaitForIdle()
+{
+    for(;;)
+    {
+        mLock.Lock();
+        int inFlight = mInFlight;
+        mLock.UnLock();
+
+        if(inFlight==0)
+            return;
+
+        mBufferReleased.Wait(100);
+    }
+}
+
+//== Writer Thread =====================================================================================----
+
+void cStreamWriter::WriterThread()
+{
+    for(;;)
+    {
+        sBuffer *buffer = 0;
+
+        mLock.Lock();
+
+        if(!mPendingBuffers.empty())
+        {
+            buffer = mPendingBuffers.front();
+            mPendingBuffers.pop_front();
+        }
+
+        mLock.UnLock();
+
+        if(buffer==0)
+        {
+            if(!mRunning)
+                break;
+
+            mWorkAvailable.Wait(100);
+            continue;
+        }
+
+        bool success = WriteBlock(buffer, buffer->Submitted);
+
+        ReleaseBuffer(buffer, success ? buffer->Submitted : -1);
+    }
+
+    mThread.mThreadRunning = false;
+}
+
+//== Platform File Access ==============================================================================----
+
+bool cStreamWriter::OpenFile(const char *Filename, bool DirectIO)
+{
+    mDirectIO = DirectIO;
+
+#ifdef WIN32
+    DWORD flags = FILE_ATTRIBUTE_NORMAL;
+
+    if(DirectIO)
+        flags |= FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH;
+
+    HANDLE file = CreateFileA(Filename, GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, flags, 0);
+
+    if(file==INVALID_HANDLE_VALUE)
+        return false;
+
+    mFileHandle = file;
+#else
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+    mFileDescriptor = -1;
+
+    if(DirectIO)
+        mFileDescriptor = open(Filename, flags | O_DIRECT, 0644);
+
+    if(mFileDescriptor<0)
+    {
+        //== not every file system supports O_DIRECT (e.g. tmpfs) ==--
+
+        mDirectIO       = false;
+        mFileDescriptor = open(Filename, flags, 0644);
+    }
+
+    if(mFileDescriptor<0)
+        return false;
+#endif
+
+    //== remember the name for truncation after unbuffered writes ==--
+
+    mFilename = Filename;
+
+    return true;
+}
+
+void cStreamWriter::CloseFile()
+{
+#ifdef WIN32
+    if(mFileHandle==0)
+        return;
+
+    CloseHandle((HANDLE) mFileHandle);
+    mFileHandle = 0;
+
+    //== Unbuffered handles can only be positioned on sector boundaries, trim the padding
+    //== through a regular handle.
+
+    HANDLE file = CreateFileA(mFilename.c_str(), GENERIC_WRITE, 0, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+
+    if(file!=INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER size;
+        size.QuadPart = (LONGLONG) mLogicalSize;
+
+        SetFilePointerEx(file, size, 0, FILE_BEGIN);
+        SetEndOfFile(file);
+        CloseHandle(file);
+    }
+#else
+    if(mFileDescriptor<0)
+        return;
+
+    if(ftruncate(mFileDescriptor, (off_t) mLogicalSize)!=0)
+        mWriteErrors++;
+
+    close(mFileDescriptor);
+    mFileDescriptor = -1;
+#endif
+}
+
+bool cStreamWriter::WriteBlock(sBuffer *Buffer, int Size)
+{
+#ifdef WIN32
+    OVERLAPPED position;
+    memset(&position, 0, sizeof(position));
+
+    position.Offset     = (DWORD) (Buffer->FileOffset & 0xFFFFFFFF);
+    position.OffsetHigh = (DWORD) (Buffer->FileOffset >> 32);
+
+    DWORD written = 0;
+
+    return (WriteFile((HANDLE) mFileHandle, Buffer->Data, (DWORD) Size, &written, &position)!=0
+            && written==(DWORD) Size);
+#else
+    int offset = 0;
+
+    while(offset<Size)
+    {
+        ssize_t result = pwrite(mFileDescriptor, Buffer->Data + offset, Size - offset,
+                                (off_t) (Buffer->FileOffset + offset));
+
+        if(result<0)
+        {
+            if(errno==EINTR)
+                continue;
+
+            return false;
+        }
+
+        offset += (int) result;
+    }
+
+    return true;
+#endif
+}
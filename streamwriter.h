@@ -0,0 +1,186 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Streaming take writer.  Unlike cSerializer, which keeps everything it is given in memory, this
+//== cIWriter appends into a small pool of sector-aligned buffers and hands each full buffer to the
+//== disk asynchronously, so memory use is bounded no matter how long a recording runs.
+//==
+//== A dedicated writer thread issues positional writes, pwrite on Linux and offset WriteFile on
+//== Windows, so the thread appending to the stream never blocks on the disk.
+//==
+//== With direct I/O enabled the file is opened with O_DIRECT / FILE_FLAG_NO_BUFFERING.  The last
+//== buffer is zero padded to the alignment and the file is truncated to its logical size on Close().
+//==
+//== The writing thread only ever waits when every buffer up to MaxBufferCount is in flight, i.e.
+//== when the disk sustainably cannot keep up.  Such waits are counted as capture stalls.
+//==
+//== The stream is append-only: Seek() only succeeds for the current position.
+//==
+//== If no buffer can be allocated at all the writer stops accepting data: everything from then on
+//== is counted in BytesDropped, the loss counts as one write error and Close() returns false.
+//== Tell() and the file on disk only ever cover the bytes that were kept.
+//==
+
+#ifndef __CAMERALIBRARY__STREAMWRITER_H__
+#define __CAMERALIBRARY__STREAMWRITER_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include "cameralibraryglobals.h"
+#include "threading.h"
+#include "lock.h"
+
+#include "Core/IWriter.h"
+#include "Core/Timer.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    const int kStreamWriterAlignment     = 4096;             //== sector/page alignment for direct I/O
+    const int kStreamWriterBufferSize    = 4*1024*1024;      //== size of each aligned buffer
+    const int kStreamWriterMaxBufferCount = 16;              //== upper bound on buffered memory
+
+    class cStreamWriter : public Core::cIWriter
+    {
+    public:
+        cStreamWriter(int BufferSize = kStreamWriterBufferSize, int MaxBufferCount = kStreamWriterMaxBufferCount);
+        virtual ~cStreamWriter();
+
+        bool            Open (const char *Filename, bool DirectIO = true);
+        bool            Close();                    //== Drain, truncate & close.  False on I/O error.
+        bool            IsOpen() const { return mOpen; }
+        bool            DirectIO() const { return mDirectIO; }  //== False if the file system refused it
+
+        struct sStatistics
+        {
+            long long   BytesWritten;               //== Logical bytes accepted from caller ===----
+            long long   BytesCompleted;             //== Bytes confirmed written to disk ======----
+            double      ThroughputMBps;             //== Completed bytes over time spent writing -
+            int         QueueDepth;                 //== Buffers currently in flight ==========----
+            int         PeakQueueDepth;
+            int         BufferCount;                //== Buffers allocated so far =============----
+            int         CaptureStalls;              //== Times the writing thread had to wait =----
+            int         WriteErrors;
+            long long   BytesDropped;               //== Never buffered, out of memory ========----
+        };
+
+        void            Statistics(sStatistics &Stats) const;
+
+        //== Appends Megabytes of take sized records (a frame header and 40 objects) to Filename
+        //== as fast as the caller can, then closes and deletes the file.  Reports the rate the
+        //== caller saw, the rate through Close(), i.e. to disk, and how often the caller waited.
+
+        struct sBenchmark
+        {
+            bool        DirectIO;                   //== As opened ============================----
+            double      AppendMBps;                 //== Caller side, up to the last record ===----
+            double      ThroughputMBps;             //== Including the final drain ============----
+            int         PeakQueueDepth;
+            int         BufferCount;
+            int         CaptureStalls;
+            int         WriteErrors;
+        };
+
+        static bool     Benchmark(const char *Filename, int Megabytes, bool DirectIO, sBenchmark &Result);
+
+        //== Core::cIWriter ==--
+
+        virtual void    WriteData( const unsigned char *buffer, unsigned int bufferSize );
+        virtual void    WriteInt( int val )              { Append( &val, sizeof( val ) ); }
+        virtual void    WriteLongLong( long long val )   { Append( &val, sizeof( val ) ); }
+        virtual void    WriteShort( short val )          { Append( &val, sizeof( val ) ); }
+        virtual void    WriteDouble( double val )        { Append( &val, sizeof( val ) ); }
+        virtual void    WriteFloat( float val )          { Append( &val, sizeof( val ) ); }
+        virtual void    WriteBool( bool val )            { unsigned char b = val ? 1 : 0; Append( &b, 1 ); }
+        virtual void    WriteString( const std::string &str );
+        virtual void    WriteWString( const std::wstring &str );
+        virtual void    WriteUID( const Core::cUID &id );
+        virtual void    WriteByte( unsigned char val )   { Append( &val, 1 ); }
+
+        virtual unsigned long long Tell() const          { return mLogicalSize; }
+        virtual bool    Seek( unsigned long long pos )   { return pos==mLogicalSize; }
+        virtual unsigned long long Size() const          { return mLogicalSize; }
+
+        //== Internal use, thread entry point needs to be public ==--
+
+        void            WriterThread();
+
+    private:
+        struct sBuffer
+        {
+            unsigned char *    Data;
+            int                Used;
+            int                Submitted;           //== Bytes handed to the writer, aligned ---
+            unsigned long long FileOffset;
+        };
+
+        inline void     Append(const void *Data, unsigned int Size)
+        {
+            if(mActive && mActive->Used+(int) Size<=mBufferSize)
+            {
+                //== fast path, almost every field lands here ==--
+
+                memcpy(mActive->Data + mActive->Used, Data, Size);
+
+                mActive->Used += Size;
+                mLogicalSize  += Size;
+            }
+            else
+            {
+                AppendSlow((const unsigned char*) Data, Size);
+            }
+        }
+
+        void            AppendSlow(const unsigned char *Data, unsigned int Size);
+        void            SubmitActive();
+        sBuffer *       AcquireBuffer();
+        void            ReleaseBuffer(sBuffer *Buffer, long long BytesWritten);
+        void            WaitForIdle();
+
+        bool            OpenFile(const char *Filename, bool DirectIO);
+        void            CloseFile();
+        bool            WriteBlock(sBuffer *Buffer, int Size);
+
+        int                   mBufferSize;
+        int                   mMaxBufferCount;
+        bool                  mOpen;
+        bool                  mDirectIO;
+        std::string           mFilename;
+
+        void *                mFileHandle;          //== Windows HANDLE =====================----
+        int                   mFileDescriptor;      //== POSIX descriptor ===================----
+
+        std::vector<sBuffer*> mAllBuffers;
+        std::vector<sBuffer*> mFreeBuffers;
+        std::deque<sBuffer*>  mPendingBuffers;      //== Writer thread work queue ===========----
+        sBuffer *             mActive;
+
+        unsigned long long    mLogicalSize;
+        unsigned long long    mSubmittedOffset;
+
+        ThreadInfo            mThread;
+        LockItem              mLock;
+        cEvent                mWorkAvailable;
+        cEvent                mBufferReleased;
+        volatile bool         mRunning;
+
+        int                   mInFlight;
+        int                   mPeakInFlight;
+        int                   mCaptureStalls;
+        int                   mWriteErrors;
+        long long             mBytesDropped;
+        long long             mBytesCompleted;
+        Core::cTimer          mClock;               //== Started by Open() ==================----
+        double                mFirstSubmitTime;
+        double                mLastCompleteTime;
+    };
+}
+
+#endif
@@ -556,7 +556,7 @@ int WINAPI WinMain(	HINSTANCE	hInstance,			// Instance
                    LPSTR		lpCmdLine,			// Command Line Parameters
                    int			nCmdShow)			// Window Show State
 {
-    return main(0,0);
+    return main(__argc, __argv);
 }
 
 bool FullscreenToggle()
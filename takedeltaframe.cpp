@@ -0,0 +1,826 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "takedeltaframe.h"
+#include "mappedreader.h"
+#include "benchmarknoise.h"
+
+#include "Core/IReader.h"
+#include "Core/IWriter.h"
+#include "Core/Serializer.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    enum eDeltaFlags
+    {
+        FlagKey     = 0x01,                     //== No reference, intra prediction only ======----
+        FlagAligned = 0x02,                     //== Object i references previous object i ====----
+        FlagEntropy = 0x04,                     //== Residuals are range coded ================----
+        FlagModel   = 0x08,                     //== Residuals update the entropy model =======----
+        FlagInvalid = 0x10,                     //== Recorded frame was invalid ===============----
+        FlagMotion  = 0x20                      //== Referenced objects predicted in motion ===----
+    };
+
+    const int          kMatchDistance     = 8*256;      //== Max reference distance, 1/256 px --
+    const int          kMaxObjectBytes    = 25;         //== Reference + four 5 byte varints ---
+    const int          kSteadyMotion      = 64;         //== Slower is noise, predicted still --
+    const unsigned int kModelIncrement    = 32;
+    const unsigned int kModelLimit        = (1<<16) - kModelIncrement;
+    const unsigned int kRangeTop          = 1<<24;
+    const unsigned int kRangeBottom       = 1<<16;
+
+    //== Varints ==--
+
+    inline void PutVarint(std::vector<unsigned char> &Output, unsigned long long Value)
+    {
+        while(Value>=0x80)
+        {
+            Output.push_back((unsigned char) (Value | 0x80));
+            Value >>= 7;
+        }
+
+        Output.push_back((unsigned char) Value);
+    }
+
+    inline void PutSigned(std::vector<unsigned char> &Output, long long Value)
+    {
+        PutVarint(Output, ((unsigned long long) Value << 1) ^ (unsigned long long) (Value >> 63));
+    }
+
+    struct sByteReader
+    {
+        sByteReader(const unsigned char *Data, int Size) : Current(Data), End(Data+Size), Overrun(false) {}
+
+        unsigned long long Varint()
+        {
+            unsigned long long value = 0;
+
+            for(int shift=0; Current<End && shift<64; shift+=7)
+            {
+                unsigned char bits = *Current++;
+
+                value |= (unsigned long long) (bits & 0x7F) << shift;
+
+                if((bits & 0x80)==0)
+                    return value;
+            }
+
+            Overrun = true;
+            return 0;
+        }
+
+        long long Signed()
+        {
+            unsigned long long value = Varint();
+
+            return (long long) (value >> 1) ^ -(long long) (value & 1);
+        }
+
+        int Remaining() const { return (int) (End-Current); }
+
+        const unsigned char * Current;
+        const unsigned char * End;
+        bool                  Overrun;
+    };
+
+    //== Adaptive order-0 model ==--
+
+    template <typename Model> void ResetModel(Model &M)
+    {
+        for(int i=0; i<256; i++)
+            M.Frequency[i] = 1;
+
+        M.Total = 256;
+    }
+
+    template <typename Model> void UpdateModel(Model &M, unsigned char Symbol)
+    {
+        M.Frequency[Symbol] += kModelIncrement;
+        M.Total             += kModelIncrement;
+
+        if(M.Total>kModelLimit)
+        {
+            M.Total = 0;
+
+            for(int i=0; i<256; i++)
+            {
+                M.Frequency[i] = (M.Frequency[i]+1) >> 1;
+                M.Total       += M.Frequency[i];
+            }
+        }
+    }
+
+    //== Carry-less range coder (Subbotin) ==--
+
+    template <typename Model>
+    void RangeEncode(Model &M, const std::vector<unsigned char> &Input, std::vector<unsigned char> &Output)
+    {
+        unsigned int low   = 0;
+        unsigned int range = 0xFFFFFFFF;
+
+        for(int i=0; i<(int) Input.size(); i++)
+        {
+            unsigned char symbol     = Input[i];
+            unsigned int  cumulative = 0;
+
+            for(int s=0; s<symbol; s++)
+                cumulative += M.Frequency[s];
+
+            range /= M.Total;
+            low   += cumulative*range;
+            range *= M.Frequency[symbol];
+
+            while((low ^ (low+range))<kRangeTop || (range<kRangeBottom && ((range = (0-low) & (kRangeBottom-1)), true)))
+            {
+                Output.push_back((unsigned char) (low >> 24));
+                low   <<= 8;
+                range <<= 8;
+            }
+
+            UpdateModel(M, symbol);
+        }
+
+        for(int i=0; i<4; i++)
+        {
+            Output.push_back((unsigned char) (low >> 24));
+            low <<= 8;
+        }
+    }
+
+    template <typename Model>
+    void RangeDecode(Model &M, const unsigned char *Input, int InputSize, unsigned char *Output, int OutputSize)
+    {
+        const unsigned char *end = Input + InputSize;
+
+        unsigned int low   = 0;
+        unsigned int range = 0xFFFFFFFF;
+        unsigned int code  = 0;
+
+        for(int i=0; i<4; i++)
+            code = (code << 8) | (Input<end ? *Input++ : 0);
+
+        for(int i=0; i<OutputSize; i++)
+        {
+            range /= M.Total;
+
+            unsigned int target = (code-low)/range;
+
+            if(target>=M.Total)
+                target = M.Total-1;
+
+            int          symbol     = 0;
+            unsigned int cumulative = 0;
+
+            while(cumulative+M.Frequency[symbol]<=target)
+                cumulative += M.Frequency[symbol++];
+
+            low   += cumulative*range;
+            range *= M.Frequency[symbol];
+
+            while((low ^ (low+range))<kRangeTop || (range<kRangeBottom && ((range = (0-low) & (kRangeBottom-1)), true)))
+            {
+                code    = (code << 8) | (Input<end ? *Input++ : 0);
+                low   <<= 8;
+                range <<= 8;
+            }
+
+            Output[i] = (unsigned char) symbol;
+
+            UpdateModel(M, (unsigned char) symbol);
+        }
+    }
+
+    inline int VarintSize(unsigned long long Value)
+    {
+        int size = 1;
+
+        while(Value>=0x80)
+        {
+            Value >>= 7;
+            size++;
+        }
+
+        return size;
+    }
+
+    //== Benchmark scene ==--
+
+    class cSyntheticFrame : public cTakeDeltaFrame
+    {
+    public:
+        cSyntheticFrame(cTakeDeltaCodec *Codec) : cTakeDeltaFrame(Codec) {}
+
+        void SetHeader(int Serial, int FrameID, double TimeStamp)
+        {
+            mInvalid           = false;
+            mSerial            = Serial;
+            mCameraID          = Serial & 0xFF;
+            mRevision          = 21;
+            mFrameID           = FrameID;
+            mFrameType         = Core::ObjectMode;
+            mTimeStamp         = TimeStamp;
+            mHardwareTimeFreq  = 1000000;
+            mHardwareTimeStamp = (long long) (TimeStamp*mHardwareTimeFreq);
+        }
+    };
+
+    bool RasterOrder(const cTinyObject &A, const cTinyObject &B)
+    {
+        if(A.Y!=B.Y)
+            return A.Y<B.Y;
+
+        return A.X<B.X;
+    }
+
+    bool SameObjects(const std::vector<cTinyObject> &A, const std::vector<cTinyObject> &B)
+    {
+        if(A.size()!=B.size())
+            return false;
+
+        for(size_t i=0; i<A.size(); i++)
+        {
+            if(A[i].X!=B[i].X || A[i].XMantissa!=B[i].XMantissa || A[i].Y!=B[i].Y || A[i].YMantissa!=B[i].YMantissa
+               || A[i].Roundness!=B[i].Roundness || A[i].Area!=B[i].Area)
+                return false;
+        }
+
+        return true;
+    }
+}
+
+//== cTakeDeltaCodec ====================================================================================----
+
+cTakeDeltaCodec::cTakeDeltaCodec(bool EntropyCoding, int KeyFrameInterval)
+    : mEntropyCoding(EntropyCoding)
+    , mKeyFrameInterval(KeyFrameInterval<1 ? 1 : KeyFrameInterval)
+{
+    ResetStatistics();
+}
+
+void cTakeDeltaCodec::Reset()
+{
+    mCameras.clear();
+}
+
+void cTakeDeltaCodec::ResetStatistics()
+{
+    mFramesEncoded   = 0;
+    mFramesDecoded   = 0;
+    mFramesDropped   = 0;
+    mRawBytesEncoded = 0;
+    mRawBytesDecoded = 0;
+    mEncodedBytes    = 0;
+    mEncodeSeconds   = 0;
+    mDecodeSeconds   = 0;
+}
+
+void cTakeDeltaCodec::Statistics(sStatistics &Stats) const
+{
+    Stats.FramesEncoded    = mFramesEncoded;
+    Stats.FramesDecoded    = mFramesDecoded;
+    Stats.FramesDropped    = mFramesDropped;
+    Stats.RawBytes         = mRawBytesEncoded;
+    Stats.EncodedBytes     = mEncodedBytes;
+    Stats.CompressionRatio = (mEncodedBytes>0)  ? (double) mRawBytesEncoded/mEncodedBytes : 0;
+    Stats.EncodeMBps       = (mEncodeSeconds>0) ? (mRawBytesEncoded/(1024.0*1024.0))/mEncodeSeconds : 0;
+    Stats.DecodeMBps       = (mDecodeSeconds>0) ? (mRawBytesDecoded/(1024.0*1024.0))/mDecodeSeconds : 0;
+}
+
+//== cTakeDeltaFrame ====================================================================================----
+
+cTakeDeltaFrame::cTakeDeltaFrame(cTakeDeltaCodec *Codec)
+    : mCodec(Codec)
+{
+}
+
+int cTakeDeltaFrame::SerializedSize() const
+{
+    return kPrefixSize + (int) mEncoded.size();
+}
+
+void cTakeDeltaFrame::Encode()
+{
+    mCodec->mTimer.CatchUp();
+
+    cTakeDeltaCodec::sCameraState &state = mCodec->mCameras[mSerial];
+
+    const std::vector<cTakeDeltaCodec::sDeltaObject> &previous = state.Objects;
+
+    int  count   = (int) mObjects.size();
+    bool key     = !state.Valid || state.FramesSinceKey+1>=mCodec->mKeyFrameInterval;
+    bool aligned = !key && count==(int) previous.size();
+
+    mCurrent.resize(count);
+
+    for(int i=0; i<count; i++)
+    {
+        const cTinyObject &obj = mObjects[i];
+
+        mCurrent[i].X         = (obj.X << 8) | obj.XMantissa;
+        mCurrent[i].Y         = (obj.Y << 8) | obj.YMantissa;
+        mCurrent[i].Roundness = obj.Roundness;
+        mCurrent[i].Area      = obj.Area;
+    }
+
+    //== Index alignment only pays while objects keep their order, raster order changes as
+    //== markers pass each other ==--
+
+    for(int i=0; aligned && i<count; i++)
+    {
+        int distance = abs(previous[i].X+previous[i].VelocityX-mCurrent[i].X)
+                     + abs(previous[i].Y+previous[i].VelocityY-mCurrent[i].Y);
+
+        aligned = distance<kMatchDistance;
+    }
+
+    //== Residuals ==--
+
+    mResiduals.clear();
+    mResiduals.reserve(count*kMaxObjectBytes);
+
+    if(!key && !aligned)
+        mMatched.assign(previous.size(), 0);
+
+    cTakeDeltaCodec::sDeltaObject zero = { 0, 0, 0, 0, 0, 0 };
+
+    for(int i=0; i<count; i++)
+    {
+        cTakeDeltaCodec::sDeltaObject       &current   = mCurrent[i];
+        const cTakeDeltaCodec::sDeltaObject *reference = 0;
+
+        if(aligned)
+        {
+            reference = &previous[i];
+        }
+        else if(!key)
+        {
+            //== nearest unused object of the previous frame ==--
+
+            int best         = -1;
+            int bestDistance = kMatchDistance;
+
+            for(int j=0; j<(int) previous.size(); j++)
+            {
+                if(mMatched[j])
+                    continue;
+
+                int distance = abs(previous[j].X+previous[j].VelocityX-current.X)
+                             + abs(previous[j].Y+previous[j].VelocityY-current.Y);
+
+                if(distance<bestDistance)
+                {
+                    best         = j;
+                    bestDistance = distance;
+                }
+            }
+
+            if(best>=0)
+            {
+                mMatched[best] = 1;
+                reference      = &previous[best];
+            }
+
+            PutVarint(mResiduals, (unsigned long long) (best+1));
+        }
+
+        //== Tracked objects carry on at their reference's velocity, the others are predicted
+        //== standing still at their predecessor in the frame ==--
+
+        bool tracked = (reference!=0);
+
+        if(!tracked)
+            reference = (i>0) ? &mCurrent[i-1] : &zero;
+
+        bool moving = tracked && abs(reference->VelocityX)+abs(reference->VelocityY)>kSteadyMotion;
+
+        int velocityX = moving ? reference->VelocityX : 0;
+        int velocityY = moving ? reference->VelocityY : 0;
+
+        PutSigned(mResiduals, current.X         - reference->X - velocityX);
+        PutSigned(mResiduals, current.Y         - reference->Y - velocityY);
+        PutSigned(mResiduals, current.Roundness - reference->Roundness);
+        PutSigned(mResiduals, current.Area      - reference->Area);
+
+        current.VelocityX = tracked ? current.X - reference->X : 0;
+        current.VelocityY = tracked ? current.Y - reference->Y : 0;
+    }
+
+    //== Optional entropy stage ==--
+
+    unsigned int flags = FlagMotion;
+
+    if(key)
+    {
+        flags |= FlagKey;
+        ResetModel(state.Model);
+    }
+
+    if(aligned)
+        flags |= FlagAligned;
+
+    if(mInvalid)
+        flags |= FlagInvalid;
+
+    if(mCodec->mEntropyCoding)
+    {
+        flags |= FlagModel;
+
+        mCoded.clear();
+        RangeEncode(state.Model, mResiduals, mCoded);
+
+        if(mCoded.size()+VarintSize(mResiduals.size())<mResiduals.size())
+            flags |= FlagEntropy;
+    }
+
+    //== Header ==--
+
+    mEncoded.clear();
+
+    PutVarint(mEncoded, flags);
+    PutSigned(mEncoded, key ? mFrameID : mFrameID-state.FrameID);
+    PutVarint(mEncoded, (unsigned long long) mFrameType);
+    PutVarint(mEncoded, (unsigned long long) mCameraID);
+    PutVarint(mEncoded, (unsigned long long) mRevision);
+    PutSigned(mEncoded, key ? mHardwareTimeStamp : mHardwareTimeStamp-state.HardwareTimeStamp);
+    PutVarint(mEncoded, mHardwareTimeFreq);
+    PutVarint(mEncoded, (unsigned long long) count);
+
+    if(flags & FlagEntropy)
+    {
+        PutVarint(mEncoded, mResiduals.size());
+        mEncoded.insert(mEncoded.end(), mCoded.begin(), mCoded.end());
+    }
+    else
+    {
+        mEncoded.insert(mEncoded.end(), mResiduals.begin(), mResiduals.end());
+    }
+
+    //== This frame becomes the camera's reference ==--
+
+    state.Valid             = true;
+    state.FramesSinceKey    = key ? 0 : state.FramesSinceKey+1;
+    state.FrameID           = mFrameID;
+    state.HardwareTimeStamp = mHardwareTimeStamp;
+    state.Objects.swap(mCurrent);
+
+    mCodec->mFramesEncoded++;
+    mCodec->mRawBytesEncoded += cTakeFrame::SerializedSize();
+    mCodec->mEncodedBytes    += SerializedSize();
+    mCodec->mEncodeSeconds   += mCodec->mTimer.Elapsed();
+}
+
+void cTakeDeltaFrame::Save(Core::cIWriter *Stream) const
+{
+    Stream->WriteInt   ((int) CompressionType());
+    Stream->WriteInt   (mSerial);
+    Stream->WriteDouble(mTimeStamp);
+    Stream->WriteInt   ((int) mEncoded.size());
+
+    if(!mEncoded.empty())
+        Stream->WriteData(&mEncoded[0], (unsigned int) mEncoded.size());
+}
+
+bool cTakeDeltaFrame::Load(Core::cIReader *Stream, int)
+{
+    mInvalid = true;
+
+    if(Stream->ReadInt()!=(int) CompressionType())
+        return false;
+
+    mSerial    = Stream->ReadInt();
+    mTimeStamp = Stream->ReadDouble();
+
+    int size = Stream->ReadInt();
+
+    if(size<0 || size>64+kMaxObjectsPerFrame*kMaxObjectBytes)
+        return false;
+
+    mEncoded.resize(size);
+
+    if(size>0 && Stream->ReadData(&mEncoded[0], size)!=(unsigned int) size)
+        return false;
+
+    return Decode(size>0 ? &mEncoded[0] : 0, size);
+}
+
+bool cTakeDeltaFrame::Load(cMappedReader &Stream)
+{
+    mInvalid = true;
+
+    const unsigned char *prefix = Stream.Span(kPrefixSize);
+
+    if(prefix==0)
+        return false;
+
+    int type, size;
+
+    memcpy(&type,       prefix,      sizeof(int));
+    memcpy(&mSerial,    prefix +  4, sizeof(int));
+    memcpy(&mTimeStamp, prefix +  8, sizeof(double));
+    memcpy(&size,       prefix + 16, sizeof(int));
+
+    if(type!=(int) CompressionType() || size<0)
+        return false;
+
+    //== decode straight out of the mapping ==--
+
+    const unsigned char *payload = Stream.Span(size);
+
+    if(payload==0)
+        return false;
+
+    return Decode(payload, size);
+}
+
+bool cTakeDeltaFrame::Decode(const unsigned char *Data, int Size)
+{
+    mCodec->mTimer.CatchUp();
+
+    mInvalid = true;
+
+    sByteReader header(Data, Size);
+
+    unsigned int       flags      = (unsigned int) header.Varint();
+    long long          frameID    = header.Signed();
+    Core::eVideoMode   frameType  = (Core::eVideoMode) header.Varint();
+    int                cameraID   = (int) header.Varint();
+    int                revision   = (int) header.Varint();
+    long long          hardwareTS = header.Signed();
+    unsigned int       hardwareHz = (unsigned int) header.Varint();
+    unsigned long long count      = header.Varint();
+
+    if(header.Overrun || count>(unsigned long long) kMaxObjectsPerFrame)
+        return false;
+
+    cTakeDeltaCodec::sCameraState &state = mCodec->mCameras[mSerial];
+
+    const std::vector<cTakeDeltaCodec::sDeltaObject> &previous = state.Objects;
+
+    bool key     = (flags & FlagKey)!=0;
+    bool aligned = (flags & FlagAligned)!=0;
+
+    if(!key && (!state.Valid || (aligned && previous.size()!=count)))
+    {
+        //== no reference yet (joined mid-stream) or a damaged stream, wait for a key frame ==--
+
+        state.Valid = false;
+        mCodec->mFramesDropped++;
+        return false;
+    }
+
+    if(key)
+        ResetModel(state.Model);
+
+    //== Undo the entropy stage ==--
+
+    const unsigned char *residuals;
+    int                  residualSize;
+
+    if(flags & FlagEntropy)
+    {
+        unsigned long long rawSize = header.Varint();
+
+        if(header.Overrun || rawSize>count*kMaxObjectBytes)
+        {
+            state.Valid = false;
+            return false;
+        }
+
+        mResiduals.resize(rawSize ? (size_t) rawSize : 1);
+        RangeDecode(state.Model, header.Current, header.Remaining(), &mResiduals[0], (int) rawSize);
+
+        residuals    = &mResiduals[0];
+        residualSize = (int) rawSize;
+    }
+    else
+    {
+        residuals    = header.Current;
+        residualSize = header.Remaining();
+
+        if(flags & FlagModel)
+        {
+            for(int i=0; i<residualSize; i++)
+                UpdateModel(state.Model, residuals[i]);
+        }
+    }
+
+    //== Reconstruct objects ==--
+
+    sByteReader body(residuals, residualSize);
+
+    mCurrent.resize((size_t) count);
+
+    cTakeDeltaCodec::sDeltaObject zero = { 0, 0, 0, 0, 0, 0 };
+
+    bool velocity = (flags & FlagMotion)!=0;          //== Off in takes recorded before it ==--
+
+    for(int i=0; i<(int) count; i++)
+    {
+        const cTakeDeltaCodec::sDeltaObject *reference = 0;
+
+        if(aligned)
+        {
+            reference = &previous[i];
+        }
+        else if(!key)
+        {
+            unsigned long long index = body.Varint();
+
+            if(index>0 && index<=previous.size())
+                reference = &previous[(size_t) index-1];
+        }
+
+        bool tracked = (reference!=0);
+
+        if(!tracked)
+            reference = (i>0) ? &mCurrent[i-1] : &zero;
+
+        bool moving = tracked && velocity && abs(reference->VelocityX)+abs(reference->VelocityY)>kSteadyMotion;
+
+        int velocityX = moving ? reference->VelocityX : 0;
+        int velocityY = moving ? reference->VelocityY : 0;
+
+        cTakeDeltaCodec::sDeltaObject &current = mCurrent[i];
+
+        current.X         = reference->X         + velocityX + (int) body.Signed();
+        current.Y         = reference->Y         + velocityY + (int) body.Signed();
+        current.Roundness = reference->Roundness + (int) body.Signed();
+        current.Area      = reference->Area      + (int) body.Signed();
+        current.VelocityX = tracked ? current.X - reference->X : 0;
+        current.VelocityY = tracked ? current.Y - reference->Y : 0;
+    }
+
+    if(body.Overrun)
+    {
+        state.Valid = false;
+        return false;
+    }
+
+    mObjects.resize((size_t) count);
+
+    for(int i=0; i<(int) count; i++)
+    {
+        const cTakeDeltaCodec::sDeltaObject &current = mCurrent[i];
+        cTinyObject &obj = mObjects[i];
+
+        obj.X         = (unsigned short) (current.X >> 8);
+        obj.XMantissa = (unsigned char)  (current.X & 0xFF);
+        obj.Y         = (unsigned short) (current.Y >> 8);
+        obj.YMantissa = (unsigned char)  (current.Y & 0xFF);
+        obj.Roundness = (unsigned char)  current.Roundness;
+        obj.Area      = (unsigned char)  current.Area;
+    }
+
+    mFrameID           = (int) (key ? frameID : state.FrameID+frameID);
+    mFrameType         = frameType;
+    mCameraID          = cameraID;
+    mRevision          = revision;
+    mHardwareTimeStamp = key ? hardwareTS : state.HardwareTimeStamp+hardwareTS;
+    mHardwareTimeFreq  = hardwareHz;
+    mInvalid           = (flags & FlagInvalid)!=0;
+
+    state.Valid             = true;
+    state.FramesSinceKey    = key ? 0 : state.FramesSinceKey+1;
+    state.FrameID           = mFrameID;
+    state.HardwareTimeStamp = mHardwareTimeStamp;
+    state.Objects.swap(mCurrent);
+
+    mCodec->mFramesDecoded++;
+    mCodec->mRawBytesDecoded += cTakeFrame::SerializedSize();
+    mCodec->mDecodeSeconds   += mCodec->mTimer.Elapsed();
+
+    return true;
+}
+
+//== Benchmark =========================================================================================----
+
+void cTakeDeltaCodec::Benchmark(int Cameras, int Markers, int Frames, bool EntropyCoding, sBenchmark &Result)
+{
+    const double kRate = 1.0/360.0;
+
+    Cameras = std::max(Cameras, 1);
+    Markers = std::min(std::max(Markers, 1), kMaxObjectsPerFrame);
+    Frames  = std::max(Frames, 1);
+
+    cBenchmarkNoise noise(1013904223u);
+
+    //== Markers circle their own center, a few to several hundred pixels across ==--
+
+    struct sMarker
+    {
+        float CenterX, CenterY, Radius, Speed, Phase;
+        int   Area, Roundness;
+    };
+
+    std::vector<sMarker> markers(Cameras*Markers);
+
+    for(size_t i=0; i<markers.size(); i++)
+    {
+        sMarker &marker = markers[i];
+
+        marker.Radius    = 20 + 200*noise.Uniform();
+        marker.CenterX   = marker.Radius + 4 + (1280 - 2*marker.Radius - 8)*noise.Uniform();
+        marker.CenterY   = marker.Radius + 4 + (1024 - 2*marker.Radius - 8)*noise.Uniform();
+        marker.Speed     = (1 + 2*noise.Uniform())/marker.Radius;     //== Radians per frame ==--
+        marker.Phase     = 6.2831853f*noise.Uniform();
+        marker.Area      = 20 + (int) (40*noise.Uniform());
+        marker.Roundness = 200 + (int) (40*noise.Uniform());
+    }
+
+    //== Encode and save every frame, keeping the originals ==--
+
+    cTakeDeltaCodec encoder(EntropyCoding);
+    cSyntheticFrame frame(&encoder);
+
+    std::vector< std::vector<cTinyObject> > originals(Cameras*Frames);
+
+    Core::cSerializer take;
+
+    for(int f=0; f<Frames; f++)
+    {
+        for(int c=0; c<Cameras; c++)
+        {
+            std::vector<cTinyObject> &objects = frame.Objects();
+
+            objects.clear();
+
+            for(int m=0; m<Markers; m++)
+            {
+                const sMarker &marker = markers[c*Markers + m];
+
+                if(noise.Uniform()<0.01f)
+                    continue;
+
+                float angle = marker.Phase + marker.Speed*f;
+                float x     = marker.CenterX + marker.Radius*cosf(angle) + 0.05f*noise.Normal();
+                float y     = marker.CenterY + marker.Radius*sinf(angle) + 0.05f*noise.Normal();
+
+                int fixedX = (int) (x*256);
+                int fixedY = (int) (y*256);
+
+                cTinyObject object;
+
+                object.X         = (unsigned short) (fixedX >> 8);
+                object.XMantissa = (unsigned char)  (fixedX & 0xFF);
+                object.Y         = (unsigned short) (fixedY >> 8);
+                object.YMantissa = (unsigned char)  (fixedY & 0xFF);
+                object.Area      = (unsigned char)  (marker.Area + (noise.Uniform()<0.2f ? (noise.Signed()<0 ? -1 : 1) : 0));
+                object.Roundness = (unsigned char)  (marker.Roundness + (int) (2*noise.Signed()));
+
+                objects.push_back(object);
+            }
+
+            std::sort(objects.begin(), objects.end(), RasterOrder);
+
+            frame.SetHeader(1000 + c, f, f*kRate);
+            frame.Encode();
+            frame.Save(&take);
+
+            originals[f*Cameras + c] = objects;
+        }
+    }
+
+    //== Load and decode it back through a fresh codec, as playback would ==--
+
+    std::vector<unsigned char> data((size_t) take.Size());
+
+    take.Seek(0);
+
+    if(!data.empty())
+        take.ReadData(&data[0], (unsigned int) data.size());
+
+    cMappedReader reader;
+    reader.Attach(data.empty() ? 0 : &data[0], data.size());
+
+    cTakeDeltaCodec decoder;
+    cTakeDeltaFrame decoded(&decoder);
+
+    int mismatches = 0;
+
+    for(int i=0; i<Cameras*Frames; i++)
+    {
+        if(!decoded.Load(reader) || !SameObjects(decoded.Objects(), originals[i]))
+            mismatches++;
+    }
+
+    sStatistics encoded, replayed;
+
+    encoder.Statistics(encoded);
+    decoder.Statistics(replayed);
+
+    Result.Cameras          = Cameras;
+    Result.Markers          = Markers;
+    Result.Frames           = Frames;
+    Result.CompressionRatio = encoded.CompressionRatio;
+    Result.EncodeMBps       = encoded.EncodeMBps;
+    Result.DecodeMBps       = replayed.DecodeMBps;
+    Result.Mismatches       = mismatches;
+}
@@ -0,0 +1,185 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Delta compressed object-only frames (cICameraFrame::DeltaObjectOnly).
+//==
+//== Consecutive frames of a camera are highly correlated, so instead of storing each cTinyObject at
+//== fixed width every object is predicted from its counterpart in the previous frame of the same
+//== camera and only the zigzag varint residual is stored.  Centroids are predicted in 1/256 pixel
+//== units (whole pixels plus mantissa) so the residual of a still marker is usually a single byte.
+//==
+//==   - Frames with the same object count as the reference, whose objects each stay near their
+//==     counterpart, are index aligned.  Otherwise each object names its reference (the unused
+//==     object of the previous frame nearest to where it was heading) or none.
+//==   - An object with a reference is predicted to have moved on at its reference's velocity,
+//==     so only the noise of a marker in steady motion is stored.
+//==   - Every KeyFrameInterval frames, and whenever no reference exists, a camera emits a key frame
+//==     that only predicts objects from their predecessor within the frame.
+//==   - The optional entropy stage range codes the residual bytes with an adaptive order-0 model
+//==     that persists across frames of the camera and restarts on key frames.  It is only used
+//==     for a frame when it actually makes that frame smaller.
+//==
+//== Decoding is streaming: frames must be decoded in recorded order through one cTakeDeltaCodec,
+//== after a seek call Reset() and decoding resumes at each camera's next key frame.
+//==
+//== Payload layout:  int type, int serial, double timestamp, int size, then 'size' bytes of varint
+//== header fields followed by the residuals.
+//==
+
+#ifndef __CAMERALIBRARY__TAKEDELTAFRAME_H__
+#define __CAMERALIBRARY__TAKEDELTAFRAME_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <map>
+#include <vector>
+#include "takefile.h"
+
+#include "Core/Timer.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cTakeDeltaFrame;
+    class cMappedReader;
+
+    const int kDeltaKeyFrameInterval = 120;     //== Frames per camera between key frames =======----
+
+    //== Per-take encoder/decoder state.  Use one instance per recorded or replayed stream, it
+    //== is not thread safe.
+
+    class cTakeDeltaCodec
+    {
+    public:
+        cTakeDeltaCodec(bool EntropyCoding = true, int KeyFrameInterval = kDeltaKeyFrameInterval);
+
+        void Reset();                               //== Forget all references (rewind, new take)
+
+        void SetEntropyCoding(bool Enable)          { mEntropyCoding = Enable; }
+        bool EntropyCoding() const                  { return mEntropyCoding; }
+
+        void SetKeyFrameInterval(int Frames)        { mKeyFrameInterval = (Frames<1 ? 1 : Frames); }
+        int  KeyFrameInterval() const               { return mKeyFrameInterval; }
+
+        struct sStatistics
+        {
+            int       FramesEncoded;
+            int       FramesDecoded;
+            int       FramesDropped;                //== Undecodable, waiting for a key frame -
+            long long RawBytes;                     //== Same frames stored as TinyObjectOnly -
+            long long EncodedBytes;
+            double    CompressionRatio;
+            double    EncodeMBps;                   //== Raw bytes per second of encode time -
+            double    DecodeMBps;                   //== Raw bytes per second of decode time -
+        };
+
+        void Statistics(sStatistics &Stats) const;
+        void ResetStatistics();
+
+        //== Round trip of a synthetic take: Cameras each seeing Markers markers circle at 1 to 3
+        //== pixels per frame with 0.05 px noise, in raster order, each occluded 1% of frames.
+        //== Frames are encoded and saved, then loaded and decoded through a second codec and
+        //== compared with the originals.  Rates are of raw, TinyObjectOnly bytes.
+
+        struct sBenchmark
+        {
+            int       Cameras;
+            int       Markers;
+            int       Frames;                       //== Per camera ===========================----
+            double    CompressionRatio;             //== Against TinyObjectOnly ===============----
+            double    EncodeMBps;
+            double    DecodeMBps;
+            int       Mismatches;                   //== Frames not decoded to their original -
+        };
+
+        static void Benchmark(int Cameras, int Markers, int Frames, bool EntropyCoding, sBenchmark &Result);
+
+    private:
+        friend class cTakeDeltaFrame;
+
+        struct sDeltaObject
+        {
+            int X;                                  //== Pixels*256 + mantissa ==============----
+            int Y;
+            int Roundness;
+            int Area;
+            int VelocityX;                          //== Since its reference, 0 if it had none
+            int VelocityY;
+        };
+
+        struct sByteModel
+        {
+            unsigned int Frequency[256];
+            unsigned int Total;
+        };
+
+        struct sCameraState
+        {
+            sCameraState() : Valid(false), FramesSinceKey(0), FrameID(0), HardwareTimeStamp(0) {}
+
+            bool      Valid;
+            int       FramesSinceKey;
+            int       FrameID;
+            long long HardwareTimeStamp;
+
+            std::vector<sDeltaObject> Objects;
+            sByteModel                Model;
+        };
+
+        std::map<int,sCameraState> mCameras;        //== Keyed by serial ===================----
+
+        bool          mEntropyCoding;
+        int           mKeyFrameInterval;
+
+        Core::cTimer  mTimer;
+        int           mFramesEncoded;
+        int           mFramesDecoded;
+        int           mFramesDropped;
+        long long     mRawBytesEncoded;
+        long long     mRawBytesDecoded;
+        long long     mEncodedBytes;
+        double        mEncodeSeconds;
+        double        mDecodeSeconds;
+    };
+
+    //== A delta compressed take frame.  Populate it like any cTakeFrame, then Encode() before
+    //== SerializedSize()/Save().
+
+    class cTakeDeltaFrame : public cTakeFrame
+    {
+    public:
+        cTakeDeltaFrame(cTakeDeltaCodec *Codec = 0);
+
+        void SetCodec(cTakeDeltaCodec *Codec)       { mCodec = Codec; }
+
+        void Encode();                              //== Compress against the codec state ===----
+
+        int  SerializedSize() const;
+
+        static const int kPrefixSize = 20;          //== type, serial, timestamp, size ======----
+
+        //== Core::cICameraFrame ==--
+
+        virtual void    Save( Core::cIWriter *stream ) const;
+        virtual bool    Load( Core::cIReader *stream, int version = kCompressedFrameVersion );
+
+        bool            Load( cMappedReader &Stream );
+
+        virtual eCompressedFrameTypes CompressionType() const { return DeltaObjectOnly; }
+
+    private:
+        bool Decode(const unsigned char *Data, int Size);
+
+        cTakeDeltaCodec *          mCodec;
+        std::vector<unsigned char> mEncoded;        //== Payload after the prefix ============----
+        std::vector<unsigned char> mResiduals;      //== Scratch ============================----
+        std::vector<unsigned char> mCoded;          //== Scratch ============================----
+        std::vector<cTakeDeltaCodec::sDeltaObject> mCurrent;
+        std::vector<char>          mMatched;
+    };
+}
+
+#endif
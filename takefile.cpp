@@ -0,0 +1,350 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <string.h>
+
+#include "takefile.h"
+#include "camera.h"
+#include "frame.h"
+#include "inputmanagerbase.h"
+#include "mappedreader.h"
+
+#include "Core/IReader.h"
+#include "Core/IWriter.h"
+
+using namespace CameraLibrary;
+
+//== cTakeFile ==========================================================================================----
+
+void cTakeFile::WriteHeader(Core::cIWriter *Stream)
+{
+    Stream->WriteInt(kTakeFileSignature);
+    Stream->WriteInt(kTakeFileVersion);
+}
+
+bool cTakeFile::ReadHeader(Core::cIReader *Stream, int &Version)
+{
+    if(Stream->Size()-Stream->Tell()<8)
+        return false;
+
+    if(Stream->ReadInt()!=kTakeFileSignature)
+        return false;
+
+    Version = Stream->ReadInt();
+
+    return (Version>0 && Version<=kTakeFileVersion);
+}
+
+void cTakeFile::WriteRecordHeader(Core::cIWriter *Stream, eTakeRecordTypes Type, int PayloadSize)
+{
+    Stream->WriteByte((unsigned char) Type);
+    Stream->WriteInt (PayloadSize);
+}
+
+bool cTakeFile::ReadRecordHeader(Core::cIReader *Stream, eTakeRecordTypes &Type, int &PayloadSize)
+{
+    if(Stream->Size()-Stream->Tell()<(unsigned long long) kRecordHeaderSize)
+        return false;
+
+    Type        = (eTakeRecordTypes) Stream->ReadByte();
+    PayloadSize = Stream->ReadInt();
+
+    //== truncated record (e.g. recording was interrupted) ==--
+
+    if(PayloadSize<0 || Stream->Size()-Stream->Tell()<(unsigned long long) PayloadSize)
+        return false;
+
+    return true;
+}
+
+bool cTakeFile::ReadRecordHeader(cMappedReader &Stream, eTakeRecordTypes &Type, int &PayloadSize)
+{
+    const unsigned char *header = Stream.Span(kRecordHeaderSize);
+
+    if(header==0)
+        return false;
+
+    Type = (eTakeRecordTypes) header[0];
+    memcpy(&PayloadSize, header+1, sizeof(int));
+
+    return (PayloadSize>=0 && Stream.Remaining()>=(unsigned long long) PayloadSize);
+}
+
+//== cTakeCameraInfo ====================================================================================----
+
+cTakeCameraInfo::cTakeCameraInfo()
+    : Serial(0)
+    , Revision(0)
+    , CameraID(0)
+    , Width(0)
+    , Height(0)
+    , FrameRate(0)
+{
+    memset(Name, 0, sizeof(Name));
+}
+
+void cTakeCameraInfo::PopulateFrom(Camera *Camera)
+{
+    Serial    = Camera->Serial();
+    Revision  = Camera->Revision();
+    CameraID  = Camera->CameraID();
+    Width     = Camera->PhysicalPixelWidth();
+    Height    = Camera->PhysicalPixelHeight();
+    FrameRate = Camera->ActualFrameRate();
+
+    strncpy(Name, Camera->Name(), kCameraNameMaxLen-1);
+    Name[kCameraNameMaxLen-1] = 0;
+}
+
+void cTakeCameraInfo::WriteTo(cVirtualConfigurationData *Config) const
+{
+    memcpy(Config->CameraName, Name, kCameraNameMaxLen);
+
+    Config->CameraWidth     = Width;
+    Config->CameraHeight    = Height;
+    Config->CameraFrameRate = FrameRate;
+    Config->CameraRevision  = Revision;
+    Config->CameraSerial    = Serial;
+    Config->CameraID        = CameraID;
+}
+
+int cTakeCameraInfo::SerializedSize() const
+{
+    return 6*sizeof(int) + kCameraNameMaxLen;
+}
+
+void cTakeCameraInfo::Save(Core::cIWriter *Stream) const
+{
+    Stream->WriteInt (Serial);
+    Stream->WriteInt (Revision);
+    Stream->WriteInt (CameraID);
+    Stream->WriteInt (Width);
+    Stream->WriteInt (Height);
+    Stream->WriteInt (FrameRate);
+    Stream->WriteData((const unsigned char*) Name, kCameraNameMaxLen);
+}
+
+bool cTakeCameraInfo::Load(Core::cIReader *Stream)
+{
+    Serial    = Stream->ReadInt();
+    Revision  = Stream->ReadInt();
+    CameraID  = Stream->ReadInt();
+    Width     = Stream->ReadInt();
+    Height    = Stream->ReadInt();
+    FrameRate = Stream->ReadInt();
+
+    if(Stream->ReadData((unsigned char*) Name, kCameraNameMaxLen)!=(unsigned int) kCameraNameMaxLen)
+        return false;
+
+    Name[kCameraNameMaxLen-1] = 0;
+
+    return true;
+}
+
+//== cTakeFrame =========================================================================================----
+
+cTakeFrame::cTakeFrame()
+    : mInvalid(false)
+    , mSerial(0)
+    , mCameraID(0)
+    , mRevision(0)
+    , mFrameID(0)
+    , mFrameType(Core::UnknownMode)
+    , mTimeStamp(0)
+    , mHardwareTimeStamp(0)
+    , mHardwareTimeFreq(0)
+{
+}
+
+void cTakeFrame::PopulateFrom(Camera *Camera, Frame *Frame)
+{
+    mInvalid   = Frame->IsInvalid();
+    mSerial    = Camera->Serial();
+    mCameraID  = Camera->CameraID();
+    mRevision  = Camera->Revision();
+    mFrameID   = Frame->FrameID();
+    mFrameType = Frame->FrameType();
+    mTimeStamp = Frame->TimeStamp();
+
+    if(Frame->IsHardwareTimeStamp())
+    {
+        mHardwareTimeStamp = (long long) Frame->HardwareTimeStamp();
+        mHardwareTimeFreq  = Frame->HardwareTimeFreq();
+    }
+    else
+    {
+        mHardwareTimeStamp = 0;
+        mHardwareTimeFreq  = 0;
+    }
+
+    int count = Frame->ObjectCount();
+
+    mObjects.resize(count);
+
+    for(int i=0; i<count; i++)
+        mObjects[i].PopulateFrom(Frame->Object(i));
+}
+
+long cTakeFrame::MemorySize() const
+{
+    return (long) (sizeof(cTakeFrame) + mObjects.capacity()*sizeof(cTinyObject));
+}
+
+int cTakeFrame::SerializedSize() const
+{
+    const int kTinyObjectSize = 8;
+
+    return kFrameHeaderSize + (int) mObjects.size()*kTinyObjectSize;
+}
+
+void cTakeFrame::SaveFrameHeader(Core::cIWriter *Stream) const
+{
+    Stream->WriteInt     ((int) CompressionType());
+    Stream->WriteInt     (mSerial);
+    Stream->WriteInt     (mCameraID);
+    Stream->WriteInt     (mRevision);
+    Stream->WriteInt     (mFrameID);
+    Stream->WriteInt     ((int) mFrameType);
+    Stream->WriteDouble  (mTimeStamp);
+    Stream->WriteLongLong(mHardwareTimeStamp);
+    Stream->WriteInt     ((int) mHardwareTimeFreq);
+    Stream->WriteInt     (CountWord());
+}
+
+bool cTakeFrame::LoadFrameHeader(Core::cIReader *Stream)
+{
+    int type = Stream->ReadInt();
+
+    if(type!=(int) CompressionType())
+        return false;
+
+    mSerial            = Stream->ReadInt();
+    mCameraID          = Stream->ReadInt();
+    mRevision          = Stream->ReadInt();
+    mFrameID           = Stream->ReadInt();
+    mFrameType         = (Core::eVideoMode) Stream->ReadInt();
+    mTimeStamp         = Stream->ReadDouble();
+    mHardwareTimeStamp = Stream->ReadLongLong();
+    mHardwareTimeFreq  = (unsigned int) Stream->ReadInt();
+
+    int countWord = Stream->ReadInt();
+    int count     = countWord & kCountMask;
+
+    if(count>kMaxObjectsPerFrame)
+        return false;
+
+    mObjects.resize(count);
+    mInvalid = (countWord & kFrameFlagInvalid)!=0;
+
+    return true;
+}
+
+void cTakeFrame::Save(Core::cIWriter *Stream) const
+{
+    SaveFrameHeader(Stream);
+
+    int count = (int) mObjects.size();
+
+    for(int i=0; i<count; i++)
+    {
+        const cTinyObject &obj = mObjects[i];
+
+        Stream->WriteShort((short) obj.X);
+        Stream->WriteByte (obj.XMantissa);
+        Stream->WriteShort((short) obj.Y);
+        Stream->WriteByte (obj.YMantissa);
+        Stream->WriteByte (obj.Roundness);
+        Stream->WriteByte (obj.Area);
+    }
+}
+
+bool cTakeFrame::Load(Core::cIReader *Stream, int)
+{
+    if(!LoadFrameHeader(Stream))
+    {
+        mInvalid = true;
+        return false;
+    }
+
+    int count = (int) mObjects.size();
+
+    for(int i=0; i<count; i++)
+    {
+        cTinyObject &obj = mObjects[i];
+
+        obj.X         = (unsigned short) Stream->ReadShort();
+        obj.XMantissa = Stream->ReadByte();
+        obj.Y         = (unsigned short) Stream->ReadShort();
+        obj.YMantissa = Stream->ReadByte();
+        obj.Roundness = Stream->ReadByte();
+        obj.Area      = Stream->ReadByte();
+    }
+
+    return true;
+}
+
+bool cTakeFrame::Load(cMappedReader &Stream)
+{
+    //== Decode straight out of the mapping: one bounds check for the header, one for the
+    //== object block and no per-field virtual calls.  Layout matches SaveFrameHeader().
+
+    const unsigned char *header = Stream.Span(kFrameHeaderSize);
+
+    if(header==0)
+    {
+        mInvalid = true;
+        return false;
+    }
+
+    int type, frameType, hardwareFreq, countWord;
+
+    memcpy(&type,               header,      sizeof(int));
+    memcpy(&mSerial,            header +  4, sizeof(int));
+    memcpy(&mCameraID,          header +  8, sizeof(int));
+    memcpy(&mRevision,          header + 12, sizeof(int));
+    memcpy(&mFrameID,           header + 16, sizeof(int));
+    memcpy(&frameType,          header + 20, sizeof(int));
+    memcpy(&mTimeStamp,         header + 24, sizeof(double));
+    memcpy(&mHardwareTimeStamp, header + 32, sizeof(long long));
+    memcpy(&hardwareFreq,       header + 40, sizeof(int));
+    memcpy(&countWord,          header + 44, sizeof(int));
+
+    int count = countWord & kCountMask;
+
+    mFrameType        = (Core::eVideoMode) frameType;
+    mHardwareTimeFreq = (unsigned int) hardwareFreq;
+
+    if(type!=(int) CompressionType() || count>kMaxObjectsPerFrame)
+    {
+        mInvalid = true;
+        return false;
+    }
+
+    const int kTinyObjectSize = 8;
+
+    const unsigned char *objects = Stream.Span((unsigned long long) count*kTinyObjectSize);
+
+    if(objects==0)
+    {
+        mInvalid = true;
+        return false;
+    }
+
+    mObjects.resize(count);
+    mInvalid = (countWord & kFrameFlagInvalid)!=0;
+
+    for(int i=0; i<count; i++, objects+=kTinyObjectSize)
+    {
+        cTinyObject &obj = mObjects[i];
+
+        memcpy(&obj.X, objects,     sizeof(unsigned short));
+        obj.XMantissa  = objects[2];
+        memcpy(&obj.Y, objects + 3, sizeof(unsigned short));
+        obj.YMantissa  = objects[5];
+        obj.Roundness  = objects[6];
+        obj.Area       = objects[7];
+    }
+
+    return true;
+}
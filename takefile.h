@@ -0,0 +1,168 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Take files are a flat stream of records preceded by a small file header.  Each record is a one
+//== byte record type followed by the size of its payload, so readers can skip records they do not
+//== care about without decoding them.  Camera records always precede the first frame record for
+//== that camera, which lets a player create its virtual cameras in a single forward scan.
+//==
+
+#ifndef __CAMERALIBRARY__TAKEFILE_H__
+#define __CAMERALIBRARY__TAKEFILE_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <vector>
+#include "cameralibraryglobals.h"
+#include "object.h"
+
+#include "Core/Frame.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace Core
+{
+    class cIReader;
+    class cIWriter;
+}
+
+class cVirtualConfigurationData;
+
+namespace CameraLibrary
+{
+    class Camera;
+    class Frame;
+    class cMappedReader;
+
+    const int kTakeFileSignature = 0x4B54504E;  //== 'NPTK' ==--
+    const int kTakeFileVersion   = 1;
+
+    enum eTakeRecordTypes
+    {
+        TakeRecordCamera = 1,                   //== cTakeCameraInfo payload ===================----
+        TakeRecordFrame,                        //== cTakeFrame payload ========================----
+        TakeRecordTypeCount
+    };
+
+    //== Take file header & record framing helpers ==--
+
+    class cTakeFile
+    {
+    public:
+        static void WriteHeader      (Core::cIWriter *Stream);
+        static bool ReadHeader       (Core::cIReader *Stream, int &Version);
+
+        static void WriteRecordHeader(Core::cIWriter *Stream, eTakeRecordTypes Type, int PayloadSize);
+        static bool ReadRecordHeader (Core::cIReader *Stream, eTakeRecordTypes &Type, int &PayloadSize);
+        static bool ReadRecordHeader (cMappedReader &Stream, eTakeRecordTypes &Type, int &PayloadSize);
+
+        static const int kRecordHeaderSize = 5; //== record type byte + payload size =========----
+    };
+
+    //== Per-camera description stored once per take ==--
+
+    class cTakeCameraInfo
+    {
+    public:
+        cTakeCameraInfo();
+
+        void PopulateFrom(Camera *Camera);
+        void WriteTo     (cVirtualConfigurationData *Config) const;
+
+        void Save(Core::cIWriter *Stream) const;
+        bool Load(Core::cIReader *Stream);
+
+        int  SerializedSize() const;
+
+        int  Serial;
+        int  Revision;
+        int  CameraID;
+        int  Width;
+        int  Height;
+        int  FrameRate;
+        char Name[kCameraNameMaxLen];
+    };
+
+    //== A single recorded camera frame.  Objects are stored in their cTinyObject form. ==--
+
+    class cTakeFrame : public Core::cICameraFrame
+    {
+    public:
+        cTakeFrame();
+        virtual ~cTakeFrame() {};
+
+        void PopulateFrom(Camera *Camera, Frame *Frame);    //== Capture a live frame =========----
+
+        int  SerializedSize() const;                        //== Payload size for Save() ======----
+
+        void SetTimeStamp(double TimeStamp) { mTimeStamp = TimeStamp; }
+
+        const std::vector<cTinyObject> & Objects() const { return mObjects; }
+        std::vector<cTinyObject> &       Objects()       { return mObjects; }
+
+        //== Core::cICameraFrame ==--
+
+        virtual void    Save( Core::cIWriter *stream ) const;
+        virtual bool    Load( Core::cIReader *stream, int version = kCompressedFrameVersion );
+
+        bool            Load( cMappedReader &Stream );      //== Zero-copy fast path ========----
+
+        virtual eCompressedFrameTypes CompressionType() const { return TinyObjectOnly; }
+
+        virtual bool    IsInvalid() const    { return mInvalid;  }
+        virtual double  TimeStamp() const    { return mTimeStamp; }
+        virtual int     ObjectCount() const  { return (int) mObjects.size(); }
+        virtual int     SegmentCount() const { return 0; }
+        virtual int     FrameID() const      { return mFrameID;  }
+        virtual Core::eVideoMode FrameType() const { return mFrameType; }
+        virtual int     Serial() const       { return mSerial;   }
+        virtual int     Revision() const     { return mRevision; }
+        virtual int     CameraID() const     { return mCameraID; }
+        virtual long    MemorySize() const;
+
+        virtual void    RemoveData()         { mObjects.clear(); }
+        virtual bool    IsEmpty() const      { return mObjects.empty(); }
+        virtual bool    IsSyncFrame() const  { return false; }
+
+        virtual long long HardwareTimeStamp() const { return mHardwareTimeStamp; }
+        virtual unsigned int HardwareTimeFreq() const { return mHardwareTimeFreq; }
+
+        virtual bool    IsTimeCodeValid() const { return false; }
+        virtual Core::sTimeCode TimeCode() const { return Core::sTimeCode(); }
+
+        virtual unsigned char* ObjectData() const  { return mObjects.empty() ? 0 : (unsigned char*) &mObjects[0]; }
+        virtual unsigned char* SegmentData() const { return 0; }
+        virtual unsigned char* PacketData() const  { return 0; }
+        virtual int     PacketDataSize() const     { return 0; }
+
+    protected:
+        void SaveFrameHeader(Core::cIWriter *Stream) const;
+        bool LoadFrameHeader(Core::cIReader *Stream);
+
+        static const int kFrameHeaderSize = 48;
+
+        //== The header's last word holds the object count in its low 16 bits and frame flags
+        //== above, takes recorded before the flags read back as valid frames.
+
+        static const int kCountMask        = 0xFFFF;
+        static const int kFrameFlagInvalid = 0x10000;
+
+        int  CountWord() const { return (int) mObjects.size() | (mInvalid ? kFrameFlagInvalid : 0); }
+
+        bool             mInvalid;
+        int              mSerial;
+        int              mCameraID;
+        int              mRevision;
+        int              mFrameID;
+        Core::eVideoMode mFrameType;
+        double           mTimeStamp;
+        long long        mHardwareTimeStamp;
+        unsigned int     mHardwareTimeFreq;
+
+        std::vector<cTinyObject> mObjects;
+    };
+}
+
+#endif
@@ -0,0 +1,378 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include <string.h>
+
+#include "takegrayscaleframe.h"
+#include "grayscalecodec.h"
+#include "mappedreader.h"
+#include "camera.h"
+#include "frame.h"
+
+#include "Core/IReader.h"
+#include "Core/IWriter.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    const int kImageHeaderSize = 3*sizeof(int);         //== width, height, encoded size ===----
+    const int kMaxImageSize    = 4096*4096;
+
+#ifdef WIN32
+    unsigned long __stdcall EncoderThreadProc(void *Param)
+    {
+        cTakeGrayscaleEncoder::sWorker *worker = (cTakeGrayscaleEncoder::sWorker*) Param;
+        worker->Encoder->WorkerThread(worker);
+        return 0;
+    }
+#else
+    void EncoderThreadProc(void *Param)
+    {
+        cTakeGrayscaleEncoder::sWorker *worker = (cTakeGrayscaleEncoder::sWorker*) Param;
+        worker->Encoder->WorkerThread(worker);
+    }
+#endif
+
+    int ProcessorCount()
+    {
+#ifdef WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return (int) info.dwNumberOfProcessors;
+#else
+        return (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    }
+}
+
+//== cTakeGrayscaleFrame ================================================================================----
+
+cTakeGrayscaleFrame::cTakeGrayscaleFrame()
+    : mImageWidth(0)
+    , mImageHeight(0)
+{
+}
+
+bool cTakeGrayscaleFrame::PopulateFrom(Camera *Camera, Frame *Frame)
+{
+    cTakeFrame::PopulateFrom(Camera, Frame);
+
+    mEncoded.clear();
+
+    unsigned char *data  = Frame->GetGrayscaleData();
+    int            size  = Frame->GetGrayscaleDataSize();
+    int            width = Frame->Width();
+
+    if(data==0 || width<=0 || size<width)
+    {
+        mImageWidth  = 0;
+        mImageHeight = 0;
+        mImage.clear();
+        return false;
+    }
+
+    mImageWidth  = width;
+    mImageHeight = size/width;
+
+    mImage.assign(data, data + mImageWidth*mImageHeight);
+
+    return true;
+}
+
+void cTakeGrayscaleFrame::Encode()
+{
+    mEncoded.clear();
+
+    if(!mImage.empty())
+        cGrayscaleCodec::Encode(&mImage[0], mImageWidth, mImageHeight, mImageWidth, mEncoded, mScratch);
+}
+
+int cTakeGrayscaleFrame::SerializedSize() const
+{
+    return cTakeFrame::SerializedSize() + kImageHeaderSize + (int) mEncoded.size();
+}
+
+long cTakeGrayscaleFrame::MemorySize() const
+{
+    return cTakeFrame::MemorySize() + (long) (mImage.capacity() + mEncoded.capacity() + mScratch.capacity());
+}
+
+void cTakeGrayscaleFrame::RemoveData()
+{
+    cTakeFrame::RemoveData();
+
+    mImage.clear();
+    mEncoded.clear();
+    mImageWidth  = 0;
+    mImageHeight = 0;
+}
+
+void cTakeGrayscaleFrame::Save(Core::cIWriter *Stream) const
+{
+    cTakeFrame::Save(Stream);
+
+    Stream->WriteInt(mImageWidth);
+    Stream->WriteInt(mImageHeight);
+    Stream->WriteInt((int) mEncoded.size());
+
+    if(!mEncoded.empty())
+        Stream->WriteData(&mEncoded[0], (unsigned int) mEncoded.size());
+}
+
+bool cTakeGrayscaleFrame::Load(Core::cIReader *Stream, int Version)
+{
+    if(!cTakeFrame::Load(Stream, Version))
+        return false;
+
+    mImageWidth  = Stream->ReadInt();
+    mImageHeight = Stream->ReadInt();
+
+    int size = Stream->ReadInt();
+
+    if(size<0 || size>cGrayscaleCodec::MaxEncodedSize(kMaxImageSize, 1))
+    {
+        mInvalid = true;
+        return false;
+    }
+
+    mEncoded.resize(size);
+
+    if(size>0 && Stream->ReadData(&mEncoded[0], size)!=(unsigned int) size)
+    {
+        mInvalid = true;
+        return false;
+    }
+
+    return LoadImage(size>0 ? &mEncoded[0] : 0, size);
+}
+
+bool cTakeGrayscaleFrame::Load(cMappedReader &Stream)
+{
+    if(!cTakeFrame::Load(Stream))
+        return false;
+
+    const unsigned char *header = Stream.Span(kImageHeaderSize);
+
+    if(header==0)
+    {
+        mInvalid = true;
+        return false;
+    }
+
+    int size;
+
+    memcpy(&mImageWidth,  header,     sizeof(int));
+    memcpy(&mImageHeight, header + 4, sizeof(int));
+    memcpy(&size,         header + 8, sizeof(int));
+
+    //== decode straight out of the mapping ==--
+
+    const unsigned char *data = (size>=0) ? Stream.Span(size) : 0;
+
+    if(data==0 && size!=0)
+    {
+        mInvalid = true;
+        return false;
+    }
+
+    return LoadImage(data, size);
+}
+
+bool cTakeGrayscaleFrame::LoadImage(const unsigned char *Data, int Size)
+{
+    if(mImageWidth<=0 || mImageHeight<=0 || mImageWidth*(long long) mImageHeight>kMaxImageSize)
+    {
+        mImageWidth  = 0;
+        mImageHeight = 0;
+        mImage.clear();
+
+        //== frame without image, object data is still valid ==--
+
+        return true;
+    }
+
+    mImage.resize(mImageWidth*mImageHeight);
+
+    if(!cGrayscaleCodec::Decode(Data, Size, &mImage[0], mImageWidth, mImageHeight))
+    {
+        mInvalid = true;
+        return false;
+    }
+
+    return true;
+}
+
+//== cTakeGrayscaleEncoder ==============================================================================----
+
+cTakeGrayscaleEncoder::cTakeGrayscaleEncoder(int ThreadCount)
+    : mRunning(true)
+{
+    if(ThreadCount<=0)
+        ThreadCount = ProcessorCount();
+
+    if(ThreadCount<1)
+        ThreadCount = 1;
+
+    for(int i=0; i<ThreadCount; i++)
+    {
+        sWorker *worker = new sWorker();
+        worker->Encoder = this;
+
+        mWorkers.push_back(worker);
+
+#ifdef WIN32
+        worker->Thread.StartThread((void*) EncoderThreadProc, worker);
+#else
+        worker->Thread.StartThread(EncoderThreadProc, worker);
+#endif
+    }
+}
+
+cTakeGrayscaleEncoder::~cTakeGrayscaleEncoder()
+{
+    //== finish outstanding work so no thread touches a deleted frame, the frames nobody
+    //== collected go back to the pool and are deleted with it ==--
+
+    cTakeGrayscaleFrame *frame;
+
+    while((frame = NextEncoded(true))!=0)
+        ReleaseFrame(frame);
+
+    mRunning = false;
+
+    for(int i=0; i<(int) mWorkers.size(); i++)
+    {
+        mWorkAvailable.Trigger();
+        mWorkers[i]->Thread.StopThread();
+        delete mWorkers[i];
+    }
+
+    for(int i=0; i<(int) mFreeFrames.size(); i++)
+        delete mFreeFrames[i];
+}
+
+cTakeGrayscaleFrame * cTakeGrayscaleEncoder::AcquireFrame()
+{
+    cTakeGrayscaleFrame *frame = 0;
+
+    mLock.Lock();
+
+    if(!mFreeFrames.empty())
+    {
+        frame = mFreeFrames.back();
+        mFreeFrames.pop_back();
+    }
+
+    mLock.UnLock();
+
+    if(frame==0)
+        frame = new cTakeGrayscaleFrame();
+
+    return frame;
+}
+
+void cTakeGrayscaleEncoder::ReleaseFrame(cTakeGrayscaleFrame *Frame)
+{
+    mLock.Lock();
+    mFreeFrames.push_back(Frame);
+    mLock.UnLock();
+}
+
+void cTakeGrayscaleEncoder::Submit(cTakeGrayscaleFrame *Frame)
+{
+    sJob *job = new sJob();
+
+    job->Frame = Frame;
+    job->Done  = false;
+
+    mLock.Lock();
+    mQueue.push_back(job);
+    mOrder.push_back(job);
+    mLock.UnLock();
+
+    mWorkAvailable.Trigger();
+}
+
+cTakeGrayscaleFrame * cTakeGrayscaleEncoder::NextEncoded(bool Wait)
+{
+    for(;;)
+    {
+        mLock.Lock();
+
+        if(mOrder.empty())
+        {
+            mLock.UnLock();
+            return 0;
+        }
+
+        sJob *job = mOrder.front();
+
+        if(job->Done)
+        {
+            mOrder.pop_front();
+            mLock.UnLock();
+
+            cTakeGrayscaleFrame *frame = job->Frame;
+            delete job;
+
+            return frame;
+        }
+
+        mLock.UnLock();
+
+        if(!Wait)
+            return 0;
+
+        mJobDone.Wait(100);
+    }
+}
+
+int cTakeGrayscaleEncoder::Pending()
+{
+    mLock.Lock();
+    int pending = (int) mOrder.size();
+    mLock.UnLock();
+
+    return pending;
+}
+
+void cTakeGrayscaleEncoder::WorkerThread(sWorker *Worker)
+{
+    while(mRunning && Worker->Thread.IsSteadyState())
+    {
+        sJob *job = 0;
+
+        mLock.Lock();
+
+        if(!mQueue.empty())
+        {
+            job = mQueue.front();
+            mQueue.pop_front();
+        }
+
+        mLock.UnLock();
+
+        if(job==0)
+        {
+            mWorkAvailable.Wait(100);
+            continue;
+        }
+
+        job->Frame->Encode();
+
+        mLock.Lock();
+        job->Done = true;
+        mLock.UnLock();
+
+        mJobDone.Trigger();
+    }
+
+    Worker->Thread.mThreadRunning = false;
+}
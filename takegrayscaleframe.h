@@ -0,0 +1,119 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Lossless grayscale take frames (cICameraFrame::LosslessGrayscale).  Same payload as a
+//== TinyObjectOnly frame followed by the camera image compressed with cGrayscaleCodec, so object
+//== data stays available to players that ignore the image.
+//==
+//== Image compression is the expensive part of recording grayscale video, cTakeGrayscaleEncoder
+//== spreads it over a pool of worker threads, one frame per job, and hands frames back in
+//== submission order.
+//==
+
+#ifndef __CAMERALIBRARY__TAKEGRAYSCALEFRAME_H__
+#define __CAMERALIBRARY__TAKEGRAYSCALEFRAME_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <deque>
+#include <vector>
+#include "takefile.h"
+#include "threading.h"
+#include "lock.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cMappedReader;
+
+    class cTakeGrayscaleFrame : public cTakeFrame
+    {
+    public:
+        cTakeGrayscaleFrame();
+
+        bool PopulateFrom(Camera *Camera, Frame *Frame);    //== False without grayscale data --
+
+        void Encode();                              //== Compress image before Save() =======----
+
+        int  SerializedSize() const;
+
+        int  ImageWidth() const                     { return mImageWidth;  }
+        int  ImageHeight() const                    { return mImageHeight; }
+        const unsigned char * Image() const         { return mImage.empty() ? 0 : &mImage[0]; }
+
+        //== Core::cICameraFrame ==--
+
+        virtual void    Save( Core::cIWriter *stream ) const;
+        virtual bool    Load( Core::cIReader *stream, int version = kCompressedFrameVersion );
+
+        bool            Load( cMappedReader &Stream );
+
+        virtual eCompressedFrameTypes CompressionType() const { return LosslessGrayscale; }
+
+        virtual long    MemorySize() const;
+        virtual void    RemoveData();
+
+    private:
+        bool LoadImage(const unsigned char *Data, int Size);
+
+        int                        mImageWidth;
+        int                        mImageHeight;
+        std::vector<unsigned char> mImage;
+        std::vector<unsigned char> mEncoded;
+        std::vector<unsigned char> mScratch;
+    };
+
+    //== Multi-threaded frame encoder ==--
+
+    class cTakeGrayscaleEncoder
+    {
+    public:
+        cTakeGrayscaleEncoder(int ThreadCount = 0);     //== 0: one thread per processor =====----
+        ~cTakeGrayscaleEncoder();
+
+        cTakeGrayscaleFrame * AcquireFrame();           //== Recycled frame to populate ======----
+        void  ReleaseFrame(cTakeGrayscaleFrame *Frame); //== Return frame after writing it ===----
+
+        void  Submit(cTakeGrayscaleFrame *Frame);       //== Queue frame for encoding ========----
+
+        //== Next encoded frame in submission order.  Returns 0 when nothing is pending or, unless
+        //== Wait is set, when the oldest frame is still being encoded.
+
+        cTakeGrayscaleFrame * NextEncoded(bool Wait);
+
+        int   Pending();
+        int   ThreadCount() const                   { return (int) mWorkers.size(); }
+
+        //== Internal use, thread entry point needs to be public ==--
+
+        struct sWorker
+        {
+            cTakeGrayscaleEncoder * Encoder;
+            ThreadInfo              Thread;
+        };
+
+        void  WorkerThread(sWorker *Worker);
+
+    private:
+        struct sJob
+        {
+            cTakeGrayscaleFrame * Frame;
+            bool                  Done;
+        };
+
+        std::vector<sWorker*>             mWorkers;
+        std::vector<cTakeGrayscaleFrame*> mFreeFrames;
+        std::deque<sJob*>                 mQueue;       //== Waiting for a worker ===========----
+        std::deque<sJob*>                 mOrder;       //== All pending, submission order ==----
+
+        LockItem                          mLock;
+        cEvent                            mWorkAvailable;
+        cEvent                            mJobDone;
+        volatile bool                     mRunning;
+    };
+}
+
+#endif
@@ -0,0 +1,1105 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <math.h>
+#include <algorithm>
+
+#include "triangulator.h"
+#include "benchmarknoise.h"
+#include "framegroup.h"
+#include "frame.h"
+#include "object.h"
+#include "camera.h"
+#include "Core/Timer.h"
+
+#if !defined(__PLATFORM__LINUX__)
+#include "Core/CameraRay.h"
+#include "Core/RayBundle.h"
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define TRIANGULATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace CameraLibrary;
+
+namespace
+{
+    //== 2D grid cells searched around a projection in each direction, at most ==--
+
+    const int kMaxCellRange = 8;
+
+    //== Normal equations closer to singular than this (relative to the ray count) come from
+    //== (nearly) parallel rays and are not solved.
+
+    const float kMinDeterminant = 1e-6f;
+}
+
+cTriangulator::cTriangulator()
+    : mCellMask(0)
+{
+    mSettings.MaxRayDistance   = 0.004f;
+    mSettings.SeedRadius       = 0.02f;
+    mSettings.MinDepth         = 0.1f;
+    mSettings.MaxDepth         = 20.0f;
+    mSettings.VolumeMin[0]     = -10.0f;
+    mSettings.VolumeMin[1]     = -1.0f;
+    mSettings.VolumeMin[2]     = -10.0f;
+    mSettings.VolumeMax[0]     = 10.0f;
+    mSettings.VolumeMax[1]     = 5.0f;
+    mSettings.VolumeMax[2]     = 10.0f;
+    mSettings.CellSize         = 0.005f;
+    mSettings.MinRays          = 3;
+    mSettings.UsePreviousFrame = true;
+
+    mStatistics.Rays         = 0;
+    mStatistics.Seeded       = 0;
+    mStatistics.Discovered   = 0;
+    mStatistics.IndexEntries = 0;
+    mStatistics.PairsTested  = 0;
+    mStatistics.Unassigned   = 0;
+}
+
+void cTriangulator::SetCameras(const std::vector<sCamera> &Cameras)
+{
+    mCameras.resize(Cameras.size());
+
+    for(int c=0; c<(int) Cameras.size(); c++)
+    {
+        sCameraState &state = mCameras[c];
+
+        state.Camera = Cameras[c];
+
+        for(int r=0; r<3; r++)
+            for(int k=0; k<3; k++)
+                state.Rotation[r*3 + k] = (float) Cameras[c].Orientation[k*3 + r];
+
+        for(int k=0; k<3; k++)
+            state.Position[k] = (float) Cameras[c].Position[k];
+    }
+
+    mCollected.resize(mCameras.size());
+    mIndex.SetCameras(Cameras);
+
+    Reset();
+}
+
+int cTriangulator::CameraIndex(int Serial) const
+{
+    for(int c=0; c<(int) mCameras.size(); c++)
+        if(mCameras[c].Camera.Serial==Serial)
+            return c;
+
+    return -1;
+}
+
+void cTriangulator::Reset()
+{
+    mPrevious.clear();
+}
+
+int cTriangulator::Reconstruct(FrameGroup *Group)
+{
+    BeginFrame();
+
+    for(int i=0; i<Group->Count(); i++)
+    {
+        Frame *frame = Group->GetFrame(i);
+
+        if(frame==0 || frame->GetCamera()==0)
+            continue;
+
+        int camera = CameraIndex(frame->GetCamera()->Serial());
+
+        if(camera<0)
+            continue;
+
+        for(int o=0; o<frame->ObjectCount(); o++)
+        {
+            cObject *object = frame->Object(o);
+
+            AddObservation(camera, object->X(), object->Y(), object->Area());
+        }
+    }
+
+    return Solve();
+}
+
+void cTriangulator::BeginFrame()
+{
+    mRays.clear();
+    mMarkers.clear();
+    mMarkerRays.clear();
+}
+
+void cTriangulator::AddObservation(int Camera, float X, float Y, float Area)
+{
+    sCameraState &state = mCameras[Camera];
+    Core::DistortionModel &model = state.Camera.Model;
+
+    float x = X;
+    float y = Y;
+
+    if(model.Distort)
+        Core::Undistort2DPoint(model, x, y);
+
+    sRay ray;
+
+    ray.Camera        = Camera;
+    ray.Image[0]      = X;
+    ray.Image[1]      = Y;
+    ray.Area          = Area;
+    ray.Normalized[0] = (float) ((x - model.LensCenterX)/model.HorizontalFocalLength);
+    ray.Normalized[1] = (float) ((y - model.LensCenterY)/model.VerticalFocalLength);
+    ray.Marker        = -1;
+
+    double local[3] = { ray.Normalized[0], ray.Normalized[1], 1.0 };
+    double length   = sqrt(local[0]*local[0] + local[1]*local[1] + 1.0);
+
+    const double *orientation = state.Camera.Orientation;
+
+    for(int k=0; k<3; k++)
+    {
+        ray.Origin[k]    = (float) state.Camera.Position[k];
+        ray.Direction[k] = (float) ((orientation[k*3]*local[0] + orientation[k*3 + 1]*local[1] +
+                                     orientation[k*3 + 2]*local[2])/length);
+    }
+
+    mRays.push_back(ray);
+}
+
+int cTriangulator::Solve()
+{
+    mStatistics.Rays         = (int) mRays.size();
+    mStatistics.Seeded       = 0;
+    mStatistics.Discovered   = 0;
+    mStatistics.IndexEntries = 0;
+    mStatistics.PairsTested  = 0;
+
+    mMarkers.clear();
+    mMarkerRays.clear();
+
+    if(!mRays.empty())
+    {
+        BuildGrid();
+
+        if(mSettings.UsePreviousFrame && !mPrevious.empty())
+            Seed();
+
+        Discover();
+        Refine();
+    }
+
+    //== remember this frame's markers as next frame's seeds ==--
+
+    mPrevious.resize(3*mMarkers.size());
+
+    for(int m=0; m<(int) mMarkers.size(); m++)
+        for(int k=0; k<3; k++)
+            mPrevious[3*m + k] = mMarkers[m].Position[k];
+
+    mStatistics.Unassigned = 0;
+
+    for(int r=0; r<(int) mRays.size(); r++)
+        if(mRays[r].Marker<0)
+            mStatistics.Unassigned++;
+
+    return (int) mMarkers.size();
+}
+
+unsigned int cTriangulator::Cell(int Camera, int X, int Y) const
+{
+    //== each camera owns a contiguous slice of buckets, so a camera's lookups stay in cache ==--
+
+    return (unsigned int) Camera*(unsigned int) (mCellMask + 1) +
+           (((unsigned int) X*73856093u ^ (unsigned int) Y*19349663u) & (unsigned int) mCellMask);
+}
+
+void cTriangulator::BuildGrid()
+{
+    //== observations hashed per camera on their cell, counting sorted ==--
+
+    int rays    = (int) mRays.size();
+    int cameras = (int) mCameras.size();
+    int slice   = 16;
+
+    while(slice*cameras<2*rays)
+        slice <<= 1;
+
+    mCellMask = slice - 1;
+
+    int buckets = slice*cameras;
+
+    mCellStart.assign(buckets + 1, 0);
+    mCellEntries.resize(rays);
+    mEntries.resize(rays);
+
+    float scale = 1.0f/mSettings.CellSize;
+
+    for(int r=0; r<rays; r++)
+    {
+        const sRay &ray = mRays[r];
+
+        unsigned int cell = Cell(ray.Camera, (int) floorf(ray.Normalized[0]*scale),
+                                             (int) floorf(ray.Normalized[1]*scale));
+
+        mEntries[r] = std::make_pair(cell, r);
+        mCellStart[cell + 1]++;
+    }
+
+    for(int b=0; b<buckets; b++)
+        mCellStart[b + 1] += mCellStart[b];
+
+    //== fill advances every bucket's start to its end, shift back afterwards ==--
+
+    for(int r=0; r<rays; r++)
+    {
+        sCellEntry &entry = mCellEntries[mCellStart[mEntries[r].first]++];
+
+        entry.X   = mRays[r].Normalized[0];
+        entry.Y   = mRays[r].Normalized[1];
+        entry.Ray = r;
+    }
+
+    for(int b=buckets; b>0; b--)
+        mCellStart[b] = mCellStart[b - 1];
+
+    mCellStart[0] = 0;
+}
+
+int cTriangulator::Nearest(int Camera, const float Point[3], float Radius) const
+{
+    //== nearest free observation of Camera within Radius of Point, -1 if none ==--
+
+    const sCameraState &state = mCameras[Camera];
+    const float *rotation = state.Rotation;
+
+    float v[3] = { Point[0] - state.Position[0], Point[1] - state.Position[1], Point[2] - state.Position[2] };
+    float z    = rotation[6]*v[0] + rotation[7]*v[1] + rotation[8]*v[2];
+
+    if(z<mSettings.MinDepth)
+        return -1;
+
+    float inverse = 1.0f/z;
+    float x       = (rotation[0]*v[0] + rotation[1]*v[1] + rotation[2]*v[2])*inverse;
+    float y       = (rotation[3]*v[0] + rotation[4]*v[1] + rotation[5]*v[2])*inverse;
+
+    //== distance in the normalized image plane times depth ~ distance from the ray ==--
+
+    float scale     = 1.0f/mSettings.CellSize;
+    float tolerance = std::min(Radius*inverse, kMaxCellRange*mSettings.CellSize);
+    float best      = tolerance*tolerance;
+    int   bestRay   = -1;
+
+    int x0 = (int) floorf((x - tolerance)*scale);
+    int x1 = (int) floorf((x + tolerance)*scale);
+    int y0 = (int) floorf((y - tolerance)*scale);
+    int y1 = (int) floorf((y + tolerance)*scale);
+
+    for(int gy=y0; gy<=y1; gy++)
+    {
+        for(int gx=x0; gx<=x1; gx++)
+        {
+            unsigned int cell = Cell(Camera, gx, gy);
+
+            for(int s=mCellStart[cell]; s<mCellStart[cell + 1]; s++)
+            {
+                const sCellEntry &entry = mCellEntries[s];
+
+                float dx = entry.X - x;
+                float dy = entry.Y - y;
+                float d2 = dx*dx + dy*dy;
+
+                if(d2<=best && mRays[entry.Ray].Marker<0)
+                {
+                    best    = d2;
+                    bestRay = entry.Ray;
+                }
+            }
+        }
+    }
+
+    return bestRay;
+}
+
+int cTriangulator::Collect(const float Point[3], float Radius, int *Rays) const
+{
+    //== one ray per camera that sees Point ==--
+
+    int count = 0;
+
+    for(int c=0; c<(int) mCameras.size(); c++)
+    {
+        int ray = Nearest(c, Point, Radius);
+
+        if(ray>=0)
+            Rays[count++] = ray;
+    }
+
+    return count;
+}
+
+bool cTriangulator::SolvePoint(const int *Rays, int Count, const float Reference[3], float Point[3]) const
+{
+    //== point closest to all rays: sum (I - d d^T) (p - o) = 0, solved around Reference ==--
+
+    double a[6] = { 0, 0, 0, 0, 0, 0 };     //== xx xy xz yy yz zz ==--
+    double b[3] = { 0, 0, 0 };
+
+    for(int i=0; i<Count; i++)
+    {
+        const sRay &ray = mRays[Rays[i]];
+
+        double d[3] = { ray.Direction[0], ray.Direction[1], ray.Direction[2] };
+        double v[3] = { ray.Origin[0] - Reference[0], ray.Origin[1] - Reference[1], ray.Origin[2] - Reference[2] };
+
+        double dv = d[0]*v[0] + d[1]*v[1] + d[2]*v[2];
+
+        a[0] += 1 - d[0]*d[0];
+        a[1] -= d[0]*d[1];
+        a[2] -= d[0]*d[2];
+        a[3] += 1 - d[1]*d[1];
+        a[4] -= d[1]*d[2];
+        a[5] += 1 - d[2]*d[2];
+
+        for(int k=0; k<3; k++)
+            b[k] += v[k] - d[k]*dv;
+    }
+
+    double c00 = a[3]*a[5] - a[4]*a[4];
+    double c01 = a[2]*a[4] - a[1]*a[5];
+    double c02 = a[1]*a[4] - a[2]*a[3];
+    double c11 = a[0]*a[5] - a[2]*a[2];
+    double c12 = a[1]*a[2] - a[0]*a[4];
+    double c22 = a[0]*a[3] - a[1]*a[1];
+
+    double determinant = a[0]*c00 + a[1]*c01 + a[2]*c02;
+
+    if(determinant<=kMinDeterminant*Count*Count*Count)
+        return false;
+
+    double inverse = 1.0/determinant;
+
+    Point[0] = (float) (Reference[0] + inverse*(c00*b[0] + c01*b[1] + c02*b[2]));
+    Point[1] = (float) (Reference[1] + inverse*(c01*b[0] + c11*b[1] + c12*b[2]));
+    Point[2] = (float) (Reference[2] + inverse*(c02*b[0] + c12*b[1] + c22*b[2]));
+
+    return true;
+}
+
+void cTriangulator::SolveBatch(int Jobs)
+{
+    //== normal equations of every job into structure of arrays (relative to the job's
+    //== reference, which keeps float precise), then the 3x3 solves four jobs at a time
+
+    int padded = (Jobs + 3) & ~3;
+
+    mNormal.assign(10*padded, 0.0f);
+    mSolved.resize(3*padded);
+    mValid.resize(padded);
+
+    float *axx = &mNormal[0];
+    float *axy = axx + padded;
+    float *axz = axy + padded;
+    float *ayy = axz + padded;
+    float *ayz = ayy + padded;
+    float *azz = ayz + padded;
+    float *bx  = azz + padded;
+    float *by  = bx + padded;
+    float *bz  = by + padded;
+    float *n   = bz + padded;
+
+    for(int j=0; j<Jobs; j++)
+    {
+        const float *reference = &mReferences[3*j];
+
+        for(int i=mJobStart[j]; i<mJobStart[j + 1]; i++)
+        {
+            const sRay &ray = mRays[mJobRays[i]];
+            const float *d  = ray.Direction;
+
+            float v[3] = { ray.Origin[0] - reference[0], ray.Origin[1] - reference[1], ray.Origin[2] - reference[2] };
+            float dv   = d[0]*v[0] + d[1]*v[1] + d[2]*v[2];
+
+            axx[j] += 1 - d[0]*d[0];
+            axy[j] -= d[0]*d[1];
+            axz[j] -= d[0]*d[2];
+            ayy[j] += 1 - d[1]*d[1];
+            ayz[j] -= d[1]*d[2];
+            azz[j] += 1 - d[2]*d[2];
+            bx[j]  += v[0] - d[0]*dv;
+            by[j]  += v[1] - d[1]*dv;
+            bz[j]  += v[2] - d[2]*dv;
+        }
+
+        n[j] = (float) (mJobStart[j + 1] - mJobStart[j]);
+    }
+
+    //== deltas overwrite the first three columns once a lane's cofactors are computed ==--
+
+    float *dx = axx;
+    float *dy = axy;
+    float *dz = axz;
+
+    int j = 0;
+
+#ifdef TRIANGULATOR_SSE2
+    __m128 minimum = _mm_set1_ps(kMinDeterminant);
+
+    for(; j<Jobs; j+=4)
+    {
+        __m128 xx = _mm_loadu_ps(axx + j), xy = _mm_loadu_ps(axy + j), xz = _mm_loadu_ps(axz + j);
+        __m128 yy = _mm_loadu_ps(ayy + j), yz = _mm_loadu_ps(ayz + j), zz = _mm_loadu_ps(azz + j);
+        __m128 b0 = _mm_loadu_ps(bx + j),  b1 = _mm_loadu_ps(by + j),  b2 = _mm_loadu_ps(bz + j);
+        __m128 count = _mm_loadu_ps(n + j);
+
+        __m128 c00 = _mm_sub_ps(_mm_mul_ps(yy, zz), _mm_mul_ps(yz, yz));
+        __m128 c01 = _mm_sub_ps(_mm_mul_ps(xz, yz), _mm_mul_ps(xy, zz));
+        __m128 c02 = _mm_sub_ps(_mm_mul_ps(xy, yz), _mm_mul_ps(xz, yy));
+        __m128 c11 = _mm_sub_ps(_mm_mul_ps(xx, zz), _mm_mul_ps(xz, xz));
+        __m128 c12 = _mm_sub_ps(_mm_mul_ps(xy, xz), _mm_mul_ps(xx, yz));
+        __m128 c22 = _mm_sub_ps(_mm_mul_ps(xx, yy), _mm_mul_ps(xy, xy));
+
+        __m128 determinant = _mm_add_ps(_mm_mul_ps(xx, c00), _mm_add_ps(_mm_mul_ps(xy, c01), _mm_mul_ps(xz, c02)));
+        __m128 threshold   = _mm_mul_ps(minimum, _mm_mul_ps(count, _mm_mul_ps(count, count)));
+        __m128 valid       = _mm_cmpgt_ps(determinant, threshold);
+
+        //== invalid lanes divide by one and are flagged, no special values leak out ==--
+
+        __m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), _mm_or_ps(_mm_and_ps(valid, determinant),
+                                                                 _mm_andnot_ps(valid, _mm_set1_ps(1.0f))));
+
+        _mm_storeu_ps(dx + j, _mm_mul_ps(inverse, _mm_add_ps(_mm_mul_ps(c00, b0), _mm_add_ps(_mm_mul_ps(c01, b1), _mm_mul_ps(c02, b2)))));
+        _mm_storeu_ps(dy + j, _mm_mul_ps(inverse, _mm_add_ps(_mm_mul_ps(c01, b0), _mm_add_ps(_mm_mul_ps(c11, b1), _mm_mul_ps(c12, b2)))));
+        _mm_storeu_ps(dz + j, _mm_mul_ps(inverse, _mm_add_ps(_mm_mul_ps(c02, b0), _mm_add_ps(_mm_mul_ps(c12, b1), _mm_mul_ps(c22, b2)))));
+
+        int mask = _mm_movemask_ps(valid);
+
+        for(int k=0; k<4; k++)
+            mValid[j + k] = (char) ((mask>>k) & 1);
+    }
+#else
+    for(; j<Jobs; j++)
+    {
+        float c00 = ayy[j]*azz[j] - ayz[j]*ayz[j];
+        float c01 = axz[j]*ayz[j] - axy[j]*azz[j];
+        float c02 = axy[j]*ayz[j] - axz[j]*ayy[j];
+        float c11 = axx[j]*azz[j] - axz[j]*axz[j];
+        float c12 = axy[j]*axz[j] - axx[j]*ayz[j];
+        float c22 = axx[j]*ayy[j] - axy[j]*axy[j];
+
+        float determinant = axx[j]*c00 + axy[j]*c01 + axz[j]*c02;
+
+        mValid[j] = (char) (determinant>kMinDeterminant*n[j]*n[j]*n[j]);
+
+        float inverse = mValid[j] ? 1.0f/determinant : 1.0f;
+
+        dx[j] = inverse*(c00*bx[j] + c01*by[j] + c02*bz[j]);
+        dy[j] = inverse*(c01*bx[j] + c11*by[j] + c12*bz[j]);
+        dz[j] = inverse*(c02*bx[j] + c12*by[j] + c22*bz[j]);
+    }
+#endif
+
+    for(j=0; j<Jobs; j++)
+    {
+        mSolved[3*j]     = mReferences[3*j]     + dx[j];
+        mSolved[3*j + 1] = mReferences[3*j + 1] + dy[j];
+        mSolved[3*j + 2] = mReferences[3*j + 2] + dz[j];
+    }
+}
+
+float cTriangulator::RayDistance2(const sRay &Ray, const float Point[3])
+{
+    float v[3] = { Point[0] - Ray.Origin[0], Point[1] - Ray.Origin[1], Point[2] - Ray.Origin[2] };
+    float t    = v[0]*Ray.Direction[0] + v[1]*Ray.Direction[1] + v[2]*Ray.Direction[2];
+    float d2   = 0;
+
+    for(int k=0; k<3; k++)
+    {
+        float e = v[k] - t*Ray.Direction[k];
+        d2 += e*e;
+    }
+
+    return d2;
+}
+
+void cTriangulator::AddMarker(const int *Rays, int Count, const float Position[3])
+{
+    sMarker marker;
+
+    marker.Position[0] = Position[0];
+    marker.Position[1] = Position[1];
+    marker.Position[2] = Position[2];
+    marker.Residual    = 0;
+    marker.FirstRay    = (int) mMarkerRays.size();
+    marker.RayCount    = Count;
+
+    for(int i=0; i<Count; i++)
+    {
+        mRays[Rays[i]].Marker = (int) mMarkers.size();
+        mMarkerRays.push_back(Rays[i]);
+    }
+
+    mMarkers.push_back(marker);
+}
+
+void cTriangulator::Seed()
+{
+    //== last frame's markers look up their nearest observations camera by camera (each camera's
+    //== grid slice stays in cache), then all are solved in one batch
+
+    int seeds   = (int) mPrevious.size()/3;
+    int cameras = (int) mCameras.size();
+
+    mSeedRays.resize(seeds*cameras);
+
+    for(int c=0; c<cameras; c++)
+        for(int s=0; s<seeds; s++)
+            mSeedRays[s*cameras + c] = Nearest(c, &mPrevious[3*s], mSettings.SeedRadius);
+
+    mJobStart.clear();
+    mJobRays.clear();
+    mReferences.clear();
+
+    mJobStart.push_back(0);
+
+    for(int s=0; s<seeds; s++)
+    {
+        int first = (int) mJobRays.size();
+
+        for(int c=0; c<cameras; c++)
+            if(mSeedRays[s*cameras + c]>=0)
+                mJobRays.push_back(mSeedRays[s*cameras + c]);
+
+        if((int) mJobRays.size() - first<mSettings.MinRays)
+        {
+            mJobRays.resize(first);
+            continue;
+        }
+
+        mJobStart.push_back((int) mJobRays.size());
+
+        mReferences.push_back(mPrevious[3*s]);
+        mReferences.push_back(mPrevious[3*s + 1]);
+        mReferences.push_back(mPrevious[3*s + 2]);
+    }
+
+    int jobs = (int) mJobStart.size() - 1;
+
+    if(jobs==0)
+        return;
+
+    SolveBatch(jobs);
+
+    //== then the rays closest to the solved points, the same way.  Seeds can agree on a ray,
+    //== first come first served; a marker left with too few rays is for discovery to find.
+
+    float radius = 2.0f*mSettings.MaxRayDistance;
+
+    mSeedRays.resize(jobs*cameras);
+
+    for(int c=0; c<cameras; c++)
+        for(int j=0; j<jobs; j++)
+            mSeedRays[j*cameras + c] = mValid[j] ? Nearest(c, &mSolved[3*j], radius) : -1;
+
+    for(int j=0; j<jobs; j++)
+    {
+        int count = 0;
+
+        for(int c=0; c<cameras; c++)
+        {
+            int ray = mSeedRays[j*cameras + c];
+
+            if(ray>=0 && mRays[ray].Marker<0)
+                mCollected[count++] = ray;
+        }
+
+        if(count>=mSettings.MinRays)
+        {
+            AddMarker(&mCollected[0], count, &mSolved[3*j]);
+            mStatistics.Seeded++;
+        }
+    }
+}
+
+bool cTriangulator::Span(int Ray, float &Near, float &Far) const
+{
+    //== [MinDepth, MaxDepth] along the ray, clipped to the capture volume ==--
+
+    const sRay &ray = mRays[Ray];
+
+    Near = mSettings.MinDepth;
+    Far  = mSettings.MaxDepth;
+
+    for(int k=0; k<3; k++)
+    {
+        float d = ray.Direction[k];
+
+        if(fabsf(d)<1e-9f)
+        {
+            if(ray.Origin[k]<mSettings.VolumeMin[k] || ray.Origin[k]>mSettings.VolumeMax[k])
+                return false;
+
+            continue;
+        }
+
+        float a = (mSettings.VolumeMin[k] - ray.Origin[k])/d;
+        float b = (mSettings.VolumeMax[k] - ray.Origin[k])/d;
+
+        Near = std::max(Near, std::min(a, b));
+        Far  = std::min(Far, std::max(a, b));
+    }
+
+    return Near<Far;
+}
+
+void cTriangulator::Discover()
+{
+    int rays    = (int) mRays.size();
+    int cameras = (int) mCameras.size();
+
+    mIndex.Clear();
+    mNear.resize(rays);
+
+    for(int r=0; r<rays; r++)
+    {
+        float far;
+
+        if(mRays[r].Marker<0 && Span(r, mNear[r], far))
+            mIndex.Add(mRays[r].Camera, r, mRays[r].Direction);
+        else
+            mNear[r] = -1;
+    }
+
+    mIndex.Build();
+
+    mStatistics.IndexEntries = mIndex.EntryCount();
+
+    if(mStatistics.IndexEntries==0)
+        return;
+
+    float limit = mSettings.MaxRayDistance*mSettings.MaxRayDistance;
+
+    for(int r=0; r<rays; r++)
+    {
+        const sRay &a = mRays[r];
+
+        if(a.Marker>=0 || mNear[r]<0)
+            continue;
+
+        //== free rays of the other cameras in (nearly) the same epipolar planes ==--
+
+        mPairs.clear();
+
+        for(int o=0; o<cameras; o++)
+        {
+            if(o==a.Camera)
+                continue;
+
+            mCandidates.clear();
+            mIndex.Query(a.Camera, o, a.Direction, mSettings.MaxRayDistance, mNear[r], mCandidates);
+
+            for(int i=0; i<(int) mCandidates.size(); i++)
+            {
+                int q = mCandidates[i];
+
+                const sRay &c = mRays[q];
+
+                if(c.Marker>=0)
+                    continue;
+
+                mStatistics.PairsTested++;
+
+                //== closest points a.Origin + s a.Direction, c.Origin + t c.Direction ==--
+
+                float w[3] = { a.Origin[0] - c.Origin[0], a.Origin[1] - c.Origin[1], a.Origin[2] - c.Origin[2] };
+
+                float cosine = a.Direction[0]*c.Direction[0] + a.Direction[1]*c.Direction[1] + a.Direction[2]*c.Direction[2];
+                float da     = a.Direction[0]*w[0] + a.Direction[1]*w[1] + a.Direction[2]*w[2];
+                float dc     = c.Direction[0]*w[0] + c.Direction[1]*w[1] + c.Direction[2]*w[2];
+                float denom  = 1.0f - cosine*cosine;
+
+                if(denom<1e-6f)
+                    continue;
+
+                float s = (cosine*dc - da)/denom;
+                float t = (dc - cosine*da)/denom;
+
+                if(s<mNear[r] || t<mNear[q] || s>mSettings.MaxDepth || t>mSettings.MaxDepth)
+                    continue;
+
+                sPair pair;
+                float d2 = 0;
+
+                for(int k=0; k<3; k++)
+                {
+                    float pa = a.Origin[k] + s*a.Direction[k];
+                    float pc = c.Origin[k] + t*c.Direction[k];
+
+                    d2 += (pa - pc)*(pa - pc);
+                    pair.Midpoint[k] = 0.5f*(pa + pc);
+                }
+
+                if(d2>limit)
+                    continue;
+
+                pair.A        = r;
+                pair.B        = q;
+                pair.Distance = d2;
+
+                mPairs.push_back(pair);
+            }
+        }
+
+        //== closest proposals first; grow into every camera, solve, collect again at the
+        //== solution.  The first one that keeps MinRays rays wins.
+
+        std::sort(mPairs.begin(), mPairs.end());
+
+        for(int p=0; p<(int) mPairs.size(); p++)
+        {
+            float point[3];
+
+            int count = Collect(mPairs[p].Midpoint, mSettings.MaxRayDistance, &mCollected[0]);
+
+            if(count<mSettings.MinRays || !SolvePoint(&mCollected[0], count, mPairs[p].Midpoint, point))
+                continue;
+
+            count = Collect(point, mSettings.MaxRayDistance, &mCollected[0]);
+
+            if(count<mSettings.MinRays)
+                continue;
+
+            AddMarker(&mCollected[0], count, point);
+            mStatistics.Discovered++;
+            break;
+        }
+    }
+}
+
+void cTriangulator::Refine()
+{
+    //== two batched passes: the first drops rays beyond MaxRayDistance, the second gives the
+    //== final positions and residuals.  Markers left with too few rays free theirs.
+
+    float limit = mSettings.MaxRayDistance*mSettings.MaxRayDistance;
+
+    for(int pass=0; pass<2; pass++)
+    {
+        int markers = (int) mMarkers.size();
+
+        if(markers==0)
+            return;
+
+        mJobStart.resize(markers + 1);
+        mReferences.resize(3*markers);
+        mJobRays = mMarkerRays;
+
+        for(int m=0; m<markers; m++)
+        {
+            mJobStart[m] = mMarkers[m].FirstRay;
+
+            for(int k=0; k<3; k++)
+                mReferences[3*m + k] = mMarkers[m].Position[k];
+        }
+
+        mJobStart[markers] = (int) mJobRays.size();
+
+        SolveBatch(markers);
+
+        mKeptMarkers.clear();
+        mKeptRays.clear();
+
+        for(int m=0; m<markers; m++)
+        {
+            const float *point = &mSolved[3*m];
+
+            sMarker marker;
+
+            marker.FirstRay = (int) mKeptRays.size();
+            marker.RayCount = 0;
+            marker.Residual = 0;
+
+            for(int i=mJobStart[m]; i<mJobStart[m + 1]; i++)
+            {
+                int   r   = mJobRays[i];
+                sRay &ray = mRays[r];
+
+                ray.Marker = -1;
+
+                if(!mValid[m])
+                    continue;
+
+                float d2 = RayDistance2(ray, point);
+
+                if(pass==0 && d2>limit)
+                    continue;
+
+                mKeptRays.push_back(r);
+                marker.RayCount++;
+                marker.Residual += d2;
+            }
+
+            if(marker.RayCount<mSettings.MinRays)
+            {
+                mKeptRays.resize(marker.FirstRay);
+                continue;
+            }
+
+            for(int i=marker.FirstRay; i<(int) mKeptRays.size(); i++)
+                mRays[mKeptRays[i]].Marker = (int) mKeptMarkers.size();
+
+            marker.Position[0] = point[0];
+            marker.Position[1] = point[1];
+            marker.Position[2] = point[2];
+            marker.Residual    = sqrtf(marker.Residual/marker.RayCount);
+
+            mKeptMarkers.push_back(marker);
+        }
+
+        mMarkers.swap(mKeptMarkers);
+        mMarkerRays.swap(mKeptRays);
+    }
+}
+
+#if !defined(__PLATFORM__LINUX__)
+
+void cTriangulator::Rays(std::vector<Core::cCameraRay> &Rays) const
+{
+    Rays.clear();
+    Rays.reserve(mRays.size());
+
+    for(int r=0; r<(int) mRays.size(); r++)
+    {
+        const sRay &ray = mRays[r];
+
+        //== assigned rays end at their marker ==--
+
+        float length = mSettings.MaxDepth;
+
+        if(ray.Marker>=0)
+        {
+            const float *point = mMarkers[ray.Marker].Position;
+
+            length = (point[0] - ray.Origin[0])*ray.Direction[0] + (point[1] - ray.Origin[1])*ray.Direction[1] +
+                     (point[2] - ray.Origin[2])*ray.Direction[2];
+        }
+
+        Rays.push_back(Core::cCameraRay(r, mCameras[ray.Camera].Camera.Serial, ReconstructionID(r),
+                                        Core::cVector2f(ray.Image[0], ray.Image[1]), ray.Area,
+                                        Core::cVector3f(ray.Origin[0], ray.Origin[1], ray.Origin[2]),
+                                        Core::cVector3f(ray.Direction[0], ray.Direction[1], ray.Direction[2]),
+                                        length));
+    }
+}
+
+void cTriangulator::Fill(Core::cRayBundle &Bundle) const
+{
+    std::vector<Core::cCameraRay> rays;
+
+    Rays(rays);
+    Bundle.SetRays(rays);
+}
+
+#endif
+
+void cTriangulator::Benchmark(int Cameras, int Markers, int Frames, sBenchmark &Result)
+{
+    const double kRadius    = 6.0;          //== Camera ring, meters ==================================----
+    const double kFocal     = 1000.0;       //== Pixels ===============================================----
+    const int    kWidth     = 1280;
+    const int    kHeight    = 1024;
+    const float  kNoise     = 0.1f;         //== Centroid noise, pixels ===============================----
+    const float  kStep      = 0.004f;       //== Marker motion per frame, meters (1 m/s at 240 Hz) ===----
+
+    //== cameras on a ring at alternating heights, looking at the volume center ==--
+
+    std::vector<sCamera> cameras(Cameras);
+
+    for(int c=0; c<Cameras; c++)
+    {
+        sCamera &camera = cameras[c];
+
+        double angle = 2*3.14159265358979*c/Cameras;
+
+        camera.Serial      = 1000 + c;
+        camera.Position[0] = kRadius*cos(angle);
+        camera.Position[1] = (c&1) ? 3.5 : 2.5;
+        camera.Position[2] = kRadius*sin(angle);
+
+        double forward[3] = { -camera.Position[0], 1.0 - camera.Position[1], -camera.Position[2] };
+        double length     = sqrt(forward[0]*forward[0] + forward[1]*forward[1] + forward[2]*forward[2]);
+
+        for(int k=0; k<3; k++)
+            forward[k] /= length;
+
+        //== right = forward x up, down = forward x right ==--
+
+        double right[3] = { -forward[2], 0, forward[0] };
+
+        length = sqrt(right[0]*right[0] + right[2]*right[2]);
+        right[0] /= length;
+        right[2] /= length;
+
+        double down[3] = { forward[1]*right[2] - forward[2]*right[1],
+                           forward[2]*right[0] - forward[0]*right[2],
+                           forward[0]*right[1] - forward[1]*right[0] };
+
+        for(int k=0; k<3; k++)
+        {
+            camera.Orientation[k*3]     = right[k];
+            camera.Orientation[k*3 + 1] = down[k];
+            camera.Orientation[k*3 + 2] = forward[k];
+        }
+
+        camera.Model.Distort               = false;
+        camera.Model.LensCenterX           = kWidth/2;
+        camera.Model.LensCenterY           = kHeight/2;
+        camera.Model.HorizontalFocalLength = kFocal;
+        camera.Model.VerticalFocalLength   = kFocal;
+    }
+
+    cTriangulator triangulator;
+
+    triangulator.SetCameras(cameras);
+
+    cBenchmarkNoise random(2463534242u);
+
+    std::vector<float> position(3*Markers), velocity(3*Markers);
+
+    const float low[3]  = { -3.0f, 0.1f, -3.0f };
+    const float high[3] = {  3.0f, 2.2f,  3.0f };
+
+    //== rays are only paired where markers can be ==--
+
+    sSettings settings = triangulator.Settings();
+
+    for(int k=0; k<3; k++)
+    {
+        settings.VolumeMin[k] = low[k] - 0.1f;
+        settings.VolumeMax[k] = high[k] + 0.1f;
+    }
+
+    triangulator.SetSettings(settings);
+
+    for(int i=0; i<Markers; i++)
+    {
+        for(int k=0; k<3; k++)
+        {
+            position[3*i + k] = low[k] + random.Uniform()*(high[k] - low[k]);
+            velocity[3*i + k] = random.Signed()*kStep;
+        }
+    }
+
+    std::vector<int> truth;         //== Marker behind every observation ==--
+    std::vector<int> views(Markers);
+    std::vector<int> found(Markers);
+
+    Core::cTimer timer;
+
+    double cold     = 0;
+    double warm     = 0;
+    long   visible  = 0;
+    long   correct  = 0;
+    long   ghosts   = 0;
+    double error    = 0;
+
+    for(int f=0; f<Frames; f++)
+    {
+        for(int i=0; i<3*Markers; i++)
+        {
+            int k = i%3;
+
+            position[i] += velocity[i];
+
+            if(position[i]<low[k] || position[i]>high[k])
+            {
+                velocity[i] = -velocity[i];
+                position[i] += 2*velocity[i];
+            }
+        }
+
+        triangulator.BeginFrame();
+        truth.clear();
+
+        std::fill(views.begin(), views.end(), 0);
+
+        for(int c=0; c<Cameras; c++)
+        {
+            const sCameraState &state = triangulator.mCameras[c];
+
+            for(int i=0; i<Markers; i++)
+            {
+                double v[3] = { position[3*i] - state.Camera.Position[0],
+                                position[3*i + 1] - state.Camera.Position[1],
+                                position[3*i + 2] - state.Camera.Position[2] };
+
+                double z = state.Rotation[6]*v[0] + state.Rotation[7]*v[1] + state.Rotation[8]*v[2];
+
+                if(z<0.1)
+                    continue;
+
+                float x = (float) (kWidth/2  + kFocal*(state.Rotation[0]*v[0] + state.Rotation[1]*v[1] + state.Rotation[2]*v[2])/z);
+                float y = (float) (kHeight/2 + kFocal*(state.Rotation[3]*v[0] + state.Rotation[4]*v[1] + state.Rotation[5]*v[2])/z);
+
+                if(x<0 || y<0 || x>=kWidth || y>=kHeight)
+                    continue;
+
+                triangulator.AddObservation(c, x + kNoise*random.Signed(), y + kNoise*random.Signed());
+                truth.push_back(i);
+                views[i]++;
+            }
+        }
+
+        timer.CatchUp();
+        triangulator.Solve();
+
+        if(f==0)
+            cold = timer.Elapsed();
+        else
+            warm += timer.Elapsed();
+
+        //== a marker is correct when all its rays see the same true marker within 5 mm ==--
+
+        std::fill(found.begin(), found.end(), 0);
+
+        for(int m=0; m<triangulator.MarkerCount(); m++)
+        {
+            const sMarker &marker = triangulator.mMarkers[m];
+
+            int  i    = truth[triangulator.mMarkerRays[marker.FirstRay]];
+            bool same = true;
+
+            for(int r=0; r<marker.RayCount; r++)
+                same = same && (truth[triangulator.mMarkerRays[marker.FirstRay + r]]==i);
+
+            double d2 = 0;
+
+            for(int k=0; k<3; k++)
+                d2 += (marker.Position[k] - position[3*i + k])*(marker.Position[k] - position[3*i + k]);
+
+            if(same && d2<0.005*0.005 && !found[i])
+            {
+                found[i] = 1;
+                correct++;
+                error += sqrt(d2);
+            }
+            else
+                ghosts++;
+        }
+
+        for(int i=0; i<Markers; i++)
+            if(views[i]>=triangulator.mSettings.MinRays)
+                visible++;
+    }
+
+    Result.Cameras          = Cameras;
+    Result.Markers          = Markers;
+    Result.ColdMilliseconds = 1e3*cold;
+    Result.WarmMilliseconds = (Frames>1) ? 1e3*warm/(Frames - 1) : 0.0;
+    Result.Recall           = (visible>0) ? (double) correct/visible : 0.0;
+    Result.Ghosts           = (Frames>0) ? (double) ghosts/Frames : 0.0;
+    Result.MeanError        = (correct>0) ? error/correct : 0.0;
+}
@@ -0,0 +1,236 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Multi-view reconstruction: turns the 2D objects of every camera in a FrameGroup into world
+//== rays and groups rays that (nearly) meet into 3D markers.
+//==
+//== Cameras are described by their pose and Core::DistortionModel.  A camera looks down its
+//== own +Z axis with image X to the right and image Y down; Orientation is the row major
+//== matrix whose columns are those axes in world space.  Observations are undistorted with
+//== the model (when Distort is set) and normalized with its focal lengths and lens center.
+//==
+//== Rays are paired in three stages, each bounded by a spatial structure:
+//==
+//==   1. Last frame's markers are projected into every camera and pick up the nearest free
+//==      observation within SeedRadius through a per camera 2D grid.  In steady state almost
+//==      every ray is assigned here at O(markers * cameras).
+//==   2. Leftover rays that cross the capture volume go into a cEpipolarIndex.  Taking free
+//==      rays one at a time, the rays of other cameras in its epipolar planes that pass within
+//==      MaxRayDistance propose markers, closest first; the first that grows to MinRays
+//==      (by projecting into all other cameras) claims its rays, which are then skipped.
+//==   3. Every marker is solved by least squares (the point closest to all its rays) in SIMD
+//==      batches of four, rays further than MaxRayDistance are dropped and the marker is
+//==      solved again.
+//==
+//== Markers need MinRays rays.  Each ray belongs to at most one marker; ReconstructionID()
+//== reports it 1-based, 0 for unassigned rays, as cCameraRay expects.
+//==
+
+#ifndef __CAMERALIBRARY__TRIANGULATOR_H__
+#define __CAMERALIBRARY__TRIANGULATOR_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <vector>
+#include "coremath.h"
+#include "epipolarindex.h"
+#include "Core/Platform.h"
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace Core
+{
+    class cCameraRay;
+    class cRayBundle;
+}
+
+namespace CameraLibrary
+{
+    class FrameGroup;
+
+    class cTriangulator
+    {
+    public:
+        typedef cEpipolarIndex::sCamera sCamera;
+
+        struct sSettings
+        {
+            float   MaxRayDistance;             //== Ray to marker distance, meters ============----
+            float   SeedRadius;                 //== Last frame marker search radius, meters ===----
+            float   MinDepth;                   //== Along the ray, meters =====================----
+            float   MaxDepth;
+            float   VolumeMin[3];               //== Capture volume, rays are paired inside ====----
+            float   VolumeMax[3];
+            float   CellSize;                   //== 2D grid cells, normalized image units =====----
+            int     MinRays;
+            bool    UsePreviousFrame;
+        };
+
+        cTriangulator();
+
+        void    SetSettings(const sSettings &Settings)      { mSettings = Settings; }
+        const sSettings & Settings() const                  { return mSettings; }
+
+        void    SetCameras(const std::vector<sCamera> &Cameras);
+        int     CameraCount() const                 { return (int) mCameras.size(); }
+        int     CameraIndex(int Serial) const;      //== -1 if not calibrated =================----
+
+        void    Reset();                            //== Forget last frame's markers ==========----
+
+        //== Reconstruct a frame group, objects of uncalibrated cameras are ignored ==--
+
+        int     Reconstruct(FrameGroup *Group);
+
+        //== Or feed observations by hand: distorted pixel coordinates per camera index ==--
+
+        void    BeginFrame();
+        void    AddObservation(int Camera, float X, float Y, float Area = 0);
+        int     Solve();                            //== Returns the marker count ==============----
+
+        //== Results ==--
+
+        int     MarkerCount() const                 { return (int) mMarkers.size(); }
+        const float * MarkerPosition(int Marker) const      { return mMarkers[Marker].Position; }
+        float   MarkerResidual(int Marker) const    { return mMarkers[Marker].Residual; }  //== RMS, m
+        int     MarkerRayCount(int Marker) const    { return mMarkers[Marker].RayCount; }
+
+        int     RayCount() const                    { return (int) mRays.size(); }
+        int     RayCamera(int Ray) const            { return mRays[Ray].Camera; }
+        unsigned int ReconstructionID(int Ray) const        { return (unsigned int) (mRays[Ray].Marker + 1); }
+
+#if !defined(__PLATFORM__LINUX__)
+        void    Rays(std::vector<Core::cCameraRay> &Rays) const;
+        void    Fill(Core::cRayBundle &Bundle) const;
+#endif
+
+        struct sStatistics
+        {
+            int     Rays;
+            int     Seeded;                     //== Markers carried over from last frame ======----
+            int     Discovered;                 //== Markers found through the epipolar index ==----
+            int     IndexEntries;               //== Epipolar index, rays x other cameras ======----
+            int     PairsTested;
+            int     Unassigned;                 //== Rays left without a marker ================----
+        };
+
+        const sStatistics & Statistics() const      { return mStatistics; }
+
+        //== Cameras in a ring around an 8 x 8 m volume looking at its center, markers drifting
+        //== through it.  Reports the first (cold) frame, steady state frames, how many markers
+        //== were found within 5 mm and how many markers matched nothing (ghosts).
+
+        struct sBenchmark
+        {
+            int     Cameras;
+            int     Markers;
+            double  ColdMilliseconds;
+            double  WarmMilliseconds;
+            double  Recall;
+            double  Ghosts;                     //== Per frame =================================----
+            double  MeanError;                  //== Meters ====================================----
+        };
+
+        static void Benchmark(int Cameras, int Markers, int Frames, sBenchmark &Result);
+
+    private:
+        struct sCameraState
+        {
+            sCamera Camera;
+            float   Rotation[9];                //== World to camera (transpose) ===============----
+            float   Position[3];
+        };
+
+        struct sRay
+        {
+            int     Camera;
+            float   Image[2];                   //== Distorted pixels, as observed =============----
+            float   Normalized[2];              //== Undistorted, x/z and y/z ==================----
+            float   Area;
+            float   Origin[3];
+            float   Direction[3];               //== Unit length ===============================----
+            int     Marker;                     //== -1 unassigned =============================----
+        };
+
+        struct sMarker
+        {
+            float   Position[3];
+            float   Residual;
+            int     FirstRay;                   //== Into mMarkerRays ==========================----
+            int     RayCount;
+        };
+
+        struct sPair
+        {
+            int     A;
+            int     B;
+            float   Distance;                   //== Squared ===================================----
+            float   Midpoint[3];
+
+            bool operator<(const sPair &Other) const    { return Distance<Other.Distance; }
+        };
+
+        struct sCellEntry
+        {
+            float   X;                          //== Copy of Normalized, saves a ray lookup ====----
+            float   Y;
+            int     Ray;
+        };
+
+        void    BuildGrid();
+        void    Seed();
+        void    Discover();
+        bool    Span(int Ray, float &Near, float &Far) const;     //== Inside the volume ==----
+        void    Refine();
+
+        int     Nearest(int Camera, const float Point[3], float Radius) const;
+        int     Collect(const float Point[3], float Radius, int *Rays) const;   //== Per camera -
+        bool    SolvePoint(const int *Rays, int Count, const float Reference[3], float Point[3]) const;
+        void    SolveBatch(int Jobs);
+        void    AddMarker(const int *Rays, int Count, const float Position[3]);
+
+        static float RayDistance2(const sRay &Ray, const float Point[3]);     //== Squared ==----
+
+        unsigned int Cell(int Camera, int X, int Y) const;
+
+        sSettings                   mSettings;
+        sStatistics                 mStatistics;
+
+        std::vector<sCameraState>   mCameras;
+        std::vector<sRay>           mRays;
+        std::vector<sMarker>        mMarkers;
+        std::vector<int>            mMarkerRays;
+        std::vector<float>          mPrevious;          //== Last frame's markers, xyz =======----
+
+        //== Per frame scratch, kept to avoid reallocating ==--
+
+        int                         mCellMask;
+        std::vector<int>            mCellStart;         //== 2D grid bucket -> first slot ===----
+        std::vector<sCellEntry>     mCellEntries;
+
+        std::vector<std::pair<unsigned int, int> > mEntries;   //== (bucket, ray) =========----
+
+        cEpipolarIndex              mIndex;
+        std::vector<float>          mNear;              //== Volume entry depth per ray =====----
+        std::vector<int>            mCandidates;
+        std::vector<sPair>          mPairs;
+        std::vector<int>            mCollected;         //== One ray per camera =============----
+        std::vector<int>            mSeedRays;          //== Seed x camera, -1 none =========----
+
+        //== Batched solves: job i uses mJobRays[mJobStart[i] .. mJobStart[i+1]) around
+        //== mReferences[3i], results in mSolved[3i] when mValid[i].
+
+        std::vector<int>            mJobStart;
+        std::vector<int>            mJobRays;
+        std::vector<float>          mReferences;
+        std::vector<float>          mSolved;
+        std::vector<char>           mValid;
+        std::vector<float>          mNormal;            //== SoA normal equations ===========----
+
+        std::vector<sMarker>        mKeptMarkers;
+        std::vector<int>            mKeptRays;
+    };
+}
+
+#endif
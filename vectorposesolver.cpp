@@ -0,0 +1,861 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "vectorposesolver.h"
+#include "benchmarknoise.h"
+#include "modulevector.h"
+#include "Core/Timer.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    const int    kTrackSteps    = 3;        //== Gauss-Newton steps from last frame ===============----
+    const int    kAcquireSteps  = 4;        //== ... from a closed form candidate =================----
+    const double kMaxResidual   = 0.01;     //== RMS pair error allowed, of the RMS distance ======----
+
+    //== Clip arrangements, cVectorSettings::Arrangement ==--
+
+    template<int Arrangement> struct sArrangement;
+
+    template<> struct sArrangement<cVectorSettings::VectorClip>
+    {
+        enum { kMarkers = 3 };
+    };
+
+    template<> struct sArrangement<cVectorSettings::TrackClipPro>
+    {
+        enum { kMarkers = 3 };
+    };
+
+    int ArrangementMarkers(int Arrangement)
+    {
+        switch(Arrangement)
+        {
+        case cVectorSettings::VectorClip:   return sArrangement<cVectorSettings::VectorClip>::kMarkers;
+        case cVectorSettings::TrackClipPro: return sArrangement<cVectorSettings::TrackClipPro>::kMarkers;
+        }
+
+        return 0;
+    }
+
+    //== Real roots of x^2 + B x + C ==--
+
+    int SolveQuadratic(double B, double C, double Roots[2])
+    {
+        double discriminant = B*B - 4*C;
+
+        if(discriminant<0)
+            return 0;
+
+        //== the larger magnitude root first, the other from the product: no cancellation ==--
+
+        double q = -0.5*(B + (B<0 ? -sqrt(discriminant) : sqrt(discriminant)));
+
+        if(q==0)
+        {
+            Roots[0] = 0;
+            return 1;
+        }
+
+        Roots[0] = q;
+        Roots[1] = C/q;
+
+        return 2;
+    }
+
+    //== Largest real root of x^3 + A x^2 + B x + C ==--
+
+    double LargestCubicRoot(double A, double B, double C)
+    {
+        double p = B - A*A/3;
+        double q = 2*A*A*A/27 - A*B/3 + C;
+        double h = 0.25*q*q + p*p*p/27;
+        double x;
+
+        if(h>=0)
+        {
+            double root = sqrt(h);
+
+            x = cbrt(-0.5*q + root) + cbrt(-0.5*q - root);
+        }
+        else
+        {
+            double scale = sqrt(-p/3);
+
+            x = 2*scale*cos(acos(std::max(-1.0, std::min(1.0, -0.5*q/(scale*scale*scale))))/3);
+        }
+
+        x -= A/3;
+
+        for(int n=0; n<2; n++)
+        {
+            double value = ((x + A)*x + B)*x + C;
+            double slope = (3*x + 2*A)*x + B;
+
+            if(slope==0)
+                break;
+
+            x -= value/slope;
+        }
+
+        return x;
+    }
+
+    //== Real roots of C[0] + C[1] x + ... + C[4] x^4: Ferrari, through the resolvent cubic, and
+    //== a Newton step on each root against the original polynomial.
+
+    int SolveQuartic(const double C[5], double Roots[4])
+    {
+        double scale = 0;
+
+        for(int i=0; i<5; i++)
+            scale = std::max(scale, fabs(C[i]));
+
+        int count = 0;
+
+        if(fabs(C[4])<=1e-12*scale)
+        {
+            //== not really a quartic; the poses this comes from are degenerate anyway ==--
+
+            if(fabs(C[3])>1e-12*scale)
+            {
+                double a = C[2]/C[3], b = C[1]/C[3], c = C[0]/C[3];
+                double x = LargestCubicRoot(a, b, c);
+
+                Roots[count++] = x;
+                count += SolveQuadratic(a + x, b + x*(a + x), Roots + count);
+            }
+            else if(fabs(C[2])>1e-12*scale)
+                count = SolveQuadratic(C[1]/C[2], C[0]/C[2], Roots);
+
+            return count;
+        }
+
+        double a = C[3]/C[4], b = C[2]/C[4], c = C[1]/C[4], d = C[0]/C[4];
+
+        //== x = y - a/4: y^4 + p y^2 + q y + r ==--
+
+        double shift = 0.25*a;
+        double p     = b - 6*shift*shift;
+        double q     = c - 2*b*shift + 8*shift*shift*shift;
+        double r     = d - c*shift + b*shift*shift - 3*shift*shift*shift*shift;
+        double y[4];
+
+        if(fabs(q)<=1e-14*(1 + fabs(p)*fabs(p)))
+        {
+            //== biquadratic ==--
+
+            double z[2];
+            int    squares = SolveQuadratic(p, r, z);
+
+            for(int i=0; i<squares; i++)
+            {
+                if(z[i]<0)
+                    continue;
+
+                y[count++] = sqrt(z[i]);
+                y[count++] = -sqrt(z[i]);
+            }
+        }
+        else
+        {
+            //== (y^2 + p/2 + m)^2 = 2m (y - q/4m)^2 for the positive root m of the resolvent ==--
+
+            double m = LargestCubicRoot(p, 0.25*p*p - r, -0.125*q*q);
+
+            if(m<=0)
+                return 0;
+
+            double s      = sqrt(2*m);
+            double offset = q/(2*s);
+
+            count  = SolveQuadratic(-s, 0.5*p + m + offset, y);
+            count += SolveQuadratic(s, 0.5*p + m - offset, y + count);
+        }
+
+        for(int i=0; i<count; i++)
+        {
+            double x = y[i] - shift;
+
+            double value = (((x + a)*x + b)*x + c)*x + d;
+            double slope = ((4*x + 3*a)*x + 2*b)*x + c;
+
+            if(slope!=0)
+                x -= value/slope;
+
+            Roots[i] = x;
+        }
+
+        return count;
+    }
+
+    //== Pair distance refinement: Gauss-Newton on l_i^2 + l_j^2 - 2 l_i l_j c_ij - d_ij^2 over
+    //== all pairs, on the normal equations.  Markers is a constant, everything unrolls.
+
+    template<int Markers>
+    void Refine(const double (*Cosine)[cVectorPoseSolver::kMaxMarkers], const double (*Distance2)[cVectorPoseSolver::kMaxMarkers],
+                double *Depth, int Steps)
+    {
+        for(int step=0; step<Steps; step++)
+        {
+            double normal[Markers][Markers + 1];
+
+            for(int i=0; i<Markers; i++)
+                for(int j=0; j<=Markers; j++)
+                    normal[i][j] = 0;
+
+            for(int i=0; i<Markers; i++)
+            {
+                for(int j=i + 1; j<Markers; j++)
+                {
+                    double residual = Depth[i]*Depth[i] + Depth[j]*Depth[j] - 2*Depth[i]*Depth[j]*Cosine[i][j] - Distance2[i][j];
+                    double gi       = 2*(Depth[i] - Depth[j]*Cosine[i][j]);
+                    double gj       = 2*(Depth[j] - Depth[i]*Cosine[i][j]);
+
+                    normal[i][i]       += gi*gi;
+                    normal[j][j]       += gj*gj;
+                    normal[i][j]       += gi*gj;
+                    normal[j][i]       += gi*gj;
+                    normal[i][Markers] += gi*residual;
+                    normal[j][Markers] += gj*residual;
+                }
+            }
+
+            //== Gaussian elimination with partial pivoting ==--
+
+            for(int c=0; c<Markers; c++)
+            {
+                int pivot = c;
+
+                for(int r=c + 1; r<Markers; r++)
+                    if(fabs(normal[r][c])>fabs(normal[pivot][c]))
+                        pivot = r;
+
+                if(normal[pivot][c]==0)
+                    return;
+
+                if(pivot!=c)
+                    for(int k=c; k<=Markers; k++)
+                        std::swap(normal[c][k], normal[pivot][k]);
+
+                for(int r=c + 1; r<Markers; r++)
+                {
+                    double factor = normal[r][c]/normal[c][c];
+
+                    for(int k=c; k<=Markers; k++)
+                        normal[r][k] -= factor*normal[c][k];
+                }
+            }
+
+            for(int r=Markers - 1; r>=0; r--)
+            {
+                double sum = normal[r][Markers];
+
+                for(int k=r + 1; k<Markers; k++)
+                    sum -= normal[r][k]*normal[k][Markers];
+
+                normal[r][Markers] = sum/normal[r][r];
+                Depth[r]          -= normal[r][Markers];
+            }
+        }
+    }
+
+    template<int Markers>
+    double Residual(const double (*Rays)[3], const double (*Distance2)[cVectorPoseSolver::kMaxMarkers], const double *Depth)
+    {
+        double sum = 0;
+
+        for(int i=0; i<Markers; i++)
+        {
+            for(int j=i + 1; j<Markers; j++)
+            {
+                double squared = 0;
+
+                for(int k=0; k<3; k++)
+                {
+                    double d = Depth[i]*Rays[i][k] - Depth[j]*Rays[j][k];
+                    squared += d*d;
+                }
+
+                double error = sqrt(squared) - sqrt(Distance2[i][j]);
+
+                sum += error*error;
+            }
+        }
+
+        return sqrt(sum/(Markers*(Markers - 1)/2));
+    }
+}
+
+cVectorPoseSolver::cVectorPoseSolver()
+    : mSolver(0)
+    , mTracking(false)
+{
+    mConstellation.Markers = 0;
+
+    for(int i=0; i<kMaxMarkers; i++)
+        mDepth[i] = mMotion[i] = 0;
+}
+
+bool cVectorPoseSolver::SetSettings(const cVectorSettings &Settings)
+{
+    int markers = ArrangementMarkers(Settings.Arrangement);
+
+    if(markers!=3 || Settings.ImagerWidth<=0 || Settings.PixelWidth<=0)
+        return false;
+
+    double distances[9] = { 0,                   Settings.Distance12, Settings.Distance13,
+                            Settings.Distance12, 0,                   Settings.Distance23,
+                            Settings.Distance13, Settings.Distance23, 0 };
+
+    sCamera camera;
+
+    camera.FocalLength = Settings.ImagerFocalLength*Settings.PixelWidth/Settings.ImagerWidth;
+    camera.PrincipalX  = Settings.PrincipalX;
+    camera.PrincipalY  = Settings.PrincipalY;
+
+    return Dispatch(markers, distances, camera);
+}
+
+bool cVectorPoseSolver::SetCustom(int Markers, const double *Distances, const sCamera &Camera)
+{
+    return Dispatch(Markers, Distances, Camera);
+}
+
+bool cVectorPoseSolver::Dispatch(int Markers, const double *Distances, const sCamera &Camera)
+{
+    static const tSolver solvers[kMaxMarkers + 1] = { 0, 0, 0, &Solve<3>, &Solve<4>, &Solve<5>, &Solve<6>, &Solve<7>, &Solve<8> };
+
+    mSolver   = 0;
+    mTracking = false;
+
+    mConstellation.Markers = 0;
+
+    if(Markers<3 || Markers>kMaxMarkers || Camera.FocalLength<=0)
+        return false;
+
+    for(int i=0; i<Markers; i++)
+        for(int j=0; j<Markers; j++)
+            if(i!=j && Distances[i*Markers + j]<=0)
+                return false;
+
+    //== everything that only depends on the constellation and the camera, once ==--
+
+    sConstellation &constellation = mConstellation;
+
+    constellation.Markers = Markers;
+
+    for(int i=0; i<Markers; i++)
+        for(int j=0; j<Markers; j++)
+            constellation.Distance2[i][j] = Distances[i*Markers + j]*Distances[i*Markers + j];
+
+    double a2 = constellation.Distance2[1][2];
+    double b2 = constellation.Distance2[0][2];
+    double c2 = constellation.Distance2[0][1];
+
+    constellation.Difference = (a2 - c2)/b2;
+    constellation.SumRatio   = (a2 + c2)/b2;
+    constellation.A2         = a2/b2;
+    constellation.C2         = c2/b2;
+    constellation.B2         = b2;
+
+    constellation.InverseFocal = 1.0/Camera.FocalLength;
+    constellation.PrincipalX   = Camera.PrincipalX;
+    constellation.PrincipalY   = Camera.PrincipalY;
+
+    mSolver = solvers[Markers];
+
+    return true;
+}
+
+template<int Markers>
+bool cVectorPoseSolver::Solve(const sConstellation &Constellation, const double (*Rays)[3],
+                              double *Depth, bool &Tracking, double &Residual)
+{
+    double cosine[kMaxMarkers][kMaxMarkers];
+
+    for(int i=0; i<Markers; i++)
+        for(int j=i + 1; j<Markers; j++)
+            cosine[i][j] = cosine[j][i] = Rays[i][0]*Rays[j][0] + Rays[i][1]*Rays[j][1] + Rays[i][2]*Rays[j][2];
+
+    double scale = 0;
+
+    for(int i=0; i<Markers; i++)
+        for(int j=i + 1; j<Markers; j++)
+            scale += Constellation.Distance2[i][j];
+
+    double tolerance = kMaxResidual*sqrt(scale/(Markers*(Markers - 1)/2));
+
+    //== tracking: from last frame's depths ==--
+
+    double previous[kMaxMarkers];
+
+    for(int i=0; i<Markers; i++)
+        previous[i] = Depth[i];
+
+    if(Tracking)
+    {
+        Refine<Markers>(cosine, Constellation.Distance2, Depth, kTrackSteps);
+
+        bool ahead = true;
+
+        for(int i=0; i<Markers; i++)
+            ahead = ahead && Depth[i]>0;
+
+        if(ahead)
+        {
+            Residual = ::Residual<Markers>(Rays, Constellation.Distance2, Depth);
+
+            if(Residual<=tolerance)
+                return true;
+        }
+    }
+
+    //== acquisition: Grunert's quartic in v = l3 / l1, then u = l2 / l1 and l1 ==--
+
+    double ca = cosine[1][2];
+    double cb = cosine[0][2];
+    double cg = cosine[0][1];
+
+    double d  = Constellation.Difference;
+    double s  = Constellation.SumRatio;
+    double a2 = Constellation.A2;
+    double c2 = Constellation.C2;
+
+    double coefficients[5];
+
+    coefficients[4] = (d - 1)*(d - 1) - 4*c2*ca*ca;
+    coefficients[3] = 4*(d*(1 - d)*cb - (1 - s)*ca*cg + 2*c2*ca*ca*cb);
+    coefficients[2] = 2*(d*d - 1 + 2*d*d*cb*cb + 2*(1 - c2)*ca*ca - 4*s*ca*cb*cg + 2*(1 - a2)*cg*cg);
+    coefficients[1] = 4*(-d*(1 + d)*cb + 2*a2*cg*cg*cb - (1 - s)*ca*cg);
+    coefficients[0] = (1 + d)*(1 + d) - 4*a2*cg*cg;
+
+    double roots[4];
+    int    count = SolveQuartic(coefficients, roots);
+
+    double best      = -1;
+    double bestScore = 0;
+    double candidate[kMaxMarkers];
+
+    for(int r=0; r<count; r++)
+    {
+        double v           = roots[r];
+        double denominator = 2*(cg - v*ca);
+        double base        = 1 + v*v - 2*v*cb;
+
+        if(v<=0 || fabs(denominator)<1e-12 || base<=0)
+            continue;
+
+        double u = ((d - 1)*v*v - 2*d*cb*v + 1 + d)/denominator;
+
+        if(u<=0)
+            continue;
+
+        candidate[0] = sqrt(Constellation.B2/base);
+        candidate[1] = u*candidate[0];
+        candidate[2] = v*candidate[0];
+
+        //== further markers: the depth on their ray at the right distance from marker 1 that
+        //== best keeps the distance to marker 2
+
+        for(int m=3; m<Markers; m++)
+        {
+            double along  = candidate[0]*cosine[0][m];
+            double across = candidate[0]*candidate[0] - along*along;
+            double reach  = std::max(Constellation.Distance2[0][m] - across, 0.0);
+
+            double nearDepth = along - sqrt(reach);
+            double farDepth  = along + sqrt(reach);
+
+            double nearError = fabs(nearDepth*nearDepth + candidate[1]*candidate[1] - 2*nearDepth*candidate[1]*cosine[1][m] - Constellation.Distance2[1][m]);
+            double farError  = fabs(farDepth*farDepth + candidate[1]*candidate[1] - 2*farDepth*candidate[1]*cosine[1][m] - Constellation.Distance2[1][m]);
+
+            candidate[m] = (nearDepth>0 && nearError<farError) ? nearDepth : farDepth;
+        }
+
+        Refine<Markers>(cosine, Constellation.Distance2, candidate, kAcquireSteps);
+
+        bool ahead = true;
+
+        for(int i=0; i<Markers; i++)
+            ahead = ahead && candidate[i]>0;
+
+        if(!ahead)
+            continue;
+
+        //== extra markers tell the poses apart; three alone always fit, then the one nearest
+        //== to last frame wins, or the one facing the camera most squarely
+
+        double residual = ::Residual<Markers>(Rays, Constellation.Distance2, candidate);
+        double score    = 0;
+
+        if(Markers>3 && residual>tolerance)
+            score = 1e3*residual/tolerance;
+
+        if(Tracking)
+        {
+            for(int i=0; i<Markers; i++)
+                score += (candidate[i] - previous[i])*(candidate[i] - previous[i]);
+        }
+        else
+        {
+            //== sine squared between the first three's normal and the ray to their middle ==--
+
+            double p[3][3], normal[3], middle[3];
+
+            for(int i=0; i<3; i++)
+                for(int k=0; k<3; k++)
+                    p[i][k] = candidate[i]*Rays[i][k];
+
+            double e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+            double e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+
+            normal[0] = e1[1]*e2[2] - e1[2]*e2[1];
+            normal[1] = e1[2]*e2[0] - e1[0]*e2[2];
+            normal[2] = e1[0]*e2[1] - e1[1]*e2[0];
+
+            for(int k=0; k<3; k++)
+                middle[k] = p[0][k] + p[1][k] + p[2][k];
+
+            double along  = normal[0]*middle[0] + normal[1]*middle[1] + normal[2]*middle[2];
+            double normal2 = normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2];
+            double middle2 = middle[0]*middle[0] + middle[1]*middle[1] + middle[2]*middle[2];
+
+            if(normal2>0 && middle2>0)
+                score += 1 - along*along/(normal2*middle2);
+        }
+
+        if(best<0 || score<bestScore)
+        {
+            best      = residual;
+            bestScore = score;
+
+            for(int i=0; i<Markers; i++)
+                Depth[i] = candidate[i];
+        }
+    }
+
+    if(best<0 || best>tolerance)
+    {
+        Tracking = false;
+        return false;
+    }
+
+    Residual = best;
+    Tracking = false;
+
+    return true;
+}
+
+bool cVectorPoseSolver::Solve(const float *X, const float *Y, int Count, sResult &Result)
+{
+    int markers = mConstellation.Markers;
+
+    Result.Markers  = 0;
+    Result.Acquired = false;
+
+    if(!mSolver || Count<markers)
+    {
+        mTracking = false;
+        return false;
+    }
+
+    double rays[kMaxMarkers][3];
+
+    for(int i=0; i<markers; i++)
+    {
+        double x = (X[i] - mConstellation.PrincipalX)*mConstellation.InverseFocal;
+        double y = (Y[i] - mConstellation.PrincipalY)*mConstellation.InverseFocal;
+        double n = 1.0/sqrt(x*x + y*y + 1);
+
+        rays[i][0] = x*n;
+        rays[i][1] = y*n;
+        rays[i][2] = n;
+    }
+
+    //== tracking starts from where the depths are heading: where two poses fit the markers
+    //== equally their depths cross, and the prediction stays on the one it was following.
+    //== Tracking comes back false when the solver had to acquire.
+
+    bool   tracking = mTracking;
+    double last[kMaxMarkers];
+
+    for(int i=0; i<markers; i++)
+    {
+        last[i] = mDepth[i];
+
+        if(tracking)
+            mDepth[i] += mMotion[i];
+    }
+
+    if(!mSolver(mConstellation, rays, mDepth, tracking, Result.Residual))
+    {
+        mTracking = false;
+        return false;
+    }
+
+    for(int i=0; i<markers; i++)
+        mMotion[i] = tracking ? mDepth[i] - last[i] : 0.0;
+
+    Result.Acquired = !tracking;
+    mTracking       = true;
+
+    Result.Markers = markers;
+
+    for(int i=0; i<markers; i++)
+        for(int k=0; k<3; k++)
+            Result.Position[i][k] = mDepth[i]*rays[i][k];
+
+    //== frame: origin at marker 1, x towards marker 2, z normal to the first three ==--
+
+    double x[3], y[3], z[3], toThird[3];
+
+    for(int k=0; k<3; k++)
+    {
+        Result.Origin[k] = Result.Position[0][k];
+        x[k]             = Result.Position[1][k] - Result.Position[0][k];
+        toThird[k]       = Result.Position[2][k] - Result.Position[0][k];
+    }
+
+    z[0] = x[1]*toThird[2] - x[2]*toThird[1];
+    z[1] = x[2]*toThird[0] - x[0]*toThird[2];
+    z[2] = x[0]*toThird[1] - x[1]*toThird[0];
+
+    double xLength = sqrt(x[0]*x[0] + x[1]*x[1] + x[2]*x[2]);
+    double zLength = sqrt(z[0]*z[0] + z[1]*z[1] + z[2]*z[2]);
+
+    for(int k=0; k<3; k++)
+    {
+        x[k] /= xLength;
+        z[k] /= zLength;
+    }
+
+    y[0] = z[1]*x[2] - z[2]*x[1];
+    y[1] = z[2]*x[0] - z[0]*x[2];
+    y[2] = z[0]*x[1] - z[1]*x[0];
+
+    for(int k=0; k<3; k++)
+    {
+        Result.Rotation[3*k]     = x[k];
+        Result.Rotation[3*k + 1] = y[k];
+        Result.Rotation[3*k + 2] = z[k];
+    }
+
+    return true;
+}
+
+void cVectorPoseSolver::Benchmark(int Arrangement, int Frames, sBenchmark &Result)
+{
+    //== a 9 x 12 x 10 cm triangle; the clips' own distances come with their settings ==--
+
+    int markers = ArrangementMarkers(Arrangement);
+
+    Result.Markers               = markers;
+    Result.NanosecondsPerSolve   = 0;
+    Result.NanosecondsPerAcquire = 0;
+    Result.PositionError         = 0;
+    Result.Failures              = 1;
+
+    if(markers!=3)
+        return;
+
+    double distances[9] = { 0, 90, 120, 90, 0, 100, 120, 100, 0 };
+    double local[3][3]    = { { 0, 0, 0 }, { 90, 0, 0 }, { 0, 0, 0 } };
+
+    local[2][0] = (120*120 - 100*100 + 90*90)/(2.0*90);
+    local[2][1] = sqrt(120*120 - local[2][0]*local[2][0]);
+
+    sCamera camera;
+
+    camera.FocalLength = 1000;
+    camera.PrincipalX  = 320;
+    camera.PrincipalY  = 240;
+
+    cVectorPoseSolver solver;
+
+    solver.Dispatch(markers, distances, camera);
+
+    Run(solver, local, Frames, Result);
+}
+
+void cVectorPoseSolver::BenchmarkCustom(int Markers, int Frames, sBenchmark &Result)
+{
+    //== markers spread over a 12 cm box, at least 3 cm apart ==--
+
+    Markers = std::max(3, std::min(Markers, (int) kMaxMarkers));
+
+    cBenchmarkNoise random(1597334677u);
+    double local[kMaxMarkers][3];
+
+    for(int m=0; m<Markers; m++)
+    {
+        bool spaced = false;
+
+        while(!spaced)
+        {
+            for(int k=0; k<3; k++)
+                local[m][k] = 120*random.Uniform() - 60;
+
+            spaced = true;
+
+            for(int o=0; o<m && spaced; o++)
+            {
+                double squared = 0;
+
+                for(int k=0; k<3; k++)
+                    squared += (local[m][k] - local[o][k])*(local[m][k] - local[o][k]);
+
+                spaced = squared>=30*30;
+            }
+        }
+    }
+
+    double distances[kMaxMarkers*kMaxMarkers];
+
+    for(int i=0; i<Markers; i++)
+    {
+        for(int j=0; j<Markers; j++)
+        {
+            double squared = 0;
+
+            for(int k=0; k<3; k++)
+                squared += (local[i][k] - local[j][k])*(local[i][k] - local[j][k]);
+
+            distances[i*Markers + j] = sqrt(squared);
+        }
+    }
+
+    sCamera camera;
+
+    camera.FocalLength = 1000;
+    camera.PrincipalX  = 320;
+    camera.PrincipalY  = 240;
+
+    cVectorPoseSolver solver;
+
+    solver.Dispatch(Markers, distances, camera);
+
+    Result.Markers = Markers;
+
+    Run(solver, local, Frames, Result);
+}
+
+void cVectorPoseSolver::Run(cVectorPoseSolver &Solver, const double (*Local)[3], int Frames, sBenchmark &Result)
+{
+    const double kNoise = 0.05;             //== Pixels ===========================================----
+
+    int markers = Solver.mConstellation.Markers;
+
+    if(Frames<1)
+        Frames = 1;
+
+    cBenchmarkNoise random(1597334677u);
+    Core::cTimer    timer;
+
+    std::vector<float>  xs(Frames*markers), ys(Frames*markers);
+    std::vector<double> truth(Frames*markers*3);
+
+    for(int f=0; f<Frames; f++)
+    {
+        //== slow tumble, up to 40 degrees off facing the camera, 30 - 70 cm away ==--
+
+        double t     = f/120.0;
+        double yaw   = 0.7*sin(0.9*t);
+        double pitch = 0.5*sin(1.3*t + 1);
+        double roll  = 0.6*sin(0.7*t + 2);
+
+        double cy = cos(yaw),   sy = sin(yaw);
+        double cp = cos(pitch), sp = sin(pitch);
+        double cr = cos(roll),  sr = sin(roll);
+
+        double rotation[3][3] = { { cy*cr + sy*sp*sr, -cy*sr + sy*sp*cr, sy*cp },
+                                  { cp*sr,             cp*cr,            -sp    },
+                                  { -sy*cr + cy*sp*sr, sy*sr + cy*sp*cr,  cy*cp } };
+
+        double position[3] = { 80*sin(0.5*t), 60*sin(0.8*t + 1), 500 + 200*sin(0.3*t) };
+
+        for(int m=0; m<markers; m++)
+        {
+            double world[3];
+
+            for(int k=0; k<3; k++)
+            {
+                world[k] = position[k] + rotation[k][0]*Local[m][0] + rotation[k][1]*Local[m][1] + rotation[k][2]*Local[m][2];
+                truth[3*(f*markers + m) + k] = world[k];
+            }
+
+            xs[f*markers + m] = (float) (Solver.mConstellation.PrincipalX + world[0]/world[2]/Solver.mConstellation.InverseFocal + kNoise*random.Normal());
+            ys[f*markers + m] = (float) (Solver.mConstellation.PrincipalY + world[1]/world[2]/Solver.mConstellation.InverseFocal + kNoise*random.Normal());
+        }
+    }
+
+    //== tracking ==--
+
+    sResult result;
+
+    double error    = 0;
+    long   samples  = 0;
+    int    failures = 0;
+
+    Solver.Reset();
+    timer.CatchUp();
+
+    for(int f=0; f<Frames; f++)
+        Solver.Solve(&xs[f*markers], &ys[f*markers], markers, result);
+
+    Result.NanosecondsPerSolve = 1e9*timer.Elapsed()/Frames;
+
+    //== again for the errors, outside the timing ==--
+
+    Solver.Reset();
+
+    for(int f=0; f<Frames; f++)
+    {
+        bool   solved  = Solver.Solve(&xs[f*markers], &ys[f*markers], markers, result);
+        bool   wrong   = !solved;
+        double squared = 0;
+
+        for(int m=0; m<markers && solved; m++)
+        {
+            double marker = 0;
+
+            for(int k=0; k<3; k++)
+            {
+                double e = result.Position[m][k] - truth[3*(f*markers + m) + k];
+                marker  += e*e;
+            }
+
+            squared += marker;
+            wrong    = wrong || marker>25*25;
+        }
+
+        if(wrong)
+        {
+            failures++;
+            continue;
+        }
+
+        error   += squared;
+        samples += markers;
+    }
+
+    //== acquisition every frame ==--
+
+    timer.CatchUp();
+
+    for(int f=0; f<Frames; f++)
+    {
+        Solver.Reset();
+        Solver.Solve(&xs[f*markers], &ys[f*markers], markers, result);
+    }
+
+    Result.NanosecondsPerAcquire = 1e9*timer.Elapsed()/Frames;
+    Result.PositionError         = (samples>0) ? sqrt(error/samples) : 0.0;
+    Result.Failures              = (double) failures/Frames;
+}
@@ -0,0 +1,130 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Single camera clip pose: the 3D positions of a known marker constellation from its labeled
+//== 2D markers.  Every pair of marker rays f_i, f_j with depths l_i, l_j has to keep its distance:
+//==
+//==     l_i^2 + l_j^2 - 2 l_i l_j (f_i . f_j) = d_ij^2
+//==
+//==   - acquisition solves the first three markers in closed form (Grunert's quartic, up to four
+//==     poses), further markers are placed from those and everything is refined
+//==   - tracking starts from last frame's depths moved on by their last change and takes a few
+//==     Gauss-Newton steps over every pair, falling back to acquisition if they do not converge
+//==
+//== The solvers are templates on the marker count, so pair tables, normal equations and loops
+//== are fixed size.  cVectorSettings::Arrangement picks the instantiation (VectorClip and
+//== TrackClipPro are three marker clips) and SetCustom() any count up to kMaxMarkers; the choice
+//== is made once, when the settings are set, as is everything derived from the distances and
+//== the camera, so Solve() is one indirect call.
+//==
+//== Results are in the camera frame (x right, y down, z forward) in the units of the distances.
+//==
+
+#ifndef __CAMERALIBRARY__VECTORPOSESOLVER_H__
+#define __CAMERALIBRARY__VECTORPOSESOLVER_H__
+
+//== INCLUDES ===========================================================================================----
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cVectorSettings;
+
+    class cVectorPoseSolver
+    {
+    public:
+        static const int kMaxMarkers = 8;
+
+        struct sCamera
+        {
+            double  FocalLength;                //== Pixels ====================================----
+            double  PrincipalX;                 //== Pixels ====================================----
+            double  PrincipalY;
+        };
+
+        struct sResult
+        {
+            int     Markers;
+            double  Position[kMaxMarkers][3];   //== Camera frame ==============================----
+            double  Origin[3];                  //== Marker 1 ==================================----
+            double  Rotation[9];                //== Row major: x to marker 2, z off the plane =----
+            double  Residual;                   //== RMS pair distance error ===================----
+            bool    Acquired;                   //== Solved in closed form this frame ==========----
+        };
+
+        cVectorPoseSolver();
+
+        //== Distances and camera from the settings, solver by their Arrangement ==--
+
+        bool    SetSettings(const cVectorSettings &Settings);
+
+        //== Any constellation: Distances[i*Markers + j], symmetric, 3 - kMaxMarkers markers ==--
+
+        bool    SetCustom(int Markers, const double *Distances, const sCamera &Camera);
+
+        int     Markers() const                     { return mConstellation.Markers; }
+        void    Reset()                             { mTracking = false; }  //== Reacquire ===----
+
+        //== X, Y: the image markers (pixels) in constellation order.  False if there are too
+        //== few or no pose fits.
+
+        bool    Solve(const float *X, const float *Y, int Count, sResult &Result);
+
+        //== The constellation flying and turning in front of the camera with 0.05 px marker
+        //== noise.  Reports tracking and acquisition cost per solve and the position error.
+        //== Three markers can not tell a pose from its mirror tilt where the two meet (facing
+        //== the camera); frames spent on the mirror count as failures.
+
+        struct sBenchmark
+        {
+            int     Markers;
+            double  NanosecondsPerSolve;        //== Tracking ==================================----
+            double  NanosecondsPerAcquire;      //== Closed form from scratch ==================----
+            double  PositionError;              //== RMS, distance units, frames not failed ====----
+            double  Failures;                   //== Unsolved or off by 25+, of all frames =====----
+        };
+
+        static void Benchmark(int Arrangement, int Frames, sBenchmark &Result);
+        static void BenchmarkCustom(int Markers, int Frames, sBenchmark &Result);
+
+    private:
+        struct sConstellation
+        {
+            int     Markers;
+            double  Distance2[kMaxMarkers][kMaxMarkers];    //== Squared ========================----
+
+            //== Grunert's ratios for markers 1, 2, 3: a = d23, b = d13, c = d12 ==--
+
+            double  Difference;                 //== (a^2 - c^2) / b^2 =========================----
+            double  SumRatio;                   //== (a^2 + c^2) / b^2 =========================----
+            double  A2;                         //== a^2 / b^2 =================================----
+            double  C2;                         //== c^2 / b^2 =================================----
+            double  B2;                         //== b^2 ======================================----
+
+            double  InverseFocal;
+            double  PrincipalX;
+            double  PrincipalY;
+        };
+
+        typedef bool (*tSolver)(const sConstellation &Constellation, const double (*Rays)[3],
+                                double *Depth, bool &Tracking, double &Residual);
+
+        template<int Markers> static bool Solve(const sConstellation &Constellation, const double (*Rays)[3],
+                                                double *Depth, bool &Tracking, double &Residual);
+
+        bool    Dispatch(int Markers, const double *Distances, const sCamera &Camera);
+
+        static void Run(cVectorPoseSolver &Solver, const double (*Local)[3], int Frames, sBenchmark &Result);
+
+        sConstellation              mConstellation;
+        tSolver                     mSolver;
+        bool                        mTracking;
+        double                      mDepth[kMaxMarkers];
+        double                      mMotion[kMaxMarkers];   //== Depth change last frame ====----
+    };
+}
+
+#endif
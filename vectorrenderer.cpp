@@ -0,0 +1,189 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <windows.h>
+#include <stddef.h>
+#include <gl/gl.h>
+
+#include "vectorrenderer.h"
+#include "modulevectorprocessing.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    const int kMaxMarkers = 1024;               //== ~520k edges, indices stay 16-bit ==========----
+
+    //== OpenGL 1.5 buffer objects, opengl32.dll only exports 1.1 ==--
+
+    const GLenum kArrayBuffer        = 0x8892;  //== GL_ARRAY_BUFFER ============================----
+    const GLenum kElementArrayBuffer = 0x8893;  //== GL_ELEMENT_ARRAY_BUFFER ====================----
+    const GLenum kStaticDraw         = 0x88E4;  //== GL_STATIC_DRAW =============================----
+    const GLenum kDynamicDraw        = 0x88E8;  //== GL_DYNAMIC_DRAW ============================----
+
+    typedef void (APIENTRY *GenBuffersProc)   (GLsizei Count, GLuint *Buffers);
+    typedef void (APIENTRY *DeleteBuffersProc)(GLsizei Count, const GLuint *Buffers);
+    typedef void (APIENTRY *BindBufferProc)   (GLenum Target, GLuint Buffer);
+    typedef void (APIENTRY *BufferDataProc)   (GLenum Target, ptrdiff_t Size, const void *Data, GLenum Usage);
+    typedef void (APIENTRY *BufferSubDataProc)(GLenum Target, ptrdiff_t Offset, ptrdiff_t Size, const void *Data);
+
+    GenBuffersProc    glGenBuffersPtr    = 0;
+    DeleteBuffersProc glDeleteBuffersPtr = 0;
+    BindBufferProc    glBindBufferPtr    = 0;
+    BufferDataProc    glBufferDataPtr    = 0;
+    BufferSubDataProc glBufferSubDataPtr = 0;
+
+    bool LoadBufferObjects()
+    {
+        glGenBuffersPtr    = (GenBuffersProc)    wglGetProcAddress("glGenBuffers");
+        glDeleteBuffersPtr = (DeleteBuffersProc) wglGetProcAddress("glDeleteBuffers");
+        glBindBufferPtr    = (BindBufferProc)    wglGetProcAddress("glBindBuffer");
+        glBufferDataPtr    = (BufferDataProc)    wglGetProcAddress("glBufferData");
+        glBufferSubDataPtr = (BufferSubDataProc) wglGetProcAddress("glBufferSubData");
+
+        return glGenBuffersPtr && glDeleteBuffersPtr && glBindBufferPtr && glBufferDataPtr && glBufferSubDataPtr;
+    }
+}
+
+cVectorRenderer::cVectorRenderer()
+    : mMarkerCount(0)
+    , mEdgeMarkers(0)
+    , mInitialized(false)
+    , mBufferObjects(false)
+    , mEdgesUploaded(false)
+    , mVertexBuffer(0)
+    , mIndexBuffer(0)
+    , mVertexCapacity(0)
+{
+}
+
+cVectorRenderer::~cVectorRenderer()
+{
+    if(mBufferObjects)
+    {
+        GLuint buffers[2] = { mVertexBuffer, mIndexBuffer };
+
+        glDeleteBuffersPtr(2, buffers);
+    }
+}
+
+int cVectorRenderer::ExportVertices(cModuleVectorProcessing *Processor, float *Vertices, int MaxMarkers, float Scale)
+{
+    int count = Processor->MarkerCount();
+
+    if(count>MaxMarkers)
+        count = MaxMarkers;
+
+    for(int i=0; i<count; i++)
+    {
+        float *vertex = Vertices + i*3;
+
+        Processor->GetResult(i, vertex[0], vertex[1], vertex[2]);
+
+        vertex[0] *= Scale;
+        vertex[1] *= Scale;
+        vertex[2] *= Scale;
+    }
+
+    return count;
+}
+
+void cVectorRenderer::Update(cModuleVectorProcessing *Processor, float Scale)
+{
+    int count = Processor->MarkerCount();
+
+    if(count>kMaxMarkers)
+        count = kMaxMarkers;
+
+    if((int) mVertices.size()<count*3)
+        mVertices.resize(count*3);
+
+    mMarkerCount = (count>0) ? ExportVertices(Processor, &mVertices[0], count, Scale) : 0;
+
+    if(mMarkerCount!=mEdgeMarkers)
+        BuildEdges(mMarkerCount);
+}
+
+void cVectorRenderer::BuildEdges(int Markers)
+{
+    mEdges.clear();
+    mEdges.reserve(Markers*(Markers-1));
+
+    for(int i=0; i<Markers; i++)
+    {
+        for(int j=i+1; j<Markers; j++)
+        {
+            mEdges.push_back((unsigned short) i);
+            mEdges.push_back((unsigned short) j);
+        }
+    }
+
+    mEdgeMarkers   = Markers;
+    mEdgesUploaded = false;
+}
+
+void cVectorRenderer::CreateBuffers()
+{
+    mInitialized   = true;
+    mBufferObjects = LoadBufferObjects();
+
+    if(!mBufferObjects)
+        return;
+
+    GLuint buffers[2] = { 0, 0 };
+
+    glGenBuffersPtr(2, buffers);
+
+    mVertexBuffer = buffers[0];
+    mIndexBuffer  = buffers[1];
+}
+
+void cVectorRenderer::Draw()
+{
+    if(!mInitialized)
+        CreateBuffers();
+
+    if(mEdges.empty())
+        return;
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+
+    if(mBufferObjects)
+    {
+        //== vertices change every frame, edges only with the marker count ==--
+
+        glBindBufferPtr(kArrayBuffer, mVertexBuffer);
+
+        if(mMarkerCount*3>mVertexCapacity)
+        {
+            mVertexCapacity = (int) mVertices.capacity();
+            glBufferDataPtr(kArrayBuffer, mVertexCapacity*sizeof(float), 0, kDynamicDraw);
+        }
+
+        glBufferSubDataPtr(kArrayBuffer, 0, mMarkerCount*3*sizeof(float), &mVertices[0]);
+
+        glBindBufferPtr(kElementArrayBuffer, mIndexBuffer);
+
+        if(!mEdgesUploaded)
+        {
+            glBufferDataPtr(kElementArrayBuffer, mEdges.size()*sizeof(unsigned short), &mEdges[0], kStaticDraw);
+            mEdgesUploaded = true;
+        }
+
+        glVertexPointer(3, GL_FLOAT, 0, 0);
+        glDrawElements(GL_LINES, (GLsizei) mEdges.size(), GL_UNSIGNED_SHORT, 0);
+
+        //== leave immediate mode drawing elsewhere unaffected ==--
+
+        glBindBufferPtr(kArrayBuffer, 0);
+        glBindBufferPtr(kElementArrayBuffer, 0);
+    }
+    else
+    {
+        glVertexPointer(3, GL_FLOAT, 0, &mVertices[0]);
+        glDrawElements(GL_LINES, (GLsizei) mEdges.size(), GL_UNSIGNED_SHORT, &mEdges[0]);
+    }
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
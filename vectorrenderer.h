@@ -0,0 +1,66 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Batched drawing of cModuleVectorProcessing results.  Update() copies every marker position
+//== into a vertex array in one pass and Draw() renders a line between each marker pair (i<j,
+//== every edge once) with a single glDrawElements call from persistent buffer objects.  The
+//== index buffer is only rebuilt when the marker count changes.
+//==
+//== Buffer objects are OpenGL 1.5; when the driver doesn't expose them the same arrays are drawn
+//== as client side vertex arrays.  Draw() and the destructor need the GL context current.
+//==
+
+#ifndef __CAMERALIBRARY__VECTORRENDERER_H__
+#define __CAMERALIBRARY__VECTORRENDERER_H__
+
+//== INCLUDES ===========================================================================================----
+
+#include <vector>
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cModuleVectorProcessing;
+
+    class cVectorRenderer
+    {
+    public:
+        cVectorRenderer();
+        ~cVectorRenderer();
+
+        //== x,y,z per marker times Scale, returns markers written ==--
+
+        static int ExportVertices(cModuleVectorProcessing *Processor, float *Vertices, int MaxMarkers,
+                                  float Scale = 1.0f);
+
+        void    Update(cModuleVectorProcessing *Processor, float Scale = 1.0f/200);
+        void    Draw();
+
+        int     MarkerCount() const                 { return mMarkerCount; }
+        int     EdgeCount() const                   { return (int) mEdges.size()/2; }
+        const float * Vertices() const              { return mVertices.empty() ? 0 : &mVertices[0]; }
+
+        bool    UsingBufferObjects() const          { return mBufferObjects; }
+
+    private:
+        void    BuildEdges(int Markers);
+        void    CreateBuffers();
+
+        std::vector<float>          mVertices;
+        std::vector<unsigned short> mEdges;
+        int                         mMarkerCount;
+        int                         mEdgeMarkers;       //== Marker count mEdges was built for -
+
+        bool                        mInitialized;
+        bool                        mBufferObjects;
+        bool                        mEdgesUploaded;
+        unsigned int                mVertexBuffer;
+        unsigned int                mIndexBuffer;
+        int                         mVertexCapacity;    //== Floats allocated in mVertexBuffer -
+    };
+}
+
+#endif
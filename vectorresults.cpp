@@ -0,0 +1,87 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#include "vectorresults.h"
+#include "modulevectorprocessing.h"
+#include "Core/RotationVector.h"
+
+using namespace CameraLibrary;
+
+namespace
+{
+    const double kDegreesToRadians = 3.14159265358979323846/180;
+
+    //== no implicit padding, so 32 and 64-bit processes agree on the layout ==--
+
+    typedef char TimeStampAlignment[(offsetof(sVectorResults, TimeStamp) % 8)==0 ? 1 : -1];
+    typedef char SizeAlignment     [(sizeof(sVectorResults) % 8)==0 ? 1 : -1];
+}
+
+void CameraLibrary::OrientationToQuaternion(double Yaw, double Pitch, double Roll, double Quaternion[4])
+{
+    double yaw   = Yaw  *kDegreesToRadians*0.5;
+    double pitch = Pitch*kDegreesToRadians*0.5;
+    double roll  = Roll *kDegreesToRadians*0.5;
+
+    double qYaw  [4] = { 0,           sin(yaw), 0,         cos(yaw)   };
+    double qPitch[4] = { sin(pitch),  0,        0,         cos(pitch) };
+    double qRoll [4] = { 0,           0,        sin(roll), cos(roll)  };
+
+    double yawPitch[4];
+
+    Core::MultiplyQuaternions(qYaw, qPitch, yawPitch);
+    Core::MultiplyQuaternions(yawPitch, qRoll, Quaternion);
+}
+
+void CameraLibrary::QuaternionToOrientation(const double Quaternion[4], double &Yaw, double &Pitch, double &Roll)
+{
+    double x = Quaternion[0];
+    double y = Quaternion[1];
+    double z = Quaternion[2];
+    double w = Quaternion[3];
+
+    //== rotation matrix entries of R = Ry(yaw) * Rx(pitch) * Rz(roll) ==--
+
+    double m02 = 2*(x*z + w*y);
+    double m22 = 1 - 2*(x*x + y*y);
+    double m12 = 2*(y*z - w*x);
+    double m10 = 2*(x*y + w*z);
+    double m11 = 1 - 2*(x*x + z*z);
+
+    if(m12> 1) m12 =  1;
+    if(m12<-1) m12 = -1;
+
+    Yaw   = atan2(m02, m22)/kDegreesToRadians;
+    Pitch = asin(-m12)/kDegreesToRadians;
+    Roll  = atan2(m10, m11)/kDegreesToRadians;
+}
+
+bool CameraLibrary::ExportResults(cModuleVectorProcessing *Processor, sVectorResults *Results, int FrameID, double TimeStamp)
+{
+    memset(Results, 0, sizeof(sVectorResults));
+
+    Results->Version   = kVectorResultsVersion;
+    Results->Size      = sizeof(sVectorResults);
+    Results->FrameID   = FrameID;
+    Results->TimeStamp = TimeStamp;
+
+    Processor->GetPosition   (Results->Position[0],    Results->Position[1],    Results->Position[2]);
+    Processor->GetOrientation(Results->Orientation[0], Results->Orientation[1], Results->Orientation[2]);
+
+    OrientationToQuaternion(Results->Orientation[0], Results->Orientation[1], Results->Orientation[2],
+                            Results->Quaternion);
+
+    int count = Processor->MarkerCount();
+
+    Results->MarkerCount = (count<kVectorResultsMaxMarkers) ? count : kVectorResultsMaxMarkers;
+
+    for(int i=0; i<Results->MarkerCount; i++)
+        Processor->GetResult(i, Results->Markers[i][0], Results->Markers[i][1], Results->Markers[i][2]);
+
+    return count<=kVectorResultsMaxMarkers;
+}
@@ -0,0 +1,56 @@
+//======================================================================================================-----
+//== Copyright NaturalPoint, All Rights Reserved
+//======================================================================================================-----
+
+//==
+//== Snapshot of cModuleVectorProcessing output.  ExportResults() fills a plain, fixed layout
+//== struct with everything the per-value getters return (markers, position, orientation as
+//== yaw/pitch/roll and as a quaternion) plus the frame it came from, so a consumer can copy it
+//== into shared memory or a ring buffer and readers see one consistent frame.
+//==
+//== The layout only ever grows at the end.  Version is bumped when fields are added and Size is
+//== the struct size of the writer, so a reader built against an older header can still use the
+//== fields it knows about.
+//==
+
+#ifndef __CAMERALIBRARY__VECTORRESULTS_H__
+#define __CAMERALIBRARY__VECTORRESULTS_H__
+
+//== INCLUDES ===========================================================================================----
+
+//== GLOBAL DEFINITIONS AND SETTINGS ====================================================================----
+
+namespace CameraLibrary
+{
+    class cModuleVectorProcessing;
+
+    const unsigned int kVectorResultsVersion    = 1;
+    const int          kVectorResultsMaxMarkers = 32;
+
+    struct sVectorResults
+    {
+        unsigned int Version;                   //== kVectorResultsVersion of the writer ======----
+        unsigned int Size;                      //== sizeof(sVectorResults) of the writer =====----
+        int          FrameID;
+        int          MarkerCount;
+        double       TimeStamp;                 //== Seconds ==================================----
+
+        double       Position[3];               //== GetPosition() X, Y, Z ====================----
+        double       Orientation[3];            //== GetOrientation() yaw, pitch, roll, degrees -
+        double       Quaternion[4];             //== x, y, z, w of the same orientation =======----
+
+        float        Markers[kVectorResultsMaxMarkers][3];  //== GetResult() per marker =======----
+    };
+
+    //== Fill Results from Processor's latest calculation, false if markers didn't all fit ==--
+
+    bool ExportResults(cModuleVectorProcessing *Processor, sVectorResults *Results, int FrameID, double TimeStamp);
+
+    //== Orientation convention used for sVectorResults::Quaternion, yaw about Y, then pitch
+    //== about X, then roll about Z (q = yaw * pitch * roll), angles in degrees.
+
+    void OrientationToQuaternion(double Yaw, double Pitch, double Roll, double Quaternion[4]);
+    void QuaternionToOrientation(const double Quaternion[4], double &Yaw, double &Pitch, double &Roll);
+}
+
+#endif